@@ -61,6 +61,8 @@ int convert_file( std::string filename, std::vector<std::string> selected_files,
       //parser->select_sheet(sheets.back());
 			//parser->select_sheet(sheets.size() - 1);
 		}
+    // Column types are inferred from all rows while they are loaded
+    parser->set_streaming_inference( true );
     if ( parser->infer_schema() ) {
       Schema* schema = parser->get_schema();
 
@@ -70,19 +72,28 @@ int convert_file( std::string filename, std::vector<std::string> selected_files,
         if ( parser->open() ) {
           std::cout << "file successfully opened. Parsing/loading data..." << std::endl;
           table->set_ingested_status( STATUS_PROCESSING );
-          Row row;
+          RowBatch batch;
           int percentage = 0;
           int prev_percentage = 0;
-          while ( ( parser->get_next_row( row ) ) && table->get_ingested_status() == STATUS_PROCESSING ) {
-            table->append_row( row );
+          unsigned widen_count = schema->widen_count;
+          while ( ( parser->get_next_batch( batch ) ) && table->get_ingested_status() == STATUS_PROCESSING ) {
+            // Convert the rows loaded so far only when streaming inference widened some columns
+            if ( schema->widen_count != widen_count ) {
+              table->update_column_types( *schema );
+              widen_count = schema->widen_count;
+            }
+            table->append_batch( batch );
             prev_percentage = parser->get_percent_complete();
             if ( percentage < prev_percentage ) {
               percentage = prev_percentage;
               percentage_callback( percentage );
             }
           }
-          std::cout << "data successfully loaded!" << std::endl;
           parser->close();
+          if ( schema->status == STATUS_INVALID_FILE ) {
+            return 2;
+          }
+          std::cout << "data successfully loaded!" << std::endl;
 
           // Shrink column data type sizes if possible
           table->shrink_columns( );
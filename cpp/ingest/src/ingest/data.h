@@ -119,7 +119,14 @@ public:
   virtual int32_t get_list_element_count() const = 0;
 
   // Append a new element
-  virtual void append( ValueType value, bool isnull ) = 0;
+  virtual void append( const ValueType& value, bool isnull ) = 0;
+
+  // Append a batch of elements (one per flag, values of null elements are default-constructed)
+  virtual void append_batch( std::vector<ValueType> const& values, std::vector<bool> const& flagmap ) {
+    for ( size_t idx = 0; idx < values.size(); idx++ ) {
+      this->append( values[idx], !flagmap[idx] );
+    }
+  }
 
   // Offsets
   std::vector<int32_t> const& get_offsets_ref() const { return this->offsets_; }
@@ -198,7 +205,7 @@ public:
 
   virtual int32_t get_list_element_count() const override { return this->get_element_count(); }
 
-  virtual void append( typename Data<TLogicalType>::ValueType value, bool isnull ) override {
+  virtual void append( const typename Data<TLogicalType>::ValueType& value, bool isnull ) override {
     if ( ( this->get_array_buffer_size_in_bytes() + sizeof( typename Data<TLogicalType>::ValueType ) ) <= INT32_MAX ) {
       pack_bool_in_uint8_vector( !isnull, this->get_element_count(), this->nullbitmap_ );
       if ( isnull ) {
@@ -211,6 +218,25 @@ public:
                 << std::endl;
     }
   }
+
+  virtual void append_batch( std::vector<typename Data<TLogicalType>::ValueType> const& values,
+                             std::vector<bool> const& flagmap ) override {
+    if ( ( this->get_array_buffer_size_in_bytes() + values.size() * sizeof( typename Data<TLogicalType>::ValueType ) ) <=
+         INT32_MAX ) {
+      for ( size_t idx = 0; idx < values.size(); idx++ ) {
+        pack_bool_in_uint8_vector( flagmap[idx], this->get_element_count() + static_cast<int32_t>( idx ), this->nullbitmap_ );
+        if ( !flagmap[idx] ) {
+          this->nullcount_++;
+        }
+      }
+      // copy the whole batch at once
+      this->array_.insert( this->array_.end(), values.begin(), values.end() );
+    } else {
+      std::cerr << "[Error]FlatData::append_batch(): can't add new values to the data buffer as it would grow it "
+                   "above the maximum 2GB allowed size"
+                << std::endl;
+    }
+  }
 };
 
 typedef FlatData<DateType> DateData;
@@ -242,7 +268,7 @@ public:
   virtual int32_t get_list_element_count() const override { return this->get_element_count(); }
 
   // Append an element (LogicalType::NativeType)
-  virtual void append( BooleanType::ValueType /* bool */ value, bool isnull ) override {
+  virtual void append( const BooleanType::ValueType& /* bool */ value, bool isnull ) override {
     pack_bool_in_uint8_vector( !isnull, this->get_element_count(), this->nullbitmap_ );
     if ( isnull ) {
       this->nullcount_++;
@@ -281,15 +307,14 @@ public:
 
   virtual int32_t get_list_element_count() const override { return this->get_element_count(); }
 
-  virtual void append( StringType::ValueType /* std::string */ value, bool isnull ) override {
+  virtual void append( const StringType::ValueType& /* std::string */ value, bool isnull ) override {
     if ( ( value.size() + array_.size() ) <= INT32_MAX ) {
       pack_bool_in_uint8_vector( !isnull, this->get_element_count(), this->nullbitmap_ );
       if ( isnull ) {
         this->nullcount_++;
       }
       // do the copy
-      std::copy( value.c_str(), value.c_str() + static_cast<int32_t>( value.size() ),
-                 std::back_inserter( this->array_ ) );
+      this->array_.insert( this->array_.end(), value.begin(), value.end() );
       // store offset
       this->offsets_.push_back( static_cast<int32_t>( this->array_.size() ) );
     } else {
@@ -298,6 +323,25 @@ public:
                 << std::endl;
     }
   }
+
+  // Append a batch of strings stored one after another (the layout is the same, so the characters are copied at once)
+  void append_batch( StringBatch const& values, std::vector<bool> const& flagmap ) {
+    if ( ( values.chars.size() + array_.size() ) <= INT32_MAX ) {
+      int32_t base_offset = static_cast<int32_t>( this->array_.size() );
+      for ( size_t idx = 0; idx < values.size(); idx++ ) {
+        pack_bool_in_uint8_vector( flagmap[idx], this->get_element_count(), this->nullbitmap_ );
+        if ( !flagmap[idx] ) {
+          this->nullcount_++;
+        }
+        this->offsets_.push_back( base_offset + static_cast<int32_t>( values.ends[idx] ) );
+      }
+      this->array_.insert( this->array_.end(), values.chars.begin(), values.chars.end() );
+    } else {
+      std::cerr << "[Error]StringData::append_batch(): can't add new values to the data buffer as it would grow it "
+                   "above the maximum 2GB allowed size"
+                << std::endl;
+    }
+  }
 };
 
 template<typename TLogicalType>
@@ -322,13 +366,13 @@ public:
 
   virtual int32_t get_list_element_count() const override { return static_cast<int32_t>( this->array_.size() ); }
 
-  virtual void append( typename Data<TLogicalType>::ValueType value, bool isnull ) override {
+  virtual void append( const typename Data<TLogicalType>::ValueType& value, bool isnull ) override {
     if ( ( this->get_array_buffer_size_in_bytes() + sizeof( typename Data<TLogicalType>::ValueType ) ) <= INT32_MAX ) {
       pack_bool_in_uint8_vector( !isnull, this->get_element_count(), this->nullbitmap_ );
       if ( isnull ) {
         this->nullcount_++;
       } else {
-        for ( auto v : value ) {
+        for ( auto const& v : value ) {
           this->array_.push_back( std::get<typename Data<TLogicalType>::ArrayType>( v ) );
         }
       }
@@ -370,12 +414,12 @@ public:
   virtual int32_t get_list_element_count() const override { return this->count_; }
 
   // Append an element (LogicalType::NativeType)
-  virtual void append( ListBooleanType::ValueType /* std::vector<Cell> */ value, bool isnull ) override {
+  virtual void append( const ListBooleanType::ValueType& /* std::vector<Cell> */ value, bool isnull ) override {
     pack_bool_in_uint8_vector( !isnull, this->get_element_count(), this->nullbitmap_ );
     if ( isnull ) {
       this->nullcount_++;
     } else {
-      for ( auto v : value ) {
+      for ( auto const& v : value ) {
         bool bv = std::get<bool>( v );
         pack_bool_in_uint8_vector( bv, this->get_list_element_count(), this->array_ );
         this->count_++;
@@ -417,17 +461,16 @@ public:
     return static_cast<int32_t>( this->sub_offsets_.size() - 1 );
   }
 
-  virtual void append( ListStringType::ValueType /* std::vector<Cell> */ value, bool isnull ) override {
+  virtual void append( const ListStringType::ValueType& /* std::vector<Cell> */ value, bool isnull ) override {
     if ( ( value.size() + array_.size() ) <= INT32_MAX ) {
       pack_bool_in_uint8_vector( !isnull, this->get_element_count(), this->nullbitmap_ );
       if ( isnull ) {
         this->nullcount_++;
       }
-      for ( auto v : value ) {
-        std::string str_v = std::get<std::string>( v );
+      for ( auto const& v : value ) {
+        std::string const& str_v = std::get<std::string>( v );
         // do the copy
-        std::copy( str_v.c_str(), str_v.c_str() + static_cast<int32_t>( str_v.size() ),
-                   std::back_inserter( this->array_ ) );
+        this->array_.insert( this->array_.end(), str_v.begin(), str_v.end() );
         // store sub offset
         this->sub_offsets_.push_back( static_cast<int32_t>( this->array_.size() ) );
       }
@@ -465,7 +508,7 @@ public:
 
   virtual int32_t get_list_element_count() const override { return this->get_element_count(); }
 
-  virtual void append( ErrorsType::ValueType /* std::unordered_map<int, ErrorType> */ value, bool isnull ) override {
+  virtual void append( const ErrorsType::ValueType& /* std::unordered_map<int, ErrorType> */ value, bool isnull ) override {
     std::string str_value = "";
     auto error_size = value.size();
     if ( error_size > 0 ) {
@@ -0,0 +1,74 @@
+//
+// Native handover of an Ingest::Table to perspective, without building an Arrow table in Javascript
+//
+
+#ifndef DATADOCS_INGEST_PERSPECTIVE_TABLE_H
+#define DATADOCS_INGEST_PERSPECTIVE_TABLE_H
+
+// STD
+#include <cstdint>  // uint32_t, int16_t
+#include <memory>   // std::shared_ptr
+#include <utility>  // std::move
+#include <string>   // std::string
+#include <vector>   // std::vector
+
+// perspective
+#include <perspective/column_buffers.h>  // t_column_buffers, make_table_from_buffers
+
+// Ingest
+#include "table.h"  // Table
+
+namespace Ingest {
+
+// Same mapping as get_perspective_type() in perspective.js
+inline perspective::t_dtype get_perspective_dtype( LogicalTypeId type_id ) {
+  switch ( type_id ) {
+    case LogicalTypeId::Boolean: return perspective::DTYPE_BOOL;
+    case LogicalTypeId::Integer: return perspective::DTYPE_INT64;
+    case LogicalTypeId::Integer32: return perspective::DTYPE_INT32;
+    case LogicalTypeId::Integer16: return perspective::DTYPE_INT16;
+    case LogicalTypeId::Integer8: return perspective::DTYPE_INT8;
+    case LogicalTypeId::Decimal: return perspective::DTYPE_FLOAT64;
+    case LogicalTypeId::Date: return perspective::DTYPE_DATE;
+    case LogicalTypeId::Time: return perspective::DTYPE_DURATION;
+    case LogicalTypeId::Datetime: return perspective::DTYPE_TIME;
+    case LogicalTypeId::ListInteger: return perspective::DTYPE_LIST_INT64;
+    case LogicalTypeId::ListDecimal: return perspective::DTYPE_LIST_FLOAT64;
+    case LogicalTypeId::ListDatetime: return perspective::DTYPE_LIST_TIME;
+    case LogicalTypeId::ListDate: return perspective::DTYPE_LIST_DATE;
+    case LogicalTypeId::ListTime: return perspective::DTYPE_LIST_DURATION;
+    case LogicalTypeId::ListBoolean: return perspective::DTYPE_LIST_BOOL;
+    case LogicalTypeId::ListString: return perspective::DTYPE_LIST_STR;
+    default: return perspective::DTYPE_STR;  // String, Error
+  }
+}
+
+// Views on the buffers of the table columns, valid as long as the table is not modified
+inline std::vector<perspective::t_column_buffers> get_perspective_buffers( Table const& table ) {
+  std::vector<perspective::t_column_buffers> columns;
+  for ( int16_t idx = 0; idx < table.get_column_count(); idx++ ) {
+    perspective::t_column_buffers buffers;
+    buffers.m_name = table.get_column_name( idx );
+    buffers.m_dtype = get_perspective_dtype( table.get_column_type( idx ) );
+    buffers.m_validity = table.get_column_null_count( idx ) > 0 ? table.get_column_nullbitmap_buffer( idx ) : nullptr;
+    buffers.m_values = table.get_column_array_buffer( idx );
+    buffers.m_offsets = table.get_column_offsets_buffer( idx );
+    buffers.m_sub_offsets = table.get_column_sub_offsets_buffer( idx );
+    columns.push_back( std::move( buffers ) );
+  }
+  return columns;
+}
+
+// Loads the table into a new gnode of the pool: fixed-width columns are copied in bulk
+// and string columns are interned straight from the StringData buffers
+inline std::shared_ptr<perspective::t_gnode> make_perspective_table( perspective::t_pool* pool,
+                                                                     Table const& table,
+                                                                     std::string const& index = "",
+                                                                     std::uint32_t limit = 4294967295 ) {
+  perspective::t_uindex nrows = table.get_column_count() > 0 ? table.get_column_element_count( 0 ) : 0;
+  return perspective::make_table_from_buffers( pool, get_perspective_buffers( table ), nrows, index, limit );
+}
+
+}  // namespace Ingest
+
+#endif  // DATADOCS_INGEST_PERSPECTIVE_TABLE_H
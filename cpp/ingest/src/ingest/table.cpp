@@ -10,6 +10,7 @@
 #include <iostream>  // std::cout, std::endl
 #include <string>    // std::string
 #include <utility>   // std::move
+#include <type_traits>  // std::disjunction, std::is_same
 #include <variant>   // std::visit, std::get, std::holds_alternative
 
 // ingest_parser
@@ -26,6 +27,7 @@ Ingest::Table::Table( Schema const& schema ) {
     }
 
     this->column_names_.push_back( coldef.column_name );
+    this->column_definitions_.push_back( coldef );
 
     switch ( coldef.column_type ) {
       case LogicalTypeId::Boolean: {
@@ -108,6 +110,7 @@ Ingest::Table::Table( Schema const& schema ) {
 
     column_number++;
   }
+  this->source_texts_.resize( this->columns_.size() );
 }
 
 template<typename T>
@@ -115,7 +118,39 @@ void feed_cell_into_data( T& data, Ingest::Cell const& cell, bool filled ) {
   // A cell is considered to be "really filled" if it is filled (row flag is "true") AND the cell type matches the
   // column data type
   const bool really_filled = filled && std::holds_alternative<typename T::ValueType>( cell );
-  data.append( really_filled ? std::get<typename T::ValueType>( cell ) : typename T::ValueType(), !really_filled );
+  // no conditional operator here, it would copy the value
+  if ( really_filled ) {
+    data.append( std::get<typename T::ValueType>( cell ), false );
+  } else {
+    data.append( typename T::ValueType(), true );
+  }
+}
+
+// true if T is one of the alternatives of the variant TVariant
+template<typename T, typename TVariant>
+struct is_variant_alternative;
+
+template<typename T, typename... Ts>
+struct is_variant_alternative<T, std::variant<Ts...>> : std::disjunction<std::is_same<T, Ts>...> {};
+
+template<typename T>
+void feed_batch_into_data( T& data, Ingest::ColumnBatch const& column, size_t size ) {
+  typedef typename T::ValueType ValueType;
+  // The batch holds the values in the same native type as the cells (see feed_cell_into_data)
+  if constexpr ( std::is_same_v<ValueType, std::string> ) {
+    if ( auto values = std::get_if<Ingest::StringBatch>( &column.values ) ) {
+      data.append_batch( *values, column.flagmap );
+      return;
+    }
+  } else if constexpr ( is_variant_alternative<std::vector<ValueType>, Ingest::ColumnBatch::Values>::value ) {
+    if ( auto values = std::get_if<std::vector<ValueType>>( &column.values ) ) {
+      data.append_batch( *values, column.flagmap );
+      return;
+    }
+  }
+  for ( size_t idx = 0; idx < size; idx++ ) {
+    data.append( ValueType(), true );
+  }
 }
 
 // Append a Row to Table
@@ -144,6 +179,121 @@ void Ingest::Table::append_row( Row const& row ) {
   }
 }
 
+// Append a RowBatch to Table
+void Ingest::Table::append_batch( RowBatch const& batch ) {
+  int16_t column_number = 0;
+  for ( ColumnData& column : columns_ ) {
+    if ( ( column_number + 1 ) > INT16_MAX ) {
+      std::cerr << "Error: too many columns..." << std::endl;
+      break;
+    }
+
+    ColumnBatch const& column_batch = batch.columns[column_number];
+    int32_t offset = get_column_element_count( column_number );
+    for ( auto const& text : column_batch.source_text ) {
+      source_texts_[column_number].emplace_back( offset + static_cast<int32_t>( text.first ), text.second );
+    }
+    // One dispatch per column instead of one per cell
+    std::visit( [&column_batch, &batch]( auto& data ) { feed_batch_into_data( data, column_batch, batch.size ); },
+                column );
+
+    column_number++;
+  }
+}
+
+// Empty data of a column which is not a list, the types streaming inference may widen a column to
+static Ingest::ColumnData make_widened_data( Ingest::ColumnDefinition const& coldef ) {
+  switch ( coldef.column_type ) {
+    case Ingest::LogicalTypeId::Boolean:
+      return Ingest::BooleanData();
+    case Ingest::LogicalTypeId::Integer:
+      return Ingest::IntegerData();
+    case Ingest::LogicalTypeId::Decimal:
+      return Ingest::DecimalData();
+    case Ingest::LogicalTypeId::Date:
+      return Ingest::DateData();
+    case Ingest::LogicalTypeId::Time:
+      return Ingest::TimeData();
+    case Ingest::LogicalTypeId::Datetime:
+      return Ingest::DateTimeData();
+    default:
+      return Ingest::StringData();
+  }
+}
+
+// Read the element idx of a column which is not a list into cell, returns false if it is NULL
+template<typename T>
+bool get_cell_from_data( T const& data, int32_t idx, Ingest::Cell& cell ) {
+  auto const& nullbitmap = data.get_nullbitmap_ref();
+  if ( !( nullbitmap[idx / 8] & ( 1 << ( idx % 8 ) ) ) ) {
+    return false;
+  }
+  if constexpr ( std::is_same_v<T, Ingest::BooleanData> ) {
+    cell = static_cast<bool>( data.get_array_ref()[idx / 8] & ( 1 << ( idx % 8 ) ) );
+  } else if constexpr ( std::is_same_v<T, Ingest::StringData> ) {
+    auto const& offsets = data.get_offsets_ref();
+    auto const& array = data.get_array_ref();
+    cell.emplace<std::string>( array.begin() + offsets[idx], array.begin() + offsets[idx + 1] );
+  } else if constexpr ( std::is_same_v<typename T::ValueType, typename T::ArrayType> ) {
+    cell = data.get_array_ref()[idx];
+  } else {
+    return false;  // lists and errors are never widened
+  }
+  return true;
+}
+
+// Convert the data of widened columns
+void Ingest::Table::update_column_types( Schema const& schema ) {
+  for ( size_t colidx = 0; colidx < columns_.size() && colidx < schema.columns.size(); colidx++ ) {
+    ColumnDefinition const& coldef = schema.columns[colidx];
+    ColumnDefinition& current = column_definitions_[colidx];
+    if ( coldef.column_type == current.column_type && coldef.format == current.format ) {
+      continue;
+    }
+    // A String column only changes its format (e.g. from JSON), the strings are the same
+    if ( coldef.column_type != LogicalTypeId::String || current.column_type != LogicalTypeId::String ) {
+      ColumnData widened = make_widened_data( coldef );
+      bool to_string = coldef.column_type == LogicalTypeId::String;
+      auto& texts = source_texts_[colidx];
+      std::vector<std::pair<int32_t, std::string>> widened_texts;
+      std::visit(
+          [&]( auto const& data ) {
+            Cell cell, value;
+            auto text = texts.begin();
+            for ( int32_t idx = 0; idx < data.get_element_count(); idx++ ) {
+              bool has_text = text != texts.end() && text->first == idx;
+              bool is_set = get_cell_from_data( data, idx, cell );
+              int res = 0;
+              if ( has_text && to_string ) {
+                // The value as it was read, which its typed value does not give back
+                value = std::move( text->second );
+                res = 1;
+              } else if ( is_set ) {
+                res = convert_widened( cell, current, value, coldef );
+              }
+              std::visit( [&]( auto& widened_data ) { feed_cell_into_data( widened_data, value, res > 0 ); }, widened );
+              if ( has_text ) {
+                if ( !to_string ) {
+                  widened_texts.push_back( std::move( *text ) );
+                }
+                ++text;
+              } else if ( !to_string && is_set ) {
+                // Keep the text the value had if the new type or date format writes it differently
+                std::string old_text = widened_text( cell, current );
+                if ( res <= 0 || widened_text( value, coldef ) != old_text ) {
+                  widened_texts.emplace_back( idx, std::move( old_text ) );
+                }
+              }
+            }
+          },
+          columns_[colidx] );
+      columns_[colidx] = std::move( widened );
+      texts = std::move( widened_texts );
+    }
+    current = coldef;
+  }
+}
+
 int16_t Ingest::Table::get_column_count() const {
   return static_cast<int16_t>( this->columns_.size() );
 }
@@ -238,6 +388,8 @@ void Ingest::Table::dump() const {
 }
 
 void Ingest::Table::shrink_columns() {
+  // Columns are not widened any more, source texts are not needed
+  std::vector<std::vector<std::pair<int32_t, std::string>>>( columns_.size() ).swap( source_texts_ );
   // Attempt to shrink down Integer columns data type size to 32, 16 or 8 bits
   for ( ColumnData& col : this->columns_ ) {
     if ( std::holds_alternative<IntegerData>( col ) ) {
@@ -55,12 +55,16 @@ public:
 
   Table( Table&& other )
       : column_names_( std::move( other.column_names_ ) ),
+        column_definitions_( std::move( other.column_definitions_ ) ),
         columns_( std::move( other.columns_ ) ),
+        source_texts_( std::move( other.source_texts_ ) ),
         ingested_status_( std::move( other.ingested_status_ ) ) {}
 
   Table& operator=( Table&& other ) {
     column_names_ = std::move( other.column_names_ );
+    column_definitions_ = std::move( other.column_definitions_ );
     columns_ = std::move( other.columns_ );
+    source_texts_ = std::move( other.source_texts_ );
     ingested_status_ = std::move( other.ingested_status_ );
     return *this;
   }
@@ -73,6 +77,12 @@ public:
 
   void append_row( Row const& row );
 
+  // Append all rows of a batch, column by column
+  void append_batch( RowBatch const& batch );
+
+  // Convert the data of columns whose type was widened by the parser's streaming inference to the new types of the schema
+  void update_column_types( Schema const& schema );
+
   void dump() const;
 
   std::vector<ColumnData> const& get_columns_ref() const { return columns_; }
@@ -119,7 +129,11 @@ public:
 
 private:
   std::vector<std::string> column_names_;
+  std::vector<ColumnDefinition> column_definitions_;  // types of the data in columns_
   std::vector<ColumnData> columns_;
+  // Source text of typed values by column and row, for the values whose text a String column would not get back
+  // from the typed value (see ColumnBatch::source_text)
+  std::vector<std::vector<std::pair<int32_t, std::string>>> source_texts_;
   IngestedStatus ingested_status_;
 };
 
@@ -1,15 +1,100 @@
 #include <cstdio>
+#include <cstdlib>
 #include <memory>
 #include <chrono>
 #include <iostream>
+#include <functional>
 
 #include "inferrer.h"
+#include "utility.h"
 
 using namespace Ingest;
 
+typedef std::chrono::high_resolution_clock clock_type;
+
+static size_t hash_cell(const Cell& cell)
+{
+	return std::visit(overloaded{
+	[](const std::vector<Cell>& v)
+	{
+		size_t h = v.size();
+		for (const Cell& c : v)
+			h = h * 31 + hash_cell(c);
+		return h;
+	},
+	[](const std::unordered_map<int, ErrorType>& v)
+	{
+		size_t h = v.size();
+		for (const auto& p : v)
+			h += std::hash<int>()(p.first) ^ std::hash<std::string>()(p.second.value);
+		return h;
+	},
+	[](const auto& v) { return std::hash<std::decay_t<decltype(v)>>()(v); },
+	}, static_cast<const Cell::base&>(cell));
+}
+
+// same as hash_cell for the value in the batch
+static size_t hash_batch_value(const ColumnBatch& column, size_t i_row)
+{
+	return std::visit(overloaded{
+	[i_row](const StringBatch& v) { return std::hash<std::string_view>()(v.get(i_row)); },
+	[i_row](const std::vector<bool>& v) { return std::hash<bool>()(v[i_row]); },
+	[i_row](const auto& v) { return hash_cell(v[i_row]); },
+	}, column.values);
+}
+
+// parses the whole file, returns parse time, number of rows and, if checksum is given, hash of all values
+static bool read_file(const char* filename, size_t thread_count, bool batches, clock_type::duration& dur, size_t& n_rows, size_t* checksum)
+{
+	std::unique_ptr<Parser> parser(Parser::get_parser(filename));
+	if (!parser || !parser->infer_schema())
+		return false;
+	Schema& schema = *(parser->get_schema());
+	parser->set_thread_count(thread_count);
+	if (schema.status != 0 || !parser->open())
+		return false;
+	Row row(schema.columns.size());
+	RowBatch batch;
+	n_rows = 0;
+	clock_type::time_point start = clock_type::now();
+	if (batches)
+		while (parser->get_next_batch(batch))
+		{
+			n_rows += batch.size;
+			if (checksum)
+				for (size_t i_row = 0; i_row < batch.size; ++i_row)
+					for (const ColumnBatch& column : batch.columns)
+						*checksum = *checksum * 31 + (column.flagmap[i_row] ? hash_batch_value(column, i_row) : 0);
+		}
+	else
+		while (parser->get_next_row(row))
+		{
+			++n_rows;
+			if (checksum)
+				for (size_t i = 0; i < row.values.size(); ++i)
+					*checksum = *checksum * 31 + (row.flagmap[i] ? hash_cell(row.values[i]) : 0);
+		}
+	dur = clock_type::now() - start;
+	parser->close();
+	return schema.status == 0;
+}
+
+// times a pass that only parses, the checksum of all values comes from a separate untimed pass
+static bool parse_file(const char* filename, size_t thread_count, bool batches, clock_type::duration& dur, size_t& n_rows, size_t& checksum)
+{
+	clock_type::duration dur_hashed;
+	size_t n_rows_hashed;
+	checksum = 0;
+	return read_file(filename, thread_count, batches, dur, n_rows, nullptr) &&
+		read_file(filename, thread_count, batches, dur_hashed, n_rows_hashed, &checksum) && n_rows_hashed == n_rows;
+}
+
+// usage: benchmark filename [thread_count ...]
+// prints parsing overhead relative to reading the file and time of reading the file by batches,
+// with thread counts also parses the file with each thread count and prints speedup over the serial parse
 int main(int argc, char* argv[])
 {
-	if (argc != 2)
+	if (argc < 2)
 	{
 		std::cout << "filename missing" << std::endl;
 		return 1;
@@ -23,25 +108,45 @@ int main(int argc, char* argv[])
 	while ((std::fgetc(fp)) != EOF);
 	std::fseek(fp, 0, SEEK_SET);
 
-	typedef std::chrono::high_resolution_clock clock;
-	std::chrono::time_point<clock> start;
-	clock::duration dur1, dur2;
-	start = clock::now();
+	clock_type::time_point start;
+	clock_type::duration dur1, dur2;
+	start = clock_type::now();
 	while ((std::fgetc(fp)) != EOF);
-	dur1 = clock::now() - start;
+	dur1 = clock_type::now() - start;
 	std::fclose(fp);
 
-	std::unique_ptr<Parser> parser(Parser::get_parser(argv[1]));
-	if (!parser || !parser->infer_schema())
+	size_t n_rows, checksum;
+	if (!parse_file(argv[1], 1, false, dur2, n_rows, checksum))
 		return 1;
-	Schema& schema = *(parser->get_schema());
-	if (schema.status != 0 || !parser->open())
-		return 1;
-	Row row(schema.columns.size());
-	start = clock::now();
-	while (parser->get_next_row(row));
-	dur2 = clock::now() - start;
-	parser->close();
 	std::cout << (double)(dur2.count() - dur1.count()) / dur1.count() * 100.0 << "% (" << std::chrono::duration_cast<std::chrono::duration<double>>(dur2).count() << " sec.)\n";
+
+	clock_type::duration dur_batch;
+	size_t n_rows_batch, checksum_batch;
+	if (!parse_file(argv[1], 1, true, dur_batch, n_rows_batch, checksum_batch))
+		return 1;
+	std::cout << "batches: " << std::chrono::duration_cast<std::chrono::duration<double>>(dur_batch).count() << " sec.";
+	if (n_rows_batch != n_rows || checksum_batch != checksum)
+	{
+		std::cout << ", MISMATCH: " << n_rows_batch << " rows vs " << n_rows << " rows by rows" << std::endl;
+		return 1;
+	}
+	std::cout << std::endl;
+
+	for (int i_arg = 2; i_arg < argc; ++i_arg)
+	{
+		size_t thread_count = std::strtoul(argv[i_arg], nullptr, 10);
+		clock_type::duration dur;
+		size_t n_rows_par, checksum_par;
+		if (!parse_file(argv[1], thread_count, false, dur, n_rows_par, checksum_par))
+			return 1;
+		std::cout << thread_count << " threads: " << std::chrono::duration_cast<std::chrono::duration<double>>(dur).count() << " sec., speedup " <<
+			(double)dur2.count() / dur.count();
+		if (n_rows_par != n_rows || checksum_par != checksum)
+		{
+			std::cout << ", MISMATCH: " << n_rows_par << " rows vs " << n_rows << " rows in serial parse" << std::endl;
+			return 1;
+		}
+		std::cout << std::endl;
+	}
 	return 0;
 }
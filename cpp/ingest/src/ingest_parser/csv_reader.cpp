@@ -1,8 +1,11 @@
 #include <cctype>
+#include <algorithm>
 #include <utility>
 #include <array>
 #include <unordered_map>
-#include <regex>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include <unicode/ucnv.h>
 #include <unicode/ucsdet.h>
@@ -64,21 +67,13 @@ public:
 		m_cnv_pos = m_cnv_end = m_cnv_buf + cnv_buf_size;
 	}
 
-	bool get(char& c)
+	// returns all converted data available without copying, [pos, end) is valid until the next call
+	bool get_block(const char*& pos, const char*& end)
 	{
 		if (m_cnv_pos >= m_cnv_end && !underflow())
 			return false;
-		c = *m_cnv_pos++;
-		return true;
-	}
-
-	bool check_next_char(char c)
-	{
-		if (m_cnv_pos >= m_cnv_end && !underflow())
-			return false;
-		if (*m_cnv_pos != c)
-			return false;
-		++m_cnv_pos;
+		pos = m_cnv_pos;
+		end = m_cnv_pos = m_cnv_end;
 		return true;
 	}
 
@@ -86,11 +81,22 @@ public:
 	{
 		if (m_read_pos >= m_read_end)
 		{
-			size_t sz = m_reader->read(m_read_buf, read_buf_size);
-			if (sz == 0 && !m_data_in_converter)
-				return false;
-			m_read_end = m_read_buf + sz;
-			m_read_pos = m_read_buf;
+			if (m_reader->is_mapped())
+			{
+				std::string_view data = m_reader->read_view(read_buf_size);
+				if (data.empty() && !m_data_in_converter)
+					return false;
+				m_read_pos = data.data();
+				m_read_end = m_read_pos + data.size();
+			}
+			else
+			{
+				size_t sz = m_reader->read(m_read_buf, read_buf_size);
+				if (sz == 0 && !m_data_in_converter)
+					return false;
+				m_read_end = m_read_buf + sz;
+				m_read_pos = m_read_buf;
+			}
 		}
 		UErrorCode ustatus = U_ZERO_ERROR;
 		m_cnv_pos = m_cnv_end = m_cnv_buf;
@@ -117,15 +123,13 @@ private:
 
 const size_t SAMPLE_SIZE = 1024 * 1024;
 const size_t MAX_STRING_SIZE = 1024 * 1024 - 1; // not accounting for terminating 0
-static const std::regex _re_line_terminators(R"(\x02\n|\r\n|\n|\r)"); // max 2 chars
-static const std::regex _re_universal_newlines(R"(\r\n|\n|\r)"); // these are interchangeable
 static const std::array<std::string, 4> _comment_chars { "#", "//", "/*", "*/" }; // max 2 chars
 static constexpr std::string_view _delimiters = "\x00\x01\x02\x03\x04\x05\x06\x07\x08\x0b\x0c\x0e\x0f\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f\x7f|~^\t,; "sv;
 
-static void rtrim(std::string& s)
+static void rtrim(std::string& s, size_t start = 0)
 {
 	size_t sz;
-	for (sz = s.size(); sz > 0; --sz)
+	for (sz = s.size(); sz > start; --sz)
 		if (!std::isspace((unsigned char)s[sz - 1]))
 			break;
 	s.resize(sz);
@@ -146,6 +150,388 @@ static std::vector<std::string_view> split(const std::string& s, const std::stri
 	return result;
 }
 
+// Splits a local file into chunks at record boundaries and parses them on worker threads,
+// rows are handed out in the original order with the same row numbers as a serial parse.
+// Record boundaries are found in two passes: first every chunk is scanned in parallel to get a mapping
+// of the quoting state at its beginning to the state at its end, then those mappings are chained
+// to know the exact state at each chunk start, and the split point is the first newline outside quotes after it.
+// With streaming inference every chunk infers its own rows starting from the state after the first rows,
+// the consumer merges the state of each chunk in order and converts the chunk's batches to the merged types.
+class CSVChunkLoader
+{
+public:
+	static constexpr size_t chunk_size = 8 * 1024 * 1024;
+	static constexpr size_t scan_buf_size = 1024 * 1024;
+
+	static CSVChunkLoader* create(CSVParser& parser);
+	CSVChunkLoader(CSVParser& parser, std::vector<size_t>&& bounds, size_t thread_count);
+	~CSVChunkLoader();
+	bool get_next_row(Row& row);
+	bool get_next_batch(RowBatch& batch);
+	int get_percent_complete();
+
+private:
+	enum QuoteState : uint8_t { Q_OUT, Q_IN, Q_ESCAPE, Q_QUOTE, Q_STATES }; // Q_QUOTE: found quote in quotes, it may be a double quote
+	typedef std::array<std::array<QuoteState, 256>, Q_STATES> QuoteTable;
+
+	struct Chunk
+	{
+		std::vector<RowBatch> batches;
+		std::vector<std::vector<ColumnDefinition>> batch_columns; // with streaming inference, schema columns of each batch
+		std::shared_ptr<std::vector<Column>> inferred_columns; // streaming inference state after the chunk
+		size_t comment_lines_skipped = 0;
+		bool has_truncated_string = false;
+		bool failed = false; // the chunk could not be opened
+		bool ready = false;
+	};
+
+	static QuoteTable make_quote_table(const CSVSchema& schema);
+	static bool find_data_start(const std::string& filename, const CSVSchema& schema, size_t& data_start);
+	static size_t find_record_end(const std::string& filename, const CSVSchema& schema, const QuoteTable& table, size_t pos, QuoteState state);
+	void worker();
+	bool parse_chunk(size_t i_chunk);
+
+	CSVParser& m_parser;
+	CSVSchema m_schema;
+	std::shared_ptr<std::vector<Column>> m_inferred_columns; // streaming inference state the chunks start from
+	std::vector<size_t> m_bounds; // chunk i is [m_bounds[i], m_bounds[i + 1])
+	std::vector<Chunk> m_chunks;
+	size_t m_window; // max number of chunks parsed ahead of the consumer
+	size_t m_rownum_col;
+	size_t m_next_chunk;
+	size_t m_current;
+	size_t m_current_batch;
+	RowBatch m_batch; // rows returned by get_next_row()
+	size_t m_batch_row;
+	size_t m_current_base; // added to row numbers of the current chunk
+	size_t m_last_row_number;
+	bool m_stop;
+	std::mutex m_mutex;
+	std::condition_variable m_chunk_ready;
+	std::condition_variable m_can_parse;
+	std::vector<std::thread> m_threads;
+};
+
+CSVChunkLoader::QuoteTable CSVChunkLoader::make_quote_table(const CSVSchema& schema)
+{
+	QuoteTable table;
+	for (int i = 0; i < 256; ++i)
+	{
+		char c = (char)i;
+		bool is_quote = c == schema.quote_char && c != '\0';
+		table[Q_OUT][i] = is_quote ? Q_IN : Q_OUT;
+		table[Q_IN][i] = is_quote ? Q_QUOTE : c == schema.escape_char && c != '\0' ? Q_ESCAPE : Q_IN;
+		table[Q_ESCAPE][i] = Q_IN;
+		table[Q_QUOTE][i] = is_quote ? Q_IN : Q_OUT; // not a double quote: quotes are closed and c is outside of them
+	}
+	return table;
+}
+
+// same as first rows skipping in CSVParser::get_next_row_raw
+bool CSVChunkLoader::find_data_start(const std::string& filename, const CSVSchema& schema, size_t& data_start)
+{
+	FileRangeReader reader(filename, 0, SIZE_MAX);
+	if (!reader.open())
+		return false;
+	size_t pos = 0;
+	if (schema.charset == "UTF-8" && reader.startswith("\xEF\xBB\xBF"sv))
+		pos = 3;
+	auto is_newline = [&](char c)
+	{
+		if (schema.newline.empty())
+			return c == '\r' || c == '\n';
+		if (c != schema.newline[0])
+			return false;
+		if (schema.newline.size() == 1)
+			return true;
+		if (!reader.check_next_char(schema.newline[1]))
+			return false;
+		++pos;
+		return true;
+	};
+	char c;
+	if (!reader.next_char(c)) return false;
+	for (size_t i_row = 0; i_row < schema.first_data_row; ++i_row)
+	{
+		while (!is_newline(c)) { if (!reader.next_char(c)) return false; ++pos; }
+		do { if (!reader.next_char(c)) return false; ++pos; } while (is_newline(c));
+	}
+	data_start = pos;
+	return true;
+}
+
+// position after the first newline outside quotes starting at pos, or the file size
+size_t CSVChunkLoader::find_record_end(const std::string& filename, const CSVSchema& schema, const QuoteTable& table, size_t pos, QuoteState state)
+{
+	FileRangeReader reader(filename, pos, SIZE_MAX);
+	if (!reader.open())
+		return SIZE_MAX;
+	char c;
+	while (reader.next_char(c))
+	{
+		++pos;
+		if (state == Q_OUT || (state == Q_QUOTE && c != schema.quote_char))
+		{
+			if (schema.newline.empty())
+			{
+				if (c == '\r' || c == '\n')
+					return pos;
+			}
+			else if (c == schema.newline[0])
+			{
+				if (schema.newline.size() == 1)
+					return pos;
+				if (reader.check_next_char(schema.newline[1]))
+					return pos + 1;
+			}
+		}
+		state = table[state][(unsigned char)c];
+	}
+	return pos;
+}
+
+CSVChunkLoader* CSVChunkLoader::create(CSVParser& parser)
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+	return nullptr;
+#else
+	const CSVSchema& schema = parser.m_schema;
+	size_t thread_count = parser.m_thread_count > 0 ? parser.m_thread_count : std::thread::hardware_concurrency();
+	// comments may contain quotes which are ignored, it would need the comment state to be tracked as well
+	if (thread_count < 2 || !parser.m_reader->is_file() || parser.m_cvt_buf || !schema.comment.empty())
+		return nullptr;
+	size_t file_size = parser.m_reader->filesize();
+	const std::string& filename = parser.m_reader->filename();
+	size_t data_start;
+	if (file_size < 2 * chunk_size || !find_data_start(filename, schema, data_start))
+		return nullptr;
+	size_t n_chunks = (file_size - data_start + chunk_size - 1) / chunk_size;
+	if (n_chunks < 2)
+		return nullptr;
+
+	// quoting state at the end of every chunk for each possible state at its beginning
+	QuoteTable table = make_quote_table(schema);
+	std::vector<std::array<QuoteState, Q_STATES>> transitions(n_chunks);
+	if (schema.quote_char != '\0')
+	{
+		auto scan = [&](size_t i_thread)
+		{
+			std::unique_ptr<char[]> buf(new char[scan_buf_size]);
+			for (size_t i_chunk = i_thread; i_chunk < n_chunks; i_chunk += thread_count)
+			{
+				std::array<QuoteState, Q_STATES>& states = transitions[i_chunk];
+				for (int i = 0; i < Q_STATES; ++i)
+					states[i] = (QuoteState)i;
+				size_t begin = data_start + i_chunk * chunk_size;
+				FileRangeReader reader(filename, begin, begin + chunk_size);
+				if (!reader.open())
+					continue;
+				while (true)
+				{
+					std::string_view data = reader.is_mapped() ? reader.read_view(scan_buf_size) :
+						std::string_view(buf.get(), reader.read(buf.get(), scan_buf_size));
+					if (data.empty())
+						break;
+					for (char c : data)
+						for (QuoteState& state : states)
+							state = table[state][(unsigned char)c];
+				}
+			}
+		};
+		std::vector<std::thread> threads;
+		for (size_t i_thread = 1; i_thread < std::min(thread_count, n_chunks); ++i_thread)
+			threads.emplace_back(scan, i_thread);
+		scan(0);
+		for (std::thread& t : threads)
+			t.join();
+	}
+
+	std::vector<size_t> bounds { 0 };
+	QuoteState state = Q_OUT;
+	for (size_t i_chunk = 1; i_chunk < n_chunks; ++i_chunk)
+	{
+		if (schema.quote_char != '\0')
+			state = transitions[i_chunk - 1][state];
+		size_t chunk_begin = data_start + i_chunk * chunk_size;
+		if (chunk_begin <= bounds.back()) // previous record is longer than a chunk
+			continue;
+		size_t bound = find_record_end(filename, schema, table, chunk_begin, state);
+		if (bound >= file_size)
+			break;
+		bounds.push_back(bound);
+	}
+	bounds.push_back(file_size);
+	if (bounds.size() < 3)
+		return nullptr;
+	return new CSVChunkLoader(parser, std::move(bounds), thread_count);
+#endif
+}
+
+CSVChunkLoader::CSVChunkLoader(CSVParser& parser, std::vector<size_t>&& bounds, size_t thread_count) :
+	m_parser(parser),
+	m_schema(parser.m_schema),
+	m_bounds(std::move(bounds)),
+	m_chunks(m_bounds.size() - 1),
+	m_window(thread_count * 2),
+	m_rownum_col(SIZE_MAX),
+	m_next_chunk(0),
+	m_current(0),
+	m_current_batch(0),
+	m_batch_row(0),
+	m_current_base(0),
+	m_last_row_number(m_schema.first_data_row),
+	m_stop(false)
+{
+	for (size_t i_col = 0; i_col < m_schema.columns.size(); ++i_col)
+		if (m_schema.columns[i_col].index == COL_ROWNUM)
+			m_rownum_col = i_col;
+	if (parser.m_streaming_inference && parser.m_inferred_columns)
+		m_inferred_columns = CSVParser::copy_inference(*parser.m_inferred_columns);
+	for (size_t i_thread = 0; i_thread < std::min(thread_count, m_chunks.size()); ++i_thread)
+		m_threads.emplace_back(&CSVChunkLoader::worker, this);
+}
+
+CSVChunkLoader::~CSVChunkLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_can_parse.notify_all();
+	for (std::thread& t : m_threads)
+		t.join();
+}
+
+void CSVChunkLoader::worker()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_can_parse.wait(lock, [this] { return m_stop || m_next_chunk >= m_chunks.size() || m_next_chunk < m_current + m_window; });
+		if (m_stop || m_next_chunk >= m_chunks.size())
+			return;
+		size_t i_chunk = m_next_chunk++;
+		lock.unlock();
+		bool parsed = parse_chunk(i_chunk);
+		lock.lock();
+		m_chunks[i_chunk].failed = !parsed;
+		m_chunks[i_chunk].ready = true;
+		m_chunk_ready.notify_all();
+	}
+}
+
+bool CSVChunkLoader::parse_chunk(size_t i_chunk)
+{
+	Chunk& chunk = m_chunks[i_chunk];
+	CSVParser parser(std::make_shared<FileRangeReader>(m_parser.m_reader->filename(), m_bounds[i_chunk], m_bounds[i_chunk + 1]));
+	parser.m_schema = m_schema;
+	parser.m_thread_count = 1;
+	if (i_chunk > 0)
+	{
+		parser.m_schema.first_data_row = 0;
+		parser.m_schema.charset = "ASCII"; // bytes are passed through as is, only don't look for BOM in the middle of the file
+	}
+	if (m_inferred_columns)
+	{
+		parser.m_streaming_inference = true;
+		parser.m_inferred_columns = CSVParser::copy_inference(*m_inferred_columns);
+	}
+	if (!parser.open())
+		return false;
+	RowBatch batch;
+	chunk.batches.clear();
+	chunk.batch_columns.clear();
+	while (parser.get_next_batch(batch))
+	{
+		chunk.batches.push_back(std::move(batch));
+		if (m_inferred_columns)
+			chunk.batch_columns.push_back(parser.m_schema.columns);
+	}
+	chunk.inferred_columns = parser.m_inferred_columns;
+	chunk.comment_lines_skipped = parser.m_schema.comment_lines_skipped_in_parsing;
+	chunk.has_truncated_string = parser.m_schema.has_truncated_string;
+	return true;
+}
+
+bool CSVChunkLoader::get_next_row(Row& row)
+{
+	if (m_batch_row >= m_batch.size)
+	{
+		if (!get_next_batch(m_batch))
+			return false;
+		m_batch_row = 0;
+	}
+	m_batch.move_row(m_batch_row++, row);
+	return true;
+}
+
+bool CSVChunkLoader::get_next_batch(RowBatch& batch)
+{
+	while (m_current < m_chunks.size())
+	{
+		Chunk& chunk = m_chunks[m_current];
+		if (m_current_batch == 0)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_chunk_ready.wait(lock, [&chunk] { return chunk.ready; });
+		}
+		if (chunk.failed)
+		{
+			// a worker could not open its range, parse it again here before giving up on the file
+			chunk.failed = !parse_chunk(m_current);
+			if (chunk.failed)
+			{
+				m_parser.m_schema.status = STATUS_INVALID_FILE;
+				return false;
+			}
+		}
+		if (m_current_batch == 0 && chunk.inferred_columns)
+		{
+			m_parser.merge_inference(*chunk.inferred_columns);
+			chunk.inferred_columns.reset();
+		}
+		if (m_current_batch < chunk.batches.size())
+		{
+			if (!chunk.batch_columns.empty())
+			{
+				std::vector<ColumnDefinition>& batch_columns = chunk.batch_columns[m_current_batch];
+				for (size_t i_col = 0; i_col < batch_columns.size(); ++i_col)
+				{
+					const ColumnDefinition& col = m_parser.m_schema.columns[i_col];
+					if (batch_columns[i_col].column_type != col.column_type || batch_columns[i_col].format != col.format)
+						convert_batch_column(chunk.batches[m_current_batch].columns[i_col], batch_columns[i_col], col);
+				}
+			}
+			batch = std::move(chunk.batches[m_current_batch++]);
+			if (m_rownum_col != SIZE_MAX && batch.size > 0)
+			{
+				std::vector<int32_t>& row_numbers = std::get<std::vector<int32_t>>(batch.columns[m_rownum_col].values);
+				for (int32_t& row_number : row_numbers)
+					row_number += (int32_t)m_current_base; // chunks except the first one are numbered from 1
+				m_parser.m_row_number = m_last_row_number = row_numbers.back();
+			}
+			return true;
+		}
+		m_parser.m_schema.comment_lines_skipped_in_parsing += chunk.comment_lines_skipped;
+		m_parser.m_schema.has_truncated_string |= chunk.has_truncated_string;
+		std::vector<RowBatch>().swap(chunk.batches);
+		std::vector<std::vector<ColumnDefinition>>().swap(chunk.batch_columns);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			++m_current;
+			m_current_batch = 0;
+		}
+		m_can_parse.notify_all();
+		m_current_base = m_last_row_number;
+	}
+	return false;
+}
+
+int CSVChunkLoader::get_percent_complete()
+{
+	return (int)((double)m_bounds[m_current] * 100 / m_bounds.back());
+}
+
 Parser* CSVParser::create_parser(std::shared_ptr<BaseReader> reader)
 {
 	return new CSVParser(reader);
@@ -153,6 +539,8 @@ Parser* CSVParser::create_parser(std::shared_ptr<BaseReader> reader)
 
 CSVParser::CSVParser(std::shared_ptr<BaseReader> reader) :
 	m_reader(reader),
+	m_pos(nullptr),
+	m_end(nullptr),
 	m_row_number(0)
 {
 	m_schema.delimiter = ',';
@@ -226,10 +614,10 @@ bool CSVParser::do_infer_schema()
 	}
 	sample.resize(iw);
 
-	std::smatch m;
-	if (!std::regex_search(sample, m, _re_line_terminators))
+	std::string_view newline = find_line_terminator(sample); // max 2 chars
+	if (newline.empty())
 		return false;
-	m_schema.newline = m.str();
+	m_schema.newline = newline;
 	std::vector<std::string_view> lines = split(sample, m_schema.newline);
 	if (!complete_file)
 		lines.pop_back();
@@ -291,7 +679,7 @@ found_bad_quote:
 	infer_table(comment);
 	close();
 	
-//	if (std::regex_match(m_schema.newline, _re_universal_newlines))
+//	if (m_schema.newline == "\r\n" || m_schema.newline == "\n" || m_schema.newline == "\r") // these are interchangeable
 //		m_schema.newline.clear();
 	if (comment != nullptr)
 		m_schema.comment = *comment;
@@ -301,6 +689,7 @@ found_bad_quote:
 
 bool CSVParser::open()
 {
+	m_chunk_loader.reset();
 	m_cvt_buf.reset();
 	if (!m_reader->open())
 		return false;
@@ -317,6 +706,19 @@ bool CSVParser::open()
 			m_reader->startswith("\xFE\xFF"sv);
 		m_cvt_buf.reset(new ucvt_streambuf(m_reader, std::move(ucnv_from), std::move(ucnv_to)));
 	}
+	if (!m_cvt_buf && !m_reader->is_mapped() && !m_buf)
+		m_buf.reset(new char[read_buf_size]);
+	m_pos = m_end = nullptr;
+	std::string chars { m_schema.delimiter };
+	if (m_schema.quote_char != '\0')
+		chars += m_schema.quote_char;
+	if (m_schema.escape_char != '\0')
+		chars += m_schema.escape_char;
+	if (m_schema.newline.empty())
+		chars += "\r\n";
+	else
+		chars += m_schema.newline[0];
+	m_scanner.init(chars);
 	m_row_number = 0;
 	m_schema.comment_lines_skipped_in_parsing = 0;
 	return true;
@@ -324,23 +726,64 @@ bool CSVParser::open()
 
 void CSVParser::close()
 {
+	m_chunk_loader.reset();
 	m_reader->close();
 	m_cvt_buf.reset();
 }
 
-int CSVParser::get_percent_complete()
+bool CSVParser::get_next_row(Row& row)
 {
-	return m_reader->pos_percent();
+	if (m_row_number == 0 && !m_chunk_loader) // large files are parsed in parallel from the start
+		m_chunk_loader.reset(CSVChunkLoader::create(*this));
+	if (m_chunk_loader)
+		return m_chunk_loader->get_next_row(row);
+	return Parser::get_next_row(row);
+}
+
+bool CSVParser::get_next_batch(RowBatch& batch)
+{
+	if (m_row_number == 0 && !m_chunk_loader)
+		m_chunk_loader.reset(CSVChunkLoader::create(*this));
+	if (m_chunk_loader)
+		return m_chunk_loader->get_next_batch(batch);
+	return Parser::get_next_batch(batch);
 }
 
-bool CSVParser::next_char(char& c)
+int CSVParser::get_percent_complete()
 {
-	return m_cvt_buf ? m_cvt_buf->get(c) : m_reader->next_char(c);
+	if (m_chunk_loader)
+		return m_chunk_loader->get_percent_complete();
+	return m_reader->pos_percent();
 }
 
-bool CSVParser::check_next_char(char c)
+bool CSVParser::fill_buffer()
 {
-	return m_cvt_buf ? m_cvt_buf->check_next_char(c) : m_reader->check_next_char(c);
+	m_scanner.reset();
+	do
+	{
+		if (m_cvt_buf)
+		{
+			if (!m_cvt_buf->get_block(m_pos, m_end))
+				return false;
+		}
+		else if (m_reader->is_mapped())
+		{
+			std::string_view data = m_reader->read_view(read_buf_size); // no copy, points into the mapped file
+			if (data.empty())
+				return false;
+			m_pos = data.data();
+			m_end = m_pos + data.size();
+		}
+		else
+		{
+			size_t sz = m_reader->read(m_buf.get(), read_buf_size);
+			if (sz == 0)
+				return false;
+			m_pos = m_buf.get();
+			m_end = m_pos + sz;
+		}
+	} while (m_pos >= m_end);
+	return true;
 }
 
 bool CSVParser::is_newline(char c)
@@ -352,10 +795,37 @@ bool CSVParser::is_newline(char c)
 
 int64_t CSVParser::get_next_row_raw(RowRaw& row)
 {
-	std::string* field = nullptr;
+	int64_t row_number = parse_row();
+	row.clear();
+	for (size_t i_field = 0; i_field < m_field_starts.size(); ++i_field)
+		row.emplace_back(std::in_place_type<std::string>, field_view(i_field));
+	return row_number;
+}
+
+int64_t CSVParser::get_next_row_view(RowView& row)
+{
+	int64_t row_number = parse_row();
+	row.clear();
+	for (size_t i_field = 0; i_field < m_field_starts.size(); ++i_field)
+		row.emplace_back(std::in_place_type<std::string_view>, field_view(i_field));
+	return row_number;
+}
+
+std::string_view CSVParser::field_view(size_t i_field) const
+{
+	size_t start = m_field_starts[i_field];
+	size_t end = i_field + 1 < m_field_starts.size() ? m_field_starts[i_field + 1] : m_row_buf.size();
+	return std::string_view(m_row_buf.data() + start, end - start - 1); // not including terminating 0
+}
+
+// reads the next row into m_row_buf, each field is followed by terminating 0, field starts are stored in m_field_starts
+int64_t CSVParser::parse_row()
+{
+	size_t field_start = 0;
 	bool in_quotes = false;
 	bool in_comment = false;
-	row.clear();
+	m_row_buf.clear();
+	m_field_starts.clear();
 
 	char c;
 	if (!next_char(c)) return -1;
@@ -372,17 +842,21 @@ int64_t CSVParser::get_next_row_raw(RowRaw& row)
 			{
 				if (in_comment)
 					in_comment = false;
-				else if (!row.empty())
+				else if (!m_field_starts.empty())
 				{
-					rtrim(*field);
+					rtrim(m_row_buf, field_start);
+					m_row_buf += '\0';
 					return (int64_t)m_row_number;
 				}
 				continue; // Skip empty rows
 			}
 
 			if (in_comment)
+			{
+				m_pos = m_scanner.find(m_pos, m_end); // skip to the next newline candidate
 				continue;
-			if (field == nullptr) // first character of the row
+			}
+			if (m_field_starts.empty()) // first character of the row
 			{
 				if (!m_schema.comment.empty() &&
 					c == m_schema.comment[0] && (m_schema.comment.size() == 1 || check_next_char(m_schema.comment[1])))
@@ -391,13 +865,14 @@ int64_t CSVParser::get_next_row_raw(RowRaw& row)
 					++m_schema.comment_lines_skipped_in_parsing;
 					continue;
 				}
-				field = &std::get<std::string>(row.emplace_back(std::in_place_type<std::string>));
+				m_field_starts.push_back(field_start = m_row_buf.size());
 			}
 
 			if (c == m_schema.delimiter)
 			{
-				rtrim(*field);
-				field = &std::get<std::string>(row.emplace_back(std::in_place_type<std::string>));
+				rtrim(m_row_buf, field_start);
+				m_row_buf += '\0';
+				m_field_starts.push_back(field_start = m_row_buf.size());
 				continue;
 			}
 
@@ -417,14 +892,32 @@ int64_t CSVParser::get_next_row_raw(RowRaw& row)
 			else if (c == m_schema.escape_char && m_schema.escape_char != '\0' && !next_char(c))
 				break;
 		}
-		if (field->empty() && std::isspace((unsigned char)c)) // left-trim whitespace
+		size_t field_size = m_row_buf.size() - field_start;
+		if (field_size == 0 && std::isspace((unsigned char)c)) // left-trim whitespace
 			;
-		else if (field->size() < MAX_STRING_SIZE)
-			*field += c;
+		else if (field_size < MAX_STRING_SIZE)
+		{
+			m_row_buf += c;
+			++field_size;
+		}
 		else
 			m_schema.has_truncated_string = true;
+
+		// characters up to the next structural one are copied as is
+		const char* span_end = m_scanner.find(m_pos, m_end);
+		if (field_size == 0)
+			while (m_pos < span_end && std::isspace((unsigned char)*m_pos))
+				++m_pos;
+		size_t n = std::min((size_t)(span_end - m_pos), MAX_STRING_SIZE - field_size);
+		m_row_buf.append(m_pos, n);
+		if (n < (size_t)(span_end - m_pos))
+			m_schema.has_truncated_string = true;
+		m_pos = span_end;
 	} while (next_char(c));
-	return row.empty() ? -1 : (int64_t)m_row_number;
+	if (m_field_starts.empty())
+		return -1;
+	m_row_buf += '\0';
+	return (int64_t)m_row_number;
 }
 
 }
@@ -3,10 +3,12 @@
 
 #include "inferrer.h"
 #include "file_reader.h"
+#include "csv_scanner.h"
 
 namespace Ingest {
 
 class ucvt_streambuf;
+class CSVChunkLoader;
 
 class CSVParser : public Parser
 {
@@ -18,17 +20,47 @@ public:
 	virtual Schema* get_schema() override { return &m_schema; }
 	virtual bool open() override;
 	virtual void close() override;
+	virtual bool get_next_row(Row& row) override;
+	virtual bool get_next_batch(RowBatch& batch) override;
 	virtual int get_percent_complete() override;
 
 protected:
-	bool next_char(char& c);
-	bool check_next_char(char c);
+	friend class CSVChunkLoader;
+	static constexpr size_t read_buf_size = 64 * 1024;
+
+	bool fill_buffer();
+	bool next_char(char& c)
+	{
+		if (m_pos >= m_end && !fill_buffer())
+			return false;
+		c = *m_pos++;
+		return true;
+	}
+	bool check_next_char(char c)
+	{
+		if (m_pos >= m_end && !fill_buffer())
+			return false;
+		if (*m_pos != c)
+			return false;
+		++m_pos;
+		return true;
+	}
 	bool is_newline(char c);
 	virtual int64_t get_next_row_raw(RowRaw& row) override;
+	virtual int64_t get_next_row_view(RowView& row) override;
+	int64_t parse_row();
+	std::string_view field_view(size_t i_field) const;
 
 	CSVSchema m_schema;
 	std::shared_ptr<BaseReader> m_reader;
 	std::unique_ptr<ucvt_streambuf> m_cvt_buf;
+	std::unique_ptr<CSVChunkLoader> m_chunk_loader;
+	std::unique_ptr<char[]> m_buf;
+	const char* m_pos;
+	const char* m_end;
+	CSVScanner m_scanner;
+	std::string m_row_buf; // fields of the current row
+	std::vector<size_t> m_field_starts;
 	size_t m_row_number;
 };
 
@@ -0,0 +1,136 @@
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CSV_SCANNER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(CSV_SCANNER_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CSV_SCANNER_AVX2
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "csv_scanner.h"
+
+namespace Ingest {
+
+static inline int count_trailing_zeros(uint64_t v)
+{
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanForward64(&i, v);
+	return (int)i;
+#else
+	return __builtin_ctzll(v);
+#endif
+}
+
+#ifndef CSV_SCANNER_SSE2
+static uint64_t block_mask_scalar(const char* block, const char* chars, size_t n_chars)
+{
+	uint64_t mask = 0;
+	for (size_t i = 0; i < CSVScanner::block_size; ++i)
+		for (size_t i_char = 0; i_char < n_chars; ++i_char)
+			if (block[i] == chars[i_char])
+			{
+				mask |= (uint64_t)1 << i;
+				break;
+			}
+	return mask;
+}
+#endif
+
+#ifdef CSV_SCANNER_SSE2
+static uint64_t block_mask_sse2(const char* block, const char* chars, size_t n_chars)
+{
+	__m128i v[4];
+	for (int i = 0; i < 4; ++i)
+		v[i] = _mm_loadu_si128((const __m128i*)(block + i * 16));
+	__m128i eq[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+	for (size_t i_char = 0; i_char < n_chars; ++i_char)
+	{
+		__m128i c = _mm_set1_epi8(chars[i_char]);
+		for (int i = 0; i < 4; ++i)
+			eq[i] = _mm_or_si128(eq[i], _mm_cmpeq_epi8(v[i], c));
+	}
+	return (uint64_t)(uint16_t)_mm_movemask_epi8(eq[0]) |
+		(uint64_t)(uint16_t)_mm_movemask_epi8(eq[1]) << 16 |
+		(uint64_t)(uint16_t)_mm_movemask_epi8(eq[2]) << 32 |
+		(uint64_t)(uint16_t)_mm_movemask_epi8(eq[3]) << 48;
+}
+#endif
+
+#ifdef CSV_SCANNER_AVX2
+__attribute__((target("avx2")))
+static uint64_t block_mask_avx2(const char* block, const char* chars, size_t n_chars)
+{
+	__m256i v0 = _mm256_loadu_si256((const __m256i*)block);
+	__m256i v1 = _mm256_loadu_si256((const __m256i*)(block + 32));
+	__m256i eq0 = _mm256_setzero_si256(), eq1 = _mm256_setzero_si256();
+	for (size_t i_char = 0; i_char < n_chars; ++i_char)
+	{
+		__m256i c = _mm256_set1_epi8(chars[i_char]);
+		eq0 = _mm256_or_si256(eq0, _mm256_cmpeq_epi8(v0, c));
+		eq1 = _mm256_or_si256(eq1, _mm256_cmpeq_epi8(v1, c));
+	}
+	return (uint64_t)(uint32_t)_mm256_movemask_epi8(eq0) | (uint64_t)(uint32_t)_mm256_movemask_epi8(eq1) << 32;
+}
+#endif
+
+static CSVScanner::BlockMaskFunc select_block_mask()
+{
+#ifdef CSV_SCANNER_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return block_mask_avx2;
+#endif
+#ifdef CSV_SCANNER_SSE2
+	return block_mask_sse2;
+#else
+	return block_mask_scalar;
+#endif
+}
+
+static const CSVScanner::BlockMaskFunc _block_mask = select_block_mask();
+
+void CSVScanner::init(std::string_view chars)
+{
+	m_is_special.fill(false);
+	m_n_chars = 0;
+	for (char c : chars)
+		if (!m_is_special[(unsigned char)c] && m_n_chars < max_chars)
+		{
+			m_is_special[(unsigned char)c] = true;
+			m_chars[m_n_chars++] = c;
+		}
+	m_block_mask = _block_mask;
+	m_block = nullptr;
+}
+
+const char* CSVScanner::find(const char* pos, const char* end)
+{
+	while (pos < end)
+	{
+		if (m_block && pos >= m_block && pos < m_block + block_size)
+		{
+			uint64_t mask = m_mask >> (pos - m_block);
+			if (mask != 0)
+				return std::min(pos + count_trailing_zeros(mask), end);
+			pos = m_block + block_size;
+			continue;
+		}
+		if ((size_t)(end - pos) < block_size)
+		{
+			while (pos < end && !m_is_special[(unsigned char)*pos])
+				++pos;
+			return pos;
+		}
+		m_block = pos;
+		m_mask = m_block_mask(pos, m_chars, m_n_chars);
+	}
+	return end;
+}
+
+}
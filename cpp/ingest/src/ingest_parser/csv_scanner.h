@@ -0,0 +1,36 @@
+#ifndef CSV_SCANNER_H
+#define CSV_SCANNER_H
+
+#include <stdint.h>
+#include <array>
+#include <string_view>
+
+namespace Ingest {
+
+// Finds structural characters (delimiter, quote, newline...) in a buffer.
+// Buffer is processed in 64-byte blocks, a bitmask of structural characters is built for each block
+// with SSE2/AVX2 instructions if available (selected at runtime), and is reused while positions stay in the block.
+class CSVScanner
+{
+public:
+	static constexpr size_t block_size = 64;
+	static constexpr size_t max_chars = 8;
+
+	void init(std::string_view chars); // structural characters, duplicates are ignored
+	void reset() { m_block = nullptr; } // must be called when buffer contents change
+	const char* find(const char* pos, const char* end); // first structural character in [pos, end) or end
+
+	typedef uint64_t (*BlockMaskFunc)(const char* block, const char* chars, size_t n_chars);
+
+private:
+	std::array<bool, 256> m_is_special;
+	char m_chars[max_chars];
+	size_t m_n_chars = 0;
+	const char* m_block = nullptr;
+	uint64_t m_mask = 0;
+	BlockMaskFunc m_block_mask = nullptr;
+};
+
+}
+
+#endif
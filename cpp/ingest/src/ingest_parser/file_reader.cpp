@@ -1,3 +1,14 @@
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define INGEST_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "file_reader.h"
 
 namespace Ingest {
@@ -11,18 +22,88 @@ BaseReader::~BaseReader()
 
 FileReader::FileReader(const std::string& filename) :
 	BaseReader(filename),
-	m_fp(nullptr)
+	m_fp(nullptr),
+	m_data(nullptr),
+	m_file_size(0),
+	m_begin(0),
+	m_end(0),
+	m_pos(0),
+	m_prefetched(0)
 {}
 
+FileReader::~FileReader()
+{
+	close();
+}
+
 bool FileReader::open()
 {
-	m_fp = std::fopen(m_filename.data(), "rb");
-	if (!m_fp)
+	close();
+	if (!map_file())
+	{
+		m_fp = std::fopen(m_filename.data(), "rb");
+		if (!m_fp)
+			return false;
+		std::fseek(m_fp, 0, SEEK_END);
+		m_file_size = (size_t)std::ftell(m_fp);
+		std::fseek(m_fp, 0, SEEK_SET);
+	}
+	set_range(0, m_file_size);
+	return true;
+}
+
+// maps the whole file, empty files and special files are read with m_fp
+bool FileReader::map_file()
+{
+#ifdef INGEST_MMAP
+	int fd = ::open(m_filename.data(), O_RDONLY);
+	if (fd < 0)
 		return false;
-	std::fseek(m_fp, 0, SEEK_END);
-	m_content.size = (size_t)std::ftell(m_fp);
-	std::fseek(m_fp, 0, SEEK_SET);
+	struct stat st;
+	void* data = MAP_FAILED;
+	if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+		data = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping stays valid
+	if (data == MAP_FAILED)
+		return false;
+	m_data = (const char*)data;
+	m_file_size = (size_t)st.st_size;
 	return true;
+#else
+	return false;
+#endif
+}
+
+void FileReader::set_range(size_t begin, size_t end)
+{
+	m_end = std::min(end, m_file_size);
+	m_begin = std::min(begin, m_end);
+	m_pos = m_prefetched = m_begin;
+	m_content.size = m_end - m_begin;
+	if (m_fp)
+		std::fseek(m_fp, (long)m_begin, SEEK_SET);
+#ifdef INGEST_MMAP
+	if (m_data && m_end > m_begin)
+	{
+		size_t page_begin = m_begin & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+		::madvise((void*)(m_data + page_begin), m_end - page_begin, MADV_SEQUENTIAL);
+		prefetch();
+	}
+#endif
+}
+
+// asks to page in the data ahead of the current position, it is done in steps of prefetch_size
+// so that only the part of the file which is about to be read is loaded
+void FileReader::prefetch()
+{
+#ifdef INGEST_MMAP
+	if (m_pos + prefetch_size / 2 < m_prefetched || m_prefetched >= m_end)
+		return;
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	size_t begin = std::max(m_pos, m_prefetched) & ~(page_size - 1);
+	m_prefetched = std::min(begin + prefetch_size, m_end);
+	::madvise((void*)(m_data + begin), m_prefetched - begin, MADV_WILLNEED);
+#endif
 }
 
 void FileReader::close()
@@ -32,14 +113,26 @@ void FileReader::close()
 		std::fclose(m_fp);
 		m_fp = nullptr;
 	}
+#ifdef INGEST_MMAP
+	if (m_data)
+	{
+		::munmap((void*)m_data, m_file_size);
+		m_data = nullptr;
+	}
+#endif
+	m_content.buffer = nullptr; // it pointed to the mapped file
+	m_file_size = m_begin = m_end = m_pos = m_prefetched = 0;
 }
 
 bool FileReader::startswith(const std::string_view& prefix)
 {
-	for (unsigned char c : prefix)
-		if (std::fgetc(m_fp) != c)
+	char c;
+	for (char c_prefix : prefix)
+		if (!next_char(c) || c != c_prefix)
 		{
-			std::fseek(m_fp, 0, SEEK_SET);
+			m_pos = m_begin;
+			if (m_fp)
+				std::fseek(m_fp, (long)m_begin, SEEK_SET);
 			return false;
 		}
 	return true;
@@ -47,33 +140,104 @@ bool FileReader::startswith(const std::string_view& prefix)
 
 bool FileReader::next_char(char& c)
 {
-	int cc = std::fgetc(m_fp);
-	c = (char)cc;
-	return cc != EOF;
+	if (m_pos >= m_end)
+		return false;
+	if (m_data)
+		c = m_data[m_pos];
+	else
+	{
+		int cc = std::fgetc(m_fp);
+		if (cc == EOF)
+			return false;
+		c = (char)cc;
+	}
+	++m_pos;
+	return true;
 }
 
 bool FileReader::check_next_char(char c)
 {
-	int cc = std::fgetc(m_fp);
-	if (cc == (unsigned char)c)
-		return true;
-	std::ungetc(cc, m_fp);
-	return false;
+	if (m_pos >= m_end)
+		return false;
+	if (m_data)
+	{
+		if (m_data[m_pos] != c)
+			return false;
+	}
+	else
+	{
+		int cc = std::fgetc(m_fp);
+		if (cc != (unsigned char)c)
+		{
+			std::ungetc(cc, m_fp);
+			return false;
+		}
+	}
+	++m_pos;
+	return true;
 }
 
 size_t FileReader::read(char* buffer, size_t size)
 {
-	return std::fread(buffer, 1, size, m_fp);
+	if (m_data)
+	{
+		std::string_view data = read_view(size);
+		std::memcpy(buffer, data.data(), data.size());
+		return data.size();
+	}
+	size_t sz = std::fread(buffer, 1, std::min(size, m_end - m_pos), m_fp);
+	m_pos += sz;
+	return sz;
+}
+
+std::string_view FileReader::read_view(size_t size)
+{
+	if (!m_data)
+		return std::string_view();
+	size = std::min(size, m_end - m_pos);
+	std::string_view data(m_data + m_pos, size);
+	m_pos += size;
+	prefetch();
+	return data;
 }
 
 int FileReader::pos_percent()
 {
 	if (m_content.size == 0)
 		return 0;
-	long pos = std::ftell(m_fp);
-	if (pos < 0)
-		return 0;
-	return (int)((double)pos * 100 / m_content.size);
+	return (int)((double)(m_pos - m_begin) * 100 / m_content.size);
+}
+
+// the mapped file is returned as is, it stays valid until the reader is closed
+xls::MemBuffer* FileReader::read_all()
+{
+	if (!m_data && !open())
+		return &m_content;
+	if (m_data)
+	{
+		m_content.buffer = const_cast<char*>(m_data);
+		m_content.owns_buffer = false;
+		m_content.size = m_file_size;
+		m_content.pos = 0;
+#ifdef INGEST_MMAP
+		::madvise((void*)m_data, m_file_size, MADV_WILLNEED); // read in random order
+#endif
+	}
+	return &m_content;
+}
+
+FileRangeReader::FileRangeReader(const std::string& filename, size_t begin, size_t end) :
+	FileReader(filename),
+	m_range_begin(begin),
+	m_range_end(end)
+{}
+
+bool FileRangeReader::open()
+{
+	if (!FileReader::open())
+		return false;
+	set_range(m_range_begin, m_range_end);
+	return true;
 }
 
 }
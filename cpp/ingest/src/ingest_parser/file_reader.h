@@ -3,6 +3,7 @@
 
 #include <cstdio>
 #include <string>
+#include <string_view>
 
 #include "xls/xlscommon.h"
 
@@ -22,6 +23,8 @@ public:
 	virtual bool next_char(char& c) = 0;
 	virtual bool check_next_char(char c) = 0;
 	virtual size_t read(char* buffer, size_t size) = 0;
+	virtual bool is_mapped() { return false; } // contents are in memory and can be read with read_view()
+	virtual std::string_view read_view(size_t size) { return std::string_view(); } // same as read() without copying
 	virtual int pos_percent() = 0;
 	virtual xls::MemBuffer* read_all() { return &m_content; };
 
@@ -30,10 +33,14 @@ protected:
 	xls::MemBuffer m_content;
 };
 
+// reads local file, the file is memory-mapped where possible
 class FileReader : public BaseReader
 {
 public:
+	static constexpr size_t prefetch_size = 4 * 1024 * 1024;
+
 	FileReader(const std::string& filename);
+	virtual ~FileReader() override;
 	virtual bool is_file() override { return true; }
 	virtual bool open() override;
 	virtual void close() override;
@@ -41,10 +48,35 @@ public:
 	virtual bool next_char(char& c) override;
 	virtual bool check_next_char(char c) override;
 	virtual size_t read(char* buffer, size_t size) override;
+	virtual bool is_mapped() override { return m_data != nullptr; }
+	virtual std::string_view read_view(size_t size) override;
 	virtual int pos_percent() override;
+	virtual xls::MemBuffer* read_all() override;
 
 protected:
+	bool map_file();
+	void set_range(size_t begin, size_t end);
+	void prefetch();
+
 	std::FILE* m_fp;
+	const char* m_data; // contents of the mapped file, nullptr if the file is read with m_fp
+	size_t m_file_size;
+	size_t m_begin; // reading is limited to bytes [m_begin, m_end)
+	size_t m_end;
+	size_t m_pos;
+	size_t m_prefetched; // end of the range requested to be paged in
+};
+
+// reads only bytes [begin, end) of a file, used to parse parts of the same file in parallel
+class FileRangeReader : public FileReader
+{
+public:
+	FileRangeReader(const std::string& filename, size_t begin, size_t end);
+	virtual bool open() override;
+
+protected:
+	size_t m_range_begin;
+	size_t m_range_end;
 };
 
 }
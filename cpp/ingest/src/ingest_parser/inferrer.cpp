@@ -2,6 +2,7 @@
 #include <cstdlib>
 #include <cctype>
 #include <cmath>
+#include <algorithm>
 #include <ctime>
 #include <type_traits>
 #include <utility>
@@ -10,7 +11,6 @@
 #include <unordered_set>
 #include <sstream>
 #include <iomanip>
-#include <regex>
 
 #include "inferrer.h"
 #include "file_reader.h"
@@ -38,12 +38,41 @@ static bool cell_empty(const CellRaw& cell)
 	return s && s->empty();
 }
 
+static bool view_empty(const CellView& cell)
+{
+	const std::string_view* s = std::get_if<std::string_view>(&cell);
+	return s && s->empty();
+}
+
 static bool cell_null_str(const CellRaw& cell)
 {
 	const std::string* s = std::get_if<std::string>(&cell);
 	return s && (*s == "NULL" || *s == "null");
 }
 
+static bool cell_null_str(const CellView& cell)
+{
+	const std::string_view* s = std::get_if<std::string_view>(&cell);
+	return s && (*s == "NULL" || *s == "null");
+}
+
+static CellView cell_view(const CellRaw& cell)
+{
+	return std::visit(overloaded{
+	[](const std::string& v) { return CellView(std::in_place_type<std::string_view>, v); },
+	[](const auto& v) { return CellView(std::in_place_type<std::decay_t<decltype(v)>>, v); },
+	}, cell);
+}
+
+// reuses memory of the string already stored in the cell
+static void assign_string(Cell& dst, std::string_view s)
+{
+	if (std::string* p = std::get_if<std::string>(&dst))
+		p->assign(s.data(), s.size());
+	else
+		dst.emplace<std::string>(s);
+}
+
 Parser::~Parser() {}
 
 Parser* Parser::get_parser(const std::string& filename)
@@ -71,12 +100,12 @@ bool Parser::open()
 
 void Parser::close() {}
 
-typedef int (*ConvertFunc)(CellRaw& src, Cell& dst, const ColumnDefinition& format);
+typedef int (*ConvertFunc)(const CellView& src, Cell& dst, const ColumnDefinition& format);
 
-static int ConvertToString(CellRaw& src, Cell& dst, const ColumnDefinition& format)
+static int ConvertToString(const CellView& src, Cell& dst, const ColumnDefinition& format)
 {
 	std::visit(overloaded{
-	[&](std::string& s) { dst = std::move(s); },
+	[&](std::string_view s) { assign_string(dst, s); },
 	[&](int64_t v) { dst = std::to_string(v); },
 	[&](bool v) { dst.emplace<std::string>(v ? "true" : "false"); },
 	[&](double v) { std::ostringstream ss; ss << v; dst = ss.str(); },
@@ -121,24 +150,24 @@ static int ConvertToString(CellRaw& src, Cell& dst, const ColumnDefinition& form
 	return 1;
 }
 
-static std::string ConvertRawToString(CellRaw& src)
+static std::string ConvertRawToString(const CellView& src)
 {
 	Cell tmp;
 	ConvertToString(src, tmp, ColumnDefinition());
 	return std::move(std::get<std::string>(tmp));
 }
 
-static const std::unordered_map<std::string, bool> _bool_dict {
+static const std::unordered_map<std::string_view, bool> _bool_dict {
 	{"0", false}, {"1", true},
 	{"false", false}, {"False", false}, {"FALSE", false}, {"true", true}, {"True", true}, {"TRUE", true},
 	{"n", false}, {"N", false}, {"no", false}, {"No", false}, {"NO", false},
 	{"y", true}, {"Y", true}, {"yes", true}, {"Yes", true}, {"YES", true}
 };
 
-static int ConvertToBool(CellRaw& src, Cell& dst, const ColumnDefinition& format)
+static int ConvertToBool(const CellView& src, Cell& dst, const ColumnDefinition& format)
 {
 	return std::visit(overloaded{
-	[&](const std::string& s) -> int
+	[&](std::string_view s) -> int
 	{
 		if (s.empty())
 			return 0;
@@ -165,19 +194,18 @@ static int ConvertToBool(CellRaw& src, Cell& dst, const ColumnDefinition& format
 	}, src);
 }
 
-static int ConvertToInteger(CellRaw& src, Cell& dst, const ColumnDefinition& format)
+static int ConvertToInteger(const CellView& src, Cell& dst, const ColumnDefinition& format)
 {
 	return std::visit(overloaded{
-	[&](const std::string& s) -> int
+	[&](std::string_view s) -> int
 	{
 		if (s.empty())
 			return 0;
-		char* endptr; //size_t pos;
-		int64_t v = std::strtoll(s.data(), &endptr, 10); //std::stoll(s, &pos);
-		if (*endptr) //(pos != s.size())
+		int64_t v;
+		if (!parse_int64(s, v))
 		{
-			double d = std::strtod(s.data(), &endptr);
-			if (*endptr || !is_integer(d))
+			double d;
+			if (!parse_double(s, d) || !is_integer(d))
 				return -1;
 			dst = (int64_t)d;
 			return 1;
@@ -205,17 +233,16 @@ static int ConvertToInteger(CellRaw& src, Cell& dst, const ColumnDefinition& for
 	}, src);
 }
 
-static int ConvertToDouble(CellRaw& src, Cell& dst, const ColumnDefinition& format)
+static int ConvertToDouble(const CellView& src, Cell& dst, const ColumnDefinition& format)
 {
 	return std::visit(overloaded{
-	[&](const std::string& s) -> int
+	[&](std::string_view s) -> int
 	{
 		if (s.empty())
 			return 0;
-		char* endptr; //size_t pos;
-		double v = std::strtod(s.data(), &endptr); //double v = std::stod(s, &pos);
-		if (*endptr) //(pos != s.size())
-			return -1; //throw std::invalid_argument("invalid value");
+		double v;
+		if (!parse_double(s, v))
+			return -1;
 		dst = v;
 		return 1;
 	},
@@ -232,16 +259,23 @@ static int ConvertToDouble(CellRaw& src, Cell& dst, const ColumnDefinition& form
 	}, src);
 }
 
-static int ConvertToDate(CellRaw& src, Cell& dst, const ColumnDefinition& format)
+// returns format of date/time column compiled on first use
+static const DateFormat& date_format(const ColumnDefinition& col)
+{
+	if (!col.date_format || col.date_format->format() != col.format)
+		col.date_format = std::make_shared<DateFormat>(col.format);
+	return *col.date_format;
+}
+
+static int ConvertToDate(const CellView& src, Cell& dst, const ColumnDefinition& format)
 {
 	return std::visit(overloaded{
-	[&](const std::string& s) -> int
+	[&](std::string_view s) -> int
 	{
 		if (s.empty())
 			return 0;
-		// dst.emplace<int32_t>((int)strptime(s, format.format));
 		double t;
-		if (!strptime(s, format.format, t))
+		if (!date_format(format).parse(s, t))
 			return -1;
 		dst.emplace<int32_t>((int)t);
 		return 1;
@@ -255,15 +289,15 @@ static int ConvertToDate(CellRaw& src, Cell& dst, const ColumnDefinition& format
 	}, src);
 }
 
-static int ConvertToTime(CellRaw& src, Cell& dst, const ColumnDefinition& format)
+static int ConvertToTime(const CellView& src, Cell& dst, const ColumnDefinition& format)
 {
 	return std::visit(overloaded{
-	[&](const std::string& s) -> int
+	[&](std::string_view s) -> int
 	{
 		if (s.empty())
 			return 0;
-		double t; // = strptime(s, format.format);
-		if (!strptime(s, format.format, t))
+		double t;
+		if (!date_format(format).parse(s, t))
 			return -1;
 		dst.emplace<double>(t - int(t));
 		return 1;
@@ -277,16 +311,15 @@ static int ConvertToTime(CellRaw& src, Cell& dst, const ColumnDefinition& format
 	}, src);
 }
 
-static int ConvertToDateTime(CellRaw& src, Cell& dst, const ColumnDefinition& format)
+static int ConvertToDateTime(const CellView& src, Cell& dst, const ColumnDefinition& format)
 {
 	return std::visit(overloaded{
-	[&](const std::string& s) -> int
+	[&](std::string_view s) -> int
 	{
 		if (s.empty())
 			return 0;
-		//dst.emplace<double>(strptime(s, format.format));
 		double t;
-		if (!strptime(s, format.format, t))
+		if (!date_format(format).parse(s, t))
 			return -1;
 		dst.emplace<double>(t);
 		return 1;
@@ -302,16 +335,19 @@ static int ConvertToDateTime(CellRaw& src, Cell& dst, const ColumnDefinition& fo
 
 static ConvertFunc _converters[] = { ConvertToString, ConvertToBool, ConvertToInteger, ConvertToDouble, ConvertToDate, ConvertToTime, ConvertToDateTime };
 
-static int ConvertToList(CellRaw& src, Cell& dst, const ColumnDefinition& format)
+static int ConvertToList(const CellView& src, Cell& dst, const ColumnDefinition& format)
 {
-	const std::string* sp = std::get_if<std::string>(&src);
+	const std::string_view* sp = std::get_if<std::string_view>(&src);
 	if (!sp)
 		return -1;
-	const std::string& s = *sp;
+	std::string_view s = *sp;
 	if (s.empty())
 		return 0;
 	ConvertFunc converter = _converters[static_cast<size_t>(format.column_type)];
-	std::vector<Cell> values;
+	std::vector<Cell>* values = std::get_if<std::vector<Cell>>(&dst); // elements of the previous row are reused
+	if (!values)
+		values = &dst.emplace<std::vector<Cell>>();
+	size_t n_values = 0;
 
 	size_t pos, last_pos, new_pos, end_pos;
 	if (s.front() == '<' && s.back() == '>')
@@ -324,7 +360,7 @@ static int ConvertToList(CellRaw& src, Cell& dst, const ColumnDefinition& format
 			--last_pos;
 		if (pos == last_pos) // empty list "<   >"
 		{
-			dst.emplace<std::vector<Cell>>(std::move(values));
+			values->clear();
 			return 1;
 		}
 	}
@@ -333,30 +369,54 @@ static int ConvertToList(CellRaw& src, Cell& dst, const ColumnDefinition& format
 		pos = 0;
 		last_pos = s.size();
 	}
+	thread_local std::string item; // list items are copied to have terminating 0
 	while (true)
 	{
 		new_pos = end_pos = s.find(',', pos);
-		if (end_pos == std::string::npos)
+		if (end_pos == std::string_view::npos)
 			end_pos = last_pos;
 		while (pos < end_pos && std::isspace(s[pos]))
 			++pos;
 		while (pos < end_pos && std::isspace(s[end_pos - 1]))
 			--end_pos;
-		CellRaw value = s.substr(pos, end_pos - pos);
-		if (converter(value, values.emplace_back(), format) != 1)
+		item.assign(s.data() + pos, end_pos - pos);
+		if (n_values == values->size())
+			values->emplace_back();
+		if (converter(std::string_view(item), (*values)[n_values++], format) != 1)
 			return -1;
-		if (new_pos == std::string::npos)
+		if (new_pos == std::string_view::npos)
 			break;
 		pos = new_pos + 1;
 	}
-	dst.emplace<std::vector<Cell>>(std::move(values));
+	values->resize(n_values);
 	return 1;
 }
 
+int64_t Parser::get_next_row_view(RowView& row)
+{
+	int64_t row_number = get_next_row_raw(m_raw_row);
+	row.clear();
+	for (const CellRaw& cell : m_raw_row)
+		row.push_back(cell_view(cell));
+	return row_number;
+}
+
+// converts value of a data column, returns 1 if converted, 0 for Null, -1 for type error
+static int convert_cell(const Schema& schema, const ColumnDefinition& col, const RowView& raw_row, Cell& dst)
+{
+	if (col.index >= (int)raw_row.size())
+		return 0;
+	const CellView& cell = raw_row[col.index];
+	if (schema.remove_null_strings && cell_null_str(cell))
+		return 0;
+	return col.is_list ?
+		ConvertToList(cell, dst, col) :
+		_converters[static_cast<size_t>(col.column_type)](cell, dst, col);
+}
+
 bool Parser::get_next_row(Row& row)
 {
-	RowRaw raw_row;
-	int64_t row_number = get_next_row_raw(raw_row);
+	int64_t row_number = get_next_row_view(m_row_view);
 	if (row_number < 0)
 		return false;
 	const Schema& schema = *get_schema();
@@ -369,27 +429,10 @@ bool Parser::get_next_row(Row& row)
 		const ColumnDefinition& col = schema.columns[i_col];
 		if (col.index >= 0)
 		{
-			if (col.index >= (int)raw_row.size())
-				row.flagmap[i_col] = false;
-			else
-			{
-				CellRaw& cell = raw_row[col.index];
-				if (schema.remove_null_strings && cell_null_str(cell))
-					row.flagmap[i_col] = false;
-				else
-				{
-					int res = col.is_list ?
-						ConvertToList(cell, row.values[i_col], col) :
-						_converters[static_cast<size_t>(col.column_type)](cell, row.values[i_col], col);
-					if (res >= 0)
-						row.flagmap[i_col] = (bool)res;
-					else
-					{
-						errors[(int)i_col] = { ErrorCode::TypeError, ConvertRawToString(cell) };
-						row.flagmap[i_col] = false;
-					}
-				}
-			}
+			int res = convert_cell(schema, col, m_row_view, row.values[i_col]);
+			if (res < 0)
+				errors[(int)i_col] = { ErrorCode::TypeError, ConvertRawToString(m_row_view[col.index]) };
+			row.flagmap[i_col] = res > 0;
 		}
 		else
 		{
@@ -414,6 +457,226 @@ bool Parser::get_next_row(Row& row)
 	return true;
 }
 
+static ColumnBatch::Values column_batch_values(const ColumnDefinition& col)
+{
+	if (col.index == COL_ROWNUM)
+		return std::vector<int32_t>();
+	if (col.index == COL_ERROR)
+		return std::vector<std::unordered_map<int, ErrorType>>();
+	if (col.is_list)
+		return std::vector<std::vector<Cell>>();
+	switch (col.column_type)
+	{
+	case ColumnType::String: return StringBatch();
+	case ColumnType::Boolean: return std::vector<bool>();
+	case ColumnType::Date:
+	case ColumnType::Integer32: return std::vector<int32_t>();
+	case ColumnType::Decimal:
+	case ColumnType::Time:
+	case ColumnType::Datetime: return std::vector<double>();
+	default: return std::vector<int64_t>();
+	}
+}
+
+// appends converted value to the column if res is 1 and value has the column's type, otherwise appends Null
+static void push_batch_value(ColumnBatch& column, Cell& value, int res)
+{
+	bool is_set = std::visit(overloaded{
+	[&](StringBatch& v)
+	{
+		const std::string* p = res > 0 ? std::get_if<std::string>(&value) : nullptr;
+		v.push_back(p ? std::string_view(*p) : std::string_view());
+		return p != nullptr;
+	},
+	[&](auto& v)
+	{
+		typedef typename std::decay_t<decltype(v)>::value_type T;
+		T* p = res > 0 ? std::get_if<T>(&value) : nullptr;
+		v.push_back(p ? std::move(*p) : T());
+		return p != nullptr;
+	},
+	}, column.values);
+	column.flagmap.push_back(is_set);
+}
+
+// appends value of a data column to the batch, returns -1 without appending anything if the value has wrong type
+static int push_data_value(const Schema& schema, const ColumnDefinition& col, const RowView& raw_row, ColumnBatch& column, Cell& value)
+{
+	StringBatch* strings = std::get_if<StringBatch>(&column.values);
+	const std::string_view* s = strings && col.index < (int)raw_row.size() ? std::get_if<std::string_view>(&raw_row[col.index]) : nullptr;
+	if (s) // text is copied straight into the batch
+	{
+		bool is_null = schema.remove_null_strings && (*s == "NULL" || *s == "null");
+		strings->push_back(is_null ? std::string_view() : *s);
+		column.flagmap.push_back(!is_null);
+		return !is_null;
+	}
+	int res = convert_cell(schema, col, raw_row, value);
+	if (res >= 0)
+		push_batch_value(column, value, res);
+	return res;
+}
+
+static void get_batch_value(ColumnBatch& column, size_t i_row, Cell& dst) // non-string values are moved out of the batch
+{
+	std::visit(overloaded{
+	[&](StringBatch& v) { assign_string(dst, v.get(i_row)); },
+	[&](std::vector<bool>& v) { dst = (bool)v[i_row]; },
+	[&](auto& v) { dst = std::move(v[i_row]); },
+	}, column.values);
+}
+
+std::string widened_text(const Cell& src, const ColumnDefinition& col)
+{
+	auto date_text = [&col](double dt)
+	{
+		std::string s;
+		if (col.format.empty() || !date_format(col).write(dt, s))
+			s = ConvertRawToString(CellRawDate{ dt });
+		return s;
+	};
+	return std::visit(overloaded{
+	[](const std::string& v) { return v; },
+	[](bool v) { return std::string(v ? "true" : "false"); },
+	[&](double v) { return col.column_type == ColumnType::Decimal ? format_double(v) : date_text(v); },
+	[&](int32_t v) { return col.column_type == ColumnType::Date ? date_text(v) : std::to_string(v); },
+	[](auto&& v) -> std::string
+	{
+		if constexpr (std::is_integral_v<std::decay_t<decltype(v)>>)
+			return std::to_string(v);
+		else
+			return std::string();
+	},
+	}, src);
+}
+
+// with streaming inference, keeps the text of a value just appended to a typed column if widening the column to String
+// would not give it back; value holds the converted value if res is 1, scalar values are left in it by push_batch_value()
+static void keep_source_text(const Schema& schema, const ColumnDefinition& col, const RowView& raw_row, ColumnBatch& column,
+	const Cell& value, int res)
+{
+	if (col.is_list || col.column_type == ColumnType::String || col.index >= (int)raw_row.size())
+		return;
+	const CellView& cell = raw_row[col.index];
+	if (schema.remove_null_strings && cell_null_str(cell)) // Null for String columns too
+		return;
+	// the text a String column stores, as in push_data_value()
+	const std::string_view* s = std::get_if<std::string_view>(&cell);
+	std::string text = s ? std::string() : ConvertRawToString(cell);
+	std::string_view source = s ? *s : std::string_view(text);
+	if (res > 0 && widened_text(value, col) == source)
+		return;
+	column.source_text.emplace_back(column.flagmap.size() - 1, std::string(source));
+}
+
+int convert_widened(const Cell& src, const ColumnDefinition& from, Cell& dst, const ColumnDefinition& to)
+{
+	bool is_date = from.column_type == ColumnType::Date || from.column_type == ColumnType::Time || from.column_type == ColumnType::Datetime;
+	CellView typed = std::visit(overloaded{
+	[](const std::string& v) -> CellView { return std::string_view(v); },
+	[](bool v) -> CellView { return v; },
+	[&](double v) -> CellView { if (is_date) return CellRawDate{ v }; return v; },
+	[&](int32_t v) -> CellView { if (is_date) return CellRawDate{ (double)v }; return (int64_t)v; },
+	[](auto&& v) -> CellView
+	{
+		if constexpr (std::is_integral_v<std::decay_t<decltype(v)>>)
+			return (int64_t)v;
+		else
+			return std::string_view();
+	},
+	}, src);
+	ConvertFunc convert = _converters[static_cast<size_t>(to.column_type)];
+	auto convert_text = [&]()
+	{
+		std::string text = widened_text(src, from);
+		return convert(std::string_view(text), dst, to);
+	};
+	// strings get the text, dates also do when the new format may read them differently
+	bool text_first = to.column_type == ColumnType::String || (is_date && from.format != to.format);
+	int res = text_first ? convert_text() : convert(typed, dst, to);
+	if (res < 0)
+		res = text_first ? convert(typed, dst, to) : convert_text();
+	return res;
+}
+
+bool Parser::get_next_batch(RowBatch& batch)
+{
+	const Schema& schema = *get_schema();
+	size_t n_columns = schema.columns.size();
+	batch.columns.resize(n_columns);
+	for (size_t i_col = 0; i_col < n_columns; ++i_col)
+	{
+		ColumnBatch& column = batch.columns[i_col];
+		ColumnBatch::Values values = column_batch_values(schema.columns[i_col]);
+		if (column.values.index() != values.index())
+			column.values = std::move(values);
+		else
+			std::visit([](auto& v) { v.clear(); }, column.values); // keep allocated memory
+		column.flagmap.clear();
+		column.source_text.clear();
+	}
+	batch.size = 0;
+
+	bool inferred = m_streaming_inference && m_inferred_columns;
+	std::unordered_map<int, ErrorType> errors;
+	Cell value;
+	int64_t row_number;
+	while (batch.size < BATCH_SIZE && (row_number = get_next_row_view(m_row_view)) >= 0)
+	{
+		for (size_t i_col = 0; i_col < n_columns; ++i_col)
+		{
+			const ColumnDefinition& col = schema.columns[i_col];
+			ColumnBatch& column = batch.columns[i_col];
+			if (col.index >= 0)
+			{
+				if (inferred)
+					infer_value(col);
+				int res = push_data_value(schema, col, m_row_view, column, value);
+				if (res < 0 && inferred && widen_column(i_col, batch))
+					res = push_data_value(schema, col, m_row_view, column, value);
+				if (res < 0)
+				{
+					errors[(int)i_col] = { ErrorCode::TypeError, ConvertRawToString(m_row_view[col.index]) };
+					push_batch_value(column, value, res);
+				}
+				if (inferred)
+					keep_source_text(schema, col, m_row_view, column, value, res);
+			}
+			else if (col.index == COL_ROWNUM)
+			{
+				std::get<std::vector<int32_t>>(column.values).push_back((int32_t)row_number);
+				column.flagmap.push_back(true);
+			}
+			else if (col.index == COL_ERROR)
+			{
+				column.flagmap.push_back(!errors.empty());
+				std::get<std::vector<std::unordered_map<int, ErrorType>>>(column.values).push_back(std::move(errors));
+				errors.clear();
+			}
+			else
+				push_batch_value(column, value, 0);
+		}
+		++batch.size;
+	}
+	if (inferred) // types may have widened without conversion errors, e.g. Integer to Decimal
+		for (size_t i_col = 0; i_col < n_columns; ++i_col)
+			widen_column(i_col, batch);
+	return batch.size > 0;
+}
+
+void RowBatch::move_row(size_t i_row, Row& row)
+{
+	row.values.resize(columns.size());
+	row.flagmap.resize(columns.size());
+	for (size_t i_col = 0; i_col < columns.size(); ++i_col)
+	{
+		ColumnBatch& column = columns[i_col];
+		Cell& dst = row.values[i_col];
+		row.flagmap[i_col] = column.flagmap[i_row];
+		get_batch_value(column, i_row, dst);
+	}
+}
+
 int Parser::get_percent_complete()
 {
 	return 0;
@@ -472,70 +735,72 @@ public:
 		return m_valid;
 	}
 
-	int infer(const CellRaw& cell) = delete;
+	int infer(const CellView& cell) = delete;
+
+	void merge(const TType& other)
+	{
+		m_valid = m_valid && other.m_valid;
+	}
 
 	bool m_valid = true;
 };
 
 template<>
-int TType<ColumnType::Boolean>::infer(const CellRaw& cell)
+int TType<ColumnType::Boolean>::infer(const CellView& cell)
 {
 	if (!m_valid)
 		return 0;
 	return m_valid = std::visit(overloaded{
-	[](const std::string& s) -> bool { return _bool_dict.find(s) != _bool_dict.end(); },
+	[](std::string_view s) -> bool { return _bool_dict.find(s) != _bool_dict.end(); },
 	[](bool v) -> bool { return true; },
 	[](int64_t v) -> bool { return v == 0 || v == 1; },
 	[](auto v) -> bool { return false; },
 	}, cell);
 }
 
-static const std::regex _re_check_integer(R"(0|-?[1-9]\d*)");
 template<>
-int TType<ColumnType::Integer>::infer(const CellRaw& cell)
+int TType<ColumnType::Integer>::infer(const CellView& cell)
 {
 	if (!m_valid)
 		return 0;
 	return m_valid = std::visit(overloaded{
-	[](const std::string& s) -> bool { return std::regex_match(s, _re_check_integer); },
+	[](std::string_view s) -> bool { return match_integer(s); },
 	[](double v) -> bool { return is_integer(v); },
 	[](auto v) -> bool { return std::is_integral_v<decltype(v)>; },
 	}, cell);
 }
 
 template<>
-int TType<ColumnType::Integer32>::infer(const CellRaw& cell)
+int TType<ColumnType::Integer32>::infer(const CellView& cell)
 {
   if (!m_valid)
     return 0;
-  return m_valid = std::regex_match(std::get<std::string>(cell), _re_check_integer);
+  return m_valid = match_integer(std::get<std::string_view>(cell));
 }
 
 template<>
-int TType<ColumnType::Integer16>::infer(const CellRaw& cell)
+int TType<ColumnType::Integer16>::infer(const CellView& cell)
 {
   if (!m_valid)
     return 0;
-  return m_valid = std::regex_match(std::get<std::string>(cell), _re_check_integer);
+  return m_valid = match_integer(std::get<std::string_view>(cell));
 }
 
 template<>
-int TType<ColumnType::Integer8>::infer(const CellRaw& cell)
+int TType<ColumnType::Integer8>::infer(const CellView& cell)
 {
   if (!m_valid)
     return 0;
-  return m_valid = std::regex_match(std::get<std::string>(cell), _re_check_integer);
+  return m_valid = match_integer(std::get<std::string_view>(cell));
 }
 
-static const std::regex _re_check_decimal(R"([+-]?(0|[1-9]\d*|\d+\.|\d*\.\d+)([eE][+-]\d+)?)", std::regex::nosubs);
-
 template<>
-int TType<ColumnType::Decimal>::infer(const CellRaw& cell)
+int TType<ColumnType::Decimal>::infer(const CellView& cell)
 {
 	if (!m_valid)
 		return 0;
 	return m_valid = std::visit(overloaded{
-	[](const std::string& s) -> bool { return std::regex_match(s, _re_check_decimal); },
+	[](std::string_view s) -> bool { return match_decimal(s); },
 	[](auto v) -> bool { return std::is_arithmetic_v<decltype(v)>; },
 	}, cell);
 }
@@ -549,13 +814,10 @@ static const std::unordered_map<std::string, char> _dt_tokens {
 	{"jan", 'b'}, {"feb", 'b'}, {"mar", 'b'}, {"apr", 'b'}, {"may", 'b'}, {"jun", 'b'}, {"jul", 'b'}, {"aug", 'b'}, {"sep", 'b'}, {"oct", 'b'}, {"nov", 'b'}, {"dec", 'b'}
 };
 
-// time | number | word | non-word
-static const std::regex _re_dt_components(R"((\d\d?\s*:\s*\d\d(?:\s*:\s*\d\d(?:[.,]\d{1,6})?)?(?!\d))|(\d+)|[a-zA-Z]+|[^\da-zA-Z]+)");
-
 class TDateTime
 {
 public:
-	bool infer_dt_format(const std::string& input_string, bool month_first = true)
+	bool infer_dt_format(std::string_view input_string, bool month_first = true)
 	{
 		char c;
 		std::string fmt_s; // current format string with "%_" placeholders for d/m/y tokens
@@ -565,20 +827,23 @@ public:
 		int where_year = -1; // if found definite year token - how many d/m/y placeholders were found before it
 		bool have_ampm = false, have_month = false;
 		// separate time, numbers, words and delimiters, time is H:MM[:SS[.FFFFFF]]
-		for (std::sregex_iterator m(input_string.begin(), input_string.end(), _re_dt_components); m != std::sregex_iterator(); ++m)
+		DTToken kind;
+		for (size_t pos = 0, token_size; pos < input_string.size(); pos += token_size)
 		{
-			if ((*m)[2].matched) // token is number
+			token_size = next_dt_token(input_string, pos, kind);
+			std::string_view token(input_string.data() + pos, token_size);
+			if (kind == DTToken::Number)
 			{
-				int lng = (int)m->length();
-				if ((lng == 4 || lng == 6) && m->position() > 0 && (c = input_string[m->position() - 1], c == '+' || c == '-') && // may be timezone offset -0100
-						!(lng == 4 && std::stoi(m->str()) > 1500)) // though it also may be year. Limit offset to 1500 in the hopes that Samoa or Kiribati won't shift further east.
+				int lng = (int)token_size;
+				if ((lng == 4 || lng == 6) && pos > 0 && (c = input_string[pos - 1], c == '+' || c == '-') && // may be timezone offset -0100
+						!(lng == 4 && std::stoi(std::string(token)) > 1500)) // though it also may be year. Limit offset to 1500 in the hopes that Samoa or Kiribati won't shift further east.
 				{
 					fmt_s.back() = '%'; // instead of previous '+|-'
 					fmt_s += 'z';
 				}
 				else
 				{
-					if (lng == 8 && "19000101" <= (*m)[0] && (*m)[0] <= "20991231") // YYYYMMDD
+					if (lng == 8 && "19000101" <= token && token <= "20991231") // YYYYMMDD
 					{
 						if (where_year >= 0)
 							return false;
@@ -603,7 +868,7 @@ public:
 						return false;
 				}
 			}
-			else if ((*m)[1].matched) // valid time sequence, encode as 't'
+			else if (kind == DTToken::Time) // valid time sequence, encode as 't'
 			{
 				if (where_hour >= 0)
 					return false;
@@ -611,7 +876,7 @@ public:
 				static const char time_fmt[] = { 'H', 'M', 'S', 'f' };
 				size_t i_fmt = 0;
 				bool in_digits = false;
-				for (auto i = (*m)[0].first, end = (*m)[0].second; i < end; ++i) // substitute all numbers in time with corresponding format codes
+				for (auto i = token.begin(), end = token.end(); i < end; ++i) // substitute all numbers in time with corresponding format codes
 				{
 					bool is_digit = std::isdigit(*i);
 					if (!is_digit)
@@ -623,12 +888,12 @@ public:
 			}
 			else
 			{
-				std::string s = m->str();
+				std::string s(token);
 				std::transform(s.begin(), s.end(), s.begin(), ::tolower);
 				auto new_s = _dt_tokens.find(s); // find a format code of a word
 				if (new_s == _dt_tokens.end())
 				{
-					for (auto i = (*m)[0].first, end = (*m)[0].second; i < end; ++i)
+					for (auto i = token.begin(), end = token.end(); i < end; ++i)
 					{
 						if (*i == '%') // escape literal %
 							fmt_s += '%';
@@ -700,21 +965,30 @@ public:
 		return !m_formats.empty();
 	}
 
-	int infer(const CellRaw& cell)
+	int infer(const CellView& cell)
 	{
 		if (!m_valid)
 			return 0;
 		return m_valid = std::visit(overloaded{
-		[this](const std::string& input_string) -> bool
+		[this](std::string_view input_string) -> bool
 		{
 			if (m_formats.empty())
 				return infer_dt_format(input_string);
-			for (auto it = m_formats.end(); it > m_formats.begin();)
+			if (m_parsers.size() != m_formats.size()) // candidate formats are compiled once they are found
 			{
-				--it;
+				m_parsers.clear();
+				for (const std::string& format : m_formats)
+					m_parsers.emplace_back(format);
+			}
+			for (size_t i = m_formats.size(); i > 0;)
+			{
+				--i;
 				double t;
-				if (!strptime(input_string, *it, t))
-					it = m_formats.erase(it);
+				if (!m_parsers[i].parse(input_string, t))
+				{
+					m_formats.erase(m_formats.begin() + i);
+					m_parsers.erase(m_parsers.begin() + i);
+				}
 				else if (t - int(t) != 0.0)
 					m_have_time = true;
 			}
@@ -747,23 +1021,44 @@ public:
 		return m_valid;
 	}
 
+	// candidate formats have to read the values of both
+	void merge(const TDateTime& other)
+	{
+		m_valid = m_valid && other.m_valid;
+		if (!m_valid)
+			return;
+		m_have_time = m_have_time || other.m_have_time;
+		m_have_date = m_have_date || other.m_have_date;
+		if (other.m_formats.empty())
+			return;
+		if (m_formats.empty())
+			m_formats = other.m_formats;
+		else
+			m_formats.erase(std::remove_if(m_formats.begin(), m_formats.end(), [&other](const std::string& format)
+				{ return std::find(other.m_formats.begin(), other.m_formats.end(), format) == other.m_formats.end(); }),
+				m_formats.end());
+		m_parsers.clear();
+		m_valid = !m_formats.empty();
+	}
+
 	bool m_valid = true;
 	bool m_have_time = false;
 	bool m_have_date = false;
 	std::vector<std::string> m_formats;
+	std::vector<DateFormat> m_parsers; // compiled m_formats
 };
 
 class TList
 {
 public:
-	int infer(const CellRaw& cell)
+	int infer(const CellView& cell)
 	{
 		if (!m_valid)
 			return 0;
-		const std::string* sp = std::get_if<std::string>(&cell);
+		const std::string_view* sp = std::get_if<std::string_view>(&cell);
 		if (!sp)
 			return m_valid = false;
-		const std::string& s = *sp;
+		std::string_view s = *sp;
 
 		size_t pos, last_pos, new_pos, end_pos;
 		if (s.front() == '<' && s.back() == '>')
@@ -785,16 +1080,18 @@ public:
 		while (true)
 		{
 			new_pos = end_pos = s.find(',', pos);
-			if (end_pos == std::string::npos)
+			if (end_pos == std::string_view::npos)
 				end_pos = last_pos;
 			while (pos < end_pos && std::isspace((unsigned char)s[pos]))
 				++pos;
 			while (pos < end_pos && std::isspace((unsigned char)s[end_pos - 1]))
 				--end_pos;
-			CellRaw value = s.substr(pos, end_pos - pos);
+			thread_local std::string item; // list items are copied to have terminating 0
+			item.assign(s.data() + pos, end_pos - pos);
+			CellView value(std::in_place_type<std::string_view>, item);
 			if (std::apply([&value](auto&& ... args) { return (args.infer(value) + ...); }, m_types) == 0)
 				return m_valid = false;
-			if (new_pos == std::string::npos)
+			if (new_pos == std::string_view::npos)
 				break;
 			pos = new_pos + 1;
 		}
@@ -811,6 +1108,11 @@ public:
 		return m_valid;
 	}
 
+	void merge(const TList& other) // streaming inference does not infer lists
+	{
+		m_valid = m_valid && other.m_valid;
+	}
+
 	bool m_valid = true;
 	std::tuple<
 		TType<ColumnType::Boolean>,
@@ -820,22 +1122,20 @@ public:
 	> m_types;
 };
 
-static const std::regex _re_not_list_item(R"(\.(\W|$))", std::regex::nosubs);
-
 class TStringList
 {
 public:
-	int infer(const CellRaw& cell)
+	int infer(const CellView& cell)
 	{
 		if (!m_valid)
 			return 0;
-		const std::string* sp = std::get_if<std::string>(&cell);
+		const std::string_view* sp = std::get_if<std::string_view>(&cell);
 		if (!sp)
 			return m_valid = false;
-		const std::string& s = *sp;
+		std::string_view s = *sp;
 		return m_valid =
 			s.front() == '<' && s.back() == '>' ||
-			s.find(',') != std::string::npos && !std::regex_search(s, _re_not_list_item);
+			s.find(',') != std::string_view::npos && !search_not_list_item(s);
 	}
 
 	bool create_schema(ColumnDefinition& col) const
@@ -848,22 +1148,25 @@ public:
 		return m_valid;
 	}
 
+	void merge(const TStringList& other)
+	{
+		m_valid = m_valid && other.m_valid;
+	}
+
 	bool m_valid = true;
 };
 
-static const std::regex _re_is_xml(R"(^<(?:\?xml|(\w+)(?:.*</\1|/)>$))");
-
 class TXML
 {
 public:
-	int infer(const CellRaw& cell)
+	int infer(const CellView& cell)
 	{
 		if (!m_valid)
 			return 0;
-		const std::string* sp = std::get_if<std::string>(&cell);
+		const std::string_view* sp = std::get_if<std::string_view>(&cell);
 		if (!sp)
 			return m_valid = false;
-		return m_valid = std::regex_search(*sp, _re_is_xml);
+		return m_valid = match_xml(*sp);
 	}
 
 	bool create_schema(ColumnDefinition& col) const
@@ -876,30 +1179,27 @@ public:
 		return m_valid;
 	}
 
+	void merge(const TXML& other)
+	{
+		m_valid = m_valid && other.m_valid;
+	}
+
 	bool m_valid = true;
 };
 
-#if defined(_MSC_VER) && defined(_WIN64)
-static const std::regex _re_is_json(R"((\[|\{\s*"([^"\\]|\\.)*"\s*:\s*((?=")|[{[0-9.\-]|true|false|null))([,:{}\[\]0-9.\-+Eaeflnr-u \n\r\t]|"[^"]*")*[}\]]|\{\s*\})", std::regex::nosubs);
-#else
-static const std::regex _re_is_json(R"((\[|\{\s*"([^"\\]|\\.)*"\s*:\s*((?=")|[{[0-9.\-]|true|false|null))([,:{}\[\]0-9.\-+Eaeflnr-u \n\r\t]|"([^"\\]|\\.)*")*[}\]]|\{\s*\})", std::regex::nosubs);
-#endif
-
-static const std::regex _re_is_geojson(R"~("type"\s*:\s*"(Point|MultiPoint|LineString|MultiLineString|Polygon|MultiPolygon|GeometryCollection|Feature|FeatureCollection)"|^\{\s*\}$)~", std::regex::nosubs);
-
 class TJSON
 {
 public:
-	int infer(const CellRaw& cell)
+	int infer(const CellView& cell)
 	{
 		if (!m_valid)
 			return 0;
-		const std::string* sp = std::get_if<std::string>(&cell);
+		const std::string_view* sp = std::get_if<std::string_view>(&cell);
 		if (!sp)
 			return m_valid = false;
-		m_valid = std::regex_match(*sp, _re_is_json);
+		m_valid = match_json(*sp);
 		if (m_valid && m_is_geo)
-			m_is_geo = std::regex_search(*sp, _re_is_geojson);
+			m_is_geo = match_geojson(*sp);
 		return m_valid;
 	}
 
@@ -913,23 +1213,27 @@ public:
 		return m_valid;
 	}
 
+	void merge(const TJSON& other)
+	{
+		m_valid = m_valid && other.m_valid;
+		m_is_geo = m_is_geo && other.m_is_geo;
+	}
+
 	bool m_valid = true;
 	bool m_is_geo = true;
 };
 
-static const std::regex _re_is_wkt(R"(\s*(POINT|LINESTRING|CIRCULARSTRING|COMPOUNDCURVE|CURVEPOLYGON|POLYGON|TRIANGLE|MULTIPOINT|MULTICURVE|MULTILINESTRING|MULTISURFACE|MULTIPOLYGON|POLYHEDRALSURFACE|TIN|GEOMETRYCOLLECTION)(\s+(Z|M|ZM))?\s*(\(|EMPTY)[\sa-zA-Z0-9()+\-.,]*)", std::regex::nosubs | std::regex::icase);
-
 class TWKT
 {
 public:
-	int infer(const CellRaw& cell)
+	int infer(const CellView& cell)
 	{
 		if (!m_valid)
 			return 0;
-		const std::string* sp = std::get_if<std::string>(&cell);
+		const std::string_view* sp = std::get_if<std::string_view>(&cell);
 		if (!sp)
 			return m_valid = false;
-		return m_valid = std::regex_match(*sp, _re_is_wkt);
+		return m_valid = match_wkt(*sp);
 	}
 
 	bool create_schema(ColumnDefinition& col) const
@@ -942,6 +1246,11 @@ public:
 		return m_valid;
 	}
 
+	void merge(const TWKT& other)
+	{
+		m_valid = m_valid && other.m_valid;
+	}
+
 	bool m_valid = true;
 };
 
@@ -950,12 +1259,13 @@ public:
 class Column
 {
 public:
-	bool infer(const CellRaw& cell)
+	// lists=false skips list types, streaming inference uses it for columns which are not lists
+	bool infer(const CellView& cell, bool lists = true)
 	{
-		if (!cell_empty(cell))
+		if (!view_empty(cell))
 		{
 			empty = false;
-			return std::apply([&cell](auto&& ... args) { return (args.infer(cell) + ...); }, m_types) > 0;
+			return std::apply([&](auto&& ... args) { return (infer_type(args, cell, lists) + ...); }, m_types) > 0;
 		}
 		return true;
 	}
@@ -968,9 +1278,30 @@ public:
 	{
 		return std::apply([](auto&& ... args) { return (args.m_valid || ...); }, m_types);
 	}
+	// state after the values of both columns
+	void merge(const Column& other)
+	{
+		empty = empty && other.empty;
+		merge_types(other, std::make_index_sequence<std::tuple_size_v<decltype(m_types)>>());
+	}
 	std::string name;
 	bool empty = true;
 private:
+	template<size_t... I>
+	void merge_types(const Column& other, std::index_sequence<I...>)
+	{
+		(std::get<I>(m_types).merge(std::get<I>(other.m_types)), ...);
+	}
+
+	template<class T>
+	static int infer_type(T& type, const CellView& cell, bool lists)
+	{
+		if constexpr (std::is_same_v<T, TList> || std::is_same_v<T, TStringList>)
+			if (!lists)
+				return 0;
+		return type.infer(cell);
+	}
+
 	std::tuple<
 		TType<ColumnType::Boolean>,
 		TType<ColumnType::Integer>,
@@ -1128,7 +1459,7 @@ void Parser::infer_table(const std::string* comment)
 
 		for (size_t i_col = 0; i_col < n_columns; ++i_col)
 			for (size_t i_row = 1; i_row < rows.size(); ++i_row) // ignore potential header for now
-				if (!columns[i_col].infer(rows[i_row][i_col])) // no consistent type
+				if (!columns[i_col].infer(cell_view(rows[i_row][i_col]))) // no consistent type
 					break;
 
 		found_header = false;
@@ -1141,7 +1472,7 @@ void Parser::infer_table(const std::string* comment)
 			if (cell_empty(v))
 				continue;
 			// include header into type detection
-			if (!columns_header[i_col].infer(v) && !columns[i_col].empty) // do not detect header for empty columns
+			if (!columns_header[i_col].infer(cell_view(v)) && !columns[i_col].empty) // do not detect header for empty columns
 			{
 				found_header = true;
 				break;
@@ -1156,9 +1487,11 @@ void Parser::infer_table(const std::string* comment)
 
 	if (found_header)
 		for (size_t i = 0; i < columns.size(); ++i)
-			columns[i].name = ConvertRawToString(rows[0][i]);
+			columns[i].name = ConvertRawToString(cell_view(rows[0][i]));
 
 	build_column_info(columns);
+	if (m_streaming_inference)
+		m_inferred_columns = std::make_shared<std::vector<Column>>(std::move(columns));
 	if (CSVSchema* schema = dynamic_cast<CSVSchema*>(get_schema()))
 	{
 		schema->first_data_row = found_header ? data_row : header_row;
@@ -1171,6 +1504,99 @@ void Parser::infer_table(const std::string* comment)
 	}
 }
 
+void Parser::infer_value(const ColumnDefinition& col)
+{
+	if (col.is_list || col.index >= (int)m_row_view.size())
+		return;
+	const CellView& cell = m_row_view[col.index];
+	if (!(get_schema()->remove_null_strings && cell_null_str(cell)))
+		(*m_inferred_columns)[col.index].infer(cell, false);
+}
+
+void convert_batch_column(ColumnBatch& column, const ColumnDefinition& from, const ColumnDefinition& to)
+{
+	if (from.column_type == ColumnType::String && to.column_type == ColumnType::String) // only the format changes
+		return;
+	ColumnBatch converted;
+	converted.values = column_batch_values(to);
+	bool to_string = to.column_type == ColumnType::String;
+	auto source = column.source_text.begin();
+	Cell src, dst;
+	for (size_t i_row = 0; i_row < column.flagmap.size(); ++i_row)
+	{
+		bool has_source = source != column.source_text.end() && source->first == i_row;
+		int res = 0;
+		if (has_source && to_string)
+		{
+			dst = std::move(source->second);
+			res = 1;
+		}
+		else if (column.flagmap[i_row])
+		{
+			get_batch_value(column, i_row, src);
+			res = convert_widened(src, from, dst, to);
+		}
+		push_batch_value(converted, dst, res);
+		if (has_source)
+		{
+			if (!to_string)
+				converted.source_text.push_back(std::move(*source));
+			++source;
+		}
+		else if (!to_string && column.flagmap[i_row])
+		{
+			// the text of the value may change with its type or date format, keep the one it had
+			std::string text = widened_text(src, from);
+			if (res <= 0 || widened_text(dst, to) != text)
+				converted.source_text.emplace_back(i_row, std::move(text));
+		}
+	}
+	column = std::move(converted);
+}
+
+bool Parser::infer_widened(size_t i_col, ColumnDefinition& widened)
+{
+	const ColumnDefinition& col = get_schema()->columns[i_col];
+	if (col.index < 0 || col.is_list)
+		return false;
+	widened = { col.column_name, ColumnType::String, col.index, false };
+	(*m_inferred_columns)[col.index].create_schema(widened);
+	if (widened.is_list) // lists are inferred from the first rows only
+		widened = { col.column_name, ColumnType::String, col.index, false };
+	return widened.column_type != col.column_type || widened.format != col.format;
+}
+
+bool Parser::widen_column(size_t i_col, RowBatch& batch)
+{
+	ColumnDefinition widened;
+	if (!infer_widened(i_col, widened))
+		return false;
+	ColumnDefinition& col = get_schema()->columns[i_col];
+	convert_batch_column(batch.columns[i_col], col, widened);
+	col = std::move(widened);
+	get_schema()->widen_count++;
+	return true;
+}
+
+std::shared_ptr<std::vector<Column>> Parser::copy_inference(const std::vector<Column>& inferred_columns)
+{
+	return std::make_shared<std::vector<Column>>(inferred_columns);
+}
+
+void Parser::merge_inference(const std::vector<Column>& inferred_columns)
+{
+	for (size_t i = 0; i < m_inferred_columns->size() && i < inferred_columns.size(); ++i)
+		(*m_inferred_columns)[i].merge(inferred_columns[i]);
+	Schema& schema = *get_schema();
+	ColumnDefinition widened;
+	for (size_t i_col = 0; i_col < schema.columns.size(); ++i_col)
+		if (infer_widened(i_col, widened))
+		{
+			schema.columns[i_col] = std::move(widened);
+			schema.widen_count++;
+		}
+}
+
 bool Parser::infer_schema()
 {
 	Schema& schema = *get_schema();
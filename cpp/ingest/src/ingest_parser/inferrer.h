@@ -6,12 +6,15 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <variant>
 
 namespace Ingest {
 
 const int INFER_MAX_ROWS = 100;
+const size_t BATCH_SIZE = 64 * 1024; // max number of rows returned by Parser::get_next_batch()
 
 enum class ColumnType { String, Boolean, Integer, Decimal, Date, Time, Datetime, Error, ListInteger, ListDecimal,
 						ListDatetime, ListDate, ListTime, ListBoolean, ListString, Integer32,
@@ -21,6 +24,8 @@ enum ServiceColumns { COL_ROWNUM = -1, COL_COUNT = -2, COL_ERROR = -3 };
 
 enum SchemaStatus { STATUS_OK = 0, STATUS_INVALID_FILE = 1 };
 
+class DateFormat;
+
 struct ColumnDefinition
 {
 	std::string column_name;
@@ -28,6 +33,7 @@ struct ColumnDefinition
 	int index; // 0-based
 	bool is_list;
 	std::string format; // datetime format
+	mutable std::shared_ptr<const DateFormat> date_format; // format compiled by the parser on first use
 };
 
 class Schema
@@ -37,6 +43,7 @@ public:
 	SchemaStatus status = STATUS_OK;
 	bool remove_null_strings = true; // "NULL" and "null" strings signify null values
 	bool has_truncated_string = false; // if a string longer than allowed limit was truncated
+	unsigned widen_count = 0; // incremented each time streaming inference widens columns
 	virtual ~Schema() {}
 };
 
@@ -90,17 +97,63 @@ public:
 	Row(size_t count) : values(count), flagmap(count) {}
 };
 
+// strings of a column batch stored one after another
+class StringBatch
+{
+public:
+	std::string chars;
+	std::vector<size_t> ends; // end of each string in chars
+	size_t size() const { return ends.size(); }
+	std::string_view get(size_t i) const { size_t start = i > 0 ? ends[i - 1] : 0; return std::string_view(chars.data() + start, ends[i] - start); }
+	void push_back(std::string_view s) { chars.append(s.data(), s.size()); ends.push_back(chars.size()); }
+	void clear() { chars.clear(); ends.clear(); }
+};
+
+// values of one column for consecutive rows, values are of the type which Cell holds for the column type,
+// Null values are default-constructed
+class ColumnBatch
+{
+public:
+	typedef std::variant<StringBatch, std::vector<bool>, std::vector<int64_t>, std::vector<int32_t>, std::vector<double>,
+		std::vector<std::vector<Cell>>, std::vector<std::unordered_map<int, ErrorType>>> Values;
+	Values values;
+	std::vector<bool> flagmap; // false means value is Null
+	// with streaming inference, source text of typed values by row, kept for values of which widened_text() gives
+	// a different text (e.g. "1.50" or "007") or none, so a column widened to String gets the text of the file
+	std::vector<std::pair<size_t, std::string>> source_text;
+};
+
+class RowBatch
+{
+public:
+	std::vector<ColumnBatch> columns; // in the order of schema columns
+	size_t size = 0; // number of rows
+	void move_row(size_t i_row, Row& row); // copies row values, non-string values are moved out of the batch
+};
+
 struct CellRawDate {
 	double d;
 	bool operator== (const CellRawDate& other) const { return other.d == d; }
 };
 typedef std::variant<std::string, int64_t, bool, double, CellRawDate> CellRaw;
 typedef std::vector<CellRaw> RowRaw;
+// same as CellRaw but strings are views into the parser's buffers valid until the next row is read,
+// viewed strings are always followed by terminating 0
+typedef std::variant<std::string_view, int64_t, bool, double, CellRawDate> CellView;
+typedef std::vector<CellView> RowView;
 class Column;
 
 class BaseReader;
 class ZIPParser;
 
+// text of a value stored for a column, dates are written in the column's format
+std::string widened_text(const Cell& src, const ColumnDefinition& col);
+// converts src, a value of column from, to the type of column to which is a widening of from, returns 1 if converted, -1 if not
+int convert_widened(const Cell& src, const ColumnDefinition& from, Cell& dst, const ColumnDefinition& to);
+// converts all values of a batch column with convert_widened(), values which do not convert become Null,
+// values with source text get the text when the column is widened to String
+void convert_batch_column(ColumnBatch& column, const ColumnDefinition& from, const ColumnDefinition& to);
+
 class Parser
 {
 public:
@@ -110,7 +163,10 @@ public:
 	virtual Schema* get_schema() = 0; // returns pointer to instance member, do not delete
 	virtual bool open();
 	virtual void close();
-	bool get_next_row(Row& row);
+	virtual bool get_next_row(Row& row);
+	// reads up to BATCH_SIZE rows, returns false if there are no more rows; with streaming inference
+	// column types of the schema may widen while the rows are read, batch values have the types after the call
+	virtual bool get_next_batch(RowBatch& batch);
 	virtual int get_percent_complete();
 	virtual size_t get_sheet_count();
 	virtual std::vector<std::string> get_sheet_names();
@@ -120,14 +176,32 @@ public:
 	virtual std::vector<std::string> get_file_names();
 	virtual bool select_file(const std::string& file_name);
 	virtual bool select_file(size_t file_number);
+	void set_thread_count(size_t thread_count) { m_thread_count = thread_count; } // 0 - use all hardware threads, 1 - parse in the calling thread only
+	// set before infer_schema(): get_next_batch() goes on inferring types from all rows instead of the first INFER_MAX_ROWS
+	// and widens the types of columns, e.g. Integer to Decimal or to String
+	void set_streaming_inference(bool enable) { m_streaming_inference = enable; }
 
 protected:
 	friend class ZIPParser;
 	static Parser* get_parser_from_reader(std::shared_ptr<BaseReader> reader);
 	virtual bool do_infer_schema() = 0;
 	virtual int64_t get_next_row_raw(RowRaw& row) = 0;
+	virtual int64_t get_next_row_view(RowView& row); // by default converts the row from get_next_row_raw()
 	void build_column_info(const std::vector<Column>& columns);
 	void infer_table(const std::string* comment);
+	void infer_value(const ColumnDefinition& col); // adds value of a data column from m_row_view to streaming inference
+	bool widen_column(size_t i_col, RowBatch& batch); // applies streaming inference to the column, returns true if its type changed
+	bool infer_widened(size_t i_col, ColumnDefinition& widened); // definition of the column from streaming inference, returns true if it differs
+	// parsers reading parts of the rows in parallel start from a copy of the inference state,
+	// their states are merged back in the order of the parts and the schema types are widened to the result
+	static std::shared_ptr<std::vector<Column>> copy_inference(const std::vector<Column>& inferred_columns);
+	void merge_inference(const std::vector<Column>& inferred_columns);
+
+	size_t m_thread_count = 0;
+	bool m_streaming_inference = false;
+	std::shared_ptr<std::vector<Column>> m_inferred_columns; // type inference state of data columns for streaming inference
+	RowRaw m_raw_row;
+	RowView m_row_view;
 };
 
 }
@@ -4,7 +4,10 @@
 #include <cctype>
 #include <cmath>
 #include <limits>
-#include <regex>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <charconv>
 
 #include "utility.h"
 
@@ -23,13 +26,132 @@ bool is_integer(double v)
 static const char* _weekdays[] = { "sunday", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday" };
 static const char* _months[] = { "january", "february", "march", "april", "may", "june", "july", "august", "september", "october", "november", "december" };
 
-static const std::regex _re_z(R"([+-]\d\d:?[0-5]\d(:?[0-5]\d(\.\d{1,6})?)?)", std::regex::nosubs);
-
 inline static char _to_lower(char c)
 {
 	return c >= 'A' && c <= 'Z' ? c - ('A' - 'a') : c;
 }
 
+inline static bool _is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+inline static bool _is_space(char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static const double _pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+bool parse_int64(std::string_view src, int64_t& v)
+{
+	size_t i = 0;
+	bool negative = false;
+	if (!src.empty() && (src[0] == '-' || src[0] == '+'))
+		negative = src[i++] == '-';
+	size_t digits_end = std::min(src.size(), i + 18); // 18 digits can't overflow
+	uint64_t n = 0;
+	size_t start = i;
+	while (i < digits_end && _is_digit(src[i]))
+		n = n * 10 + (src[i++] - '0');
+	if (i > start && i == src.size())
+	{
+		v = negative ? -(int64_t)n : (int64_t)n;
+		return true;
+	}
+	char* endptr;
+	v = std::strtoll(src.data(), &endptr, 10);
+	return *endptr == '\0';
+}
+
+// decimal numbers with up to 19 significant digits and small exponent are converted exactly with one
+// floating point operation (Clinger's fast path), longer ones go to std::from_chars() which is exact too,
+// and anything else (hex, inf, nan, leading spaces) is left to strtod()
+bool parse_double(std::string_view src, double& v)
+{
+	size_t i = 0, size = src.size();
+	bool negative = false;
+	if (i < size && (src[i] == '-' || src[i] == '+'))
+		negative = src[i++] == '-';
+	uint64_t mantissa = 0;
+	int n_digits = 0; // significant digits in mantissa
+	int exponent = 0;
+	bool has_digits = false;
+	bool is_long = false; // mantissa doesn't fit in 19 digits
+	for (; i < size && _is_digit(src[i]); ++i)
+	{
+		has_digits = true;
+		if (n_digits < 19)
+		{
+			if (mantissa > 0 || src[i] != '0')
+				++n_digits;
+			mantissa = mantissa * 10 + (src[i] - '0');
+		}
+		else
+			is_long = true;
+	}
+	if (i < size && src[i] == '.')
+		for (++i; i < size && _is_digit(src[i]); ++i)
+		{
+			has_digits = true;
+			if (n_digits < 19)
+			{
+				if (mantissa > 0 || src[i] != '0')
+					++n_digits;
+				mantissa = mantissa * 10 + (src[i] - '0');
+				--exponent;
+			}
+			else
+				is_long = true;
+		}
+	bool is_plain = has_digits;
+	if (is_plain && i < size && (src[i] == 'e' || src[i] == 'E'))
+	{
+		++i;
+		bool exp_negative = false;
+		if (i < size && (src[i] == '-' || src[i] == '+'))
+			exp_negative = src[i++] == '-';
+		int exp = 0;
+		size_t start = i;
+		for (; i < size && _is_digit(src[i]); ++i)
+			if (exp < 100000)
+				exp = exp * 10 + (src[i] - '0');
+		is_plain = i > start;
+		exponent += exp_negative ? -exp : exp;
+	}
+	if (is_plain && i == size)
+	{
+		if (!is_long && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+		{
+			double d = (double)mantissa;
+			d = exponent < 0 ? d / _pow10[-exponent] : d * _pow10[exponent];
+			v = negative ? -d : d;
+			return true;
+		}
+#if defined(__cpp_lib_to_chars)
+		const char* begin = src.data() + (src[0] == '+'); // from_chars() doesn't accept '+'
+		auto [end, ec] = std::from_chars(begin, src.data() + size, v);
+		if (ec == std::errc() && end == src.data() + size)
+			return true;
+#endif
+	}
+	char* endptr;
+	v = std::strtod(src.data(), &endptr);
+	return *endptr == '\0';
+}
+
+std::string format_double(double v)
+{
+	char buf[32];
+#if defined(__cpp_lib_to_chars)
+	auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+	if (ec == std::errc())
+		return std::string(buf, end);
+#endif
+	return std::string(buf, std::snprintf(buf, sizeof(buf), "%.17g", v));
+}
+
 static bool find_string(const char*& src, const char** lookup, size_t size, int& result)
 {
 	for (size_t n = 0; n < size; ++n)
@@ -77,95 +199,139 @@ static int read_number(const char*& src, size_t limit, int& result)
 	return (int)i;
 }
 
-bool strptime(const std::string& s_src, const std::string& s_fmt, double& dt)
+// matches [+-]\d\d:?[0-5]\d(:?[0-5]\d(\.\d{1,6})?)? at the start of src
+static bool skip_time_zone(const char*& src)
+{
+	const char* p = src;
+	auto two_digits = [&p]() -> bool // :?[0-5]\d
+	{
+		const char* q = p + (*p == ':');
+		if (*q < '0' || *q > '5' || !_is_digit(q[1]))
+			return false;
+		p = q + 2;
+		return true;
+	};
+	if ((*p != '+' && *p != '-') || !_is_digit(p[1]) || !_is_digit(p[2]))
+		return false;
+	p += 3;
+	if (!two_digits())
+		return false;
+	if (two_digits() && *p == '.' && _is_digit(p[1]))
+	{
+		++p;
+		for (int i = 0; i < 6 && _is_digit(*p); ++i)
+			++p;
+	}
+	src = p;
+	return true;
+}
+
+struct DateFormat::Fields
 {
-	int day = 1;
-	int month = 1;
-	int year = 1904;
-	int h = 0;
+	int values[FIELD_COUNT] = { 1, 1, 1904, 0, 0, 0, 0 };
 	bool h_12 = false;
-	int m = 0;
-	int s = 0;
-	int ms = 0;
-	int weekday = 0;
 	bool h_pm = false;
-	const char* src = s_src.data();
-	for (const char* fmt = s_fmt.data(); *fmt != 0; ++fmt)
+	int weekday = 0;
+
+	// checks and stores numeric field which has n_digits digits
+	bool set(const Item& item, int value, int n_digits)
 	{
-		switch (*fmt)
+		if (value < item.min || value > item.max)
+			return false;
+		switch (item.code)
+		{
+		case 'y':
+			value += value < 68 ? 2000 : 1900;
+			if (n_digits != 2) return false;
+			break;
+		case 'Y':
+			if (n_digits != 4) return false;
+			break;
+		case 'H':
+			h_12 = false;
+			break;
+		case 'I':
+			if (value == 12)
+				value = 0;
+			h_12 = true;
+			break;
+		case 'f':
+			for (int i = n_digits; i < 6; ++i)
+				value *= 10;
+			break;
+		}
+		values[item.field] = value;
+		return true;
+	}
+
+	bool get(double& dt)
+	{
+		int day = values[DAY];
+		int month = values[MONTH];
+		int year = values[YEAR];
+		int h = values[HOUR];
+		int max_day;
+		if (month == 4 || month == 6 || month == 9 || month == 11)
+			max_day = 30;
+		else if (month == 2)
+			max_day = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0) ? 29 : 28;
+		else
+			max_day = 31;
+		if (day > max_day)
+			return false;
+		if (h_12 && h_pm)
+			h += 12;
+
+		int y = year;
+		y -= month <= 2;
+		int era = (y >= 0 ? y : y - 399) / 400;
+		unsigned yoe = (unsigned)(y - era * 400); // [0, 399]
+		unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1; // [0, 365]
+		unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy; // [0, 146096]
+		dt = era * 146097 + (int)doe - 719468 + 25569 +
+			(h * 3600 + values[MINUTE] * 60 + values[SECOND] + values[MICROSECOND] / 1000000.0) / 86400.0;
+		return true;
+	}
+};
+
+DateFormat::DateFormat(const std::string& fmt) :
+	m_format(fmt),
+	m_valid(true)
+{
+	size_t pos = 0; // offset in values of fixed size
+	bool is_fixed = true;
+	for (const char* p = fmt.data(); *p != 0; ++p)
+	{
+		Item item { 0, *p, 0, 0, FIELD_COUNT, 0, 0 };
+		auto number = [&item](uint8_t width, Field field, int min, int max) { item.width = width; item.field = field; item.min = min; item.max = max; };
+		switch (*p)
 		{
 		case '%':
-			switch (*++fmt)
+			item.code = *++p;
+			switch (item.code)
 			{
-			case 'a':
-			case 'A':
-				if (!find_string(src, _weekdays, 7, weekday)) return false;
-				break;
-			case 'd':
-				if (!read_number(src, 2, day) || day == 0) return false;
-				break;
-			case 'b':
-			case 'B':
-				if (!find_string(src, _months, 12, month)) return false;
-				break;
-			case 'm':
-				if (!read_number(src, 2, month) || month == 0 || month > 12) return false;
-				break;
-			case 'y':
-				if (read_number(src, 2, year) != 2) return false;
-				year += year < 68 ? 2000 : 1900;
-				break;
-			case 'Y':
-				if (read_number(src, 4, year) != 4 || year == 0) return false;
-				break;
-			case 'H':
-				if (!read_number(src, 2, h) || h > 23) return false;
-				h_12 = false;
-				break;
-			case 'I':
-				if (!read_number(src, 2, h) || h == 0 || h > 12) return false;
-				if (h == 12)
-					h = 0;
-				h_12 = true;
-				break;
+			case 'd': number(2, DAY, 1, 99); break;
+			case 'm': number(2, MONTH, 1, 12); break;
+			case 'y': number(2, YEAR, 0, 99); m_year_code = 'y'; break;
+			case 'Y': number(4, YEAR, 1, 9999); m_year_code = 'Y'; break;
+			case 'H': number(2, HOUR, 0, 23); m_hour_code = 'H'; break;
+			case 'I': number(2, HOUR, 1, 12); m_hour_code = 'I'; break;
+			case 'M': number(2, MINUTE, 0, 59); break;
+			case 'S': number(2, SECOND, 0, 59); break;
+			case 'f': number(6, MICROSECOND, 0, 999999); break;
 			case 'p':
-				if (_to_lower(src[1]) != 'm')
-					return false;
-				if (char c = _to_lower(*src); c == 'p')
-					h_pm = true;
-				else if (c != 'a')
-					return false;
-				src += 2;
-				break;
-			case 'M':
-				if (!read_number(src, 2, m) || m > 59) return false;
-				break;
-			case 'S':
-				if (!read_number(src, 2, s) || s > 59) return false;
-				break;
-			case 'f':
-				if (int i; !(i = read_number(src, 6, ms))) return false;
-				else
-					while (i < 6)
-						ms *= 10, ++i;
-				break;
-			case 'z':
-				{
-					std::cmatch mm;
-					if (!std::regex_search(src, mm, _re_z, std::regex_constants::match_continuous))
-						return false;
-					src += mm.length();
-				}
-				break;
-			case 'Z':
-				while (std::isalnum(*src)) ++src;
+				item.width = 2;
 				break;
 			case '%':
-				if (*src++ != '%')
-					return false;
+				item.code = 0;
+				item.c = '%';
+				break;
+			case 'a': case 'A': case 'b': case 'B': case 'z': case 'Z':
+				is_fixed = false;
 				break;
 			default:
-				return false;
+				m_valid = false;
+				return;
 			}
 			break;
 		case ' ':
@@ -174,41 +340,228 @@ bool strptime(const std::string& s_src, const std::string& s_fmt, double& dt)
 		case '\n':
 		case '\f':
 		case '\v':
-			while (std::isspace(*src))
-				++src;
+			item.code = ' ';
+			item.width = 1;
+			break;
+		}
+		item.pos = (uint8_t)std::min(pos, (size_t)UINT8_MAX);
+		pos += item.code == 0 ? 1 : item.width;
+		m_items.push_back(item);
+	}
+	if (!is_fixed || pos < 8 || pos > max_fixed_size)
+		return;
+	m_fixed_size = pos;
+	unsigned char digit_mask[max_fixed_size] = {}, literal_mask[max_fixed_size] = {}, literals[max_fixed_size] = {};
+	for (const Item& item : m_items)
+	{
+		switch (item.code)
+		{
+		case 0:
+			literal_mask[item.pos] = 0xFF;
+			literals[item.pos] = (unsigned char)item.c;
+			break;
+		case ' ': // other whitespace characters are left to parse_items()
+			literal_mask[item.pos] = 0xFF;
+			literals[item.pos] = ' ';
+			break;
+		case 'p':
+			m_ampm_pos = item.pos;
 			break;
 		default:
-			if (*src++ != *fmt)
+			std::memset(digit_mask + item.pos, 0xFF, item.width);
+			m_numbers.push_back(item);
+			break;
+		}
+	}
+	for (size_t i = 0; i < (m_fixed_size + 7) / 8; ++i)
+	{
+		size_t word_pos = m_word_pos[i] = std::min(i * 8, m_fixed_size - 8);
+		std::memcpy(&m_digit_mask[i], digit_mask + word_pos, 8);
+		std::memcpy(&m_literal_mask[i], literal_mask + word_pos, 8);
+		std::memcpy(&m_literals[i], literals + word_pos, 8);
+	}
+}
+
+// parses value where all numbers have max number of digits and whitespace is a single space,
+// e.g. "2020-01-05" for "%Y-%m-%d", the result is the same as of parse_items()
+bool DateFormat::parse_fixed(const char* src, Fields& f) const
+{
+	const uint64_t high = 0xF0F0F0F0F0F0F0F0, zeros = 0x3030303030303030, sixes = 0x0606060606060606;
+	for (size_t i = 0, n = (m_fixed_size + 7) / 8; i < n; ++i)
+	{
+		uint64_t word;
+		std::memcpy(&word, src + m_word_pos[i], 8);
+		// byte c is a digit if both c and c + 6 are 0x3?, carry between bytes can only fail the check
+		uint64_t digits = word & m_digit_mask[i];
+		if ((word & m_literal_mask[i]) != m_literals[i] || (digits & high) != (zeros & m_digit_mask[i]) ||
+				((digits + sixes) & high & m_digit_mask[i]) != (zeros & m_digit_mask[i]))
+			return false;
+	}
+	bool is_valid = true;
+	for (const Item& item : m_numbers)
+	{
+		const char* p = src + item.pos;
+		int value = (p[0] - '0') * 10 + (p[1] - '0');
+		if (item.width > 2)
+			value = value * 100 + (p[2] - '0') * 10 + (p[3] - '0');
+		if (item.width > 4)
+			value = value * 100 + (p[4] - '0') * 10 + (p[5] - '0');
+		is_valid &= value >= item.min && value <= item.max;
+		f.values[item.field] = value;
+	}
+	if (m_ampm_pos >= 0)
+	{
+		char c = _to_lower(src[m_ampm_pos]);
+		is_valid &= _to_lower(src[m_ampm_pos + 1]) == 'm' && (c == 'a' || c == 'p');
+		f.h_pm = c == 'p';
+	}
+	if (!is_valid)
+		return false;
+	// only the last of the items setting the same field matters
+	if (m_year_code == 'y')
+		f.values[YEAR] += f.values[YEAR] < 68 ? 2000 : 1900;
+	if (m_hour_code == 'I')
+	{
+		f.h_12 = true;
+		if (f.values[HOUR] == 12)
+			f.values[HOUR] = 0;
+	}
+	return true;
+}
+
+bool DateFormat::parse_items(const char* src, Fields& f) const
+{
+	for (const Item& item : m_items)
+	{
+		switch (item.code)
+		{
+		case 0:
+			if (*src++ != item.c)
 				return false;
 			break;
+		case ' ':
+			while (_is_space(*src))
+				++src;
+			break;
+		case 'a':
+		case 'A':
+			if (!find_string(src, _weekdays, 7, f.weekday)) return false;
+			break;
+		case 'b':
+		case 'B':
+			if (!find_string(src, _months, 12, f.values[MONTH])) return false;
+			break;
+		case 'p':
+			if (_to_lower(src[1]) != 'm')
+				return false;
+			if (char c = _to_lower(*src); c == 'p')
+				f.h_pm = true;
+			else if (c != 'a')
+				return false;
+			src += 2;
+			break;
+		case 'z':
+			if (!skip_time_zone(src))
+				return false;
+			break;
+		case 'Z':
+			while (std::isalnum((unsigned char)*src)) ++src;
+			break;
+		default:
+			{
+				int value;
+				int n_digits = read_number(src, item.width, value);
+				if (!n_digits || !f.set(item, value, n_digits))
+					return false;
+			}
+			break;
 		}
 	}
-	if (*src != '\0')
+	return *src == '\0';
+}
+
+bool DateFormat::parse(std::string_view src, double& dt) const
+{
+	if (!m_valid)
 		return false;
+	Fields f;
+	if (m_fixed_size == 0 || src.size() != m_fixed_size || !parse_fixed(src.data(), f))
+	{
+		f = Fields();
+		if (!parse_items(src.data(), f))
+			return false;
+	}
+	return f.get(dt);
+}
 
-	int max_day;
-	if (month == 4 || month == 6 || month == 9 || month == 11)
-		max_day = 30;
-	else if (month == 2)
-		max_day = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0) ? 29 : 28;
-	else
-		max_day = 31;
-	if (day > max_day)
+static const char* _weekday_names[] = { "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday" };
+static const char* _month_names[] = { "January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December" };
+
+// inverse of Fields::get(), time zones are written as UTC
+bool DateFormat::write(double dt, std::string& dst) const
+{
+	if (!m_valid || !std::isfinite(dt))
 		return false;
-	if (h_12 && h_pm)
-		h += 12;
-
-	int y = year;
-	y -= month <= 2;
-	int era = (y >= 0 ? y : y - 399) / 400;
-	unsigned yoe = (unsigned)(y - era * 400); // [0, 399]
-	unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1; // [0, 365]
-	unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy; // [0, 146096]
-	dt = era * 146097 + (int)doe - 719468 + 25569 +
-		(h * 3600 + m * 60 + s + ms / 1000000.0) / 86400.0;
+	int64_t days = (int64_t)std::floor(dt);
+	int64_t us = std::llround((dt - days) * 86400000000.0);
+	if (us >= 86400000000)
+		++days, us = 0;
+	int64_t z = days - 25569 + 719468; // days since 0000-03-01
+	int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+	unsigned doe = (unsigned)(z - era * 146097); // [0, 146096]
+	unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365; // [0, 399]
+	unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100); // [0, 365]
+	unsigned mp = (5 * doy + 2) / 153; // [0, 11]
+	int day = (int)(doy - (153 * mp + 2) / 5 + 1);
+	int month = (int)(mp < 10 ? mp + 3 : mp - 9);
+	int year = (int)(yoe + era * 400) + (month <= 2);
+	int weekday = (int)(((days - 25569 + 4) % 7 + 7) % 7); // 1970-01-01 is Thursday
+	int hour = (int)(us / 3600000000);
+	int minute = (int)(us / 60000000 % 60);
+	int second = (int)(us / 1000000 % 60);
+	int microsecond = (int)(us % 1000000);
+
+	dst.clear();
+	auto number = [&dst](int value, int width)
+	{
+		char buf[12];
+		int n = std::snprintf(buf, sizeof(buf), "%0*d", width, value);
+		dst.append(buf, n);
+	};
+	for (const Item& item : m_items)
+	{
+		switch (item.code)
+		{
+		case 0:
+		case ' ':
+			dst += item.c;
+			break;
+		case 'd': number(day, 2); break;
+		case 'm': number(month, 2); break;
+		case 'y': number(year % 100, 2); break;
+		case 'Y': number(year, 4); break;
+		case 'H': number(hour, 2); break;
+		case 'I': number(hour % 12 == 0 ? 12 : hour % 12, 2); break;
+		case 'M': number(minute, 2); break;
+		case 'S': number(second, 2); break;
+		case 'f': number(microsecond, 6); break;
+		case 'p': dst += hour < 12 ? "AM" : "PM"; break;
+		case 'a': dst.append(_weekday_names[weekday], 3); break;
+		case 'A': dst += _weekday_names[weekday]; break;
+		case 'b': dst.append(_month_names[month - 1], 3); break;
+		case 'B': dst += _month_names[month - 1]; break;
+		case 'z': dst += "+0000"; break;
+		case 'Z': dst += "UTC"; break;
+		}
+	}
 	return true;
 }
 
+bool strptime(std::string_view src, const std::string& fmt, double& dt)
+{
+	return DateFormat(fmt).parse(src, dt);
+}
+
 //double strptime(const std::string& src, const std::string& fmt)
 //{
 //	double dt;
@@ -217,4 +570,327 @@ bool strptime(const std::string& s_src, const std::string& s_fmt, double& dt)
 //	return dt;
 //}
 
+inline static bool _is_alpha(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+inline static bool _is_word(char c)
+{
+	return _is_digit(c) || _is_alpha(c) || c == '_';
+}
+
+inline static size_t _skip_spaces(std::string_view s, size_t i)
+{
+	while (i < s.size() && _is_space(s[i]))
+		++i;
+	return i;
+}
+
+// case-insensitive comparison with upper case word at position i
+static bool _match_word_ic(std::string_view s, size_t i, std::string_view word)
+{
+	if (s.size() - i < word.size())
+		return false;
+	for (size_t j = 0; j < word.size(); ++j)
+		if ((s[i + j] & ~0x20) != word[j])
+			return false;
+	return true;
+}
+
+bool match_integer(std::string_view s)
+{
+	size_t i = 0;
+	if (s.size() == 1 && s[0] == '0')
+		return true;
+	if (i < s.size() && s[i] == '-')
+		++i;
+	if (i == s.size() || s[i] < '1' || s[i] > '9')
+		return false;
+	while (++i < s.size())
+		if (!_is_digit(s[i]))
+			return false;
+	return true;
+}
+
+bool match_decimal(std::string_view s)
+{
+	size_t i = 0, size = s.size();
+	if (i < size && (s[i] == '+' || s[i] == '-'))
+		++i;
+	size_t start = i;
+	while (i < size && _is_digit(s[i]))
+		++i;
+	size_t int_digits = i - start;
+	if (i < size && s[i] == '.')
+	{
+		start = ++i;
+		while (i < size && _is_digit(s[i]))
+			++i;
+		if (int_digits == 0 && i == start) // lone dot
+			return false;
+	}
+	else if (int_digits == 0 || (int_digits > 1 && s[start] == '0')) // no leading zeros without a dot
+		return false;
+	if (i < size && (s[i] == 'e' || s[i] == 'E'))
+	{
+		if (++i == size || (s[i] != '+' && s[i] != '-'))
+			return false;
+		start = ++i;
+		while (i < size && _is_digit(s[i]))
+			++i;
+		if (i == start)
+			return false;
+	}
+	return i == size;
+}
+
+bool search_not_list_item(std::string_view s)
+{
+	for (size_t i = s.find('.'); i != std::string_view::npos; i = s.find('.', i + 1))
+		if (i + 1 == s.size() || !_is_word(s[i + 1]))
+			return true;
+	return false;
+}
+
+bool match_xml(std::string_view s)
+{
+	size_t n = s.size();
+	if (n < 2 || s[0] != '<')
+		return false;
+	if (s.substr(1, 4) == "?xml")
+		return true;
+	if (s[n - 1] != '>')
+		return false;
+	size_t tag_end = 1;
+	while (tag_end < n && _is_word(s[tag_end]))
+		++tag_end;
+	size_t tag_size = tag_end - 1;
+	if (tag_size == 0)
+		return false;
+	if (tag_end + 2 == n && s[tag_end] == '/') // <tag/>
+		return true;
+	// <tag ... </tag> where the tag may be any prefix of the leading word and "..." has no line breaks
+	size_t first_newline = s.find_first_of("\r\n", 1);
+	for (size_t k = 1; k <= tag_size && 2 * k + 4 <= n; ++k)
+	{
+		size_t close = n - k - 3;
+		if (s[close] == '<' && s[close + 1] == '/' && s.compare(close + 2, k, s, 1, k) == 0 &&
+				(first_newline == std::string_view::npos || first_newline >= close))
+			return true;
+	}
+	return false;
+}
+
+// "([^"\\]|\\.)*" starting at the opening quote, returns position after the closing quote or npos
+static size_t _skip_json_string(std::string_view s, size_t i)
+{
+	size_t n = s.size();
+	for (++i; i < n; ++i)
+	{
+		if (s[i] == '"')
+			return i + 1;
+		if (s[i] == '\\' && (++i == n || s[i] == '\n' || s[i] == '\r'))
+			return std::string_view::npos;
+	}
+	return std::string_view::npos;
+}
+
+static bool _is_json_body_char(char c)
+{
+	static const struct Table
+	{
+		bool v[256] = {};
+		Table()
+		{
+			for (unsigned char c : std::string_view(",:{}[]0123456789.-+Eaeflnrstu \n\r\t"))
+				v[c] = true;
+		}
+	} table;
+	return table.v[(unsigned char)c];
+}
+
+bool match_json(std::string_view s)
+{
+	size_t n = s.size();
+	if (n < 2 || (s[0] != '[' && s[0] != '{') || (s[n - 1] != '}' && s[n - 1] != ']'))
+		return false;
+	size_t i = 1;
+	if (s[0] == '{')
+	{
+		i = _skip_spaces(s, 1);
+		if (i == n - 1 && s[i] == '}') // {}
+			return true;
+		// object must start with a key followed by a string, object, array, number or literal
+		if (s[i] != '"' || (i = _skip_json_string(s, i)) == std::string_view::npos)
+			return false;
+		i = _skip_spaces(s, i);
+		if (i == n || s[i] != ':')
+			return false;
+		i = _skip_spaces(s, i + 1);
+		if (i == n)
+			return false;
+		char c = s[i];
+		if (!(c == '"' || c == '{' || c == '[' || _is_digit(c) || c == '.' || c == '-' ||
+				s.compare(i, 4, "true") == 0 || s.compare(i, 5, "false") == 0 || s.compare(i, 4, "null") == 0))
+			return false;
+	}
+	// the rest up to the closing bracket is a sequence of strings and characters allowed in json
+	--n;
+	while (i < n)
+	{
+		if (s[i] == '"')
+		{
+			i = _skip_json_string(s, i);
+			if (i > n) // npos or the string ate the closing bracket
+				return false;
+		}
+		else if (_is_json_body_char(s[i]))
+			++i;
+		else
+			return false;
+	}
+	return true;
+}
+
+bool match_geojson(std::string_view s)
+{
+	static const std::string_view types[] = { "Point", "MultiPoint", "LineString", "MultiLineString", "Polygon",
+		"MultiPolygon", "GeometryCollection", "Feature", "FeatureCollection" };
+	for (size_t pos = s.find("\"type\""); pos != std::string_view::npos; pos = s.find("\"type\"", pos + 1))
+	{
+		size_t i = _skip_spaces(s, pos + 6);
+		if (i == s.size() || s[i] != ':')
+			continue;
+		i = _skip_spaces(s, i + 1);
+		if (i == s.size() || s[i] != '"')
+			continue;
+		++i;
+		for (std::string_view type : types)
+			if (s.compare(i, type.size(), type) == 0 && i + type.size() < s.size() && s[i + type.size()] == '"')
+				return true;
+	}
+	// {}
+	if (s.empty() || s[0] != '{' || s.back() != '}')
+		return false;
+	return _skip_spaces(s, 1) == s.size() - 1;
+}
+
+bool match_wkt(std::string_view s)
+{
+	static const std::string_view keywords[] = { "POINT", "LINESTRING", "CIRCULARSTRING", "COMPOUNDCURVE", "CURVEPOLYGON",
+		"POLYGON", "TRIANGLE", "MULTIPOINT", "MULTICURVE", "MULTILINESTRING", "MULTISURFACE", "MULTIPOLYGON",
+		"POLYHEDRALSURFACE", "TIN", "GEOMETRYCOLLECTION" };
+	// the whole string consists of characters allowed after the geometry type
+	for (char c : s)
+		if (!(_is_space(c) || _is_digit(c) || _is_alpha(c) || c == '(' || c == ')' || c == '+' || c == '-' || c == '.' || c == ','))
+			return false;
+	size_t i = _skip_spaces(s, 0);
+	size_t kw_size = 0;
+	for (std::string_view kw : keywords)
+		if (_match_word_ic(s, i, kw))
+		{
+			kw_size = kw.size();
+			break;
+		}
+	if (kw_size == 0)
+		return false;
+	i += kw_size;
+	auto is_start = [&s](size_t i) { return (i < s.size() && s[i] == '(') || _match_word_ic(s, i, "EMPTY"); };
+	size_t j = _skip_spaces(s, i);
+	if (is_start(j))
+		return true;
+	if (j == i) // dimension must be separated by space
+		return false;
+	static const std::string_view dimensions[] = { "ZM", "Z", "M" };
+	for (std::string_view dim : dimensions)
+		if (_match_word_ic(s, j, dim) && is_start(_skip_spaces(s, j + dim.size())))
+			return true;
+	return false;
+}
+
+size_t next_dt_token(std::string_view s, size_t pos, DTToken& kind)
+{
+	size_t n = s.size(), i = pos;
+	char c = s[i];
+	if (_is_digit(c))
+	{
+		// H:MM[:SS[.FFFFFF]] not followed by a digit
+		if (i + 1 < n && _is_digit(s[i + 1]))
+			++i;
+		i = _skip_spaces(s, i + 1);
+		if (i < n && s[i] == ':')
+		{
+			i = _skip_spaces(s, i + 1);
+			if (i + 1 < n && _is_digit(s[i]) && _is_digit(s[i + 1]))
+			{
+				i += 2;
+				size_t end = i; // H:MM
+				size_t j = _skip_spaces(s, i);
+				if (j < n && s[j] == ':')
+				{
+					j = _skip_spaces(s, j + 1);
+					if (j + 1 < n && _is_digit(s[j]) && _is_digit(s[j + 1]))
+					{
+						j += 2;
+						if (j < n && (s[j] == '.' || s[j] == ','))
+						{
+							size_t k = j + 1;
+							while (k < n && k < j + 8 && _is_digit(s[k]))
+								++k;
+							if (k > j + 1 && k <= j + 7) // 1 to 6 digits
+							{
+								kind = DTToken::Time;
+								return k - pos;
+							}
+						}
+						if (j == n || !_is_digit(s[j]))
+						{
+							kind = DTToken::Time;
+							return j - pos;
+						}
+					}
+				}
+				if (end == n || !_is_digit(s[end]))
+				{
+					kind = DTToken::Time;
+					return end - pos;
+				}
+			}
+		}
+		i = pos;
+		while (i < n && _is_digit(s[i]))
+			++i;
+		kind = DTToken::Number;
+	}
+	else if (_is_alpha(c))
+	{
+		while (i < n && _is_alpha(s[i]))
+			++i;
+		kind = DTToken::Word;
+	}
+	else
+	{
+		while (i < n && !_is_digit(s[i]) && !_is_alpha(s[i]))
+			++i;
+		kind = DTToken::Other;
+	}
+	return i - pos;
+}
+
+std::string_view find_line_terminator(std::string_view s)
+{
+	for (size_t i = 0; i < s.size(); ++i)
+	{
+		char c = s[i];
+		if (c == '\n')
+			return s.substr(i, 1);
+		if (c == '\r')
+			return s.substr(i, i + 1 < s.size() && s[i + 1] == '\n' ? 2 : 1);
+		if (c == '\x02' && i + 1 < s.size() && s[i + 1] == '\n')
+			return s.substr(i, 2);
+	}
+	return std::string_view();
+}
+
 }
@@ -1,8 +1,10 @@
 #ifndef UTILITY_H
 #define UTILITY_H
 
+#include <stdint.h>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <algorithm>
 
 namespace Ingest {
@@ -31,7 +33,79 @@ private:
 bool str_endswith_lc(const std::string& s, const std::string_view& suffix);
 
 bool is_integer(double v);
-bool strptime(const std::string& src, const std::string& fmt, double& dt);
+// parse whole string as a number like strtoll()/strtod() do, plain decimal numbers take a fast path,
+// src must be followed by terminating 0
+bool parse_int64(std::string_view src, int64_t& v);
+bool parse_double(std::string_view src, double& v);
+std::string format_double(double v); // shortest text which parse_double() reads back as v
+
+// strptime() format compiled once and applied to many values
+class DateFormat
+{
+public:
+	DateFormat() {}
+	explicit DateFormat(const std::string& fmt);
+	const std::string& format() const { return m_format; }
+	bool parse(std::string_view src, double& dt) const; // src must be followed by terminating 0
+	bool write(double dt, std::string& dst) const; // writes dt so that parse() reads it back
+
+private:
+	enum Field : uint8_t { DAY, MONTH, YEAR, HOUR, MINUTE, SECOND, MICROSECOND, FIELD_COUNT };
+	struct Item
+	{
+		char code; // conversion specifier, ' ' for any whitespace or 0 for literal character
+		char c; // literal character
+		uint8_t width; // max number of digits in numeric fields
+		uint8_t pos; // offset of the item in values of fixed size
+		Field field; // field set by numeric item, FIELD_COUNT for other items
+		int min; // valid range of numeric item
+		int max;
+	};
+	struct Fields;
+
+	bool parse_fixed(const char* src, Fields& f) const;
+	bool parse_items(const char* src, Fields& f) const;
+
+	std::string m_format;
+	std::vector<Item> m_items;
+	bool m_valid = false; // false if the format has unknown specifiers
+	char m_year_code = 0; // last specifiers which set the year and the hour
+	char m_hour_code = 0;
+
+	// values of fixed size, e.g. "2020-01-05" for "%Y-%m-%d", are checked 8 characters at a time,
+	// the last word overlaps the previous one if the size is not a multiple of 8,
+	// masks have 0xFF in bytes where the value must have a digit or a literal character
+	static constexpr size_t max_fixed_size = 32;
+	size_t m_fixed_size = 0; // 0 if the format has variable-size items
+	size_t m_word_pos[max_fixed_size / 8] = {};
+	uint64_t m_digit_mask[max_fixed_size / 8] = {};
+	uint64_t m_literal_mask[max_fixed_size / 8] = {};
+	uint64_t m_literals[max_fixed_size / 8] = {};
+	std::vector<Item> m_numbers; // numeric items
+	int m_ampm_pos = -1; // position of %p
+};
+
+bool strptime(std::string_view src, const std::string& fmt, double& dt); // src must be followed by terminating 0
+
+// single-pass matchers used by type inference, each makes the same decision as
+// std::regex_match() (or regex_search() where noted) with the expression in its comment
+bool match_integer(std::string_view s); // 0|-?[1-9]\d*
+bool match_decimal(std::string_view s); // [+-]?(0|[1-9]\d*|\d+\.|\d*\.\d+)([eE][+-]\d+)?
+bool search_not_list_item(std::string_view s); // search \.(\W|$)
+bool match_xml(std::string_view s); // search ^<(?:\?xml|(\w+)(?:.*</\1|/)>$)
+// (\[|\{\s*"([^"\\]|\\.)*"\s*:\s*((?=")|[{[0-9.\-]|true|false|null))([,:{}\[\]0-9.\-+Eaeflnr-u \n\r\t]|"([^"\\]|\\.)*")*[}\]]|\{\s*\})
+bool match_json(std::string_view s);
+// search "type"\s*:\s*"(Point|MultiPoint|LineString|MultiLineString|Polygon|MultiPolygon|GeometryCollection|Feature|FeatureCollection)"|^\{\s*\}$
+bool match_geojson(std::string_view s);
+// \s*(POINT|LINESTRING|...|GEOMETRYCOLLECTION)(\s+(Z|M|ZM))?\s*(\(|EMPTY)[\sa-zA-Z0-9()+\-.,]*, case insensitive
+bool match_wkt(std::string_view s);
+
+// splits a datetime string into consecutive tokens like the iteration over
+// (\d\d?\s*:\s*\d\d(?:\s*:\s*\d\d(?:[.,]\d{1,6})?)?(?!\d))|(\d+)|[a-zA-Z]+|[^\da-zA-Z]+
+enum class DTToken { Time, Number, Word, Other };
+size_t next_dt_token(std::string_view s, size_t pos, DTToken& kind); // returns length of the token at pos < s.size()
+
+std::string_view find_line_terminator(std::string_view s); // first \x02\n|\r\n|\n|\r, empty if not found
 
 }
 
@@ -11,8 +11,9 @@ struct MemBuffer
 	char* buffer = nullptr;
 	size_t size = 0;
 	size_t pos = 0;
+	bool owns_buffer = true; // false if buffer points to memory owned by somebody else, e.g. a mapped file
 	~MemBuffer() { clear(); }
-	void clear()  { delete[] buffer; buffer = nullptr; }
+	void clear()  { if (owns_buffer) delete[] buffer; buffer = nullptr; }
 };
 
 enum class CellType { Empty, String, Integer, Double, Date, Bool, Error };
@@ -124,10 +124,12 @@ bool XLParser<TWorkBook>::do_open_wb()
 {
 	if (m_wb)
 		return true;
-	if (m_reader->is_file())
+	// local files are read from the memory mapping if it is available, the mapping lives as long as the reader
+	xls::MemBuffer* buffer = m_reader->read_all();
+	if (m_reader->is_file() && (!buffer || !buffer->buffer))
 		return m_wb.open(m_reader->filename());
 	else
-		return m_wb.open(m_reader->read_all());
+		return m_wb.open(buffer);
 }
 
 template<class TWorkBook>
@@ -168,9 +168,12 @@ ZIPParser::~ZIPParser()
 
 bool ZIPParser::do_infer_schema()
 {
-	if (m_parser)
-		return m_parser->do_infer_schema();
-	return false;
+	if (!m_parser)
+		return false;
+	m_parser->m_streaming_inference = m_streaming_inference;
+	bool res = m_parser->do_infer_schema();
+	m_inferred_columns = m_parser->m_inferred_columns; // batches are read by this parser
+	return res;
 }
 
 Schema* ZIPParser::get_schema()
@@ -271,10 +274,11 @@ bool ZIPParser::do_open_zip()
 	if (m_zip)
 		return true;
 	m_files.clear();
-	if (m_reader->is_file())
+	xls::MemBuffer* buffer = m_reader->read_all();
+	if (m_reader->is_file() && (!buffer || !buffer->buffer))
 		m_zip = unzOpen(m_reader->filename().data());
 	else
-		m_zip = xls::unzOpenMemory(m_reader->read_all());
+		m_zip = xls::unzOpenMemory(buffer);
 	if (!m_zip)
 		return false;
 	if (unzGoToFirstFile(m_zip) != UNZ_OK)
@@ -302,4 +306,11 @@ int64_t ZIPParser::get_next_row_raw(RowRaw& row)
 	return -1;
 }
 
+int64_t ZIPParser::get_next_row_view(RowView& row)
+{
+	if (m_parser)
+		return m_parser->get_next_row_view(row);
+	return -1;
+}
+
 }
\ No newline at end of file
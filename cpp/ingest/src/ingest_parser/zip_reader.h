@@ -29,6 +29,7 @@ public:
 protected:
 	bool do_open_zip();
 	virtual int64_t get_next_row_raw(RowRaw& row) override;
+	virtual int64_t get_next_row_view(RowView& row) override;
 
 	Schema m_invalid_schema;
 	std::shared_ptr<BaseReader> m_reader;
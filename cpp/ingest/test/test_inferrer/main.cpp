@@ -0,0 +1,175 @@
+//
+// Differential test of the type inference matchers against the regular expressions they replaced
+//
+
+// STD
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// ingest_parser
+#include <ingest_parser/utility.h>
+
+using namespace Ingest;
+
+// the expressions used by the inferrer before the hand-written matchers
+static const std::regex re_integer( R"(0|-?[1-9]\d*)" );
+static const std::regex re_decimal( R"([+-]?(0|[1-9]\d*|\d+\.|\d*\.\d+)([eE][+-]\d+)?)", std::regex::nosubs );
+static const std::regex re_not_list_item( R"(\.(\W|$))", std::regex::nosubs );
+static const std::regex re_xml( R"(^<(?:\?xml|(\w+)(?:.*</\1|/)>$))" );
+static const std::regex re_json(
+    R"((\[|\{\s*"([^"\\]|\\.)*"\s*:\s*((?=")|[{[0-9.\-]|true|false|null))([,:{}\[\]0-9.\-+Eaeflnr-u \n\r\t]|"([^"\\]|\\.)*")*[}\]]|\{\s*\})",
+    std::regex::nosubs );
+static const std::regex re_geojson(
+    R"~("type"\s*:\s*"(Point|MultiPoint|LineString|MultiLineString|Polygon|MultiPolygon|GeometryCollection|Feature|FeatureCollection)"|^\{\s*\}$)~",
+    std::regex::nosubs );
+static const std::regex re_wkt(
+    R"(\s*(POINT|LINESTRING|CIRCULARSTRING|COMPOUNDCURVE|CURVEPOLYGON|POLYGON|TRIANGLE|MULTIPOINT|MULTICURVE|MULTILINESTRING|MULTISURFACE|MULTIPOLYGON|POLYHEDRALSURFACE|TIN|GEOMETRYCOLLECTION)(\s+(Z|M|ZM))?\s*(\(|EMPTY)[\sa-zA-Z0-9()+\-.,]*)",
+    std::regex::nosubs | std::regex::icase );
+static const std::regex re_dt_components(
+    R"((\d\d?\s*:\s*\d\d(?:\s*:\s*\d\d(?:[.,]\d{1,6})?)?(?!\d))|(\d+)|[a-zA-Z]+|[^\da-zA-Z]+)" );
+static const std::regex re_line_terminators( R"(\x02\n|\r\n|\n|\r)" );
+
+// libstdc++ regex is recursive, longer strings may overflow the stack
+static const size_t max_value_size = 2000;
+// values from the first lines of each file are also checked with mutations
+static const size_t max_mutated_lines = 100;
+
+static size_t g_checked = 0;
+static size_t g_failed = 0;
+
+static void report( const char* name, const std::string& s, bool expected, bool actual ) {
+  ++g_checked;
+  if ( expected != actual ) {
+    if ( ++g_failed <= 50 )
+      std::cout << name << " mismatch (regex " << expected << "): [" << s << "]" << std::endl;
+  }
+}
+
+static std::string dt_tokens_regex( const std::string& s ) {
+  std::string result;
+  for ( std::sregex_iterator m( s.begin(), s.end(), re_dt_components ); m != std::sregex_iterator(); ++m ) {
+    char kind = ( *m )[1].matched ? 't' : ( *m )[2].matched ? 'n' : std::isalpha( ( unsigned char )s[m->position()] ) ? 'w' : 'o';
+    result += kind + std::to_string( m->position() ) + ':' + std::to_string( m->length() ) + ' ';
+  }
+  return result;
+}
+
+static std::string dt_tokens( const std::string& s ) {
+  static const char kinds[] = { 't', 'n', 'w', 'o' };
+  std::string result;
+  DTToken kind;
+  for ( size_t pos = 0, size; pos < s.size(); pos += size ) {
+    size = next_dt_token( s, pos, kind );
+    result += kinds[( int )kind] + std::to_string( pos ) + ':' + std::to_string( size ) + ' ';
+  }
+  return result;
+}
+
+static void check_value( const std::string& s ) {
+  report( "integer", s, std::regex_match( s, re_integer ), match_integer( s ) );
+  report( "decimal", s, std::regex_match( s, re_decimal ), match_decimal( s ) );
+  report( "not_list_item", s, std::regex_search( s, re_not_list_item ), search_not_list_item( s ) );
+  report( "xml", s, std::regex_search( s, re_xml ), match_xml( s ) );
+  report( "json", s, std::regex_match( s, re_json ), match_json( s ) );
+  report( "geojson", s, std::regex_search( s, re_geojson ), match_geojson( s ) );
+  report( "wkt", s, std::regex_match( s, re_wkt ), match_wkt( s ) );
+  std::string expected = dt_tokens_regex( s );
+  report( "dt_tokens", s, true, expected == dt_tokens( s ) );
+  std::smatch m;
+  std::string terminator = std::regex_search( s, m, re_line_terminators ) ? m.str() : std::string();
+  report( "line_terminator", s, true, terminator == find_line_terminator( s ) );
+}
+
+// the value itself and its variants with one character removed, replaced or inserted
+static void check_with_mutations( const std::string& s, std::unordered_set<std::string>& seen, bool mutate = true ) {
+  static const std::string alphabet = "0 1:9.,-+eE\"\\{}[]<>/_aZmT\n\r\x02\xc3";
+  std::vector<std::string> values{ s };
+  if ( mutate && s.size() <= 64 ) {
+    for ( size_t i = 0; i <= s.size(); ++i ) {
+      if ( i < s.size() )
+        values.push_back( s.substr( 0, i ) + s.substr( i + 1 ) );
+      for ( char c : alphabet ) {
+        if ( i < s.size() )
+          values.push_back( s.substr( 0, i ) + c + s.substr( i + 1 ) );
+        values.push_back( s.substr( 0, i ) + c + s.substr( i ) );
+      }
+    }
+  } else if ( mutate ) {
+    for ( size_t i = 1; i < s.size(); i += s.size() / 16 + 1 ) {
+      values.push_back( s.substr( 0, i ) );
+      values.push_back( s.substr( i ) );
+    }
+  }
+  for ( const std::string& v : values )
+    if ( seen.insert( v ).second )
+      check_value( v );
+}
+
+static void split( const std::string& s, const std::string& delimiters, std::vector<std::string>& result ) {
+  size_t pos = 0;
+  while ( true ) {
+    size_t end = s.find_first_of( delimiters, pos );
+    result.push_back( s.substr( pos, end - pos ) );
+    if ( end == std::string::npos )
+      break;
+    pos = end + 1;
+  }
+}
+
+// main
+int main( int argc, char** argv ) {
+  if ( argc < 2 ) {
+    std::cout << "Not enough command line arguments: test_inferrer <filename>..." << std::endl;
+    return 1;
+  }
+
+  std::unordered_set<std::string> seen;
+  for ( const std::string s : { "", "0", "-0", "00", "1.", ".1", ".", "1e5", "1e+5", "-1.5E-10", "<a/>", "<ab>x</a>", "<a>\n</a>",
+                                "<?xml", "[", "{}", "{ }", "{\"a\":1}", "{\"a\":\"}", "{\"a\\\n\":1}", "{\"type\":\"Point\"}",
+                                "POINT(1 2)", " point z (1 2 3)", "POINT ZM EMPTY", "POINTZ(1 2)", "tin empty", "12:30", "1:2",
+                                "12 : 30 : 45.1234567", "2020-01-01T10:11:12.123456+0100", "a\x02\nb", "a\rb", "a\r\nb" } )
+    check_with_mutations( s, seen );
+
+  for ( int i = 1; i < argc; ++i ) {
+    std::ifstream file( argv[i], std::ios::binary );
+    if ( !file ) {
+      std::cout << "Unable to open " << argv[i] << std::endl;
+      return 1;
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    std::string content = ss.str();
+    check_value( content.substr( 0, max_value_size ) );
+
+    std::vector<std::string> lines, fields;
+    split( content, "\n", lines );
+    for ( size_t i_line = 0; i_line < lines.size(); ++i_line ) {
+      const std::string& line = lines[i_line];
+      bool mutate = i_line < max_mutated_lines;
+      if ( line.size() <= max_value_size )
+        check_with_mutations( line, seen, mutate );
+      fields.clear();
+      split( line, ",;\t|", fields );
+      for ( std::string& field : fields ) {
+        if ( field.size() >= 2 && field.front() == '"' && field.back() == '"' )
+          field = field.substr( 1, field.size() - 2 );
+        if ( field.size() <= max_value_size )
+          check_with_mutations( field, seen, mutate );
+      }
+    }
+    std::cout << "checked " << argv[i] << std::endl;
+  }
+
+  std::cout << g_checked << " checks, " << g_failed << " mismatches" << std::endl;
+  if ( g_failed > 0 ) {
+    std::cout << "ERROR!" << std::endl;
+    return 1;
+  }
+  std::cout << "Success!" << std::endl;
+  return 0;
+}
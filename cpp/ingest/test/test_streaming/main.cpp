@@ -0,0 +1,171 @@
+//
+// Checks streaming type inference: a file whose columns widen after the first rows loads the same with the
+// chunked CSV loader as with a serial parse, and columns widened to String hold the text of the file,
+// the same as loading them with the String type from the start
+//
+
+// STD
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// simple_icu_init
+#include <simple_icu_init.h>
+
+// ingest
+#include <ingest/table.h>  // Table
+
+// ingest_parser
+#include <ingest_parser/inferrer.h>
+
+using namespace Ingest;
+
+// initialize ICU
+static const int g_icu_initialized = simple_icu_init( ICU_DATA );
+
+// more than two 8 MB chunks of the CSV loader
+static const int row_count = 1000000;
+
+static int g_failed = 0;
+
+static void check( bool ok, const std::string& what ) {
+  if ( !ok ) {
+    if ( ++g_failed <= 50 )
+      std::cout << "mismatch: " << what << std::endl;
+  }
+}
+
+// id stays Integer, ratio widens from Integer to Decimal after a quarter of the rows,
+// amount widens to Decimal after half of the rows and to String near the end
+static bool write_file( const std::string& filename ) {
+  std::ofstream file( filename, std::ios::binary );
+  file << "id,amount,ratio\n";
+  for ( int r = 0; r < row_count; ++r ) {
+    std::string amount = std::to_string( r );
+    if ( r % 97 == 0 )
+      amount = "NULL";
+    else if ( r % 89 == 0 )
+      amount = "";
+    else if ( r == row_count - 10 )
+      amount = "n/a";
+    else if ( r >= row_count / 2 && r % 4 == 0 )
+      amount += ".50";
+    else if ( r >= row_count / 2 && r % 1000 == 7 )
+      amount = std::to_string( r % 100 ) + "e+1";
+    std::string ratio = std::to_string( r );
+    if ( r >= row_count / 4 && r % 3 == 0 )
+      ratio += ".25";
+    file << r << ',' << amount << ',' << ratio << '\n';
+  }
+  return static_cast<bool>( file );
+}
+
+// loads the file as convert_file() does; with a schema, its column types are used without streaming inference
+static std::unique_ptr<Table> load( const std::string& filename, size_t thread_count, Schema const* final_schema,
+                                    std::vector<ColumnDefinition>& columns ) {
+  std::unique_ptr<Parser> parser( Parser::get_parser( filename ) );
+  if ( !parser )
+    return nullptr;
+  parser->set_thread_count( thread_count );
+  parser->set_streaming_inference( final_schema == nullptr );
+  if ( !parser->infer_schema() || !parser->open() )
+    return nullptr;
+  Schema* schema = parser->get_schema();
+  if ( final_schema )
+    schema->columns = final_schema->columns;
+  std::unique_ptr<Table> table( new Table( *schema ) );
+  RowBatch batch;
+  unsigned widen_count = schema->widen_count;
+  while ( parser->get_next_batch( batch ) ) {
+    if ( schema->widen_count != widen_count ) {
+      table->update_column_types( *schema );
+      widen_count = schema->widen_count;
+    }
+    table->append_batch( batch );
+  }
+  parser->close();
+  if ( schema->status != STATUS_OK )
+    return nullptr;
+  columns = schema->columns;
+  return table;
+}
+
+static bool same_bytes( void const* a, void const* b, size_t size ) {
+  return size == 0 || std::memcmp( a, b, size ) == 0;
+}
+
+static void check_same_column( Table const& a, Table const& b, int16_t colidx ) {
+  std::string name = a.get_column_name( colidx );
+  check( a.get_column_type( colidx ) == b.get_column_type( colidx ), name + " type" );
+  if ( a.get_column_type( colidx ) != b.get_column_type( colidx ) )
+    return;
+  check( a.get_column_element_count( colidx ) == b.get_column_element_count( colidx ), name + " element count" );
+  check( a.get_column_null_count( colidx ) == b.get_column_null_count( colidx ), name + " null count" );
+  check( a.get_column_nullbitmap_buffer_size( colidx ) == b.get_column_nullbitmap_buffer_size( colidx ) &&
+             same_bytes( a.get_column_nullbitmap_buffer( colidx ), b.get_column_nullbitmap_buffer( colidx ),
+                         a.get_column_nullbitmap_buffer_size( colidx ) ),
+         name + " nulls" );
+  check( a.get_column_array_buffer_size_in_bytes( colidx ) == b.get_column_array_buffer_size_in_bytes( colidx ) &&
+             same_bytes( a.get_column_array_buffer( colidx ), b.get_column_array_buffer( colidx ),
+                         a.get_column_array_buffer_size_in_bytes( colidx ) ),
+         name + " values" );
+  check( a.get_column_offsets_buffer_size( colidx ) == b.get_column_offsets_buffer_size( colidx ) &&
+             same_bytes( a.get_column_offsets_buffer( colidx ), b.get_column_offsets_buffer( colidx ),
+                         a.get_column_offsets_buffer_size( colidx ) * sizeof( int32_t ) ),
+         name + " offsets" );
+}
+
+// text of the element idx of a String column
+static std::string get_string( Table const& table, int16_t colidx, int32_t idx ) {
+  int32_t const* offsets = table.get_column_offsets_buffer( colidx );
+  char const* chars = static_cast<char const*>( table.get_column_array_buffer( colidx ) );
+  return std::string( chars + offsets[idx], chars + offsets[idx + 1] );
+}
+
+// main
+int main( int argc, char** argv ) {
+  std::string filename = argc > 1 ? argv[1] : "test_streaming.csv";
+  if ( !write_file( filename ) ) {
+    std::cout << "Unable to write " << filename << std::endl;
+    return 1;
+  }
+
+  std::vector<ColumnDefinition> serial_columns, chunked_columns, string_columns;
+  std::unique_ptr<Table> serial = load( filename, 1, nullptr, serial_columns );
+  std::unique_ptr<Table> chunked = load( filename, 4, nullptr, chunked_columns );
+  Schema final_schema;
+  final_schema.columns = serial_columns;
+  std::unique_ptr<Table> typed = load( filename, 1, &final_schema, string_columns );
+  std::remove( filename.c_str() );
+  if ( !serial || !chunked || !typed ) {
+    std::cout << "Unable to load " << filename << std::endl;
+    return 1;
+  }
+
+  check( serial_columns.size() == 5 && serial_columns[0].column_type == ColumnType::Integer &&
+             serial_columns[1].column_type == ColumnType::String && serial_columns[2].column_type == ColumnType::Decimal,
+         "widened types" );
+  check( serial->get_column_count() == chunked->get_column_count(), "column count" );
+  for ( int16_t colidx = 0; colidx < serial->get_column_count() && colidx < chunked->get_column_count(); ++colidx )
+    check_same_column( *serial, *chunked, colidx );
+
+  // amount is typed until its last rows, the text of the file is kept: "NULL" is Null, "" is not, "1.50" stays
+  for ( int16_t colidx = 0; colidx < serial->get_column_count(); ++colidx )
+    check_same_column( *serial, *typed, colidx );
+  if ( g_failed == 0 ) {
+    check( get_string( *serial, 1, row_count / 2 ) == std::to_string( row_count / 2 ) + ".50", "amount text" );
+    check( get_string( *serial, 1, row_count / 2 + 7 ) == "7e+1", "amount exponent" );
+  }
+
+  if ( g_failed > 0 ) {
+    std::cout << g_failed << " mismatches" << std::endl;
+    std::cout << "ERROR!" << std::endl;
+    return 1;
+  }
+  std::cout << "Success!" << std::endl;
+  return 0;
+}
@@ -219,6 +219,12 @@ t_aggspec::agg_str() const {
         case AGGTYPE_DISTINCT_VALUES: {
             return "distinct values";
         }
+        case AGGTYPE_APPROX_MEDIAN: {
+            return "approx median";
+        }
+        case AGGTYPE_APPROX_DISTINCT_COUNT: {
+            return "approx distinct count";
+        }
         default: {
             PSP_COMPLAIN_AND_ABORT("Unknown agg type");
             return "unknown";
@@ -364,6 +370,7 @@ t_aggspec::get_output_specs(const t_schema& schema) const {
         case AGGTYPE_UNIQUE:
         case AGGTYPE_DOMINANT:
         case AGGTYPE_MEDIAN:
+        case AGGTYPE_APPROX_MEDIAN:
         case AGGTYPE_FIRST:
         case AGGTYPE_LAST:
         case AGGTYPE_OR:
@@ -448,7 +455,8 @@ t_aggspec::get_output_specs(const t_schema& schema) const {
             }
             return mk_col_name_type_vec(name(), DTYPE_BOOL, dftype);
         }
-        case AGGTYPE_DISTINCT_COUNT: {
+        case AGGTYPE_DISTINCT_COUNT:
+        case AGGTYPE_APPROX_DISTINCT_COUNT: {
             //return mk_col_name_type_vec(name(), DTYPE_UINT32, DATA_FORMAT_NUMBER);
             t_dataformattype dftype = DATA_FORMAT_NUMBER;
             auto iter = schema.m_coldatatype_map.find(name());
@@ -485,6 +493,7 @@ t_aggspec::get_formula_output_specs(const t_schema& schema, std::string tbl_coln
         case AGGTYPE_UNIQUE:
         case AGGTYPE_DOMINANT:
         case AGGTYPE_MEDIAN:
+        case AGGTYPE_APPROX_MEDIAN:
         case AGGTYPE_FIRST:
         case AGGTYPE_LAST:
         case AGGTYPE_OR:
@@ -535,7 +544,8 @@ t_aggspec::can_change_data_format() const {
         case AGGTYPE_IDENTITY:
         case AGGTYPE_DISTINCT_LEAF:
         case AGGTYPE_CUSTOM:
-        case AGGTYPE_DISTINCT_VALUES: {
+        case AGGTYPE_DISTINCT_VALUES:
+        case AGGTYPE_APPROX_MEDIAN: {
             return true;
         } break;
 
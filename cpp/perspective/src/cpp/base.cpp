@@ -151,26 +151,14 @@ get_dtype_size(t_dtype dtype) {
         case DTYPE_F64PAIR: {
             return sizeof(std::pair<double, double>);
         }
-        case DTYPE_LIST_BOOL: {
-            return sizeof(std::vector<bool>);
-        }
-        case DTYPE_LIST_DATE: {
-            return sizeof(std::vector<std::int32_t>);
-        }
-        case DTYPE_LIST_TIME: {
-            return sizeof(std::vector<double>);
-        }
+        case DTYPE_LIST_STR:
+        case DTYPE_LIST_BOOL:
+        case DTYPE_LIST_FLOAT64:
+        case DTYPE_LIST_INT64:
+        case DTYPE_LIST_DATE:
+        case DTYPE_LIST_TIME:
         case DTYPE_LIST_DURATION: {
-            return sizeof(std::vector<double>);
-        }
-        case DTYPE_LIST_FLOAT64: {
-            return sizeof(std::vector<double>);
-        }
-        case DTYPE_LIST_INT64: {
-            return sizeof(std::vector<std::int64_t>);
-        }
-        case DTYPE_LIST_STR: {
-            return sizeof(std::vector<std::string>);
+            return sizeof(t_list_extent);
         }
         case DTYPE_DECIMAL: {
             return sizeof(decNumber);
@@ -887,6 +875,10 @@ str_to_aggtype(const std::string& str) {
         return t_aggtype::AGGTYPE_CUSTOM;
     } else if (str == "distinct values") {
         return t_aggtype::AGGTYPE_DISTINCT_VALUES;
+    } else if (str == "approx median" || str == "approx_median") {
+        return t_aggtype::AGGTYPE_APPROX_MEDIAN;
+    } else if (str == "approx distinct count" || str == "approx_distinct_count") {
+        return t_aggtype::AGGTYPE_APPROX_DISTINCT_COUNT;
     } else {
         PSP_COMPLAIN_AND_ABORT("Encountered unknown aggregate operation.");
         // use any as default
@@ -106,6 +106,9 @@ t_column::t_column()
     , m_isvlen(false)
     , m_data(nullptr)
     , m_vocab(nullptr)
+    , m_list_values(nullptr)
+    , m_list_elemsize(0)
+    , m_list_garbage(0)
     , m_status(nullptr)
     , m_size(0)
     , m_status_enabled(false)
@@ -120,6 +123,8 @@ t_column::t_column()
 t_column::t_column(const t_column_recipe& recipe)
     : m_dtype(recipe.m_dtype)
     , m_init(false)
+    , m_list_elemsize(0)
+    , m_list_garbage(0)
     , m_size(recipe.m_size)
     , m_status_enabled(recipe.m_status_enabled)
     , m_from_recipe(true)
@@ -131,12 +136,18 @@ t_column::t_column(const t_column_recipe& recipe)
     m_data.reset(new t_lstore(recipe.m_data));
     m_isvlen = is_vlen_dtype(recipe.m_dtype);
 
-    if (m_isvlen) {
+    if (m_isvlen || m_dtype == DTYPE_LIST_STR) {
         m_vocab.reset(new t_vocab(recipe));
     } else {
         m_vocab.reset(new t_vocab);
     }
 
+    if (is_dtype_list(m_dtype)) {
+        m_list_values.reset(new t_lstore(recipe.m_list_values));
+    } else {
+        m_list_values.reset(new t_lstore);
+    }
+
     if (m_status_enabled) {
         m_status.reset(new t_lstore(recipe.m_status));
     } else {
@@ -154,6 +165,9 @@ t_column::column_copy_helper(const t_column& other) {
     m_data.reset(new t_lstore(other.m_data->get_recipe()));
     m_vocab.reset(new t_vocab(other.m_vocab->get_vlendata()->get_recipe(),
         other.m_vocab->get_extents()->get_recipe()));
+    m_list_values.reset(new t_lstore(other.m_list_values->get_recipe()));
+    m_list_elemsize = other.m_list_elemsize;
+    m_list_garbage = 0;
     m_status.reset(new t_lstore(other.m_status->get_recipe()));
 
     m_size = other.m_size;
@@ -161,6 +175,11 @@ t_column::column_copy_helper(const t_column& other) {
     m_from_recipe = false;
     m_data_format_type = other.m_data_format_type;
     m_truncated = other.m_truncated;
+    m_zones.reset();
+    m_search_index.reset();
+    for (auto& ranks : m_string_ranks) {
+        ranks.reset();
+    }
 }
 
 t_column::t_column(const t_column& c) {
@@ -186,6 +205,8 @@ t_column::t_column(t_dtype dtype, bool missing_enabled, const t_lstore_recipe& a
     t_uindex row_capacity, t_dataformattype data_format_type)
     : m_dtype(dtype)
     , m_init(false)
+    , m_list_elemsize(0)
+    , m_list_garbage(0)
     , m_size(0)
     , m_status_enabled(missing_enabled)
     , m_from_recipe(false)
@@ -199,7 +220,7 @@ t_column::t_column(t_dtype dtype, bool missing_enabled, const t_lstore_recipe& a
     LOG_CONSTRUCTOR("t_column");
     m_isvlen = is_vlen_dtype(m_dtype);
 
-    if (is_vlen_dtype(dtype)) {
+    if (is_vlen_dtype(dtype) || dtype == DTYPE_LIST_STR) {
         t_lstore_recipe vlendata_args(a);
         t_lstore_recipe extents_args(a);
 
@@ -214,6 +235,15 @@ t_column::t_column(t_dtype dtype, bool missing_enabled, const t_lstore_recipe& a
         m_vocab.reset(new t_vocab);
     }
 
+    if (is_dtype_list(dtype)) {
+        t_lstore_recipe list_values_args(a);
+        list_values_args.m_capacity = DEFAULT_EMPTY_CAPACITY;
+        list_values_args.m_colname = a.m_colname + std::string("_list_values");
+        m_list_values.reset(new t_lstore(list_values_args));
+    } else {
+        m_list_values.reset(new t_lstore);
+    }
+
     if (is_status_enabled()) {
         t_lstore_recipe missing_args(a);
         missing_args.m_capacity = row_capacity;
@@ -240,10 +270,15 @@ t_column::init() {
 
     m_errors.reset();
 
-    if (is_vlen_dtype(m_dtype)) {
+    if (is_vlen_dtype(m_dtype) || m_dtype == DTYPE_LIST_STR) {
         m_vocab->init(m_from_recipe);
     }
 
+    if (is_dtype_list(m_dtype)) {
+        m_list_values->init();
+        m_list_elemsize = get_dtype_size(list_type_to_dtype(m_dtype));
+    }
+
     if (is_status_enabled()) {
         m_status->init();
     }
@@ -274,6 +309,10 @@ t_column::get_data_format_type() const {
 void
 t_column::set_data_format_type(t_dataformattype dftype) {
     m_data_format_type = dftype;
+    // the words of the cells depend on their rendering
+    if (m_search_index) {
+        m_search_index->mark_all();
+    }
 }
 
 // extend based on dtype size
@@ -282,6 +321,7 @@ t_column::extend_dtype(t_uindex idx) {
     t_uindex new_extents = idx * get_dtype_size(m_dtype);
     m_data->reserve(new_extents);
     m_data->set_size(new_extents);
+    zones_changed(std::min(m_size, idx), std::max(m_size, idx));
     m_size = m_data->size() / get_dtype_size(m_dtype);
 
     if (is_status_enabled()) {
@@ -464,6 +504,7 @@ t_column::set_size(t_uindex size) {
     PSP_VERBOSE_ASSERT(size * get_dtype_size(m_dtype) <= m_data->capacity(),
         "Not enough space reserved for column");
 #endif
+    zones_changed(std::min(m_size, size), std::max(m_size, size));
     m_size = size;
     m_data->set_size(m_elemsize * size);
 
@@ -485,7 +526,7 @@ t_column::_get_data_lstore() {
 
 t_tscalar
 t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_level, t_binning_info binning,
-    t_dataformattype df_type, std::vector<double>& dbinning) const {
+    t_dataformattype df_type, std::vector<double>& dbinning, t_symtable& symtable) const {
     COLUMN_CHECK_ACCESS(idx);
     t_tscalar rv;
     rv.clear();
@@ -494,20 +535,16 @@ t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_le
 
     switch (m_dtype) {
         case DTYPE_LIST_STR: {
-            std::vector<std::string> value = *(m_data->get_nth<std::vector<std::string>>(idx));
+            auto value = get_list_nth<t_uindex>(idx);
             if (value.size() == 0 || uidx >= value.size() || uidx < 0) {
                 is_empty = true;
                 new_type = DTYPE_STR;
                 break;
             }
-            if (is_vlen_dtype(DTYPE_STR) && !m_vocab->is_init()) {
-                m_vocab->init(m_from_recipe);
-            }
-            t_uindex sidx = m_vocab->get_interned(value[uidx].c_str());
-            rv.set(m_vocab->unintern_c(sidx));
+            rv.set(m_vocab->unintern_c(value[uidx]));
         } break;
         case DTYPE_LIST_BOOL: {
-            std::vector<bool> value = *(m_data->get_nth<std::vector<bool>>(idx));
+            auto value = get_list_nth<bool>(idx);
             if (value.size() == 0 || uidx >= value.size() || uidx < 0) {
                 is_empty = true;
                 new_type = DTYPE_BOOL;
@@ -516,7 +553,7 @@ t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_le
             rv.set((bool)value[uidx]);
         } break;
         case DTYPE_LIST_FLOAT64: {
-            std::vector<double> value = *(m_data->get_nth<std::vector<double>>(idx));
+            auto value = get_list_nth<double>(idx);
             if (value.size() == 0 || uidx >= value.size() || uidx < 0) {
                 is_empty = true;
                 new_type = DTYPE_FLOAT64;
@@ -525,8 +562,7 @@ t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_le
             rv.set(value[uidx]);
         } break;
         case DTYPE_LIST_INT64: {
-            std::vector<std::int64_t> value
-                = *(m_data->get_nth<std::vector<std::int64_t>>(idx));
+            auto value = get_list_nth<std::int64_t>(idx);
             if (value.size() == 0 || uidx >= value.size() || uidx < 0) {
                 is_empty = true;
                 new_type = DTYPE_INT64;
@@ -535,7 +571,7 @@ t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_le
             rv.set(value[uidx]);
         } break;
         case DTYPE_LIST_DATE: {
-            std::vector<t_date> value = *(m_data->get_nth<std::vector<t_date>>(idx));
+            auto value = get_list_nth<t_date>(idx);
             if (value.size() == 0 || uidx >= value.size() || uidx < 0) {
                 is_empty = true;
                 new_type = DTYPE_DATE;
@@ -554,7 +590,7 @@ t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_le
                         std::int64_t num = std::int64_t(value[uidx].agg_level_num(t, agg_level));
                         rv.set(num);
                     } else {
-                        rv.set(get_interned_tscalar(value[uidx].agg_level_str(t, agg_level).c_str()));
+                        rv.set(symtable.get_interned_tscalar(value[uidx].agg_level_str(t, agg_level).c_str()));
                     }
                 } else {
                     PSP_COMPLAIN_AND_ABORT("Could not return date value.");
@@ -564,7 +600,7 @@ t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_le
             }
         } break;
         case DTYPE_LIST_TIME: {
-            std::vector<t_time> value = *(m_data->get_nth<std::vector<t_time>>(idx));
+            auto value = get_list_nth<t_time>(idx);
             if (value.size() == 0 || uidx >= value.size() || uidx < 0) {
                 is_empty = true;
                 new_type = DTYPE_TIME;
@@ -593,7 +629,7 @@ t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_le
                         t_duration duration = t_duration(num);
                         rv.set(duration);
                     } else {
-                        rv.set(get_interned_tscalar(value[uidx].agg_level_str(t, agg_level).c_str()));
+                        rv.set(symtable.get_interned_tscalar(value[uidx].agg_level_str(t, agg_level).c_str()));
                     }
                 } else {
                     PSP_COMPLAIN_AND_ABORT("Could not return date value.");
@@ -603,7 +639,7 @@ t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_le
             }
         } break;
         case DTYPE_LIST_DURATION: {
-            std::vector<t_duration> value = *(m_data->get_nth<std::vector<t_duration>>(idx));
+            auto value = get_list_nth<t_duration>(idx);
             if (value.size() == 0 || uidx >= value.size() || uidx < 0) {
                 is_empty = true;
                 new_type = DTYPE_DURATION;
@@ -615,7 +651,7 @@ t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_le
                     t_duration duration = t_duration(num);
                     rv.set(duration);
                 } else {
-                    rv.set(get_interned_tscalar(value[uidx].agg_level_str(get_data_format_type(), agg_level).c_str()));
+                    rv.set(symtable.get_interned_tscalar(value[uidx].agg_level_str(get_data_format_type(), agg_level).c_str()));
                 }
             } else {
                 rv.set(value[uidx]);
@@ -628,7 +664,7 @@ t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_le
                 struct tm t;
                 bool rcode = value.as_tm(t);
                 if (rcode) {
-                    rv.set(get_interned_tscalar(value.agg_level_str(t, agg_level).c_str()));
+                    rv.set(symtable.get_interned_tscalar(value.agg_level_str(t, agg_level).c_str()));
                 } else {
                     PSP_COMPLAIN_AND_ABORT("Could not return date value.");
                 }
@@ -643,7 +679,7 @@ t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_le
                 struct tm t;
                 bool rcode = value.as_tm(t);
                 if (rcode) {
-                    rv.set(get_interned_tscalar(value.agg_level_str(t, agg_level).c_str()));
+                    rv.set(symtable.get_interned_tscalar(value.agg_level_str(t, agg_level).c_str()));
                 } else {
                     PSP_COMPLAIN_AND_ABORT("Could not return datetime value.");
                 }
@@ -655,7 +691,7 @@ t_column::get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_le
             if (agg_level != AGG_LEVEL_NONE) {
                 const t_duration::t_rawtype* v = m_data->get_nth<t_duration::t_rawtype>(idx);
                 t_duration value = t_duration(*v);
-                rv.set(get_interned_tscalar(value.agg_level_str(get_data_format_type(), agg_level).c_str()));
+                rv.set(symtable.get_interned_tscalar(value.agg_level_str(get_data_format_type(), agg_level).c_str()));
             } else {
                 rv = get_scalar(idx);
             }
@@ -760,25 +796,37 @@ t_column::get_scalar(t_uindex idx, bool include_error) const {
             rv.set(pair->first / pair->second);
         } break;
         case DTYPE_LIST_STR: {
-            rv.set(*(m_data->get_nth<std::vector<std::string>>(idx)));
+            auto span = get_list_nth<t_uindex>(idx);
+            std::vector<std::string> value;
+            value.reserve(span.size());
+            for (t_uindex sidx : span) {
+                value.emplace_back(m_vocab->unintern_c(sidx));
+            }
+            rv.set(value);
         } break;
         case DTYPE_LIST_BOOL: {
-            rv.set(*(m_data->get_nth<std::vector<bool>>(idx)));
+            auto span = get_list_nth<bool>(idx);
+            rv.set(std::vector<bool>(span.begin(), span.end()));
         } break;
         case DTYPE_LIST_FLOAT64: {
-            rv.set(*(m_data->get_nth<std::vector<double>>(idx)));
+            auto span = get_list_nth<double>(idx);
+            rv.set(std::vector<double>(span.begin(), span.end()));
         } break;
         case DTYPE_LIST_INT64: {
-            rv.set(*(m_data->get_nth<std::vector<std::int64_t>>(idx)));
+            auto span = get_list_nth<std::int64_t>(idx);
+            rv.set(std::vector<std::int64_t>(span.begin(), span.end()));
         } break;
         case DTYPE_LIST_DATE: {
-            rv.set(*(m_data->get_nth<std::vector<t_date>>(idx)));
+            auto span = get_list_nth<t_date>(idx);
+            rv.set(std::vector<t_date>(span.begin(), span.end()));
         } break;
         case DTYPE_LIST_TIME: {
-            rv.set(*(m_data->get_nth<std::vector<t_time>>(idx)));
+            auto span = get_list_nth<t_time>(idx);
+            rv.set(std::vector<t_time>(span.begin(), span.end()));
         } break;
         case DTYPE_LIST_DURATION: {
-            rv.set(*(m_data->get_nth<std::vector<t_duration>>(idx)));
+            auto span = get_list_nth<t_duration>(idx);
+            rv.set(std::vector<t_duration>(span.begin(), span.end()));
         } break;
         case DTYPE_DECIMAL: {
             rv.set(*(m_data->get_nth<t_decimal>(idx)));
@@ -815,6 +863,10 @@ t_column::get_error(t_uindex idx) const {
     COLUMN_CHECK_ACCESS(idx);
     t_cell_error rv;
 
+    if (!m_errors) {
+        return rv;
+    }
+
     auto &errors = *m_errors;
     rv = t_cell_error{errors[idx].m_code, errors[idx].m_value};
 
@@ -1005,6 +1057,9 @@ t_column::set_nth<std::string>(t_uindex idx, std::string elem, t_status status)
 
 void
 t_column::set_error(t_uindex idx, t_cell_error error) {
+    if (!m_errors) {
+        m_errors = std::make_shared<std::map<t_uindex, t_cell_error>>();
+    }
     m_errors->insert(std::pair<t_uindex, t_cell_error>(idx, error));
 }
 
@@ -1026,6 +1081,7 @@ t_column::set_warning_status(t_uindex idx) {
 void
 t_column::set_status(t_uindex idx, t_status status) {
     m_status->set_nth<t_status>(idx, status);
+    zones_changed(idx, idx + 1);
 }
 
 void
@@ -1141,6 +1197,141 @@ t_column::set_scalar(t_uindex idx, t_tscalar value) {
     }
 }
 
+t_uindex
+t_column::get_list_size(t_uindex idx) const {
+    COLUMN_CHECK_ACCESS(idx);
+    if (!is_dtype_list(m_dtype)) {
+        return 0;
+    }
+    const t_list_extent* extent = m_data->get_nth<t_list_extent>(idx);
+    return extent->m_end - extent->m_begin;
+}
+
+void
+t_column::set_nth_value(t_uindex idx, const std::vector<bool>& v) {
+    // std::vector<bool> is packed
+    std::unique_ptr<bool[]> items(new bool[v.size()]);
+    std::copy(v.begin(), v.end(), items.get());
+    set_list_nth_raw(idx, items.get(), v.size());
+}
+
+void
+t_column::set_nth_value(t_uindex idx, const std::vector<std::string>& v) {
+    std::vector<t_uindex> items(v.size());
+    for (t_uindex sidx = 0, loop_end = v.size(); sidx < loop_end; ++sidx) {
+        items[sidx] = m_vocab->get_interned(v[sidx]);
+    }
+    set_list_nth_raw(idx, items.data(), items.size());
+}
+
+void
+t_column::set_list_nth_raw(t_uindex idx, const void* items, t_uindex count) {
+    t_list_extent* extent = m_data->get_nth<t_list_extent>(idx);
+    t_uindex nitems = m_list_values->size() / m_list_elemsize;
+    t_uindex osize = extent->m_begin <= extent->m_end && extent->m_end <= nitems
+        ? extent->m_end - extent->m_begin
+        : 0;
+
+    // a cell which does not grow is rewritten in place
+    if (count <= osize) {
+        if (count > 0) {
+            std::memcpy(m_list_values->get_ptr(extent->m_begin * m_list_elemsize), items,
+                count * m_list_elemsize);
+        }
+        extent->m_end = static_cast<std::uint32_t>(extent->m_begin + count);
+        m_list_garbage += osize - count;
+        return;
+    }
+
+    PSP_VERBOSE_ASSERT(nitems + count <= std::numeric_limits<std::uint32_t>::max(),
+        "Too many list items in column");
+    if (count > 0) {
+        m_list_values->push_back(items, count * m_list_elemsize);
+    }
+    extent->m_begin = static_cast<std::uint32_t>(nitems);
+    extent->m_end = static_cast<std::uint32_t>(nitems + count);
+    m_list_garbage += osize;
+
+    if (m_list_garbage > DEFAULT_CAPACITY && m_list_garbage * 2 > nitems + count) {
+        compact_list_values();
+    }
+}
+
+void
+t_column::copy_list_nth_raw(t_uindex idx, const t_column& other, t_uindex oidx) {
+    const t_list_extent* extent = other.m_data->get_nth<t_list_extent>(oidx);
+    t_uindex count = extent->m_end - extent->m_begin;
+    const void* items = other.m_list_values->get_ptr(extent->m_begin * m_list_elemsize);
+
+    if (&other == this) {
+        // items point into m_list_values, which may move while the cell grows
+        std::vector<unsigned char> copy(static_cast<const unsigned char*>(items),
+            static_cast<const unsigned char*>(items) + count * m_list_elemsize);
+        set_list_nth_raw(idx, copy.data(), count);
+        return;
+    }
+
+    if (m_dtype != DTYPE_LIST_STR || m_vocab == other.m_vocab) {
+        set_list_nth_raw(idx, items, count);
+        return;
+    }
+
+    std::vector<t_uindex> sidxs(count);
+    const t_uindex* osidxs = static_cast<const t_uindex*>(items);
+    for (t_uindex sidx = 0; sidx < count; ++sidx) {
+        sidxs[sidx] = m_vocab->get_interned(other.m_vocab->unintern_c(osidxs[sidx]));
+    }
+    set_list_nth_raw(idx, sidxs.data(), count);
+}
+
+void
+t_column::copy_list_nth(t_uindex idx, const t_column& other, t_uindex oidx, t_status status) {
+    COLUMN_CHECK_ACCESS(idx);
+    PSP_VERBOSE_ASSERT(m_dtype == other.m_dtype, "Mismatched dtypes detected");
+    copy_list_nth_raw(idx, other, oidx);
+
+    if (is_status_enabled()) {
+        m_status->set_nth<t_status>(idx, status);
+    }
+}
+
+// Moves the items of the rows down over the ones left behind by rewritten
+// cells, in the order they are stored in.
+void
+t_column::compact_list_values() {
+    t_uindex nrows = m_data->size() / sizeof(t_list_extent);
+    t_list_extent* extents = m_data->get_nth<t_list_extent>(0);
+
+    std::vector<t_uindex> order;
+    order.reserve(nrows);
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        if (extents[idx].m_end > extents[idx].m_begin) {
+            order.push_back(idx);
+        }
+    }
+    std::sort(order.begin(), order.end(),
+        [extents](t_uindex a, t_uindex b) { return extents[a].m_begin < extents[b].m_begin; });
+
+    char* base = static_cast<char*>(m_list_values->get_ptr(0));
+    std::uint32_t end = 0;
+    for (t_uindex idx : order) {
+        t_list_extent& extent = extents[idx];
+        std::uint32_t count = extent.m_end - extent.m_begin;
+        if (extent.m_begin != end) {
+            std::memmove(base + end * m_list_elemsize, base + extent.m_begin * m_list_elemsize,
+                count * m_list_elemsize);
+        }
+        extent.m_begin = end;
+        extent.m_end = end + count;
+        end += count;
+    }
+
+    // rows past the size would point at items which have moved
+    std::memset(m_data->get_ptr(m_data->size()), 0, m_data->capacity() - m_data->size());
+    m_list_values->set_size(end * m_list_elemsize);
+    m_list_garbage = 0;
+}
+
 bool
 t_column::is_vlen() const {
     return is_vlen_dtype(m_dtype);
@@ -1160,6 +1351,7 @@ t_column::append(const t_column& other) {
 
             m_vocab->fill(*(other.m_vocab->get_vlendata()), *(other.m_vocab->get_extents()),
                 other.m_vocab->get_vlenidx());
+            invalidate_string_ranks();
 
             set_size(other.size());
             m_vocab->rebuild_map();
@@ -1173,6 +1365,19 @@ t_column::append(const t_column& other) {
                 m_status->append(*other.m_status);
             }
         }
+    } else if (is_dtype_list(m_dtype)) {
+        // extents are rebased onto the items copied over
+        t_uindex offset = m_data->size() / sizeof(t_list_extent);
+        t_uindex osize = other.m_data->size() / sizeof(t_list_extent);
+        t_list_extent* extents = m_data->extend<t_list_extent>(osize);
+        std::fill(extents, extents + osize, t_list_extent{0, 0});
+        for (t_uindex idx = 0; idx < osize; ++idx) {
+            copy_list_nth_raw(offset + idx, other, idx);
+        }
+
+        if (is_status_enabled()) {
+            m_status->append(*other.m_status);
+        }
     } else {
         m_data->append(*other.m_data);
 
@@ -1189,10 +1394,16 @@ t_column::clear() {
     m_data->set_size(0);
     if (m_dtype == DTYPE_STR)
         m_data->clear();
+    if (is_dtype_list(m_dtype)) {
+        m_data->clear();
+        m_list_values->set_size(0);
+        m_list_garbage = 0;
+    }
     if (is_status_enabled()) {
         m_status->clear();
     }
     m_errors.reset();
+    zones_changed(0, m_size);
     m_size = 0;
 }
 
@@ -1210,11 +1421,15 @@ t_column::get_recipe() const {
     rval.m_data = m_data->get_recipe();
     rval.m_isvlen = is_vlen_dtype(m_dtype);
 
-    if (rval.m_isvlen) {
+    if (rval.m_isvlen || m_dtype == DTYPE_LIST_STR) {
         rval.m_vlendata = m_vocab->get_vlendata()->get_recipe();
         rval.m_extents = m_vocab->get_extents()->get_recipe();
     }
 
+    if (is_dtype_list(m_dtype)) {
+        rval.m_list_values = m_list_values->get_recipe();
+    }
+
     rval.m_status_enabled = m_status_enabled;
     if (m_status_enabled) {
         rval.m_status = m_status->get_recipe();
@@ -1233,6 +1448,7 @@ t_column::copy_vocabulary(const t_column* other) {
 #endif
     COLUMN_CHECK_STRCOL();
     m_vocab->copy_vocabulary(*(other->m_vocab.get()));
+    invalidate_string_ranks();
     COLUMN_CHECK_VALUES();
 }
 
@@ -1256,10 +1472,15 @@ t_column::clone() const {
 
     rval->m_truncated = m_truncated;
 
-    if (is_vlen_dtype(get_dtype())) {
+    if (is_vlen_dtype(get_dtype()) || get_dtype() == DTYPE_LIST_STR) {
         rval->m_vocab->clone(*m_vocab);
     }
 
+    if (is_dtype_list(get_dtype())) {
+        rval->m_list_values->fill(*m_list_values);
+        rval->m_list_garbage = m_list_garbage;
+    }
+
     if (m_errors) {
         rval->m_errors = std::make_shared<std::map<t_uindex, t_cell_error>>(*m_errors);
     }
@@ -1287,9 +1508,22 @@ t_column::clone(const t_mask& mask) const {
         rval->m_status->fill(*m_status, mask, sizeof(t_status));
     }
 
-    if (is_vlen_dtype(get_dtype())) {
+    if (is_vlen_dtype(get_dtype()) || get_dtype() == DTYPE_LIST_STR) {
         rval->m_vocab->clone(*m_vocab);
     }
+
+    if (is_dtype_list(get_dtype())) {
+        // the extents still point into this column, copy the items of the
+        // rows kept only
+        t_list_extent* extents = rval->m_data->get_nth<t_list_extent>(0);
+        for (t_uindex idx = 0, loop_end = mask.count(); idx < loop_end; ++idx) {
+            t_list_extent extent = extents[idx];
+            extents[idx] = t_list_extent{0, 0};
+            rval->set_list_nth_raw(idx,
+                m_list_values->get_ptr(extent.m_begin * m_list_elemsize),
+                extent.m_end - extent.m_begin);
+        }
+    }
 #ifdef PSP_COLUMN_VERIFY
     rval->verify();
 #endif
@@ -1299,6 +1533,7 @@ t_column::clone(const t_mask& mask) const {
 void
 t_column::valid_raw_fill() {
     m_status->raw_fill(STATUS_VALID);
+    zones_changed(0, m_size);
 }
 
 void
@@ -1354,6 +1589,23 @@ t_column::copy(const t_column* other, const std::vector<t_uindex>& indices, t_ui
         case DTYPE_STR: {
             copy_helper<const char>(other, indices, offset);
         } break;
+        case DTYPE_LIST_STR:
+        case DTYPE_LIST_BOOL:
+        case DTYPE_LIST_FLOAT64:
+        case DTYPE_LIST_INT64:
+        case DTYPE_LIST_DATE:
+        case DTYPE_LIST_TIME:
+        case DTYPE_LIST_DURATION: {
+            t_uindex eidx = std::min(other->size(), static_cast<t_uindex>(indices.size()));
+            reserve(eidx + offset);
+
+            for (t_uindex idx = 0; idx < eidx; ++idx) {
+                t_status status = other->is_status_enabled()
+                    ? *other->get_nth_status(indices[idx]) : STATUS_VALID;
+                copy_list_nth(offset + idx, *other, indices[idx], status);
+            }
+            COLUMN_CHECK_VALUES();
+        } break;
         default: { PSP_COMPLAIN_AND_ABORT("Unexpected type"); }
     }
 }
@@ -1434,6 +1686,7 @@ t_column::_rebuild_map() {
 void
 t_column::borrow_vocabulary(const t_column& o) {
     m_vocab = const_cast<t_column&>(o).m_vocab;
+    invalidate_string_ranks();
 }
 
 std::vector<double>
@@ -1476,6 +1729,82 @@ t_column::is_truncated() const {
     return m_truncated != WARNING_TYPE_NONE;
 }
 
+std::shared_ptr<const t_zone_map>
+t_column::get_zone_map() const {
+    if (!t_zone_map::is_supported(m_dtype)) {
+        return nullptr;
+    }
+    // contexts may filter the same table concurrently, and keep the maps
+    // they were handed, so a stale map is updated in a copy
+    std::lock_guard<std::mutex> guard(m_zones_mutex);
+    if (!m_zones || !m_zones->is_current(*this)) {
+        auto zones
+            = m_zones ? std::make_shared<t_zone_map>(*m_zones) : std::make_shared<t_zone_map>();
+        zones->update(*this);
+        m_zones = zones;
+    }
+    return m_zones;
+}
+
+std::shared_ptr<const t_string_ranks>
+t_column::get_string_ranks(t_string_collation collation) const {
+    if (m_dtype != DTYPE_STR) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(m_zones_mutex);
+    // ranks handed out earlier stay as they are, new strings are merged
+    // into a copy
+    auto& ranks = m_string_ranks[collation];
+    if (!ranks || !ranks->is_current(*m_vocab)) {
+        auto updated = ranks ? std::make_shared<t_string_ranks>(*ranks)
+                             : std::make_shared<t_string_ranks>(collation);
+        updated->update(*m_vocab);
+        ranks = updated;
+    }
+    return ranks;
+}
+
+void
+t_column::invalidate_string_ranks() {
+    std::lock_guard<std::mutex> guard(m_zones_mutex);
+    for (auto& ranks : m_string_ranks) {
+        ranks.reset();
+    }
+}
+
+void
+t_column::invalidate_zone_map() {
+    std::lock_guard<std::mutex> guard(m_zones_mutex);
+    if (m_zones) {
+        m_zones->mark_all();
+    }
+    if (m_search_index) {
+        m_search_index->mark_all();
+    }
+}
+
+std::shared_ptr<const t_search_index>
+t_column::get_search_index() const {
+    if (!t_search_index::is_supported(m_dtype)) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> guard(m_zones_mutex);
+    if (!m_search_index) {
+        m_search_index = std::make_shared<t_search_index>();
+    }
+    m_search_index->update(*this);
+    return m_search_index;
+}
+
+void
+t_column::update_search_index() {
+    std::lock_guard<std::mutex> guard(m_zones_mutex);
+    if (m_search_index) {
+        m_search_index->update(*this);
+    }
+}
+
 void
 t_column::update_metadata() {
     if (m_meta)
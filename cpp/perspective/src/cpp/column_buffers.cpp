@@ -0,0 +1,261 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/column_buffers.h>
+#include <perspective/data_format_spec.h>
+#include <perspective/schema.h>
+#include <perspective/table.h>
+#include <perspective/vocab.h>
+#include <cstring>
+
+namespace perspective {
+
+namespace {
+
+    inline bool
+    get_bit(const std::uint8_t* bits, t_uindex idx) {
+        return (bits[idx / 8] & (1 << (idx % 8))) != 0;
+    }
+
+    void
+    fill_col_bool(t_column& col, const t_column_buffers& buffers, t_uindex nrows) {
+        const std::uint8_t* bits = static_cast<const std::uint8_t*>(buffers.m_values);
+        bool* values = col.get_nth<bool>(0);
+        for (t_uindex i = 0; i < nrows; ++i) {
+            values[i] = get_bit(bits, i);
+        }
+    }
+
+    template <typename T>
+    void
+    fill_col_list(t_column& col, const t_column_buffers& buffers, t_uindex nrows) {
+        col.set_list_values(static_cast<const T*>(buffers.m_values), buffers.m_offsets, nrows);
+    }
+
+    void
+    fill_col_list_bool(t_column& col, const t_column_buffers& buffers, t_uindex nrows) {
+        const std::uint8_t* bits = static_cast<const std::uint8_t*>(buffers.m_values);
+        const std::int32_t* offsets = buffers.m_offsets;
+        std::vector<std::uint8_t> items(offsets[nrows]);
+        for (std::int32_t idx = offsets[0]; idx < offsets[nrows]; ++idx) {
+            items[idx] = get_bit(bits, idx);
+        }
+        col.set_list_values(reinterpret_cast<const bool*>(items.data()), offsets, nrows);
+    }
+
+    // Offsets of DTYPE_LIST_STR point into the values buffer, items are
+    // assigned to the row their start falls into, as the Arrow path does.
+    // All the items are interned at once and stored as ids.
+    void
+    fill_col_list_string(t_column& col, const t_column_buffers& buffers, t_uindex nrows) {
+        const std::int32_t* offsets = buffers.m_offsets;
+        const std::int32_t* sub_offsets = buffers.m_sub_offsets;
+        std::vector<std::int32_t> item_offsets(nrows + 1);
+        std::int32_t curr_idx = 0;
+
+        for (t_uindex i = 0; i < nrows; ++i) {
+            std::int32_t eidx = offsets[i + 1];
+            while (sub_offsets[curr_idx] < eidx) {
+                ++curr_idx;
+            }
+            item_offsets[i + 1] = curr_idx;
+        }
+
+        std::vector<t_uindex> sidxs(curr_idx);
+        col.get_vocab()->bulk_intern(
+            static_cast<const char*>(buffers.m_values), sub_offsets, curr_idx, sidxs.data());
+        col.set_list_values(sidxs.data(), item_offsets.data(), nrows);
+    }
+
+    /**
+     * Looks up the error of column `cidx` in a row of the __error__ column,
+     * which Ingest writes as {"<cidx>":{"c":"<code>","v":"<json escaped value>"},...}
+     */
+    bool
+    find_cell_error(const char* errors, t_index cidx, t_cell_error& error) {
+        const std::string key = "\"" + std::to_string(cidx) + "\":{\"c\":\"";
+        const char* p = std::strstr(errors, key.c_str());
+        if (p == nullptr) {
+            return false;
+        }
+        p += key.size();
+        error.m_code = num_to_error_code(std::strtol(p, nullptr, 10));
+
+        p = std::strstr(p, "\"v\":\"");
+        if (p == nullptr) {
+            return false;
+        }
+        error.m_value.clear();
+        for (p += 5; *p != '\0' && *p != '"'; ++p) {
+            if (*p != '\\' || p[1] == '\0') {
+                error.m_value.push_back(*p);
+                continue;
+            }
+            switch (*++p) {
+                case 'b': error.m_value.push_back('\b'); break;
+                case 'f': error.m_value.push_back('\f'); break;
+                case 'n': error.m_value.push_back('\n'); break;
+                case 'r': error.m_value.push_back('\r'); break;
+                case 't': error.m_value.push_back('\t'); break;
+                case 'u': {
+                    // only control characters are escaped this way
+                    error.m_value.push_back(static_cast<char>(std::strtol(std::string(p + 1, 4).c_str(), nullptr, 16)));
+                    p += 4;
+                } break;
+                default: error.m_value.push_back(*p);
+            }
+        }
+        return true;
+    }
+
+    void
+    fill_col_valid(t_column& col, const t_column_buffers& buffers, t_index cidx,
+        const t_column* error_col, t_uindex nrows) {
+        if (buffers.m_validity == nullptr) {
+            col.valid_raw_fill();
+            return;
+        }
+
+        t_cell_error cell_error;
+        for (t_uindex i = 0; i < nrows; ++i) {
+            bool v = get_bit(buffers.m_validity, i);
+            if (!v && error_col && error_col->is_valid(i)
+                && find_cell_error(
+                    error_col->get_vocab()->unintern_c(*error_col->get_nth<t_uindex>(i)),
+                    cidx, cell_error)) {
+                col.set_error_status(i);
+                col.set_error(i, cell_error);
+            } else {
+                col.set_valid(i, v);
+            }
+        }
+    }
+
+} // namespace
+
+void
+fill_column_from_buffers(t_column& col, const t_column_buffers& buffers, t_index cidx,
+    const t_column* error_col) {
+    t_uindex nrows = col.size();
+
+    if (nrows > 0) {
+        switch (buffers.m_dtype) {
+            case DTYPE_INT64:
+            case DTYPE_INT32:
+            case DTYPE_INT16:
+            case DTYPE_INT8:
+            case DTYPE_FLOAT64:
+            case DTYPE_DATE:
+            case DTYPE_TIME:
+            case DTYPE_DURATION: {
+                std::memcpy(col.get_nth<std::uint8_t>(0), buffers.m_values,
+                    get_dtype_size(buffers.m_dtype) * nrows);
+            } break;
+            case DTYPE_BOOL: {
+                fill_col_bool(col, buffers, nrows);
+            } break;
+            case DTYPE_STR: {
+                col.get_vocab()->bulk_intern(static_cast<const char*>(buffers.m_values),
+                    buffers.m_offsets, nrows, col.get_nth<t_uindex>(0));
+            } break;
+            case DTYPE_LIST_INT64: {
+                fill_col_list<std::int64_t>(col, buffers, nrows);
+            } break;
+            case DTYPE_LIST_DURATION:
+            case DTYPE_LIST_TIME:
+            case DTYPE_LIST_FLOAT64: {
+                fill_col_list<double>(col, buffers, nrows);
+            } break;
+            case DTYPE_LIST_DATE: {
+                fill_col_list<t_date>(col, buffers, nrows);
+            } break;
+            case DTYPE_LIST_BOOL: {
+                fill_col_list_bool(col, buffers, nrows);
+            } break;
+            case DTYPE_LIST_STR: {
+                fill_col_list_string(col, buffers, nrows);
+            } break;
+            default: {
+                PSP_COMPLAIN_AND_ABORT("Unsupported column type for " + buffers.m_name + ": "
+                    + get_dtype_descr(buffers.m_dtype));
+            }
+        }
+    }
+
+    fill_col_valid(col, buffers, cidx, error_col, nrows);
+    col.invalidate_zone_map();
+}
+
+std::shared_ptr<t_gnode>
+make_table_from_buffers(t_pool* pool, const std::vector<t_column_buffers>& columns,
+    t_uindex nrows, const std::string& index, std::uint32_t limit) {
+    std::vector<std::string> colnames;
+    std::vector<t_dtype> dtypes;
+    std::vector<t_dataformattype> dftypes;
+    for (const auto& buffers : columns) {
+        colnames.push_back(buffers.m_name);
+        dtypes.push_back(buffers.m_dtype);
+        dftypes.push_back(get_default_data_format_type(buffers.m_dtype));
+    }
+
+    if (index != "" && std::find(colnames.begin(), colnames.end(), index) == colnames.end()) {
+        PSP_COMPLAIN_AND_ABORT("Specified index '" + index + "' does not exist in data.")
+    }
+
+    t_schema oscm(colnames, dtypes, dftypes);
+    std::shared_ptr<t_gnode> gnode;
+
+    // The local table is released before processing, the pool keeps its own copy
+    {
+        t_table tbl(oscm);
+        tbl.init();
+        tbl.extend(nrows);
+
+        // __error__ is filled first, other columns look up their errors in it
+        std::shared_ptr<t_column> error_col;
+        auto it = std::find(colnames.begin(), colnames.end(), ERROR_COLUMN);
+        if (it != colnames.end()) {
+            t_index error_cidx = std::distance(colnames.begin(), it);
+            error_col = tbl.get_column(ERROR_COLUMN);
+            fill_column_from_buffers(*error_col, columns[error_cidx], error_cidx, nullptr);
+        }
+
+        for (t_index cidx = 0, loop_end = columns.size(); cidx < loop_end; ++cidx) {
+            if (colnames[cidx] == ERROR_COLUMN) {
+                continue;
+            }
+            fill_column_from_buffers(
+                *tbl.get_column(colnames[cidx]), columns[cidx], cidx, error_col.get());
+        }
+
+        auto op_col = tbl.add_column("psp_op", DTYPE_UINT8, false, DATA_FORMAT_NUMBER);
+        op_col->raw_fill<std::uint8_t>(OP_INSERT);
+
+        if (index == "") {
+            auto key_col = tbl.add_column("psp_pkey", DTYPE_INT32, false, DATA_FORMAT_NUMBER);
+            for (t_uindex ridx = 0; ridx < nrows; ++ridx) {
+                key_col->set_nth<std::int32_t>(ridx, ridx % limit);
+            }
+        } else {
+            tbl.clone_column(index, "psp_pkey");
+        }
+
+        gnode = std::make_shared<t_gnode>(oscm, tbl.get_schema());
+        gnode->init();
+        pool->register_gnode(gnode.get());
+        pool->send(gnode->get_id(), 0, tbl);
+    }
+
+    pool->_process();
+
+    return gnode;
+}
+
+} // end namespace perspective
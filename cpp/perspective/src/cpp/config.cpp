@@ -474,6 +474,8 @@ t_config::setup(const std::vector<std::string>& detail_columns,
             case AGGTYPE_DISTINCT_LEAF:
             case AGGTYPE_CUSTOM:
             case AGGTYPE_DISTINCT_VALUES:
+            case AGGTYPE_APPROX_MEDIAN:
+            case AGGTYPE_APPROX_DISTINCT_COUNT:
                 m_has_pkey_agg = true;
                 break;
             default:
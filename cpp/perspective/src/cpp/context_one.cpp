@@ -310,7 +310,7 @@ t_ctx1::get_data(t_index start_row, t_index end_row, t_index start_col, t_index
             for (t_uindex aggidx = ext.m_srow - 1, loop_end = aggspecs.size(); aggidx < loop_end; ++aggidx) {
                 std::vector<t_tscalar> r_values = std::vector<t_tscalar>();
                 auto aggcol = aggtable->get_const_column(aggidx).get();
-                r_values.push_back(get_interned_tscalar(aggcol->get_scalar(0)));
+                r_values.push_back(m_symtable.get_interned_tscalar(aggcol->get_scalar(0)));
                 row_values.push_back(r_values);
             }
         } 
@@ -1088,7 +1088,7 @@ t_ctx1::unity_get_row_path(t_uindex idx) const {
                 r_paths.push_back(get_interned_tscalar(aggname));
             } else {
                 if (m_traversal->get_node_expanded(nindice.m_idx)) {
-                    r_paths[0] = get_interned_tscalar(r_paths.begin()->to_string() + " " + aggname);
+                    r_paths[0] = m_symtable.get_interned_tscalar(r_paths.begin()->to_string() + " " + aggname);
                 } else {
                     r_paths.insert(r_paths.begin(), get_interned_tscalar(aggname));
                 }
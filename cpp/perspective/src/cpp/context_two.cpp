@@ -1856,7 +1856,7 @@ t_ctx2::unity_get_row_path(t_uindex idx) const {
                 r_paths.push_back(get_interned_tscalar(aggname));
             } else {
                 if (m_rtraversal->get_node_expanded(rindice.m_idx)) {
-                    r_paths[0] = get_interned_tscalar(r_paths.begin()->to_string() + " " + aggname);
+                    r_paths[0] = m_symtable.get_interned_tscalar(r_paths.begin()->to_string() + " " + aggname);
                 } else {
                     r_paths.insert(r_paths.begin(), get_interned_tscalar(aggname));
                 }
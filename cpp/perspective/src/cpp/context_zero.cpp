@@ -417,91 +417,19 @@ t_ctx0::sidedness() const {
 void
 t_ctx0::notify(const t_table& flattened, const t_table& delta, const t_table& prev,
     const t_table& curr, const t_table& transitions, const t_table& existed) {
-	PSP_COMPLAIN_AND_ABORT("unimplemented");
-	#if 0
     psp_log_time(repr() + " notify.enter");
-    t_uindex nrecs = flattened.size();
-    std::shared_ptr<const t_column> pkey_sptr = flattened.get_const_column("psp_pkey");
-    std::shared_ptr<const t_column> op_sptr = flattened.get_const_column("psp_op");
-    const t_column* pkey_col = pkey_sptr.get();
-    const t_column* op_col = op_sptr.get();
-
-    std::shared_ptr<const t_column> existed_sptr = existed.get_const_column("psp_existed");
-    const t_column* existed_col = existed_sptr.get();
-
-    bool delete_encountered = false;
-    if (m_config.has_filters()) {
-        t_mask msk_prev = filter_table_for_config(prev, m_config);
-        t_mask msk_curr = filter_table_for_config(curr, m_config);
-
-        for (t_uindex idx = 0; idx < nrecs; ++idx) {
-            t_tscalar pkey = m_symtable.get_interned_tscalar(pkey_col->get_scalar(idx));
-
-            std::uint8_t op_ = *(op_col->get_nth<std::uint8_t>(idx));
-            t_op op = static_cast<t_op>(op_);
-            bool existed = *(existed_col->get_nth<bool>(idx));
-
-            switch (op) {
-                case OP_INSERT: {
-                    bool filter_curr = msk_curr.get(idx);
-                    bool filter_prev = msk_prev.get(idx) && existed;
-
-                    if (filter_prev) {
-                        if (filter_curr) {
-                            m_traversal->update_row(m_state, m_config, pkey);
-                        } else {
-                            m_traversal->delete_row(pkey);
-                        }
-                    } else {
-                        if (filter_curr) {
-                            m_traversal->add_row(m_state, m_config, pkey);
-                        }
-                    }
-                } break;
-                case OP_DELETE: {
-                    m_traversal->delete_row(pkey);
-                    delete_encountered = true;
-                } break;
-                default: { PSP_COMPLAIN_AND_ABORT("Unexpected OP"); } break;
-            }
-        }
-        psp_log_time(repr() + " notify.has_filter_path.updated_traversal");
-        calc_step_delta(flattened, prev, curr, transitions);
-        m_has_delta = m_deltas->size() > 0 || delete_encountered;
-        psp_log_time(repr() + " notify.has_filter_path.exit");
-
-        return;
-    }
+    update_data_formats();
 
-    for (t_uindex idx = 0; idx < nrecs; ++idx) {
-        t_tscalar pkey = m_symtable.get_interned_tscalar(pkey_col->get_scalar(idx));
-        std::uint8_t op_ = *(op_col->get_nth<std::uint8_t>(idx));
-        t_op op = static_cast<t_op>(op_);
-        bool existed = *(existed_col->get_nth<bool>(idx));
-
-        switch (op) {
-            case OP_INSERT: {
-                if (existed) {
-                    m_traversal->update_row(m_state, m_config, pkey);
-                } else {
-                    m_traversal->add_row(m_state, m_config, pkey);
-                }
-            } break;
-            case OP_DELETE: {
-                m_traversal->delete_row(pkey);
-                delete_encountered = true;
-            } break;
-            case OP_CLEAR: {
-                PSP_COMPLAIN_AND_ABORT("Unexpected OP");
-            } break;
-        }
-    }
+    // only the pkeys of the update are placed, filtered and sorted again
+    bool rows_changed
+        = m_traversal->update_rows(m_state, m_config, flattened, prev, curr, existed);
+    m_rows_changed = m_rows_changed || rows_changed;
+    psp_log_time(repr() + " notify.updated_traversal");
 
-    psp_log_time(repr() + " notify.no_filter_path.updated_traversal");
     calc_step_delta(flattened, prev, curr, transitions);
-    m_has_delta = m_deltas->size() > 0 || delete_encountered;
-    psp_log_time(repr() + " notify.no_filter_path.exit");
-	#endif
+    m_has_delta = rows_changed || m_deltas->size() > 0;
+    m_config.update_query_percentage_store(QUERY_PERCENT_NOTIFY, 100);
+    psp_log_time(repr() + " notify.exit");
 }
 
 void
@@ -532,13 +460,13 @@ t_ctx0::calc_step_delta(const t_table& flattened, const t_table& prev, const t_t
                 case VALUE_TRANSITION_NVEQ_FT:
                 case VALUE_TRANSITION_NEQ_FT:
                 case VALUE_TRANSITION_NEQ_TDT: {
-                    m_deltas->insert(t_zcdelta(get_interned_tscalar(pkey_col->get_scalar(ridx)),
-                        cidx, mknone(), get_interned_tscalar(ccol->get_scalar(ridx))));
+                    m_deltas->insert(t_zcdelta(m_symtable.get_interned_tscalar(pkey_col->get_scalar(ridx)),
+                        cidx, mknone(), m_symtable.get_interned_tscalar(ccol->get_scalar(ridx))));
                 } break;
                 case VALUE_TRANSITION_NEQ_TT: {
-                    m_deltas->insert(t_zcdelta(get_interned_tscalar(pkey_col->get_scalar(ridx)),
-                        cidx, get_interned_tscalar(pcol->get_scalar(ridx)),
-                        get_interned_tscalar(ccol->get_scalar(ridx))));
+                    m_deltas->insert(t_zcdelta(m_symtable.get_interned_tscalar(pkey_col->get_scalar(ridx)),
+                        cidx, m_symtable.get_interned_tscalar(pcol->get_scalar(ridx)),
+                        m_symtable.get_interned_tscalar(ccol->get_scalar(ridx))));
                 } break;
                 default: {}
             }
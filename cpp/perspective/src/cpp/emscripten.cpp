@@ -2079,17 +2079,15 @@ namespace binding {
             // Get number of dictionary entries
             std::uint32_t dsize = dictvec["length"].as<std::uint32_t>();
 
-            t_vocab* vocab = &*col->get_vocab();
-            std::string elem;
-
+            std::vector<t_uindex> indices(dsize);
+            col->get_vocab()->bulk_intern(
+                reinterpret_cast<const char*>(data.data()), offsets.data(), dsize, indices.data());
+#ifndef NDEBUG
+            // Make sure there are no duplicates in the arrow dictionary
             for (std::uint32_t i = 0; i < dsize; ++i) {
-                std::int32_t bidx = offsets[i];
-                std::size_t es = offsets[i + 1] - bidx;
-                elem.assign(reinterpret_cast<char*>(data.data()) + bidx, es);
-                t_uindex idx = vocab->get_interned(elem);
-                // Make sure there are no duplicates in the arrow dictionary
-                assert(idx == i);
+                assert(indices[i] == i);
             }
+#endif
         }
     } // namespace arrow
 
@@ -2514,14 +2512,9 @@ namespace binding {
                 offsets.resize(osize);
                 arrow::vecFromTypedArray(voffsets, offsets.data(), osize);
 
-                std::string elem;
-
-                for (std::int32_t i = 0; i < nrows; ++i) {
-                    std::int32_t bidx = offsets[i];
-                    std::size_t es = offsets[i + 1] - bidx;
-                    elem.assign(reinterpret_cast<char*>(data.data()) + bidx, es);
-                    col->set_nth(i, elem);
-                }
+                // validity is set from the null bitmap once the values are filled
+                col->get_vocab()->bulk_intern(reinterpret_cast<const char*>(data.data()),
+                    offsets.data(), nrows, col->get_nth<t_uindex>(0));
             }
         } else {
             for (auto i = 0; i < nrows; ++i) {
@@ -2653,13 +2646,7 @@ namespace binding {
                     data.reserve(vsize/2);
                     data.resize(vsize/2);
                     arrow::vecFromTypedArray(vdata, data.data(), vsize);
-
-                    for (std::int32_t i = 0; i < nrows; ++i) {
-                        std::int32_t bidx = offsets[i];
-                        std::int32_t eidx = offsets[i + 1];
-                        std::vector<std::int64_t> elem(data.begin() + bidx, data.begin() + eidx);
-                        col->set_nth(i, elem);
-                    }
+                    col->set_list_values(data.data(), offsets.data(), nrows);
                 } break;
 
                 case DTYPE_LIST_DURATION:
@@ -2669,13 +2656,7 @@ namespace binding {
                     data.reserve(vsize);
                     data.resize(vsize);
                     arrow::vecFromTypedArray(vdata, data.data(), vsize);
-
-                    for (std::int32_t i = 0; i < nrows; ++i) {
-                        std::int32_t bidx = offsets[i];
-                        std::int32_t eidx = offsets[i + 1];
-                        std::vector<double> elem(data.begin() + bidx, data.begin() + eidx);
-                        col->set_nth(i, elem);
-                    }
+                    col->set_list_values(data.data(), offsets.data(), nrows);
                 } break;
 
                 case DTYPE_LIST_DATE: {
@@ -2683,13 +2664,7 @@ namespace binding {
                     data.reserve(vsize);
                     data.resize(vsize);
                     arrow::vecFromTypedArray(vdata, data.data(), vsize);
-
-                    for (std::int32_t i = 0; i < nrows; ++i) {
-                        std::int32_t bidx = offsets[i];
-                        std::int32_t eidx = offsets[i + 1];
-                        std::vector<int32_t> elem(data.begin() + bidx, data.begin() + eidx);
-                        col->set_nth(i, elem);
-                    }
+                    col->set_list_values(data.data(), offsets.data(), nrows);
                 } break;
 
                 case DTYPE_LIST_BOOL: {
@@ -2989,6 +2964,9 @@ namespace binding {
         }
 
         if (is_arrow) {
+            // arrow values are copied through get_nth() pointers
+            col->invalidate_zone_map();
+
             // Fill validity bitmap
             std::uint32_t null_count = dcol["nullCount"].as<std::uint32_t>();
 
@@ -4881,7 +4859,11 @@ EMSCRIPTEN_BINDINGS(perspective) {
         .constructor<>()
         .smart_ptr<std::shared_ptr<t_pool>>("shared_ptr<t_pool>")
         .function("unregister_gnode", &t_pool::unregister_gnode)
-        .function("set_update_delegate", &t_pool::set_update_delegate);
+        .function("set_update_delegate", &t_pool::set_update_delegate)
+        // wasm has no pool thread to coalesce sends, so set_coalescing is not
+        // bound; the stats count the flushes of _process()
+        .function("get_stats", &t_pool::get_stats)
+        .function("reset_stats", &t_pool::reset_stats);
 
     /******************************************************************************
      *
@@ -4903,6 +4885,18 @@ EMSCRIPTEN_BINDINGS(perspective) {
         .field("gnode_id", &t_updctx::m_gnode_id)
         .field("ctx_name", &t_updctx::m_ctx);
 
+    /******************************************************************************
+     *
+     * t_pool_stats
+     */
+    value_object<t_pool_stats>("t_pool_stats")
+        .field("nflushes", &t_pool_stats::m_nflushes)
+        .field("nrows", &t_pool_stats::m_nrows)
+        .field("last_latency", &t_pool_stats::m_last_latency)
+        .field("max_latency", &t_pool_stats::m_max_latency)
+        .field("total_latency", &t_pool_stats::m_total_latency)
+        .field("total_process", &t_pool_stats::m_total_process);
+
     /******************************************************************************
      *
      * t_cellupd
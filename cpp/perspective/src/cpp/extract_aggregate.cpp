@@ -70,7 +70,9 @@ extract_aggregate(
         case AGGTYPE_DISTINCT_COUNT:
         case AGGTYPE_DISTINCT_LEAF:
         case AGGTYPE_CUSTOM:
-        case AGGTYPE_DISTINCT_VALUES: {
+        case AGGTYPE_DISTINCT_VALUES:
+        case AGGTYPE_APPROX_MEDIAN:
+        case AGGTYPE_APPROX_DISTINCT_COUNT: {
             t_tscalar rval = aggcol->get_pivot_scalar(ridx);
             return rval;
         } break;
@@ -9,6 +9,8 @@
 
 #include <perspective/first.h>
 #include <perspective/filter.h>
+#include <algorithm>
+#include <array>
 #include <unordered_set>
 
 namespace perspective {
@@ -155,49 +157,219 @@ t_fterm::get_expr() const {
     return ss.str();
 }
 
+static inline std::uint64_t
+tail_bits(t_uindex n) {
+    return n >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << n) - 1;
+}
+
+// Packs g(row) of rows [first, last) into words. Full words have a fixed trip
+// count, so that the compiler unrolls and vectorizes the typed kernels.
+template<class G>
+static inline void
+pack_words(t_uindex first, t_uindex last, std::uint64_t *words, G g) {
+    for(t_uindex i = first; i < last; i += 64) {
+        std::uint64_t word = 0;
+        if(last - i >= 64) {
+            for(t_uindex j = 0; j < 64; ++j)
+                word |= std::uint64_t(g(i + j)) << j;
+        } else {
+            for(t_uindex j = 0, n = last - i; j < n; ++j)
+                word |= std::uint64_t(g(i + j)) << j;
+        }
+        *words++ = word;
+    }
+}
+
 template<class T, class F>
 static t_fterm::t_prepared
 prepare_block(const t_column *col, F f) {
     const t_status *status = col->get_nth_status(0);
     const T *value = col->get_nth<T>(0);
-    return [=](t_uindex first, t_uindex last) {
-        uint32_t mask = 0;
-        for(t_uindex i = first; i < last; ++i) {
-            bool b = f(status[i], value[i]);
-            mask |= b << (i - first);
+    return [=](t_uindex first, t_uindex last, std::uint64_t *words) {
+        pack_words(first, last, words, [&](t_uindex i) { return f(status[i], value[i]); });
+    };
+}
+
+template<class F>
+static t_fterm::t_prepared
+prepare_status(const t_column *col, F f) {
+    const t_status *status = col->get_nth_status(0);
+    return [=](t_uindex first, t_uindex last, std::uint64_t *words) {
+        pack_words(first, last, words, [&](t_uindex i) { return f(status[i]); });
+    };
+}
+
+static inline void
+fill_words(t_uindex first, t_uindex last, std::uint64_t *words, bool value) {
+    for(t_uindex i = first; i < last; i += 64)
+        *words++ = value ? tail_bits(last - i) : 0;
+}
+
+static t_fterm::t_prepared
+prepare_fill(bool value) {
+    return [=](t_uindex first, t_uindex last, std::uint64_t *words) {
+        fill_words(first, last, words, value);
+    };
+}
+
+// Skips the kernel on the zone map blocks whose result is known. Kernels only
+// look at the status class of the rows that are not valid: `below` and `above`
+// are their results for statuses below and above STATUS_VALID. match(zone)
+// gives the result of all the valid rows of a block, or -1 if it depends on
+// the row. Blocks holding a single value or a single status class are
+// evaluated on their first row.
+template<class M>
+static t_fterm::t_prepared
+prepare_zoned(const t_column *col, t_fterm::t_prepared kernel, bool below, bool above, M match) {
+    std::shared_ptr<const t_zone_map> zones = col->get_zone_map();
+    if(!zones)
+        return kernel;
+
+    auto outcome = [=](const t_zone &z, t_uindex bidx) {
+        if(z.is_constant() || z.m_nnull == z.m_nrows || z.m_ncleared == z.m_nrows) {
+            std::uint64_t word;
+            kernel(bidx, bidx + 1, &word);
+            return int(word & 1);
+        }
+        int res = z.num_valid() > 0 ? match(z) : int(below);
+        if(z.m_nnull > 0 && res != int(below))
+            return -1;
+        if(z.m_ncleared > 0 && res != int(above))
+            return -1;
+        return res;
+    };
+
+    return [=](t_uindex first, t_uindex last, std::uint64_t *words) {
+        // rows [pending, bidx) are left for the kernel
+        t_uindex pending = first;
+        for(t_uindex bidx = first; bidx < last;) {
+            t_uindex zidx = bidx / ZONE_MAP_BLOCK_SIZE;
+            t_uindex eidx = std::min((zidx + 1) * ZONE_MAP_BLOCK_SIZE, last);
+            int res = zidx < zones->num_zones() ? outcome(zones->get_zone(zidx), bidx) : -1;
+            if(res >= 0) {
+                if(pending < bidx)
+                    kernel(pending, bidx, words + (pending - first) / 64);
+                fill_words(bidx, eidx, words + (bidx - first) / 64, res == 1);
+                pending = eidx;
+            }
+            bidx = eidx;
         }
-        return mask;
+        if(pending < last)
+            kernel(pending, last, words + (pending - first) / 64);
     };
 }
 
+// `set` holds the bit patterns of the values, T gives their order
+template<class T, class U>
+static t_fterm::t_prepared
+prepare_in_kernel(const t_column *col, bool negate, std::vector<U> set) {
+    std::sort(set.begin(), set.end());
+    set.erase(std::unique(set.begin(), set.end()), set.end());
+
+    if(set.empty())
+        return prepare_status(col, [=](t_status s) { return s == STATUS_VALID && negate; });
+
+    // a few values are compared without branches, the first one fills the unused slots
+    if(set.size() <= 8) {
+        std::array<U, 8> small;
+        small.fill(set[0]);
+        std::copy(set.begin(), set.end(), small.begin());
+        return prepare_block<U>(col, [=](t_status s, U x) {
+            bool found = false;
+            for(size_t k = 0; k < small.size(); ++k)
+                found |= x == small[k];
+            return s == STATUS_VALID && found != negate;
+        });
+    }
+
+    // integers within a short range are looked up in a bitmap
+    if(std::is_integral<T>::value) {
+        T lo, hi;
+        memcpy(&lo, &set.front(), sizeof(T));
+        hi = lo;
+        for(U u : set) {
+            T v;
+            memcpy(&v, &u, sizeof(T));
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+        }
+        U ulo, uhi;
+        memcpy(&ulo, &lo, sizeof(U));
+        memcpy(&uhi, &hi, sizeof(U));
+        U range = U(uhi - ulo);
+        if(range < (1 << 16)) {
+            std::vector<std::uint64_t> bits(range / 64 + 1);
+            for(U u : set) {
+                U d = U(u - ulo);
+                bits[d / 64] |= std::uint64_t(1) << (d % 64);
+            }
+            return prepare_block<U>(col, [=](t_status s, U x) {
+                U d = U(x - ulo);
+                bool inside = d <= range;
+                d = inside ? d : 0;
+                bool found = inside && ((bits[d / 64] >> (d % 64)) & 1);
+                return s == STATUS_VALID && found != negate;
+            });
+        }
+    }
+
+    std::unordered_set<U> hash_bag(set.begin(), set.end());
+    return prepare_block<U>(col, [=](t_status s, U x) {
+        return s == STATUS_VALID && (hash_bag.find(x) != hash_bag.end()) != negate;
+    });
+}
+
+// blocks whose range holds none of the values are decided without a scan
+template<class T, class U>
+static t_fterm::t_prepared
+prepare_in_set(const t_column *col, bool negate, std::vector<U> set) {
+    std::vector<T> values;
+    values.reserve(set.size());
+    for(U u : set) {
+        T v;
+        memcpy(&v, &u, sizeof(T));
+        values.push_back(v);
+    }
+    t_fterm::t_prepared kernel = prepare_in_kernel<T, U>(col, negate, std::move(set));
+    if(std::any_of(values.begin(), values.end(), [](T v) { return v != v; }))
+        return kernel;
+    std::sort(values.begin(), values.end());
+
+    return prepare_zoned(col, kernel, false, false, [=](const t_zone &z) {
+        if(z.m_has_nan)
+            return -1;
+        auto it = std::lower_bound(values.begin(), values.end(), z.get_min<T>());
+        if(it != values.end() && !(z.get_max<T>() < *it))
+            return -1;
+        return int(negate);
+    });
+}
+
 template<class T, class U>
 static t_fterm::t_prepared
 prepare_in_t(const t_column *col, bool negate, const std::vector<t_tscalar> &bag) {
     static_assert(sizeof(T) == sizeof(U), "bit size mismatch");
-    std::unordered_set<U> hash_bag;
+    std::vector<U> set;
+    set.reserve(bag.size());
     for(auto &x : bag) {
         T v = x.get<T>();
         U u;
         memcpy(&u, &v, sizeof(u));
-        hash_bag.insert(u);
+        set.push_back(u);
     }
-    return prepare_block<U>(col, [=](t_status s, U x) {
-        return s == STATUS_VALID && (hash_bag.find(x) != hash_bag.end()) != negate;
-    });
+    return prepare_in_set<T, U>(col, negate, std::move(set));
 }
 
 static t_fterm::t_prepared
 prepare_in_str(const t_column *col, bool negate, const std::vector<t_tscalar> &bag) {
-    std::unordered_set<t_uindex> hash_bag;
+    std::vector<t_uindex> set;
     const t_vocab *vocab = &*col->get_vocab();
     for(auto &x : bag) {
         t_uindex u;
         if(vocab->string_exists(x.get_char_ptr(), u))
-            hash_bag.insert(u);
+            set.push_back(u);
     }
-    return prepare_block<t_uindex>(col, [=](t_status s, t_uindex x) {
-        return s == STATUS_VALID && (hash_bag.find(x) != hash_bag.end()) != negate;
-    });
+    return prepare_in_set<t_uindex, t_uindex>(col, negate, std::move(set));
 }
 
 static t_fterm::t_prepared
@@ -231,7 +403,18 @@ prepare_between_t(const t_column *col, const t_tscalar &low, const t_tscalar &hi
     T lo = low.get<T>(), hi = high.get<T>();
     if(hi < lo)
         std::swap(lo, hi);
-    return prepare_block<T>(col, [=](t_status s, T x){ return s == STATUS_VALID && lo <= x && x < hi; });
+    auto kernel = prepare_block<T>(col, [=](t_status s, T x){ return s == STATUS_VALID && lo <= x && x < hi; });
+    if(lo != lo || hi != hi)
+        return kernel;
+
+    return prepare_zoned(col, kernel, false, false, [=](const t_zone &z) {
+        T zlo = z.get_min<T>(), zhi = z.get_max<T>();
+        if(z.m_has_nan)
+            return -1;
+        if(zhi < lo || !(zlo < hi))
+            return 0;
+        return lo <= zlo && zhi < hi ? 1 : -1;
+    });
 }
 
 static t_fterm::t_prepared
@@ -255,6 +438,157 @@ prepare_between(const t_column *col, t_tscalar low, t_tscalar high) {
     }
 }
 
+// result of all the values within [lo, hi] compared to t, -1 if they differ
+template<class T>
+static int
+match_compare(t_filter_op op, T t, T lo, T hi) {
+    switch(op) {
+    case FILTER_OP_EQ:
+        return t < lo || hi < t ? 0 : (lo == hi ? 1 : -1);
+    case FILTER_OP_NE:
+        return t < lo || hi < t ? 1 : (lo == hi ? 0 : -1);
+    case FILTER_OP_LT:
+    case FILTER_OP_BEFORE:
+        return hi < t ? 1 : (!(lo < t) ? 0 : -1);
+    case FILTER_OP_LTEQ:
+        return hi <= t ? 1 : (t < lo ? 0 : -1);
+    case FILTER_OP_GT:
+    case FILTER_OP_AFTER:
+        return t < lo ? 1 : (hi <= t ? 0 : -1);
+    default:
+        return t <= lo ? 1 : (hi < t ? 0 : -1);
+    }
+}
+
+template<class T>
+static t_fterm::t_prepared
+prepare_compare_t(const t_column *col, t_filter_op op, const t_tscalar &threshold) {
+    T t = threshold.get<T>();
+
+    // rows that are not valid compare by status only, the same way for all the
+    // statuses below STATUS_VALID and for all the ones above it
+    t_tscalar probe = threshold;
+    probe.m_status = STATUS_INVALID;
+    bool below = probe.cmp(op, threshold);
+    probe.m_status = STATUS_CLEAR;
+    bool above = probe.cmp(op, threshold);
+    auto pass = [=](t_status s, bool b) {
+        return s == STATUS_VALID ? b : (s < STATUS_VALID ? below : above);
+    };
+
+    t_fterm::t_prepared kernel;
+    switch(op) {
+    case FILTER_OP_EQ:
+        kernel = prepare_block<T>(col, [=](t_status s, T x) { return pass(s, x == t); });
+        break;
+    case FILTER_OP_NE:
+        kernel = prepare_block<T>(col, [=](t_status s, T x) { return pass(s, x != t); });
+        break;
+    case FILTER_OP_LT:
+    case FILTER_OP_BEFORE:
+        kernel = prepare_block<T>(col, [=](t_status s, T x) { return pass(s, x < t); });
+        break;
+    case FILTER_OP_LTEQ:
+        kernel = prepare_block<T>(col, [=](t_status s, T x) { return pass(s, x <= t); });
+        break;
+    case FILTER_OP_GT:
+    case FILTER_OP_AFTER:
+        kernel = prepare_block<T>(col, [=](t_status s, T x) { return pass(s, x > t); });
+        break;
+    case FILTER_OP_GTEQ:
+    case FILTER_OP_LAST_7_DAYS:
+    case FILTER_OP_LAST_10_DAYS:
+    case FILTER_OP_LAST_30_DAYS:
+        kernel = prepare_block<T>(col, [=](t_status s, T x) { return pass(s, x >= t); });
+        break;
+    default: return nullptr;
+    }
+    if(t != t)
+        return kernel;
+
+    return prepare_zoned(col, kernel, below, above, [=](const t_zone &z) {
+        if(z.m_has_nan)
+            return -1;
+        return match_compare(op, t, z.get_min<T>(), z.get_max<T>());
+    });
+}
+
+static t_fterm::t_prepared
+prepare_compare(const t_column *col, t_filter_op op, const t_tscalar &threshold) {
+    t_dtype dtype = col->get_dtype();
+    t_tscalar t = threshold.coerce_numeric_dtype(dtype);
+    if(!t.is_valid() || t.m_type != dtype)
+        return nullptr;
+    // the coercion must not change the value, e.g. x < 2.5 on an integer column
+    if(threshold.is_numeric() && t.to_double() != threshold.to_double())
+        return nullptr;
+
+    switch(dtype) {
+    case DTYPE_INT64: return prepare_compare_t<int64_t>(col, op, t);
+    case DTYPE_INT32: return prepare_compare_t<int32_t>(col, op, t);
+    case DTYPE_INT16: return prepare_compare_t<int16_t>(col, op, t);
+    case DTYPE_INT8: return prepare_compare_t<int8_t>(col, op, t);
+    case DTYPE_UINT64: return prepare_compare_t<uint64_t>(col, op, t);
+    case DTYPE_UINT32: return prepare_compare_t<uint32_t>(col, op, t);
+    case DTYPE_UINT16: return prepare_compare_t<uint16_t>(col, op, t);
+    case DTYPE_UINT8: return prepare_compare_t<uint8_t>(col, op, t);
+    case DTYPE_FLOAT64: return prepare_compare_t<double>(col, op, t);
+    case DTYPE_FLOAT32: return prepare_compare_t<float>(col, op, t);
+    case DTYPE_BOOL: return prepare_compare_t<bool>(col, op, t);
+    case DTYPE_TIME: return prepare_compare_t<t_time::t_rawtype>(col, op, t);
+    case DTYPE_DATE: return prepare_compare_t<t_date::t_rawtype>(col, op, t);
+    case DTYPE_DURATION: return prepare_compare_t<t_duration::t_rawtype>(col, op, t);
+    default: return nullptr;
+    }
+}
+
+// Evaluates the term once per string of the vocabulary of a DTYPE_STR
+// column, the kernel then looks the valid rows up by string id. Substring
+// terms only evaluate the strings holding every trigram of the threshold, the
+// other strings cannot match. Rows that are not valid take the scalar path.
+static t_fterm::t_prepared
+prepare_vocab(const t_column *col, const t_fterm &term) {
+    if(col->get_dtype() != DTYPE_STR)
+        return nullptr;
+    auto vocab = col->get_vocab();
+    t_uindex nstrings = vocab->get_vlenidx();
+    if(nstrings > col->size())
+        return nullptr;
+
+    t_dataformattype df_type = col->get_data_format_type();
+    auto eval = [&](t_uindex sidx) {
+        t_tscalar s;
+        s.clear();
+        s.set(vocab->unintern_c(sidx));
+        s.m_data_format_type = df_type;
+        s.m_status = STATUS_VALID;
+        return term(s);
+    };
+
+    std::vector<std::uint8_t> hits(nstrings);
+    std::string needle = term.m_threshold.to_string();
+    bool substring = term.m_op == FILTER_OP_CONTAINS || term.m_op == FILTER_OP_NOT_CONTAIN
+        || term.m_op == FILTER_OP_BEGINS_WITH || term.m_op == FILTER_OP_ENDS_WITH;
+    std::vector<t_uindex> candidates;
+    if(substring && needle.size() >= 3 && vocab->get_trigram_candidates(needle, candidates)) {
+        std::fill(hits.begin(), hits.end(), term.m_op == FILTER_OP_NOT_CONTAIN);
+        for(t_uindex sidx : candidates)
+            hits[sidx] = eval(sidx);
+    } else {
+        for(t_uindex sidx = 0; sidx < nstrings; ++sidx)
+            hits[sidx] = eval(sidx);
+    }
+
+    const t_status *status = col->get_nth_status(0);
+    const t_uindex *value = col->get_nth<t_uindex>(0);
+    const t_fterm *ft = &term;
+    return [=](t_uindex first, t_uindex last, std::uint64_t *words) {
+        pack_words(first, last, words, [&](t_uindex i) {
+            return status[i] == STATUS_VALID ? hits[value[i]] != 0 : (*ft)(col->get_scalar(i));
+        });
+    };
+}
+
 t_fterm::t_prepared
 t_fterm::optimized_prepare(const t_column *col) const {
     if(m_agg_level != AGG_LEVEL_NONE || m_binning.type != BINNING_TYPE_NONE)
@@ -277,10 +611,56 @@ t_fterm::optimized_prepare(const t_column *col) const {
         case FILTER_OP_LAST_YEAR:
         case FILTER_OP_YEAR_TO_DATE:
         case FILTER_OP_RELATIVE_DATE:
+            if(col->get_dtype() == DTYPE_STR)
+                return prepare_vocab(col, *this);
             return prepare_between(col, m_bag[0], m_bag[1]);
 
-        case FILTER_OP_IGNORE_ALL: return [](t_uindex,t_uindex) { return 0; };
-        case FILTER_OP_TOP_N: return [](t_uindex,t_uindex) { return (t_uindex)-1; };
+        case FILTER_OP_EQ:
+        case FILTER_OP_NE:
+        case FILTER_OP_LT:
+        case FILTER_OP_LTEQ:
+        case FILTER_OP_GT:
+        case FILTER_OP_GTEQ:
+        case FILTER_OP_BEFORE:
+        case FILTER_OP_AFTER:
+        case FILTER_OP_LAST_7_DAYS:
+        case FILTER_OP_LAST_10_DAYS:
+        case FILTER_OP_LAST_30_DAYS:
+            if(col->get_dtype() == DTYPE_STR)
+                return prepare_vocab(col, *this);
+            return prepare_compare(col, m_op, m_threshold);
+
+        case FILTER_OP_CONTAINS:
+        case FILTER_OP_NOT_CONTAIN:
+        case FILTER_OP_BEGINS_WITH:
+        case FILTER_OP_ENDS_WITH:
+            return prepare_vocab(col, *this);
+
+        case FILTER_OP_IS_VALID:
+        case FILTER_OP_IS_NOT_EMPTY:
+            if(is_dtype_list(col->get_dtype()))
+                return nullptr;
+            return prepare_zoned(col, prepare_status(col, [](t_status s) { return s == STATUS_VALID; }),
+                false, false, [](const t_zone &) { return 1; });
+        case FILTER_OP_IS_NOT_VALID:
+        case FILTER_OP_IS_EMPTY:
+            if(is_dtype_list(col->get_dtype()))
+                return nullptr;
+            return prepare_zoned(col, prepare_status(col, [](t_status s) { return s != STATUS_VALID; }),
+                true, true, [](const t_zone &) { return 0; });
+        case FILTER_OP_IS_TRUE:
+            if(col->get_dtype() != DTYPE_BOOL)
+                return nullptr;
+            return prepare_zoned(col, prepare_block<bool>(col, [](t_status s, bool x) { return s == STATUS_VALID && x; }),
+                false, false, [](const t_zone &z) { return z.get_min<bool>() ? 1 : (z.get_max<bool>() ? -1 : 0); });
+        case FILTER_OP_IS_FALSE:
+            if(col->get_dtype() != DTYPE_BOOL)
+                return nullptr;
+            return prepare_zoned(col, prepare_block<bool>(col, [](t_status s, bool x) { return s == STATUS_VALID && !x; }),
+                false, false, [](const t_zone &z) { return z.get_max<bool>() ? (z.get_min<bool>() ? 0 : -1) : 1; });
+
+        case FILTER_OP_IGNORE_ALL: return prepare_fill(false);
+        case FILTER_OP_TOP_N: return prepare_fill(true);
         default: return nullptr;
     }
 }
@@ -292,10 +672,12 @@ t_fterm::prepare(const t_column *col, t_dataformattype force_df) const
         return ret;
 
     // slow way -- call the tscalar code-path
+    // bucketed and binned cells only live through the comparison, their
+    // strings are interned per prepared term and freed with it
     const t_fterm *ft = this;
-    return [=](t_uindex first, t_uindex last) {
-        uint32_t mask = 0;
-        for(t_uindex i = first; i < last; ++i) {
+    auto symtable = std::make_shared<t_symtable>();
+    return [=](t_uindex first, t_uindex last, std::uint64_t *words) {
+        pack_words(first, last, words, [&](t_uindex i) {
             t_tscalar cell_val = col->get_scalar(i);
             auto agg_level = m_agg_level;
             t_dataformattype df_type = dftype_from_dftype_and_agg_level(col->get_data_format_type(), agg_level);
@@ -316,7 +698,7 @@ t_fterm::prepare(const t_column *col, t_dataformattype force_df) const
                 } else {
                     auto col_type = dtype_from_dtype_and_agg_level(col->get_dtype(), agg_level);
                     auto temp_sca = mk_agg_level_one(cell_val, agg_level, col_type, df_type);
-                    cell_val = get_interned_tscalar(temp_sca.to_string());
+                    cell_val = symtable->get_interned_tscalar(temp_sca.to_string());
                 }
             }
             if (m_binning.type != BINNING_TYPE_NONE) {
@@ -325,7 +707,7 @@ t_fterm::prepare(const t_column *col, t_dataformattype force_df) const
                     std::set<t_tscalar> vset;
                     for (t_uindex idx = 0, vsize = vlist.size(); idx < vsize; ++idx) {
                         auto str_val = vlist[idx].to_binning_string(m_binning, df_type);
-                        vset.insert(get_interned_tscalar(str_val.c_str()));
+                        vset.insert(symtable->get_interned_tscalar(str_val.c_str()));
                     }
                     if (vset.size() == 0) {
                         cell_val = mkempty(cell_val.m_type);
@@ -337,13 +719,38 @@ t_fterm::prepare(const t_column *col, t_dataformattype force_df) const
                         df_type = force_df;
                     }
                     auto str_val = cell_val.to_binning_string(m_binning, df_type);
-                    cell_val = get_interned_tscalar(str_val.c_str());
+                    cell_val = symtable->get_interned_tscalar(str_val.c_str());
                 }
             }
-            bool b = (*ft)(cell_val);
-            mask |= b << (i - first);
+            return (*ft)(cell_val);
+        });
+    };
+}
+
+t_fterm::t_prepared
+t_fterm::combine(t_filter_op combiner, std::vector<t_prepared> terms) {
+    bool conjunction = combiner == FILTER_OP_AND;
+    if(terms.empty())
+        return prepare_fill(conjunction);
+    if(terms.size() == 1)
+        return terms[0];
+
+    return [=](t_uindex first, t_uindex last, std::uint64_t *words) {
+        t_uindex nwords = (last - first + 63) / 64;
+        std::vector<std::uint64_t> term_words(nwords);
+        terms[0](first, last, words);
+        for(size_t j = 1; j < terms.size(); ++j) {
+            if(conjunction && std::all_of(words, words + nwords, [](std::uint64_t w) { return w == 0; }))
+                return;
+            terms[j](first, last, term_words.data());
+            if(conjunction) {
+                for(t_uindex k = 0; k < nwords; ++k)
+                    words[k] &= term_words[k];
+            } else {
+                for(t_uindex k = 0; k < nwords; ++k)
+                    words[k] |= term_words[k];
+            }
         }
-        return mask;
     };
 }
 
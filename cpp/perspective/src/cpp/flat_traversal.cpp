@@ -15,6 +15,10 @@
 #include <perspective/search_utils.h>
 #include <perspective/scalar.h>
 #include <perspective/schema.h>
+#include <perspective/string_ranks.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 
 namespace perspective {
 
@@ -127,6 +131,7 @@ t_ftrav::validate_cells(const std::vector<std::pair<t_uindex, t_uindex>>& cells)
 
 void
 t_ftrav::step_begin() {
+    m_synced = false;
 }
 
 template<size_t nbins = 0x10000, class F>
@@ -269,6 +274,14 @@ static void psp_sort(std::vector<int> &index, std::vector<int> &tmp, const uint8
     psp_radix_sort<0x100>(index, tmp, desc, [&](int i){ return key[i]; });
 }
 
+// NaN compares above every number, as in the radix sorts of the absolute
+// values, so that float keys with NaNs are strictly weakly ordered
+template<class T>
+static bool psp_float_less(T x, T y)
+{
+    return x < y || (std::isnan(y) && !std::isnan(x));
+}
+
 static void psp_sort(std::vector<int> &index, std::vector<int> &tmp, const double *key, const t_sortspec &spec)
 {
     // todo: possible way to apply radix sort -- sort as-is, then permute in the very end.
@@ -276,10 +289,10 @@ static void psp_sort(std::vector<int> &index, std::vector<int> &tmp, const doubl
     auto k = (const int64_t*)key;
     switch(spec.m_sort_type) {
     default:
-        std::stable_sort(index.begin(), index.end(), [&](int x, int y) { return key[x] < key[y]; });
+        std::stable_sort(index.begin(), index.end(), [&](int x, int y) { return psp_float_less(key[x], key[y]); });
         break;
     case SORTTYPE_DESCENDING:
-        std::stable_sort(index.begin(), index.end(), [&](int x, int y) { return key[x] > key[y]; });
+        std::stable_sort(index.begin(), index.end(), [&](int x, int y) { return psp_float_less(key[y], key[x]); });
         break;
     case SORTTYPE_ASCENDING_ABS:
     case SORTTYPE_DESCENDING_ABS:
@@ -297,10 +310,10 @@ static void psp_sort(std::vector<int> &index, std::vector<int> &tmp, const float
     auto k = (const int32_t*)key;
     switch(spec.m_sort_type) {
     default:
-        std::stable_sort(index.begin(), index.end(), [&](int x, int y) { return key[x] < key[y]; });
+        std::stable_sort(index.begin(), index.end(), [&](int x, int y) { return psp_float_less(key[x], key[y]); });
         break;
     case SORTTYPE_DESCENDING:
-        std::stable_sort(index.begin(), index.end(), [&](int x, int y) { return key[x] > key[y]; });
+        std::stable_sort(index.begin(), index.end(), [&](int x, int y) { return psp_float_less(key[y], key[x]); });
         break;
     case SORTTYPE_ASCENDING_ABS:
     case SORTTYPE_DESCENDING_ABS:
@@ -316,31 +329,8 @@ static void psp_sort(std::vector<int> &index, std::vector<int> &tmp, const bool
     psp_radix_sort<2>(index, tmp, desc, [&](int i){ return key[i]; });
 }
 
-
-int psp_strcasecmp(const char *x, const char *y) {
-    // collation order: iscntrl < isspace < ispunct < isalnum < unicode
-    // upper and lower are equal
-    static const uint8_t ascii_collate[] = {
-        0,1,2,3,4,5,6,7,8,28,29,30,31,32,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,
-        33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,48,66,67,68,69,70,71,72,73,74,75,49,50,51,52,53,54,
-        55,76,77,78,79,80,81,82,83,84,85,86,87,88,89,90,91,92,93,94,95,96,97,98,99,100,101,56,57,58,59,60,
-        61,76,77,78,79,80,81,82,83,84,85,86,87,88,89,90,91,92,93,94,95,96,97,98,99,100,101,62,63,64,65,27,
-        102,103,104,105,106,107,108,109,110,111,112,113,114,115,116,117,118,119,120,121,122,123,124,125,126,127,128,129,130,131,132,133,
-        134,135,136,137,138,139,140,141,142,143,144,145,146,147,148,149,150,151,152,153,154,155,156,157,158,159,160,161,162,163,164,165,
-        166,167,168,169,170,171,172,173,174,175,176,177,178,179,180,181,182,183,184,185,186,187,188,189,190,191,192,193,194,195,196,197,
-        198,199,200,201,202,203,204,205,206,207,208,209,210,211,212,213,214,215,216,217,218,219,220,221,222,223,224,225,226,227,228,229,
-    };
-    for(int i = 0;; ++i) {
-        int d = ascii_collate[(uint8_t)x[i]] - ascii_collate[(uint8_t)y[i]];
-        if(d || !x[i])
-            return d;
-    }
-}
-
 static void psp_sort_str(std::vector<int> &index, std::vector<int> &tmp, const t_column *col, const t_sortspec &spec)
 {
-    // todo: replace with radix sort on the few first chars? or better merge-sort
-    // also because the strings are interned may be better to sort the interned table
     const t_uindex *sidx = col->get_nth<t_uindex>(0);
     const t_vocab *vocab = &*col->get_vocab();
     const t_extent_pair *extents = vocab->get_extents_base(); // pair::first is an offset into vlen where ith string begins
@@ -349,20 +339,18 @@ static void psp_sort_str(std::vector<int> &index, std::vector<int> &tmp, const t
     bool desc = is_descending(spec.m_sort_type);
     auto get = [&](int x) { return vlen + extents[x].m_begin; };
 
-    if(vlenidx < 0x10000 && vlenidx*2 < index.size())
+    if(vlenidx <= index.size())
     {
-        // small vocabulary, sort it separately
-        std::vector<uint16_t> perm(vlenidx);
-        for(int i = 0; i < vlenidx; ++i)
-            perm[i] = i;
-
-        std::sort(perm.begin(), perm.end(), [&](uint16_t x, uint16_t y) { return psp_strcasecmp(get(x), get(y)) < 0; });
-
-        std::vector<uint16_t> perm_inv(vlenidx);
-        for(int i = 0; i < vlenidx; ++i)
-            perm_inv[perm[i]] = i;
-
-        psp_radix_sort(index, tmp, desc, [&](int i){ return perm_inv[sidx[i]]; }, vlenidx);
+        // the column keeps the collation ranks of its vocabulary, radix sort on them
+        std::shared_ptr<const t_string_ranks> ranks = col->get_string_ranks(STRING_COLLATION_SORT);
+        const uint32_t *rank = ranks->get_ranks();
+        size_t nranks = ranks->num_ranks();
+        if(nranks <= 0x10000)
+            psp_radix_sort(index, tmp, desc, [&](int i){ return rank[sidx[i]]; }, nranks);
+        else {
+            psp_radix_sort(index, tmp, desc, [&](int i){ return (uint16_t)rank[sidx[i]]; });
+            psp_radix_sort(index, tmp, desc, [&](int i){ return rank[sidx[i]] >> 16; }, (nranks >> 16) + 1);
+        }
     }
     else if(desc)
         std::stable_sort(index.begin(), index.end(), [&](int x, int y) { return psp_strcasecmp(get(sidx[x]), get(sidx[y])) > 0; });
@@ -370,6 +358,35 @@ static void psp_sort_str(std::vector<int> &index, std::vector<int> &tmp, const t
         std::stable_sort(index.begin(), index.end(), [&](int x, int y) { return psp_strcasecmp(get(sidx[x]), get(sidx[y])) < 0; });
 }
 
+// lists are ordered element by element, as std::vector compares
+template<class T, class LESS>
+static void psp_sort_list(std::vector<int> &index, const t_column *col, const t_sortspec &spec, LESS less)
+{
+    auto cmp = [&](int x, int y) {
+        auto a = col->get_list_nth<T>(x);
+        auto b = col->get_list_nth<T>(y);
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), less);
+    };
+    if(!is_descending(spec.m_sort_type))
+        std::stable_sort(index.begin(), index.end(), cmp);
+    else
+        std::stable_sort(index.begin(), index.end(), [&](int x, int y) { return cmp(y, x); });
+}
+
+template<class T>
+static void psp_sort_list(std::vector<int> &index, const t_column *col, const t_sortspec &spec)
+{
+    psp_sort_list<T>(index, col, spec, std::less<T>());
+}
+
+static void psp_sort_list_str(std::vector<int> &index, const t_column *col, const t_sortspec &spec)
+{
+    const t_vocab *vocab = &*col->get_vocab();
+    psp_sort_list<t_uindex>(index, col, spec, [vocab](t_uindex x, t_uindex y) {
+        return x != y && std::strcmp(vocab->unintern_c(x), vocab->unintern_c(y)) < 0;
+    });
+}
+
 static void sort_by_column(std::vector<int> &index, std::vector<int> &tmp, const t_column *col, const t_sortspec &spec)
 {
     switch(col->get_dtype())
@@ -390,13 +407,13 @@ static void sort_by_column(std::vector<int> &index, std::vector<int> &tmp, const
     case DTYPE_STR: psp_sort_str(index, tmp, col, spec); break;
     case DTYPE_DURATION: psp_sort(index, tmp, col->get_nth<t_duration::t_rawtype>(0), spec); break;
 
-    case DTYPE_LIST_BOOL: psp_sort(index, tmp, col->get_nth<std::vector<bool>>(0), spec); break;
-    case DTYPE_LIST_FLOAT64: psp_sort(index, tmp, col->get_nth<std::vector<double>>(0), spec); break;
-    case DTYPE_LIST_INT64: psp_sort(index, tmp, col->get_nth<std::vector<std::int64_t>>(0), spec); break;
-    case DTYPE_LIST_DATE: psp_sort(index, tmp, col->get_nth<std::vector<t_date>>(0), spec); break;
-    case DTYPE_LIST_TIME: psp_sort(index, tmp, col->get_nth<std::vector<t_time>>(0), spec); break;
-    case DTYPE_LIST_DURATION: psp_sort(index, tmp, col->get_nth<std::vector<t_duration>>(0), spec); break;
-    case DTYPE_LIST_STR: psp_sort(index, tmp, col->get_nth<std::vector<std::string>>(0), spec); break;
+    case DTYPE_LIST_BOOL: psp_sort_list<bool>(index, col, spec); break;
+    case DTYPE_LIST_FLOAT64: psp_sort_list<double>(index, col, spec); break;
+    case DTYPE_LIST_INT64: psp_sort_list<std::int64_t>(index, col, spec); break;
+    case DTYPE_LIST_DATE: psp_sort_list<t_date>(index, col, spec); break;
+    case DTYPE_LIST_TIME: psp_sort_list<t_time>(index, col, spec); break;
+    case DTYPE_LIST_DURATION: psp_sort_list<t_duration>(index, col, spec); break;
+    case DTYPE_LIST_STR: psp_sort_list_str(index, col, spec); break;
 
     default: break;
     }
@@ -407,6 +424,81 @@ static void sort_by_column(std::vector<int> &index, std::vector<int> &tmp, const
     }
 }
 
+// Order of two cells under a sort spec, as sort_by_column orders them
+template<class T>
+static int psp_compare(T x, T y, t_sorttype type)
+{
+    int c = x < y ? -1 : (y < x ? 1 : 0);
+    return is_descending(type) ? -c : c;
+}
+
+static bool is_abs(t_sorttype type) {
+    return type == SORTTYPE_ASCENDING_ABS || type == SORTTYPE_DESCENDING_ABS;
+}
+
+static int psp_compare_signed(std::int64_t x, std::int64_t y, t_sorttype type)
+{
+    if(is_abs(type))
+        return psp_compare(std::abs(x), std::abs(y), type);
+    return psp_compare(x, y, type);
+}
+
+static int psp_compare_float(double x, double y, t_sorttype type)
+{
+    if(is_abs(type))
+        x = std::fabs(x), y = std::fabs(y);
+    int c = psp_float_less(x, y) ? -1 : (psp_float_less(y, x) ? 1 : 0);
+    return is_descending(type) ? -c : c;
+}
+
+static bool can_compare_cells(t_dtype dtype)
+{
+    switch(dtype)
+    {
+    case DTYPE_INT64: case DTYPE_INT32: case DTYPE_INT16: case DTYPE_INT8:
+    case DTYPE_UINT64: case DTYPE_UINT32: case DTYPE_UINT16: case DTYPE_UINT8:
+    case DTYPE_FLOAT64: case DTYPE_FLOAT32: case DTYPE_BOOL:
+    case DTYPE_TIME: case DTYPE_DATE: case DTYPE_DURATION: case DTYPE_STR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static int compare_cells(const t_column *xcol, t_uindex x, const t_column *ycol, t_uindex y, const t_sortspec &spec)
+{
+    if(xcol->is_status_enabled()) {
+        int xs = 4 - *xcol->get_nth_status(x), ys = 4 - *ycol->get_nth_status(y);
+        if(xs != ys)
+            return xs < ys ? -1 : 1;
+    }
+
+    t_sorttype type = spec.m_sort_type;
+    switch(xcol->get_dtype())
+    {
+    case DTYPE_INT64: return psp_compare_signed(*xcol->get_nth<int64_t>(x), *ycol->get_nth<int64_t>(y), type);
+    case DTYPE_INT32: return psp_compare_signed(*xcol->get_nth<int32_t>(x), *ycol->get_nth<int32_t>(y), type);
+    case DTYPE_INT16: return psp_compare_signed(*xcol->get_nth<int16_t>(x), *ycol->get_nth<int16_t>(y), type);
+    case DTYPE_INT8: return psp_compare_signed(*xcol->get_nth<int8_t>(x), *ycol->get_nth<int8_t>(y), type);
+    case DTYPE_UINT64: return psp_compare(*xcol->get_nth<uint64_t>(x), *ycol->get_nth<uint64_t>(y), type);
+    case DTYPE_UINT32: return psp_compare(*xcol->get_nth<uint32_t>(x), *ycol->get_nth<uint32_t>(y), type);
+    case DTYPE_UINT16: return psp_compare(*xcol->get_nth<uint16_t>(x), *ycol->get_nth<uint16_t>(y), type);
+    case DTYPE_UINT8: return psp_compare(*xcol->get_nth<uint8_t>(x), *ycol->get_nth<uint8_t>(y), type);
+    case DTYPE_FLOAT64: return psp_compare_float(*xcol->get_nth<double>(x), *ycol->get_nth<double>(y), type);
+    case DTYPE_FLOAT32: return psp_compare_float(*xcol->get_nth<float>(x), *ycol->get_nth<float>(y), type);
+    case DTYPE_BOOL: return psp_compare(*xcol->get_nth<bool>(x), *ycol->get_nth<bool>(y), type);
+    case DTYPE_TIME: return psp_compare_float(*xcol->get_nth<t_time::t_rawtype>(x), *ycol->get_nth<t_time::t_rawtype>(y), type);
+    case DTYPE_DATE: return psp_compare_signed(*xcol->get_nth<t_date::t_rawtype>(x), *ycol->get_nth<t_date::t_rawtype>(y), type);
+    case DTYPE_DURATION: return psp_compare_float(*xcol->get_nth<t_duration::t_rawtype>(x), *ycol->get_nth<t_duration::t_rawtype>(y), type);
+    case DTYPE_STR: {
+        const char *xs = xcol->get_vocab()->unintern_c(*xcol->get_nth<t_uindex>(x));
+        const char *ys = ycol->get_vocab()->unintern_c(*ycol->get_nth<t_uindex>(y));
+        return psp_compare(psp_strcasecmp(xs, ys), 0, type);
+    }
+    default: return 0;
+    }
+}
+
 size_t reuse_sort_suffix(const std::vector<t_sortspec> &newOrder, const std::vector<t_sortspec> &oldOrder) {
     auto half_eq = [](const t_sortspec &x, const t_sortspec &y) { return x.m_agg_index == y.m_agg_index; };
     auto full_eq = [](const t_sortspec &x, const t_sortspec &y) { return x.m_agg_index == y.m_agg_index && x.m_sort_type == y.m_sort_type; };
@@ -432,11 +524,13 @@ size_t reuse_sort_suffix(const std::vector<t_sortspec> &newOrder, const std::vec
 void
 t_ftrav::step_end(std::shared_ptr<const t_gstate> state, t_config& config) {
     MEM_REPORT("ftrav::step_end() / before allocating new indices");
-    m_index = nullptr;
     m_ncols = m_nrows = 0;
 
+    // an index updated with the table is current, otherwise start over from
+    // the last index built on the table
     std::shared_ptr<const t_table> table = state->get_table();
-    if(!m_index) m_index = table->get_last_index();
+    if(!m_synced) m_index = table->get_last_index();
+    m_synced = false;
     table->set_last_index(nullptr);
 
     if(!m_index || config.get_fterms() != m_index->filters || config.get_sterms() != m_index->searchs) {
@@ -494,6 +588,128 @@ t_ftrav::step_end(std::shared_ptr<const t_gstate> state, t_config& config) {
     config.update_query_percentage_store(QUERY_PERCENT_TRAVERSAL_STEP_END, 100);
 }
 
+bool
+t_ftrav::update_rows(std::shared_ptr<const t_gstate> state, t_config& config,
+    const t_table& flattened, const t_table& prev, const t_table& curr,
+    const t_table& existed) {
+    // without an index of the current filters step_end rebuilds one
+    if(!m_index || config.get_fterms() != m_index->filters || config.get_sterms() != m_index->searchs) {
+        m_index = nullptr;
+        return true;
+    }
+
+    std::shared_ptr<const t_table> table = state->get_table();
+    std::vector<t_sortspec> sortby = m_index->sortby;
+    std::vector<const t_column*> scols, pcols, ccols;
+    for(const t_sortspec &spec : sortby) {
+        std::string colname = config.get_sort_by(config.col_at(spec.m_agg_index));
+        if(!prev.get_schema().has_column(colname)) {
+            m_index = nullptr;
+            return true;
+        }
+        scols.push_back(&*table->get_const_column(colname));
+        pcols.push_back(&*prev.get_const_column(colname));
+        ccols.push_back(&*curr.get_const_column(colname));
+        if(!can_compare_cells(scols.back()->get_dtype())) {
+            m_index = nullptr;
+            return true;
+        }
+    }
+
+    // only the rows of the update are filtered
+    t_mask prev_mask, curr_mask, prev_smask, curr_smask;
+    if(config.has_filters()) {
+        prev_mask = filter_table_for_config(prev, config);
+        curr_mask = filter_table_for_config(curr, config);
+    }
+    if(config.has_search()) {
+        prev_smask = search_table_for_config(prev, config);
+        curr_smask = search_table_for_config(curr, config);
+    }
+    auto visible = [](const t_mask &mask, const t_mask &smask, t_uindex i) {
+        return (mask.size() <= i || mask.get(i)) && (smask.size() <= i || smask.get(i));
+    };
+
+    const t_column *pkey_col = &*flattened.get_const_column("psp_pkey");
+    const uint8_t *op_col = flattened.get_const_column("psp_op")->get_nth<uint8_t>(0);
+    const bool *existed_col = existed.get_const_column("psp_existed")->get_nth<bool>(0);
+
+    // rows leaving their place, and rows to place under the current values
+    std::vector<t_index> removed;
+    std::vector<t_index> added;
+    bool compact = false, deleted = false;
+    for(t_uindex i = 0, nrows = flattened.size(); i < nrows; ++i) {
+        bool was = existed_col[i] && visible(prev_mask, prev_smask, i);
+        if(op_col[i] == OP_DELETE) {
+            // the row was erased, it is found by its op in the table
+            deleted = deleted || was;
+            continue;
+        }
+
+        t_index row = static_cast<t_index>(state->lookup(pkey_col->get_scalar(i)).m_idx);
+        bool is = visible(curr_mask, curr_smask, i);
+        if(!existed_col[i]) {
+            // may take the row of a pkey deleted by the same update
+            removed.push_back(row);
+            if(is) added.push_back(row);
+            continue;
+        }
+
+        bool moved = was != is;
+        for(t_uindex k = 0; k < sortby.size() && !moved && is; ++k) {
+            moved = !pcols[k]->is_valid(i) || !ccols[k]->is_valid(i)
+                || compare_cells(pcols[k], i, ccols[k], i, sortby[k]) != 0;
+        }
+        if(!moved)
+            continue;
+        if(was) {
+            removed.push_back(row);
+            compact = true;
+        }
+        if(is) added.push_back(row);
+    }
+
+    m_synced = true;
+    compact = compact || deleted;
+    if(!compact && added.empty())
+        return false;
+
+    if(m_index.use_count() != 1)
+        m_index = std::make_shared<t_table_index>(*m_index);
+    auto &v = m_index->v;
+
+    if(compact) {
+        std::sort(removed.begin(), removed.end());
+        const uint8_t *table_op = table->get_const_column("psp_op")->get_nth<uint8_t>(0);
+        v.erase(std::remove_if(v.begin(), v.end(), [&](t_index row) {
+            return std::binary_search(removed.begin(), removed.end(), row)
+                || (deleted && table_op[row] != OP_INSERT);
+        }), v.end());
+    }
+
+    // ties keep the row order, as the stable sorts of step_end do
+    auto less = [&](t_index x, t_index y) {
+        for(t_uindex k = 0; k < sortby.size(); ++k) {
+            int c = compare_cells(scols[k], x, scols[k], y, sortby[k]);
+            if(c != 0)
+                return c < 0;
+        }
+        return x < y;
+    };
+    std::sort(added.begin(), added.end(), less);
+
+    // merge from the back, each row of v moves once
+    size_t hi = v.size();
+    v.resize(v.size() + added.size());
+    for(size_t j = added.size(); j --> 0; ) {
+        size_t pos = std::upper_bound(v.begin(), v.begin() + hi, added[j], less) - v.begin();
+        std::move_backward(v.begin() + pos, v.begin() + hi, v.begin() + hi + j + 1);
+        v[pos + j] = added[j];
+        hi = pos;
+    }
+    return true;
+}
+
 const std::vector<t_sortspec>&
 t_ftrav::get_sort_by() const {
     return m_sortby;
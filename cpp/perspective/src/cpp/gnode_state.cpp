@@ -35,6 +35,7 @@ t_gstate::init() {
     m_table = std::make_shared<t_table>(
         "", "", m_pkeyed_schema, DEFAULT_EMPTY_CAPACITY, BACKING_STORE_MEMORY);
     m_table->init();
+    m_table->set_search_indexed(true);
     m_pkcol = m_table->get_column("psp_pkey");
     m_opcol = m_table->get_column("psp_op");
     m_init = true;
@@ -44,12 +45,12 @@ t_rlookup
 t_gstate::lookup(t_tscalar pkey) const {
     t_rlookup rval(0, false);
 
-    t_mapping::const_iterator iter = m_mapping.find(pkey.get<t_index>());
+    t_uindex row = m_mapping.find(pkey.get<t_index>());
 
-    if (iter == m_mapping.end())
+    if (row == t_mapping::NOT_FOUND)
         return rval;
 
-    rval.m_idx = iter->second;
+    rval.m_idx = row;
     rval.m_exists = true;
     return rval;
 }
@@ -61,21 +62,22 @@ t_gstate::_mark_deleted(t_uindex idx) {
 
 void
 t_gstate::erase(const t_tscalar& pkey) {
-    t_mapping::const_iterator iter = m_mapping.find(pkey.get<t_index>());
+    auto pkey_ = pkey.get<t_index>();
+    t_uindex idx = m_mapping.find(pkey_);
 
-    if (iter == m_mapping.end()) {
+    if (idx == t_mapping::NOT_FOUND) {
         return;
     }
 
     auto columns = m_table->get_columns();
 
-    t_uindex idx = iter->second;
-
     for (auto c : columns) {
         c->clear(idx);
     }
+    // keeps the row out of flat traversals until it is reused
+    m_opcol->set_nth<std::uint8_t>(idx, OP_DELETE);
 
-    m_mapping.erase(iter);
+    m_mapping.erase(pkey_);
     _mark_deleted(idx);
 }
 
@@ -83,17 +85,17 @@ t_uindex
 t_gstate::lookup_or_create(const t_tscalar& pkey) {
     auto pkey_ = pkey.get<t_index>();
 
-    t_mapping::const_iterator iter = m_mapping.find(pkey_);
+    t_uindex row = m_mapping.find(pkey_);
 
-    if (iter != m_mapping.end()) {
-        return iter->second;
+    if (row != t_mapping::NOT_FOUND) {
+        return row;
     }
 
     if (!m_free.empty()) {
         t_free_items::const_iterator iter = m_free.begin();
         t_uindex idx = *iter;
         m_free.erase(iter);
-        m_mapping[pkey_] = idx;
+        m_mapping.set(pkey_, idx);
         return idx;
     }
 
@@ -106,7 +108,7 @@ t_gstate::lookup_or_create(const t_tscalar& pkey) {
     m_table->set_size(nrows + 1);
     m_opcol->set_nth<std::uint8_t>(nrows, OP_INSERT);
     m_pkcol->set_scalar(nrows, pkey);
-    m_mapping[pkey_] = nrows;
+    m_mapping.set(pkey_, nrows);
     return nrows;
 }
 
@@ -121,6 +123,9 @@ t_gstate::update_history(const t_table* tbl) {
     t_uindex ncols = m_table->num_columns();
     auto stable = m_table.get();
 
+    // flat traversals are indexed on the rows before the update
+    stable->set_last_index(nullptr);
+
     std::vector<t_uindex> col_translation(stable->num_columns());
 
     std::string opname("psp_op");
@@ -167,7 +172,7 @@ t_gstate::update_history(const t_table* tbl) {
         stable->set_capacity(tbl->get_capacity());
         stable->set_size(tbl->size());
 
-        // GAB: memory optim: we can prereserve m_mapping now, as it is a flat_map
+        // pkeys of a first update are usually its row numbers, the mapping stays a vector
         m_mapping.reserve(tbl->num_rows());
 
         MEM_REPORT("gnode_state::notify() / m_mappings reserved");
@@ -179,7 +184,7 @@ t_gstate::update_history(const t_table* tbl) {
 
             switch (op) {
                 case OP_INSERT: {
-                    m_mapping[pkey.get<t_index>()] = idx;
+                    m_mapping.set(pkey.get<t_index>(), idx);
                     m_opcol->set_nth<std::uint8_t>(idx, OP_INSERT);
                     m_pkcol->set_scalar(idx, pkey);
                 } break;
@@ -312,6 +317,9 @@ t_gstate::update_history(const t_table* tbl) {
                     default: { PSP_COMPLAIN_AND_ABORT("Unexpected type"); }
                 }
             }
+
+            // the next search reads the index without tokenizing the new rows
+            scolumn->update_search_index();
         }
 #ifdef PSP_PARALLEL_FOR
     );
@@ -320,12 +328,9 @@ t_gstate::update_history(const t_table* tbl) {
 
 void
 t_gstate::pprint() const {
-    std::vector<t_uindex> indices(m_mapping.size());
-    t_uindex idx = 0;
-    for (t_mapping::const_iterator iter = m_mapping.begin(); iter != m_mapping.end(); ++iter) {
-        indices[idx] = iter->second;
-        ++idx;
-    }
+    std::vector<t_uindex> indices;
+    indices.reserve(m_mapping.size());
+    m_mapping.for_each([&indices](t_index pkey, t_uindex row) { indices.push_back(row); });
     m_table->pprint(indices);
 }
 
@@ -333,9 +338,7 @@ t_mask
 t_gstate::get_cpp_mask() const {
     t_uindex sz = m_table->size();
     t_mask msk(sz);
-    for (t_mapping::const_iterator iter = m_mapping.begin(); iter != m_mapping.end(); ++iter) {
-        msk.set(iter->second, true);
-    }
+    m_mapping.for_each([&msk](t_index pkey, t_uindex row) { msk.set(row, true); });
     return msk;
 }
 
@@ -359,9 +362,9 @@ t_gstate::read_column(const std::string& colname, const std::vector<t_tscalar>&
     rval.reserve(num);
 
     for (t_index idx = 0; idx < num; ++idx) {
-        t_mapping::const_iterator iter = m_mapping.find(pkeys[idx].get<t_index>());
-        if (iter != m_mapping.end()) {
-            rval.push_back(col_->get_scalar(iter->second, include_error));
+        t_uindex row = m_mapping.find(pkeys[idx].get<t_index>());
+        if (row != t_mapping::NOT_FOUND) {
+            rval.push_back(col_->get_scalar(row, include_error));
         }
     }
 
@@ -381,26 +384,13 @@ t_gstate::read_column(const std::string& colname, const std::vector<t_tscalar>&
     std::shared_ptr<const t_column> col = m_table->get_const_column(colname);
     const t_column* col_ = col.get();
 
-    // GAB: memory optim: compute in advance the number of elements of the result vector,
-    // to be able to reserve memory space needed
-    t_index count = 0;
-    for (t_index idx = 0; idx < num; ++idx) {
-        t_mapping::const_iterator iter = m_mapping.find(pkeys[idx].get<t_index>());
-        if (iter != m_mapping.end()) {
-            auto tscalar = col_->get_scalar(iter->second);
-            if (include_nones || tscalar.is_valid()) {
-                count++;
-            }
-        }
-    }
-
-    // GAB: memory optim / bugfix: reserve the number of elements
+    // A single gather now that lookups are cheap, the pkeys bound the result size
     std::vector<double> rval;
-    rval.reserve(count);
+    rval.reserve(num);
     for (t_index idx = 0; idx < num; ++idx) {
-        t_mapping::const_iterator iter = m_mapping.find(pkeys[idx].get<t_index>());
-        if (iter != m_mapping.end()) {
-            auto tscalar = col_->get_scalar(iter->second);
+        t_uindex row = m_mapping.find(pkeys[idx].get<t_index>());
+        if (row != t_mapping::NOT_FOUND) {
+            auto tscalar = col_->get_scalar(row);
             if (include_nones || tscalar.is_valid()) {
                 rval.push_back(tscalar.to_double());
             }
@@ -411,10 +401,10 @@ t_gstate::read_column(const std::string& colname, const std::vector<t_tscalar>&
 
 t_tscalar
 t_gstate::get(t_tscalar pkey, const std::string& colname) const {
-    t_mapping::const_iterator iter = m_mapping.find(pkey.get<t_index>());
-    if (iter != m_mapping.end()) {
+    t_uindex row = m_mapping.find(pkey.get<t_index>());
+    if (row != t_mapping::NOT_FOUND) {
         std::shared_ptr<const t_column> col = m_table->get_const_column(colname);
-        return col->get_scalar(iter->second);
+        return col->get_scalar(row);
     }
 
     return t_tscalar();
@@ -425,10 +415,9 @@ t_gstate::get_row(t_tscalar pkey) const {
     auto columns = m_table->get_const_columns();
     std::vector<t_tscalar> rval(columns.size());
 
-    t_mapping::const_iterator iter = m_mapping.find(pkey.get<t_index>());
-    PSP_VERBOSE_ASSERT(iter != m_mapping.end(), "Reached end");
+    t_uindex ridx = m_mapping.find(pkey.get<t_index>());
+    PSP_VERBOSE_ASSERT(ridx != t_mapping::NOT_FOUND, "Reached end");
 
-    t_uindex ridx = iter->second;
     t_uindex idx = 0;
 
     for (auto c : columns) {
@@ -446,9 +435,9 @@ t_gstate::is_unique(
     value = mknone();
 
     for (const auto& pkey : pkeys) {
-        t_mapping::const_iterator iter = m_mapping.find(pkey.get<t_index>());
-        if (iter != m_mapping.end()) {
-            auto tmp = col_->get_scalar(iter->second);
+        t_uindex row = m_mapping.find(pkey.get<t_index>());
+        if (row != t_mapping::NOT_FOUND) {
+            auto tmp = col_->get_scalar(row);
             if (!value.is_none() && value != tmp)
                 return false;
             value = tmp;
@@ -467,9 +456,9 @@ t_gstate::apply(const std::vector<t_tscalar>& pkeys, const std::string& colname,
     value = mknone();
 
     for (const auto& pkey : pkeys) {
-        t_mapping::const_iterator iter = m_mapping.find(pkey.get<t_index>());
-        if (iter != m_mapping.end()) {
-            auto tmp = col_->get_pivot_scalar(iter->second);
+        t_uindex row = m_mapping.find(pkey.get<t_index>());
+        if (row != t_mapping::NOT_FOUND) {
+            auto tmp = col_->get_pivot_scalar(row);
             bool done = fn(tmp, value);
             if (done) {
                 value = tmp;
@@ -510,7 +499,9 @@ t_gstate::get_pkey_dtype() const {
 
 std::shared_ptr<t_table>
 t_gstate::get_sorted_pkeyed_table() const {
-    std::map<t_index, t_uindex> ordered(m_mapping.begin(), m_mapping.end());
+    std::map<t_index, t_uindex> ordered;
+    m_mapping.for_each(
+        [&ordered](t_index pkey, t_uindex row) { ordered.emplace_hint(ordered.end(), pkey, row); });
     auto sch = m_pkeyed_schema.drop({"psp_op"});
     auto rv = std::make_shared<t_table>(sch, 0);
     rv->init();
@@ -630,19 +621,19 @@ t_gstate::_get_pkeyed_table(const t_schema& schema, const t_mask& mask) const {
         }
 
         t_uindex oidx = 0;
-        for (const auto& kv : m_mapping) {
-            if (mask.get(kv.second)) {
-                order[oidx] = std::make_pair(kv.first, mapping[kv.second]);
+        m_mapping.for_each([&order, &oidx, &mask, &mapping](t_index pkey, t_uindex row) {
+            if (mask.get(row)) {
+                order[oidx] = std::make_pair(pkey, mapping[row]);
                 ++oidx;
             }
-        }
+        });
     } else // enable_pkeyed_table_mask_fix
     {
         t_uindex oidx = 0;
-        for (const auto& kv : m_mapping) {
-            order[oidx] = kv;
+        m_mapping.for_each([&order, &oidx](t_index pkey, t_uindex row) {
+            order[oidx] = std::make_pair(pkey, row);
             ++oidx;
-        }
+        });
     }
 
     std::sort(order.begin(), order.end(),
@@ -712,23 +703,20 @@ t_gstate::get_row_data_pkeys(const std::vector<t_tscalar>& pkeys) const {
     // GAB: memory optim: do a first pass to compute the number of elements, to be able to reserve memory
     t_index count = 0;
     for (const auto& pkey : pkeys) {
-        t_mapping::const_iterator iter = m_mapping.find(pkey.get<t_index>());
-        if (iter == m_mapping.end())
+        if (!m_mapping.contains(pkey.get<t_index>()))
             continue;
 
-        for (t_uindex cidx = 0; cidx < ncols; ++cidx) {
-            count++;
-        }
+        count += ncols;
     }
 
     rval.reserve(count);
     for (const auto& pkey : pkeys) {
-        t_mapping::const_iterator iter = m_mapping.find(pkey.get<t_index>());
-        if (iter == m_mapping.end())
+        t_uindex row = m_mapping.find(pkey.get<t_index>());
+        if (row == t_mapping::NOT_FOUND)
             continue;
 
         for (t_uindex cidx = 0; cidx < ncols; ++cidx) {
-            auto v = columns[cidx]->get_scalar(iter->second);
+            auto v = columns[cidx]->get_scalar(row);
             if (v.is_valid()) {
                 rval.push_back(v);
             } else {
@@ -741,7 +729,7 @@ t_gstate::get_row_data_pkeys(const std::vector<t_tscalar>& pkeys) const {
 
 bool
 t_gstate::has_pkey(t_tscalar pkey) const {
-    return m_mapping.find(pkey.get<t_index>()) != m_mapping.end();
+    return m_mapping.contains(pkey.get<t_index>());
 }
 
 std::vector<t_tscalar>
@@ -754,7 +742,7 @@ t_gstate::has_pkeys(const std::vector<t_tscalar>& pkeys) const {
 
     for (const auto& p : pkeys) {
         t_tscalar tval;
-        tval.set(m_mapping.find(p.get<t_index>()) != m_mapping.end());
+        tval.set(m_mapping.contains(p.get<t_index>()));
         rval[idx].set(tval);
         ++idx;
     }
@@ -766,9 +754,13 @@ std::vector<t_tscalar>
 t_gstate::get_pkeys() const {
     std::vector<t_tscalar> rval(m_mapping.size());
     t_uindex idx = 0;
-    for (const auto& kv : m_mapping) {
-        rval[idx].set(kv.first);
+    m_mapping.for_each([&rval, &idx](t_index pkey, t_uindex row) {
+        rval[idx].set(pkey);
         ++idx;
+    });
+    // hashed pkeys come unordered
+    if (!m_mapping.is_dense()) {
+        std::sort(rval.begin(), rval.end());
     }
     return rval;
 }
@@ -803,7 +795,7 @@ t_gstate::mapping_size() const {
 void
 t_gstate::reset() {
     m_table->clear();
-    m_mapping = t_mapping();
+    m_mapping.clear();
     m_free.clear();
 }
 
@@ -813,9 +805,9 @@ t_gstate::get_value(const t_tscalar& pkey, const std::string& colname) const {
     const t_column* col_ = col.get();
     t_tscalar rval = mknone();
 
-    auto iter = m_mapping.find(pkey.get<t_index>());
-    if (iter != m_mapping.end()) {
-        rval.set(col_->get_scalar(iter->second));
+    t_uindex row = m_mapping.find(pkey.get<t_index>());
+    if (row != t_mapping::NOT_FOUND) {
+        rval.set(col_->get_scalar(row));
     }
 
     return rval;
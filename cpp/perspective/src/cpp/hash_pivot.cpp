@@ -0,0 +1,327 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/hash_pivot.h>
+#include <perspective/string_ranks.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#ifdef PSP_PARALLEL_FOR
+#include <tbb/tbb.h>
+#endif
+
+namespace perspective {
+
+namespace {
+
+    // Pivot scalars compare on their type, then their status, then their
+    // value when they are valid. Error rows become error message strings.
+    struct t_pivot_key {
+        std::uint64_t m_value;
+        std::uint32_t m_class;
+
+        bool
+        operator==(const t_pivot_key& o) const {
+            return m_value == o.m_value && m_class == o.m_class;
+        }
+
+        bool
+        operator<(const t_pivot_key& o) const {
+            return m_class != o.m_class ? m_class < o.m_class : m_value < o.m_value;
+        }
+    };
+
+    inline std::uint64_t
+    ordered_bits(std::int64_t v) {
+        return static_cast<std::uint64_t>(v) ^ (std::uint64_t(1) << 63);
+    }
+
+    inline std::uint64_t
+    ordered_bits(double v) {
+        // -0 equals 0, all NaNs are grouped after +inf
+        if (v == 0) {
+            v = 0;
+        } else if (v != v) {
+            v = std::numeric_limits<double>::quiet_NaN();
+        }
+        std::uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return bits >> 63 ? ~bits : bits | (std::uint64_t(1) << 63);
+    }
+
+    template <typename T, typename F>
+    void
+    read_keys(const t_column* data, const t_uindex* leaves, t_uindex nelems, t_pivot_key* keys,
+        F bits) {
+        const T* values = data->get_nth<T>(0);
+        const t_status* status = data->is_status_enabled() ? data->get_nth_status(0) : nullptr;
+        std::uint32_t type_class = std::uint32_t(data->get_dtype()) << 8;
+        std::uint32_t error_class = std::uint32_t(DTYPE_STR) << 8 | STATUS_ERROR;
+
+        for (t_uindex idx = 0; idx < nelems; ++idx) {
+            t_uindex leaf = leaves[idx];
+            t_status s = status ? status[leaf] : STATUS_VALID;
+            if (s == STATUS_VALID || s == STATUS_WARNING) {
+                keys[idx] = t_pivot_key{bits(values[leaf]), type_class | s};
+            } else {
+                keys[idx] = t_pivot_key{0, s == STATUS_ERROR ? error_class : type_class | s};
+            }
+        }
+    }
+
+    void
+    read_keys(const t_column* data, const std::uint32_t* ranks, const t_uindex* leaves,
+        t_uindex nelems, t_pivot_key* keys) {
+        auto as_int = [](std::int64_t v) { return ordered_bits(v); };
+        auto as_uint = [](std::uint64_t v) { return v; };
+        auto as_double = [](double v) { return ordered_bits(v); };
+
+        switch (data->get_dtype()) {
+            case DTYPE_INT64: read_keys<std::int64_t>(data, leaves, nelems, keys, as_int); break;
+            case DTYPE_INT32: read_keys<std::int32_t>(data, leaves, nelems, keys, as_int); break;
+            case DTYPE_INT16: read_keys<std::int16_t>(data, leaves, nelems, keys, as_int); break;
+            case DTYPE_INT8: read_keys<std::int8_t>(data, leaves, nelems, keys, as_int); break;
+            case DTYPE_UINT64: read_keys<std::uint64_t>(data, leaves, nelems, keys, as_uint); break;
+            case DTYPE_UINT32: read_keys<std::uint32_t>(data, leaves, nelems, keys, as_uint); break;
+            case DTYPE_UINT16: read_keys<std::uint16_t>(data, leaves, nelems, keys, as_uint); break;
+            case DTYPE_UINT8: read_keys<std::uint8_t>(data, leaves, nelems, keys, as_uint); break;
+            case DTYPE_BOOL: read_keys<bool>(data, leaves, nelems, keys, as_uint); break;
+            case DTYPE_FLOAT64: read_keys<double>(data, leaves, nelems, keys, as_double); break;
+            case DTYPE_FLOAT32: read_keys<float>(data, leaves, nelems, keys, as_double); break;
+            case DTYPE_TIME: {
+                read_keys<t_time::t_rawtype>(data, leaves, nelems, keys, as_double);
+            } break;
+            case DTYPE_DURATION: {
+                read_keys<t_duration::t_rawtype>(data, leaves, nelems, keys, as_double);
+            } break;
+            case DTYPE_DATE: {
+                read_keys<t_date::t_rawtype>(data, leaves, nelems, keys, as_int);
+            } break;
+            case DTYPE_STR: {
+                read_keys<t_uindex>(data, leaves, nelems, keys,
+                    [ranks](t_uindex sidx) { return std::uint64_t(ranks[sidx]); });
+            } break;
+            default: { PSP_COMPLAIN_AND_ABORT("Unsupported hash pivot dtype"); }
+        }
+    }
+
+    // Children of one node: leaf ranges of the visible values in ascending
+    // order, and ranges of the values beyond the limit
+    struct t_node_children {
+        struct t_child {
+            t_uindex m_flidx;
+            t_uindex m_nleaves;
+            t_uindex m_leaf;
+        };
+
+        std::vector<t_child> m_visible;
+        std::vector<t_child> m_hidden;
+    };
+
+    void
+    pivot_node(const t_column* data, const std::uint32_t* ranks, t_uindex* leaves,
+        t_uindex flidx, t_uindex nleaves, t_sorttype sort_type, t_index sort_limit,
+        t_limit_type limit_type, t_node_children& out) {
+        if (nleaves == 0) {
+            return;
+        }
+
+        std::vector<t_pivot_key> keys(nleaves);
+        read_keys(data, ranks, leaves + flidx, nleaves, keys.data());
+
+        // group ids in order of first occurrence, slots hold id + 1
+        t_uindex capacity = 16;
+        std::vector<std::uint32_t> slots(capacity, 0);
+        std::vector<t_pivot_key> group_keys;
+        std::vector<t_uindex> counts;
+        std::vector<t_uindex> first_rows;
+        std::vector<std::uint32_t> row_groups(nleaves);
+
+        auto slot_of = [](const t_pivot_key& key, t_uindex mask) {
+            std::uint64_t h = (key.m_value ^ (std::uint64_t(key.m_class) << 40)) * 0x9E3779B97F4A7C15ULL;
+            return static_cast<t_uindex>(h ^ (h >> 31)) & mask;
+        };
+
+        for (t_uindex idx = 0; idx < nleaves; ++idx) {
+            const t_pivot_key& key = keys[idx];
+            t_uindex mask = capacity - 1;
+            t_uindex pos = slot_of(key, mask);
+            while (slots[pos] != 0 && !(group_keys[slots[pos] - 1] == key)) {
+                pos = (pos + 1) & mask;
+            }
+            if (slots[pos] == 0) {
+                slots[pos] = static_cast<std::uint32_t>(group_keys.size() + 1);
+                group_keys.push_back(key);
+                counts.push_back(0);
+                first_rows.push_back(idx);
+
+                if (2 * group_keys.size() > capacity) {
+                    capacity *= 2;
+                    mask = capacity - 1;
+                    std::vector<std::uint32_t>(capacity, 0).swap(slots);
+                    for (t_uindex gidx = 0, ngroups = group_keys.size(); gidx < ngroups; ++gidx) {
+                        t_uindex npos = slot_of(group_keys[gidx], mask);
+                        while (slots[npos] != 0) {
+                            npos = (npos + 1) & mask;
+                        }
+                        slots[npos] = static_cast<std::uint32_t>(gidx + 1);
+                    }
+                    pos = slot_of(key, mask);
+                    while (slots[pos] != static_cast<std::uint32_t>(group_keys.size())) {
+                        pos = (pos + 1) & mask;
+                    }
+                }
+            }
+            row_groups[idx] = slots[pos] - 1;
+            ++counts[row_groups[idx]];
+        }
+
+        t_uindex ngroups = group_keys.size();
+        std::vector<std::uint32_t> order(ngroups);
+        for (t_uindex gidx = 0; gidx < ngroups; ++gidx) {
+            order[gidx] = static_cast<std::uint32_t>(gidx);
+        }
+        std::sort(order.begin(), order.end(), [&group_keys](std::uint32_t a, std::uint32_t b) {
+            return group_keys[a] < group_keys[b];
+        });
+
+        // the first `limit` values in the sort order are shown
+        t_uindex nvisible = ngroups;
+        if (sort_limit != t_index(-1)) {
+            t_index limit = sort_limit;
+            if (limit_type == LIMIT_TYPE_PECENT) {
+                limit = std::max(t_index(1), t_index((double)ngroups * (double)sort_limit / 100.0));
+            }
+            nvisible = std::min(ngroups, t_uindex(std::max(limit, t_index(0))));
+        }
+        t_uindex vbegin = sort_type == SORTTYPE_DESCENDING ? ngroups - nvisible : 0;
+        t_uindex vend = vbegin + nvisible;
+
+        // values are laid out in ascending order, rows of a value keep their order
+        std::vector<t_uindex> offsets(ngroups);
+        for (t_uindex ridx = 0, offset = 0; ridx < ngroups; ++ridx) {
+            std::uint32_t gidx = order[ridx];
+            offsets[gidx] = offset;
+            t_node_children::t_child child{flidx + offset, counts[gidx], leaves[flidx + first_rows[gidx]]};
+            if (ridx >= vbegin && ridx < vend) {
+                out.m_visible.push_back(child);
+            } else {
+                out.m_hidden.push_back(child);
+            }
+            offset += counts[gidx];
+        }
+
+        std::vector<t_uindex> sorted(nleaves);
+        for (t_uindex idx = 0; idx < nleaves; ++idx) {
+            sorted[offsets[row_groups[idx]]++] = leaves[flidx + idx];
+        }
+        std::memcpy(leaves + flidx, sorted.data(), sizeof(t_uindex) * nleaves);
+    }
+
+} // namespace
+
+bool
+t_hash_pivot_processor::is_supported(t_dtype dtype) {
+    switch (dtype) {
+        case DTYPE_INT64:
+        case DTYPE_INT32:
+        case DTYPE_INT16:
+        case DTYPE_INT8:
+        case DTYPE_UINT64:
+        case DTYPE_UINT32:
+        case DTYPE_UINT16:
+        case DTYPE_UINT8:
+        case DTYPE_FLOAT64:
+        case DTYPE_FLOAT32:
+        case DTYPE_BOOL:
+        case DTYPE_TIME:
+        case DTYPE_DURATION:
+        case DTYPE_DATE:
+        case DTYPE_STR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+t_uindex
+t_hash_pivot_processor::operator()(const t_column* data, std::vector<t_dense_tnode>* nodes,
+    t_column* values, t_column* leaves, t_uindex nbidx, t_uindex neidx, t_config& config,
+    t_mask& dt_msk, t_sorttype sort_type, t_index sort_limit, t_limit_type limit_type) {
+    // held for the whole pivot, the column may drop its ranks meanwhile
+    std::shared_ptr<const t_string_ranks> str_ranks;
+    const std::uint32_t* ranks = nullptr;
+    if (data->get_dtype() == DTYPE_STR) {
+        str_ranks = data->get_string_ranks(STRING_COLLATION_SCALAR);
+        ranks = str_ranks->get_ranks();
+    }
+
+    t_uindex* leaves_ptr = leaves->get_nth<t_uindex>(0);
+    int nparents = static_cast<int>(neidx - nbidx);
+    std::vector<t_node_children> children(nparents);
+
+    // siblings own disjoint leaf ranges
+#ifdef PSP_PARALLEL_FOR
+    PSP_PFOR(0, nparents, 1,
+        [&](int pidx)
+#else
+    for (int pidx = 0; pidx < nparents; ++pidx)
+#endif
+        {
+            const t_dense_tnode& pnode = (*nodes)[nbidx + pidx];
+            pivot_node(data, ranks, leaves_ptr, pnode.m_flidx, pnode.m_nleaves, sort_type,
+                sort_limit, limit_type, children[pidx]);
+        }
+#ifdef PSP_PARALLEL_FOR
+    );
+#endif
+
+    if (config.get_cancel_query_status()) {
+        return 0;
+    }
+
+    t_uindex lvl_nidx = neidx;
+    std::int32_t prev_percentage = 0;
+    for (int pidx = 0; pidx < nparents; ++pidx) {
+        t_uindex nidx = nbidx + pidx;
+        t_uindex parent_idx = (*nodes)[nidx].m_idx;
+        const t_node_children& nc = children[pidx];
+
+        (*nodes)[nidx].m_fcidx = lvl_nidx;
+        (*nodes)[nidx].m_nchild = nc.m_visible.size();
+
+        for (const auto& child : nc.m_visible) {
+            nodes->push_back({lvl_nidx, parent_idx, 0, 0, child.m_flidx, child.m_nleaves, true});
+            lvl_nidx += 1;
+            values->push_back<t_tscalar>(data->get_pivot_scalar(child.m_leaf));
+        }
+
+        // rows of the values over the limit stay in the parent, masked out
+        for (const auto& child : nc.m_hidden) {
+            for (t_uindex idx = 0; idx < child.m_nleaves; ++idx) {
+                dt_msk.set(leaves_ptr[child.m_flidx + idx], false);
+            }
+        }
+
+        std::int32_t percentage = 100 * (pidx + 1) / nparents;
+        if (percentage > prev_percentage) {
+            prev_percentage = percentage;
+            config.update_query_percentage_store(QUERY_PERCENT_CHECK_PIVOT, percentage);
+        }
+
+        if (config.get_cancel_query_status()) {
+            return 0;
+        }
+    }
+
+    return lvl_nidx;
+}
+
+} // end namespace perspective
@@ -21,7 +21,7 @@ t_mask::t_mask(t_uindex size)
 }
 
 t_mask::t_mask(const t_simple_bitmask& m) {
-    m_bitmap = boost::dynamic_bitset<>(static_cast<size_t>(m.size()));
+    m_bitmap = t_bitmap(static_cast<size_t>(m.size()));
 
     for (t_uindex idx = 0, loop_end = m.size(); idx < loop_end; ++idx) {
         set(idx, m.is_set(idx));
@@ -0,0 +1,187 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/pkey_mapping.h>
+#include <algorithm>
+
+namespace perspective {
+
+namespace {
+
+// Keys up to twice the number of keys plus this stay dense
+const t_uindex DENSE_SLACK = 1024;
+
+// Power of two with room for n keys at a load of at most 1/4
+t_uindex
+hash_capacity(t_uindex n) {
+    t_uindex capacity = 16;
+    while (capacity < n * 4) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+} // end anonymous namespace
+
+const t_uindex t_pkey_mapping::NOT_FOUND;
+const t_uindex t_pkey_mapping::TOMBSTONE;
+
+t_pkey_mapping::t_pkey_mapping()
+    : m_dense(true)
+    , m_size(0)
+    , m_tombstones(0) {}
+
+bool
+t_pkey_mapping::fits_dense(t_index key) const {
+    if (key < 0) {
+        return false;
+    }
+    t_uindex ukey = static_cast<t_uindex>(key);
+    return ukey < m_rows.size() || ukey <= 2 * m_size + DENSE_SLACK;
+}
+
+void
+t_pkey_mapping::set(t_index key, t_uindex row) {
+    PSP_VERBOSE_ASSERT(row < TOMBSTONE, "Row out of range");
+
+    if (m_dense && !fits_dense(key)) {
+        to_hash();
+    }
+
+    if (m_dense) {
+        t_uindex ukey = static_cast<t_uindex>(key);
+        if (ukey >= m_rows.size()) {
+            m_rows.resize(ukey + 1, TOMBSTONE);
+        }
+        if (m_rows[ukey] == TOMBSTONE) {
+            ++m_size;
+        }
+        m_rows[ukey] = row;
+        return;
+    }
+
+    if ((m_size + m_tombstones + 1) * 2 > m_keys.size()) {
+        rehash(hash_capacity(m_size + 1));
+    }
+
+    t_uindex mask = m_keys.size() - 1;
+    t_uindex free_slot = NOT_FOUND;
+    for (t_uindex s = slot(key);; s = (s + 1) & mask) {
+        t_uindex current = m_rows[s];
+        if (current == NOT_FOUND) {
+            if (free_slot == NOT_FOUND) {
+                free_slot = s;
+            } else {
+                --m_tombstones;
+            }
+            m_keys[free_slot] = key;
+            m_rows[free_slot] = row;
+            ++m_size;
+            return;
+        }
+        if (current == TOMBSTONE) {
+            if (free_slot == NOT_FOUND) {
+                free_slot = s;
+            }
+        } else if (m_keys[s] == key) {
+            m_rows[s] = row;
+            return;
+        }
+    }
+}
+
+void
+t_pkey_mapping::erase(t_index key) {
+    if (m_dense) {
+        if (key >= 0 && static_cast<t_uindex>(key) < m_rows.size()
+            && m_rows[key] != TOMBSTONE) {
+            m_rows[key] = TOMBSTONE;
+            --m_size;
+        }
+        return;
+    }
+
+    t_uindex s = find_slot(key);
+    if (s != NOT_FOUND) {
+        m_rows[s] = TOMBSTONE;
+        --m_size;
+        ++m_tombstones;
+    }
+}
+
+t_uindex
+t_pkey_mapping::size() const {
+    return m_size;
+}
+
+bool
+t_pkey_mapping::empty() const {
+    return m_size == 0;
+}
+
+bool
+t_pkey_mapping::is_dense() const {
+    return m_dense;
+}
+
+void
+t_pkey_mapping::reserve(t_uindex n) {
+    if (m_dense) {
+        m_rows.reserve(n);
+    } else if ((n + m_tombstones) * 2 > m_keys.size()) {
+        rehash(hash_capacity(n));
+    }
+}
+
+void
+t_pkey_mapping::clear() {
+    m_dense = true;
+    m_size = 0;
+    m_tombstones = 0;
+    std::vector<t_uindex>().swap(m_rows);
+    std::vector<t_index>().swap(m_keys);
+}
+
+void
+t_pkey_mapping::to_hash() {
+    std::vector<t_uindex> rows;
+    rows.swap(m_rows);
+
+    t_uindex nkeys = m_size;
+    m_dense = false;
+    m_size = 0;
+    m_tombstones = 0;
+    rehash(hash_capacity(nkeys + 1));
+
+    for (t_uindex key = 0, loop_end = rows.size(); key < loop_end; ++key) {
+        if (rows[key] != TOMBSTONE) {
+            set(static_cast<t_index>(key), rows[key]);
+        }
+    }
+}
+
+void
+t_pkey_mapping::rehash(t_uindex capacity) {
+    std::vector<t_index> keys(capacity);
+    std::vector<t_uindex> rows(capacity, NOT_FOUND);
+    keys.swap(m_keys);
+    rows.swap(m_rows);
+    m_size = 0;
+    m_tombstones = 0;
+
+    for (t_uindex s = 0, loop_end = keys.size(); s < loop_end; ++s) {
+        if (rows[s] != NOT_FOUND && rows[s] != TOMBSTONE) {
+            set(keys[s], rows[s]);
+        }
+    }
+}
+
+} // end namespace perspective
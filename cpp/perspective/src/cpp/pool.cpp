@@ -24,6 +24,14 @@ t_updctx::t_updctx(t_uindex gnode_id, const std::string& ctx)
     : m_gnode_id(gnode_id)
     , m_ctx(ctx) {}
 
+t_pool_stats::t_pool_stats()
+    : m_nflushes(0)
+    , m_nrows(0)
+    , m_last_latency(0)
+    , m_max_latency(0)
+    , m_total_latency(0)
+    , m_total_process(0) {}
+
 #ifdef PSP_ENABLE_WASM
 emscripten::val
 empty_callback() {
@@ -33,33 +41,47 @@ empty_callback() {
 }
 
 t_pool::t_pool()
-    : m_sleep(0)
-    , m_update_delegate(empty_callback())
-    , m_has_python_dep(false) {
-    m_run.clear();
-}
+    : m_update_delegate(empty_callback())
+    , m_run(false)
+    , m_data_remaining(false)
+    , m_flush_rows(0)
+    , m_flush_delay(0)
+    , m_epoch(0)
+    , m_pending_rows(0)
+    , m_has_python_dep(false) {}
 #else
 
 t_pool::t_pool()
-    : m_sleep(100)
-    , m_has_python_dep(false) {
-    m_run.clear();
-}
+    : m_run(false)
+    , m_data_remaining(false)
+    , m_flush_rows(0)
+    , m_flush_delay(0)
+    , m_epoch(0)
+    , m_pending_rows(0)
+    , m_has_python_dep(false) {}
 
 #endif
 
-t_pool::~t_pool() {}
+t_pool::~t_pool() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lg(m_mtx);
+            m_run.store(false);
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+}
 
 void
 t_pool::init() {
     if (t_env::log_progress()) {
         std::cout << "t_pool.init " << std::endl;
     }
-    m_run.test_and_set(std::memory_order_acquire);
+    m_run.store(true);
     m_data_remaining.store(false);
-    std::thread t(&t_pool::_process, this);
-    set_thread_name(t, "psp_pool_thread");
-    t.detach();
+    m_thread = std::thread(&t_pool::_process_loop, this);
+    set_thread_name(m_thread, "psp_pool_thread");
 }
 
 t_uindex
@@ -93,6 +115,11 @@ void
 t_pool::send(t_uindex gnode_id, t_uindex port_id, const t_table& table) {
     {
         std::lock_guard<std::mutex> lg(m_mtx);
+        if (!m_data_remaining.load()) {
+            m_pending_since = std::chrono::steady_clock::now();
+            m_pending_rows = 0;
+        }
+        m_pending_rows += table.size();
         m_data_remaining.store(true);
         if (m_gnodes[gnode_id]) {
             m_gnodes[gnode_id]->_send(port_id, table);
@@ -108,27 +135,93 @@ t_pool::send(t_uindex gnode_id, t_uindex port_id, const t_table& table) {
             table.pprint();
         }
     }
+    m_cv.notify_one();
 }
 
 void
 t_pool::_process_helper() {
+    t_uindex nrows;
+    std::chrono::steady_clock::time_point since;
+    {
+        std::lock_guard<std::mutex> lg(m_mtx);
+        take_pending(nrows, since);
+    }
+    _process_pending(nrows, since);
+}
+
+void
+t_pool::_process_pending(t_uindex nrows, std::chrono::steady_clock::time_point since) {
     auto work_to_do = m_data_remaining.load();
     if (work_to_do) {
+        auto start = std::chrono::steady_clock::now();
         t_update_task task(*this);
         task.run();
+        record_flush(start, since, nrows);
     }
 }
 
+void
+t_pool::take_pending(t_uindex& nrows, std::chrono::steady_clock::time_point& since) {
+    nrows = m_pending_rows;
+    since = m_pending_since;
+    m_pending_rows = 0;
+}
+
 void
 t_pool::_process() {
-    t_uindex sleep_time = m_sleep.load();
     _process_helper();
-    std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
+}
+
+void
+t_pool::_process_loop() {
+    std::unique_lock<std::mutex> lk(m_mtx);
+    while (m_run.load()) {
+        m_cv.wait(lk, [this]() { return !m_run.load() || m_data_remaining.load(); });
+        if (!m_run.load()) {
+            break;
+        }
+
+        // Coalesce sends until enough rows are pending, or the first one
+        // waited long enough
+        auto deadline = m_pending_since + std::chrono::microseconds(m_flush_delay.load());
+        m_cv.wait_until(lk, deadline, [this]() {
+            t_uindex nrows = m_flush_rows.load();
+            return !m_run.load() || (nrows > 0 && m_pending_rows >= nrows);
+        });
+
+        t_uindex nrows;
+        std::chrono::steady_clock::time_point since;
+        take_pending(nrows, since);
+        _process_pending(nrows, since);
+    }
+}
+
+void
+t_pool::record_flush(std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point since, t_uindex nrows) {
+    auto end = std::chrono::steady_clock::now();
+    t_uindex latency = std::chrono::duration_cast<std::chrono::microseconds>(end - since).count();
+    t_uindex process = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    std::lock_guard<std::mutex> lg(m_stats_mtx);
+    ++m_stats.m_nflushes;
+    m_stats.m_nrows += nrows;
+    m_stats.m_last_latency = latency;
+    m_stats.m_max_latency = std::max(m_stats.m_max_latency, latency);
+    m_stats.m_total_latency += latency;
+    m_stats.m_total_process += process;
 }
 
 void
 t_pool::stop() {
-    m_run.clear(std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lg(m_mtx);
+        m_run.store(false);
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
     _process_helper();
 
     if (t_env::log_progress()) {
@@ -136,14 +229,38 @@ t_pool::stop() {
     }
 }
 
+void
+t_pool::set_coalescing(t_uindex nrows, t_uindex delay) {
+    m_flush_rows.store(nrows);
+    m_flush_delay.store(delay);
+    m_cv.notify_all();
+    if (t_env::log_progress()) {
+        std::cout << "t_pool.set_coalescing nrows => " << nrows << " delay => " << delay
+                  << std::endl;
+    }
+}
+
 void
 t_pool::set_sleep(t_uindex ms) {
-    m_sleep.store(ms);
+    m_flush_delay.store(ms * 1000);
+    m_cv.notify_all();
     if (t_env::log_progress()) {
         std::cout << "t_pool.set_sleep ms => " << ms << std::endl;
     }
 }
 
+t_pool_stats
+t_pool::get_stats() const {
+    std::lock_guard<std::mutex> lg(m_stats_mtx);
+    return m_stats;
+}
+
+void
+t_pool::reset_stats() {
+    std::lock_guard<std::mutex> lg(m_stats_mtx);
+    m_stats = t_pool_stats();
+}
+
 void
 t_pool::py_notify_userspace() {
 #ifdef PSP_ENABLE_WASM
@@ -328,12 +445,17 @@ t_pool::flush() {
     if (!m_data_remaining.load())
         return;
 
+    t_uindex nrows;
+    std::chrono::steady_clock::time_point since;
+    take_pending(nrows, since);
+    auto start = std::chrono::steady_clock::now();
     for (t_uindex idx = 0, loop_end = m_gnodes.size(); idx < loop_end; ++idx) {
         if (m_gnodes[idx]) {
             t_update_task task(*this);
             task.run(idx);
         }
     }
+    record_flush(start, since, nrows);
 }
 
 void
@@ -341,8 +463,13 @@ t_pool::flush(t_uindex gnode_id) {
     std::lock_guard<std::mutex> lg(m_mtx);
     auto work_to_do = m_data_remaining.load();
     if (work_to_do) {
+        t_uindex nrows;
+        std::chrono::steady_clock::time_point since;
+        take_pending(nrows, since);
+        auto start = std::chrono::steady_clock::now();
         t_update_task task(*this);
         task.run(gnode_id);
+        record_flush(start, since, nrows);
     }
 }
 
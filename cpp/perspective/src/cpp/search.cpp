@@ -59,6 +59,16 @@ t_sterm::get_sterm() const {
     return m_sterm;
 }
 
+const double*
+t_sterm::get_sterm_double() const {
+    return m_sterm_double.get();
+}
+
+const t_date*
+t_sterm::get_sterm_date() const {
+    return m_sterm_date.get();
+}
+
 bool
 t_sterm::call_pp(const t_tscalar& s, t_searchtype search_type) const {
     bool rv = false;
@@ -0,0 +1,396 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/search_index.h>
+#include <perspective/column.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+
+namespace perspective {
+
+namespace {
+
+    // as t_tscalar::pp_search_edge renders the month of a date
+    const char* const month_names[] = {"_____________________zero", "jan", "feb", "mar", "apr",
+        "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec"};
+
+    // pp_search_equals compares numbers within this distance
+    const double NUMBER_TOLERANCE = 0.0001;
+
+    template <typename K>
+    std::uint32_t
+    intern_key(std::map<K, std::uint32_t>& keys, const K& k, std::uint32_t& nkeys) {
+        auto it = keys.find(k);
+        if (it == keys.end()) {
+            it = keys.emplace(k, nkeys++).first;
+        }
+        return it->second;
+    }
+
+    std::vector<std::string>
+    split_words(const std::string& s) {
+        std::vector<std::string> words;
+        std::string word;
+        for (char ch : s) {
+            if (std::isspace(static_cast<unsigned char>(ch))) {
+                if (!word.empty()) {
+                    words.push_back(word);
+                }
+                word.clear();
+            } else {
+                word.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(ch))));
+            }
+        }
+        if (!word.empty()) {
+            words.push_back(word);
+        }
+        return words;
+    }
+
+} // namespace
+
+t_search_index::t_search_index()
+    : m_dtype(DTYPE_NONE)
+    , m_nkeys(0)
+    , m_nrows(0)
+    , m_has_dirty(false) {}
+
+bool
+t_search_index::is_supported(t_dtype dtype) {
+    switch (dtype) {
+        case DTYPE_STR:
+        case DTYPE_DATE:
+        case DTYPE_INT64:
+        case DTYPE_FLOAT64:
+        case DTYPE_BOOL:
+        case DTYPE_TIME:
+        case DTYPE_DURATION:
+        case DTYPE_LIST_STR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void
+t_search_index::mark(t_uindex bidx, t_uindex eidx) {
+    // rows past m_nrows are indexed anyway
+    eidx = std::min(eidx, m_nrows);
+    if (bidx >= eidx) {
+        return;
+    }
+    for (t_uindex zidx = bidx / ZONE_MAP_BLOCK_SIZE, zend = (eidx - 1) / ZONE_MAP_BLOCK_SIZE;
+         zidx <= zend; ++zidx) {
+        m_dirty[zidx] = true;
+    }
+    m_has_dirty = true;
+}
+
+void
+t_search_index::mark_all() {
+    std::fill(m_dirty.begin(), m_dirty.end(), true);
+    m_has_dirty = true;
+}
+
+void
+t_search_index::update(const t_column& col) {
+    t_uindex nrows = col.size();
+    if (nrows == m_nrows && !m_has_dirty) {
+        return;
+    }
+    m_dtype = col.get_dtype();
+
+    // the last block of the previous size may have grown or shrunk
+    t_uindex first = nrows == m_nrows ? m_segments.size()
+                                      : std::min(nrows, m_nrows) / ZONE_MAP_BLOCK_SIZE;
+    t_uindex nsegments = (nrows + ZONE_MAP_BLOCK_SIZE - 1) / ZONE_MAP_BLOCK_SIZE;
+    m_segments.resize(nsegments);
+    m_dirty.resize(nsegments, false);
+
+    for (t_uindex zidx = 0; zidx < nsegments; ++zidx) {
+        if (zidx >= first || m_dirty[zidx]) {
+            index_block(col, zidx);
+        }
+    }
+
+    std::fill(m_dirty.begin(), m_dirty.end(), false);
+    m_has_dirty = false;
+    m_nrows = nrows;
+}
+
+void
+t_search_index::add_words(const char* s, std::vector<std::uint32_t>& out) {
+    for (const auto& word : split_words(s)) {
+        out.push_back(intern_key(m_words, word, m_nkeys));
+    }
+}
+
+void
+t_search_index::add_keys(const t_column& col, t_uindex ridx, std::vector<std::uint32_t>& out) {
+    t_tscalar s = col.get_scalar(ridx);
+    if (s.m_status != STATUS_VALID) {
+        return;
+    }
+
+    switch (s.m_type) {
+        case DTYPE_STR: {
+            const char* p = s.get_char_ptr();
+            if (!p) {
+                return;
+            }
+            add_words(p, out);
+            // dates are read at the start of each word by pp_search_edge,
+            // pp_search_equals only reads the first one
+            for (t_uindex i = 0; p[i]; ++i) {
+                t_date date;
+                if ((i == 0 || isspace(p[i - 1])) && t_date::from_string(p + i, date)) {
+                    out.push_back(intern_key(m_dates, date.raw_value(), m_nkeys));
+                }
+            }
+        } break;
+        case DTYPE_DATE: {
+            auto date = s.get<t_date>();
+            out.push_back(intern_key(m_dates, date.raw_value(), m_nkeys));
+            add_words(s.to_search_string().c_str(), out);
+
+            tm tm_;
+            date.as_tm(tm_);
+            char buf[48] = {0};
+            sprintf(buf, "%d", date.year(tm_));
+            add_words(buf, out);
+            int month = date.month(tm_);
+            sprintf(buf, "%d", month);
+            add_words(buf, out);
+            if (month >= 0 && month <= 12) {
+                add_words(month_names[month], out);
+            }
+            sprintf(buf, "%d", date.day(tm_));
+            add_words(buf, out);
+        } break;
+        case DTYPE_INT64:
+        case DTYPE_FLOAT64: {
+            double d = s.to_double();
+            if (!std::isnan(d)) {
+                out.push_back(intern_key(m_numbers, d, m_nkeys));
+            }
+            add_words(s.to_search_string().c_str(), out);
+        } break;
+        case DTYPE_BOOL:
+        case DTYPE_TIME:
+        case DTYPE_DURATION:
+        case DTYPE_LIST_STR: {
+            add_words(s.to_search_string().c_str(), out);
+        } break;
+        default: break;
+    }
+}
+
+void
+t_search_index::index_block(const t_column& col, t_uindex zidx) {
+    t_uindex bidx = zidx * ZONE_MAP_BLOCK_SIZE;
+    t_uindex eidx = std::min(bidx + ZONE_MAP_BLOCK_SIZE, col.size());
+
+    // (key, row in the block) of every key of every row
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> entries;
+    std::vector<std::uint32_t> keys;
+    for (t_uindex ridx = bidx; ridx < eidx; ++ridx) {
+        keys.clear();
+        add_keys(col, ridx, keys);
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        for (auto key : keys) {
+            entries.emplace_back(key, static_cast<std::uint32_t>(ridx - bidx));
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+
+    t_segment segment;
+    std::uint32_t prev = 0;
+    for (t_uindex pidx = 0, loop_end = entries.size(); pidx < loop_end; ++pidx) {
+        const auto& entry = entries[pidx];
+        if (segment.m_keys.empty() || segment.m_keys.back() != entry.first) {
+            segment.m_keys.push_back(entry.first);
+            segment.m_offsets.push_back(static_cast<std::uint32_t>(segment.m_postings.size()));
+            prev = 0;
+        }
+        std::uint32_t delta = entry.second - prev;
+        prev = entry.second;
+        while (delta >= 0x80) {
+            segment.m_postings.push_back(static_cast<std::uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        segment.m_postings.push_back(static_cast<std::uint8_t>(delta));
+    }
+    segment.m_offsets.push_back(static_cast<std::uint32_t>(segment.m_postings.size()));
+    m_segments[zidx] = std::move(segment);
+}
+
+std::vector<std::uint32_t>
+t_search_index::find_words(const std::string& word) const {
+    std::vector<std::uint32_t> ids;
+    for (auto it = m_words.lower_bound(word);
+         it != m_words.end() && it->first.compare(0, word.size(), word) == 0; ++it) {
+        ids.push_back(it->second);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+std::vector<std::uint32_t>
+t_search_index::find_number(double d) const {
+    // the bounds are widened so that rounding never drops a match
+    std::vector<std::uint32_t> ids;
+    for (auto it = m_numbers.lower_bound(d - 2 * NUMBER_TOLERANCE);
+         it != m_numbers.end() && it->first <= d + 2 * NUMBER_TOLERANCE; ++it) {
+        if (std::abs(d - it->first) < NUMBER_TOLERANCE) {
+            ids.push_back(it->second);
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+std::vector<std::uint32_t>
+t_search_index::find_date(const t_date& date) const {
+    std::vector<std::uint32_t> ids;
+    auto it = m_dates.find(date.raw_value());
+    if (it != m_dates.end()) {
+        ids.push_back(it->second);
+    }
+    return ids;
+}
+
+void
+t_search_index::fill_rows(const std::vector<std::uint32_t>& ids, t_mask& rows) const {
+    if (ids.empty()) {
+        return;
+    }
+
+    // Short id lists are looked up in each segment, long ones (prefixes
+    // of one or two characters) are tested key by key
+    std::vector<bool> wanted;
+    bool by_key = ids.size() > 64;
+    if (by_key) {
+        wanted.resize(m_nkeys, false);
+        for (auto id : ids) {
+            wanted[id] = true;
+        }
+    }
+
+    auto add_postings = [&rows](const t_segment& segment, t_uindex kidx, t_uindex bidx) {
+        const std::uint8_t* p = segment.m_postings.data() + segment.m_offsets[kidx];
+        const std::uint8_t* end = segment.m_postings.data() + segment.m_offsets[kidx + 1];
+        t_uindex ridx = bidx;
+        while (p != end) {
+            t_uindex delta = 0;
+            for (int shift = 0;; shift += 7) {
+                std::uint8_t byte = *p++;
+                delta |= t_uindex(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) {
+                    break;
+                }
+            }
+            ridx += delta;
+            rows.set(ridx);
+        }
+    };
+
+    for (t_uindex zidx = 0, loop_end = m_segments.size(); zidx < loop_end; ++zidx) {
+        const t_segment& segment = m_segments[zidx];
+        t_uindex bidx = zidx * ZONE_MAP_BLOCK_SIZE;
+        if (by_key) {
+            for (t_uindex kidx = 0, kend = segment.m_keys.size(); kidx < kend; ++kidx) {
+                if (wanted[segment.m_keys[kidx]]) {
+                    add_postings(segment, kidx, bidx);
+                }
+            }
+            continue;
+        }
+        auto it = segment.m_keys.begin();
+        for (auto id : ids) {
+            it = std::lower_bound(it, segment.m_keys.end(), id);
+            if (it == segment.m_keys.end()) {
+                break;
+            }
+            if (*it == id) {
+                add_postings(segment, it - segment.m_keys.begin(), bidx);
+            }
+        }
+    }
+}
+
+t_masksptr
+t_search_index::find_terms(const std::string& sterm) const {
+    // every word of the term is a prefix of a word of the cell, the words
+    // of a multiword term intersect their rows
+    auto words = split_words(sterm);
+    if (words.empty()) {
+        return nullptr;
+    }
+    t_masksptr rows;
+    for (const auto& word : words) {
+        auto word_rows = std::make_shared<t_mask>(m_nrows);
+        fill_rows(find_words(word), *word_rows);
+        if (rows) {
+            *rows &= *word_rows;
+        } else {
+            rows = word_rows;
+        }
+    }
+    return rows;
+}
+
+t_masksptr
+t_search_index::find(const t_sterm& sterm, t_searchtype type) const {
+    // contains matches inside words
+    if (type == SEARCHTYPE_CONTAINS) {
+        return nullptr;
+    }
+    auto rows = std::make_shared<t_mask>(m_nrows);
+    if (type == SEARCHTYPE_NULL) {
+        return rows;
+    }
+
+    const t_date* date = sterm.get_sterm_date();
+    const double* d = sterm.get_sterm_double();
+    switch (m_dtype) {
+        case DTYPE_STR: {
+            if (date && type != SEARCHTYPE_STARTS_WITH) {
+                fill_rows(find_date(*date), *rows);
+                return rows;
+            }
+        } break;
+        case DTYPE_DATE: {
+            if (date) {
+                fill_rows(find_date(*date), *rows);
+                return rows;
+            }
+            if (type == SEARCHTYPE_EQUALS) {
+                return rows;
+            }
+        } break;
+        case DTYPE_INT64:
+        case DTYPE_FLOAT64: {
+            if (type == SEARCHTYPE_EQUALS) {
+                if (d) {
+                    fill_rows(find_number(*d), *rows);
+                }
+                return rows;
+            }
+        } break;
+        default: break;
+    }
+    return find_terms(sterm.get_sterm());
+}
+
+} // end namespace perspective
@@ -0,0 +1,339 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/sketch.h>
+#include <perspective/date.h>
+#include <perspective/time.h>
+#include <perspective/duration.h>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace perspective {
+
+namespace {
+
+// Levels keep at least this many items, whatever their depth
+const t_uindex MIN_CAPACITY = 8;
+
+// 64-bit finalizer of MurmurHash3, spreads hash_value over all the bits
+inline std::uint64_t
+fmix64(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+} // end anonymous namespace
+
+t_quantile_sketch::t_quantile_sketch(t_uindex k)
+    : m_k(k)
+    , m_n(0)
+    , m_odd(false) {}
+
+t_uindex
+t_quantile_sketch::capacity(t_uindex level) const {
+    t_uindex depth = m_levels.size() - 1 - level;
+    double cap = std::ceil(double(m_k) * std::pow(2.0 / 3.0, double(depth)));
+    return std::max(t_uindex(cap), MIN_CAPACITY);
+}
+
+void
+t_quantile_sketch::compact(t_uindex level) {
+    if (level + 1 == m_levels.size()) {
+        m_levels.emplace_back();
+    }
+
+    std::vector<double>& items = m_levels[level];
+    std::vector<double>& next = m_levels[level + 1];
+    std::sort(items.begin(), items.end());
+
+    // an odd item out stays behind, from alternate ends
+    bool keep = items.size() % 2 == 1;
+    double kept = 0;
+    if (keep) {
+        if (m_odd) {
+            kept = items.back();
+            items.pop_back();
+        } else {
+            kept = items.front();
+            items.erase(items.begin());
+        }
+    }
+
+    for (t_uindex idx = m_odd ? 1 : 0, loop_end = items.size(); idx < loop_end; idx += 2) {
+        next.push_back(items[idx]);
+    }
+    m_odd = !m_odd;
+
+    items.clear();
+    if (keep) {
+        items.push_back(kept);
+    }
+}
+
+void
+t_quantile_sketch::compress() {
+    bool compacted = true;
+    while (compacted) {
+        compacted = false;
+        for (t_uindex level = 0; level < m_levels.size(); ++level) {
+            if (m_levels[level].size() >= capacity(level)) {
+                compact(level);
+                compacted = true;
+            }
+        }
+    }
+}
+
+void
+t_quantile_sketch::add(double v) {
+    if (m_levels.empty()) {
+        m_levels.emplace_back();
+    }
+    m_levels[0].push_back(v);
+    ++m_n;
+    if (m_levels[0].size() >= capacity(0)) {
+        compress();
+    }
+}
+
+void
+t_quantile_sketch::add(const t_tscalar& v) {
+    if (!v.is_valid() || v.is_nan()) {
+        return;
+    }
+    switch (v.get_dtype()) {
+        case DTYPE_DATE:
+        case DTYPE_TIME:
+        case DTYPE_DURATION: {
+            add(v.to_double());
+        } break;
+        default: {
+            if (v.is_numeric()) {
+                add(v.to_double());
+            }
+        } break;
+    }
+}
+
+void
+t_quantile_sketch::merge(const t_quantile_sketch& other) {
+    if (other.m_n == 0) {
+        return;
+    }
+
+    if (m_levels.size() < other.m_levels.size()) {
+        m_levels.resize(other.m_levels.size());
+    }
+
+    for (t_uindex level = 0, loop_end = other.m_levels.size(); level < loop_end; ++level) {
+        const std::vector<double>& items = other.m_levels[level];
+        m_levels[level].insert(m_levels[level].end(), items.begin(), items.end());
+    }
+    m_n += other.m_n;
+    compress();
+}
+
+bool
+t_quantile_sketch::empty() const {
+    return m_n == 0;
+}
+
+t_uindex
+t_quantile_sketch::count() const {
+    return m_n;
+}
+
+t_uindex
+t_quantile_sketch::size() const {
+    t_uindex rval = 0;
+    for (const auto& items : m_levels) {
+        rval += items.size();
+    }
+    return rval;
+}
+
+double
+t_quantile_sketch::quantile(double q) const {
+    PSP_VERBOSE_ASSERT(m_n > 0, "Quantile of an empty sketch");
+
+    std::vector<std::pair<double, t_uindex>> weighted;
+    weighted.reserve(size());
+    for (t_uindex level = 0, loop_end = m_levels.size(); level < loop_end; ++level) {
+        t_uindex weight = t_uindex(1) << level;
+        for (double v : m_levels[level]) {
+            weighted.emplace_back(v, weight);
+        }
+    }
+    std::sort(weighted.begin(), weighted.end());
+
+    q = std::min(std::max(q, 0.0), 1.0);
+    t_uindex rank = std::min(t_uindex(q * double(m_n)), m_n - 1);
+
+    t_uindex seen = 0;
+    for (const auto& item : weighted) {
+        seen += item.second;
+        if (seen > rank) {
+            return item.first;
+        }
+    }
+    return weighted.back().first;
+}
+
+t_tscalar
+t_quantile_sketch::quantile(double q, t_dtype dtype) const {
+    // the quantile is one of the added values, which convert back exactly
+    double v = quantile(q);
+    t_tscalar rval;
+    switch (dtype) {
+        case DTYPE_DATE: {
+            rval.set(t_date(t_date::t_rawtype(v)));
+        } break;
+        case DTYPE_TIME: {
+            rval.set(t_time(t_time::t_rawtype(v)));
+        } break;
+        case DTYPE_DURATION: {
+            rval.set(t_duration(t_duration::t_rawtype(v)));
+        } break;
+        default: {
+            rval.set(v);
+            rval = rval.coerce_numeric_dtype(dtype);
+        } break;
+    }
+    return rval;
+}
+
+t_distinct_sketch::t_distinct_sketch() {}
+
+std::uint64_t
+t_distinct_sketch::hash(const t_tscalar& v) {
+    return fmix64(hash_value(v));
+}
+
+void
+t_distinct_sketch::add(const t_tscalar& v) {
+    add_hash(hash(v));
+}
+
+void
+t_distinct_sketch::add_hash(std::uint64_t h) {
+    if (!m_registers.empty()) {
+        insert_register(h);
+        return;
+    }
+
+    auto iter = std::lower_bound(m_sparse.begin(), m_sparse.end(), h);
+    if (iter != m_sparse.end() && *iter == h) {
+        return;
+    }
+    m_sparse.insert(iter, h);
+
+    if (m_sparse.size() > SPARSE_LIMIT) {
+        densify();
+    }
+}
+
+void
+t_distinct_sketch::insert_register(std::uint64_t h) {
+    t_uindex idx = h >> (64 - PRECISION);
+    std::uint64_t w = h << PRECISION;
+
+    // position of the first set bit after the register bits
+    std::uint8_t rank = 1;
+    while (rank <= 64 - PRECISION && !(w & (std::uint64_t(1) << 63))) {
+        ++rank;
+        w <<= 1;
+    }
+
+    if (rank > m_registers[idx]) {
+        m_registers[idx] = rank;
+    }
+}
+
+void
+t_distinct_sketch::densify() {
+    m_registers.assign(NREGISTERS, 0);
+    for (std::uint64_t h : m_sparse) {
+        insert_register(h);
+    }
+    std::vector<std::uint64_t>().swap(m_sparse);
+}
+
+void
+t_distinct_sketch::merge(const t_distinct_sketch& other) {
+    if (other.empty()) {
+        return;
+    }
+
+    if (m_registers.empty() && other.m_registers.empty()) {
+        std::vector<std::uint64_t> merged;
+        merged.reserve(m_sparse.size() + other.m_sparse.size());
+        std::set_union(m_sparse.begin(), m_sparse.end(), other.m_sparse.begin(),
+            other.m_sparse.end(), std::back_inserter(merged));
+        m_sparse.swap(merged);
+        if (m_sparse.size() > SPARSE_LIMIT) {
+            densify();
+        }
+        return;
+    }
+
+    if (m_registers.empty()) {
+        densify();
+    }
+
+    if (other.m_registers.empty()) {
+        for (std::uint64_t h : other.m_sparse) {
+            insert_register(h);
+        }
+        return;
+    }
+
+    for (t_uindex idx = 0; idx < NREGISTERS; ++idx) {
+        m_registers[idx] = std::max(m_registers[idx], other.m_registers[idx]);
+    }
+}
+
+bool
+t_distinct_sketch::empty() const {
+    return m_sparse.empty() && m_registers.empty();
+}
+
+std::uint64_t
+t_distinct_sketch::estimate() const {
+    if (m_registers.empty()) {
+        return m_sparse.size();
+    }
+
+    double m = NREGISTERS;
+    double sum = 0;
+    t_uindex zeros = 0;
+    for (std::uint8_t r : m_registers) {
+        sum += std::ldexp(1.0, -int(r));
+        zeros += r == 0;
+    }
+
+    double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double estimate = alpha * m * m / sum;
+
+    // linear counting while many registers are still empty
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * std::log(m / double(zeros));
+    }
+
+    return std::uint64_t(std::llround(estimate));
+}
+
+} // end namespace perspective
@@ -157,16 +157,14 @@ t_stree::init() {
 
 t_tscalar
 t_stree::get_value(t_index idx) const {
-    iter_by_idx iter = m_nodes->get<by_idx>().find(idx);
-    PSP_VERBOSE_ASSERT(iter != m_nodes->get<by_idx>().end(), "Reached end iterator");
-    return iter->m_value;
+    PSP_VERBOSE_ASSERT(m_nodes->contains(idx), "Reached end iterator");
+    return m_nodes->get_value(idx);
 }
 
 t_tscalar
 t_stree::get_sortby_value(t_index idx) const {
-    iter_by_idx iter = m_nodes->get<by_idx>().find(idx);
-    PSP_VERBOSE_ASSERT(iter != m_nodes->get<by_idx>().end(), "Reached end iterator");
-    return iter->m_sort_value;
+    PSP_VERBOSE_ASSERT(m_nodes->contains(idx), "Reached end iterator");
+    return m_nodes->get_sort_value(idx);
 }
 
 void
@@ -547,8 +545,8 @@ t_stree::unnest_strands_row(std::vector<const t_column*>& piv_fcols, t_build_str
     t_uindex num_rows = 1;
     std::vector<t_uindex> cell_unnest_size(rv.m_pivot_like_columns.size());
     for (t_uindex cidx = 0, loop_end = rv.m_pivot_like_columns.size(); cidx < loop_end; ++cidx) {
-        t_tscalar value = piv_fcols[cidx]->get_scalar(row_idx);
-        cell_unnest_size[cidx] = value.m_list_size > 0 ? value.m_list_size : 1;
+        t_uindex list_size = piv_fcols[cidx]->get_list_size(row_idx);
+        cell_unnest_size[cidx] = list_size > 0 ? list_size : 1;
         num_rows *= cell_unnest_size[cidx];
     }
 
@@ -573,7 +571,8 @@ t_stree::unnest_strands_row(std::vector<const t_column*>& piv_fcols, t_build_str
             for (t_uindex uidx = 0; uidx < cell_unnest_size[cidx]; ++uidx) {
                 for (t_uindex adix = 0; adix < num_rows_after; ++adix) {
                     unnest_piv_scols[cidx]->push_back(piv_fcols[cidx]->get_unnest_scalar(row_idx, uidx, agg_level_vec[cidx],
-                        binning_vec[cidx], unnest_piv_scols[cidx]->get_data_format_type(), default_binning_vec[cidx]));
+                        binning_vec[cidx], unnest_piv_scols[cidx]->get_data_format_type(), default_binning_vec[cidx],
+                        m_symtable));
                 }
             }
         }
@@ -670,7 +669,7 @@ t_stree::format_pivot_scalar(t_tscalar value, t_agg_level_type agg_level, t_binn
             if (agg_level != AGG_LEVEL_NONE) {
                 t_tscalar rv;
                 std::string str = value.to_agg_level_string(agg_level);
-                rv.set(get_interned_tscalar(str.c_str()));
+                rv.set(m_symtable.get_interned_tscalar(str.c_str()));
                 return rv;
             } else {
                 return value;
@@ -850,6 +849,84 @@ t_stree::build_strand_table(const t_table& flattened, const t_table& delta, cons
     return std::pair<std::shared_ptr<t_table>, std::shared_ptr<t_table>>(strands, aggs);
 }
 
+std::set<std::string>
+t_stree::get_delta_aggregates(const t_table& flattened, const t_table& delta,
+    const t_table& prev, const t_table& existed, const t_config& config) const {
+    std::set<std::string> rval;
+
+    // nodes only show some of their rows under previous filters, and an
+    // unnested row is counted in each of its leaves
+    if (config.has_previous_filters()) {
+        return rval;
+    }
+
+    const t_schema& fschema = flattened.get_schema();
+    for (const auto& piv : m_pivots) {
+        const std::string& colname = piv.colname();
+        if (fschema.has_column(colname) && is_dtype_list(fschema.get_dtype(colname))) {
+            return rval;
+        }
+    }
+
+    const t_column* op_col = flattened.get_const_column("psp_op").get();
+    const t_column* existed_col = existed.get_const_column("psp_existed").get();
+
+    for (const auto& spec : m_aggspecs) {
+        switch (spec.agg()) {
+            case AGGTYPE_COUNT: {
+                rval.insert(spec.name());
+            } break;
+            case AGGTYPE_PCT_SUM_PARENT:
+            case AGGTYPE_PCT_SUM_GRAND_TOTAL:
+            case AGGTYPE_SUM:
+            case AGGTYPE_MEAN: {
+                const std::string& colname = m_schema.get_tbl_colname(spec.get_dependencies()[0].name());
+                if (!fschema.has_column(colname) || !delta.get_schema().has_column(colname)
+                    || !prev.get_schema().has_column(colname)) {
+                    continue;
+                }
+
+                t_dtype dtype = fschema.get_dtype(colname);
+                if (!is_numeric_type(dtype) || dtype == DTYPE_FLOAT32 || dtype == DTYPE_UINT64) {
+                    continue;
+                }
+
+                const t_column* fcol = flattened.get_const_column(colname).get();
+                const t_column* pcol = prev.get_const_column(colname).get();
+                const t_column* dcol = delta.get_const_column(colname).get();
+
+                // Deltas of null cells are zero while the rows keep or clear
+                // their values, and integer deltas are taken in the type of
+                // the column, where they can wrap
+                bool exact = true;
+                for (t_uindex idx = 0, loop_end = flattened.size(); exact && idx < loop_end;
+                     ++idx) {
+                    bool row_existed = *(existed_col->get_nth<bool>(idx));
+                    bool is_delete = *(op_col->get_nth<std::uint8_t>(idx)) == OP_DELETE;
+
+                    if (row_existed && !pcol->is_valid(idx)) {
+                        exact = false;
+                    } else if (!is_delete && !fcol->is_valid(idx)) {
+                        exact = false;
+                    } else if (dtype != DTYPE_FLOAT64) {
+                        std::int64_t cval = is_delete ? 0 : fcol->get_scalar(idx).to_int64();
+                        std::int64_t pval = row_existed ? pcol->get_scalar(idx).to_int64() : 0;
+                        exact = dcol->get_scalar(idx).to_int64() == cval - pval;
+                    }
+                }
+
+                if (exact) {
+                    rval.insert(spec.name());
+                }
+            } break;
+            default:
+                break;
+        }
+    }
+
+    return rval;
+}
+
 // can contain additional rows
 // notably pivot changed rows will be added
 std::pair<std::shared_ptr<t_table>, std::shared_ptr<t_table>>
@@ -1189,6 +1266,7 @@ t_stree::update_shape_from_static(const t_dtree_ctx& ctx, t_config& config) {
 
     m_newids.clear();
     m_newleaves.clear();
+    m_npkeys_deltas.clear();
     m_tree_unification_records.clear();
 
     const std::shared_ptr<const t_column> scount
@@ -1203,11 +1281,8 @@ t_stree::update_shape_from_static(const t_dtree_ctx& ctx, t_config& config) {
     t_filter filter;
 
     // update root
-    auto root_iter = m_nodes->get<by_idx>().find(0);
-    auto root_node = *root_iter;
-    t_index root_nstrands = *(scount->get_nth<t_index>(0)) + root_node.m_nstrands;
-    root_node.set_nstrands(root_nstrands);
-    m_nodes->get<by_idx>().replace(root_iter, root_node);
+    t_index root_nstrands = *(scount->get_nth<t_index>(0)) + m_nodes->get_nstrands(0);
+    m_nodes->set_nstrands(0, root_nstrands);
 
     t_tree_unify_rec unif_rec(0, 0, 0, root_nstrands);
     m_tree_unification_records.push_back(unif_rec);
@@ -1247,15 +1322,15 @@ t_stree::update_shape_from_static(const t_dtree_ctx& ctx, t_config& config) {
 
         t_uindex src_ridx = dptidx;
 
-        auto iter = m_nodes->get<by_pidx_hash>().find(std::make_tuple(p_sptidx, value));
+        t_index child_idx = m_nodes->find_child(p_sptidx, value);
 
         auto nstrands = *(scount->get_nth<std::int64_t>(dptidx));
 
-        if (iter == m_nodes->get<by_pidx_hash>().end() && nstrands < 0) {
+        if (child_idx == INVALID_INDEX && nstrands < 0) {
             continue;
         }
 
-        if (iter == m_nodes->get<by_pidx_hash>().end()) {
+        if (child_idx == INVALID_INDEX) {
             // create node and enqueue
             sptidx = genidx();
             t_uindex aggsize = m_aggregates->size();
@@ -1275,32 +1350,27 @@ t_stree::update_shape_from_static(const t_dtree_ctx& ctx, t_config& config) {
                 m_newleaves.insert(sptidx);
             }
 
-            auto insert_pair = m_nodes->insert(node);
-            if (!insert_pair.second) {
-                auto failed_because = *(insert_pair.first);
-                std::cout << "failed because of " << failed_because << std::endl;
+            bool inserted = m_nodes->insert(node);
+            if (!inserted) {
+                std::cout << "failed because of " << node << std::endl;
             }
-            PSP_VERBOSE_ASSERT(insert_pair.second, "Failed to insert node");
+            PSP_VERBOSE_ASSERT(inserted, "Failed to insert node");
             t_tree_unify_rec unif_rec(sptidx, src_ridx, dst_ridx, nstrands);
             m_tree_unification_records.push_back(unif_rec);
         } else {
-            sptidx = iter->m_idx;
+            sptidx = child_idx;
 
             // update node
-            t_tnode node = *iter;
-            node.set_sort_value(sortby_value);
+            m_nodes->set_sort_value(sptidx, sortby_value);
 
-            t_uindex dst_ridx = node.m_aggidx;
+            t_uindex dst_ridx = m_nodes->get_aggidx(sptidx);
 
-            nstrands = node.m_nstrands + nstrands;
+            nstrands = m_nodes->get_nstrands(sptidx) + nstrands;
 
             t_tree_unify_rec unif_rec(sptidx, src_ridx, dst_ridx, nstrands);
             m_tree_unification_records.push_back(unif_rec);
 
-            sptidx = iter->m_idx;
-            node.set_nstrands(nstrands);
-            PSP_VERBOSE_ASSERT(m_nodes->get<by_pidx_hash>().replace(iter, node), ,
-                "Failed to replace"); // middle argument ignored
+            m_nodes->set_nstrands(sptidx, nstrands);
         }
 
         populate_pkey_idx(ctx, dtree, dptidx, sptidx, ndepth, new_idx_pkey);
@@ -1317,8 +1387,7 @@ t_stree::update_shape_from_static(const t_dtree_ctx& ctx, t_config& config) {
     auto eiter = new_idx_pkey.get<by_idx_pkey>().end();
 
     for (auto iter = biter; iter != eiter; ++iter) {
-        t_stpkey s(iter->m_idx, iter->m_pkey);
-        m_idxpkey->insert(s);
+        add_pkey(iter->m_idx, iter->m_pkey);
     }
 
     mark_zero_desc();
@@ -1335,15 +1404,13 @@ t_stree::mark_zero_desc() {
     }
 
     for (auto n : z_desc) {
-        auto iter = m_nodes->get<by_idx>().find(n);
-        auto node = *iter;
-        node.set_nstrands(0);
-        m_nodes->get<by_idx>().replace(iter, node);
+        m_nodes->set_nstrands(n, 0);
     }
 }
 
 void
-t_stree::update_aggs_from_static(const t_dtree_ctx& ctx, const t_gstate& gstate, t_config& config) {
+t_stree::update_aggs_from_static(const t_dtree_ctx& ctx, const t_gstate& gstate, t_config& config,
+    const std::set<std::string>& delta_aggregates) {
     // Set default for saved save mask
     const t_dtree& dtree = ctx.get_tree();
     std::int32_t dt_size = dtree.size();
@@ -1357,6 +1424,8 @@ t_stree::update_aggs_from_static(const t_dtree_ctx& ctx, const t_gstate& gstate,
         agg_update_info.m_src.push_back(src_aggtable.get_const_column(colname).get());
         agg_update_info.m_dst.push_back(m_aggregates->get_column(colname).get());
         agg_update_info.m_aggspecs.push_back(ctx.get_aggspec(colname));
+        agg_update_info.m_from_deltas.push_back(
+            delta_aggregates.find(colname) != delta_aggregates.end());
     }
 
     auto is_col_scaled_aggregate = [&](int col_idx) -> bool {
@@ -1411,7 +1480,11 @@ t_stree::update_aggs_from_static(const t_dtree_ctx& ctx, const t_gstate& gstate,
     std::int32_t total = m_tree_unification_records.size();
     std::int32_t percentage = 0;
     std::int32_t prev_percentage = 0;
-    for (const auto& r : m_tree_unification_records) {
+    // Children before parents, so sketches of parents merge up to date
+    // sketches of their children
+    for (auto riter = m_tree_unification_records.rbegin();
+         riter != m_tree_unification_records.rend(); ++riter) {
+        const auto& r = *riter;
         if (!node_exists(r.m_sptidx)) {
             continue;
         }
@@ -1453,7 +1526,6 @@ t_stree::update_tree_from_combined_field(const t_dtree_ctx& ctx, t_config& confi
     }*/
 
     auto combined_idx = config.get_combined_field().m_combined_index;
-    std::shared_ptr<t_treenodes> new_nodes;
     std::map<std::int32_t, std::int32_t> parent_idx_map;
     parent_idx_map[0] = 0;
     for (t_index curidx = 0, tsize = size(); curidx < tsize; ++curidx) {
@@ -1853,18 +1925,7 @@ t_stree::genidx() {
 
 std::vector<t_uindex>
 t_stree::get_children(t_uindex idx) const {
-    t_by_pidx_ipair iterators = m_nodes->get<by_pidx>().equal_range(idx);
-
-    t_uindex nchild = std::distance(iterators.first, iterators.second);
-
-    std::vector<t_uindex> temp(nchild);
-
-    t_index count = 0;
-    for (iter_by_pidx iter = iterators.first; iter != iterators.second; ++iter) {
-        temp[count] = iter->m_idx;
-        ++count;
-    }
-    return temp;
+    return std::vector<t_uindex>(m_nodes->children_begin(idx), m_nodes->children_end(idx));
 }
 
 t_uindex
@@ -1875,16 +1936,18 @@ t_stree::size() const {
 void
 t_stree::get_child_nodes(t_uindex idx, t_tnodevec& nodes) const {
     t_index num_children = get_num_children(idx);
-    t_tnodevec temp(num_children);
-    auto iterators = m_nodes->get<by_pidx>().equal_range(idx);
-    std::copy(iterators.first, iterators.second, temp.begin());
+    t_tnodevec temp;
+    temp.reserve(num_children);
+    for (auto iter = m_nodes->children_begin(idx), end = m_nodes->children_end(idx);
+         iter != end; ++iter) {
+        temp.push_back(m_nodes->get(*iter));
+    }
     std::swap(nodes, temp);
 }
 
 t_uindex
 t_stree::get_num_children(t_uindex ptidx) const {
-    auto iterators = m_nodes->get<by_pidx>().equal_range(ptidx);
-    return std::distance(iterators.first, iterators.second);
+    return m_nodes->get_num_children(ptidx);
 }
 
 t_uindex
@@ -1906,6 +1969,49 @@ t_stree::gen_aggidx() {
     return rval;
 }
 
+template <typename SKETCH_T>
+const SKETCH_T&
+t_stree::update_sketch(t_uindex nidx, t_uindex aggidx, std::vector<SKETCH_T>& sketches,
+    const std::string& tbl_colname, bool has_previous_filters, t_period_type period_type,
+    const t_gstate& gstate) {
+    if (sketches.size() <= aggidx) {
+        sketches.resize(aggidx + 1);
+    }
+
+    // Previous filters select pkeys per node, so merging is only valid
+    // without them. A child without a sketch falls back to the pkeys too.
+    SKETCH_T sketch;
+    bool merged = !has_previous_filters && !is_leaf(nidx);
+    if (merged) {
+        for (auto cidx : get_child_idx(nidx)) {
+            if (m_nodes->get_npkeys(cidx) == 0) {
+                continue;
+            }
+            t_uindex caggidx = m_nodes->get_aggidx(cidx);
+            if (caggidx >= sketches.size() || sketches[caggidx].empty()) {
+                merged = false;
+                break;
+            }
+            sketch.merge(sketches[caggidx]);
+        }
+    }
+
+    if (!merged) {
+        sketch = SKETCH_T();
+        auto pkeys = get_show_pkeys(nidx, has_previous_filters, period_type);
+        if (pkeys.size() > 0) {
+            std::vector<t_tscalar> values;
+            gstate.read_column(tbl_colname, pkeys, values);
+            for (const auto& v : values) {
+                sketch.add(v);
+            }
+        }
+    }
+
+    sketches[aggidx] = std::move(sketch);
+    return sketches[aggidx];
+}
+
 void
 t_stree::update_agg_table(t_uindex nidx, t_agg_update_info& info, t_uindex src_ridx,
     t_uindex dst_ridx, t_index nstrands, const t_gstate& gstate, const t_config& config) {
@@ -1928,6 +2034,24 @@ t_stree::update_agg_table(t_uindex nidx, t_agg_update_info& info, t_uindex src_r
             case AGGTYPE_PCT_SUM_PARENT:
             case AGGTYPE_PCT_SUM_GRAND_TOTAL:
             case AGGTYPE_SUM: {
+                if (info.m_from_deltas[idx] && m_nodes->get_npkeys(nidx) > 0
+                    && m_newids.find(nidx) == m_newids.end()) {
+                    // src holds the sum of the deltas under the node, a NaN
+                    // sum can only become finite again by summing the rows
+                    t_tscalar src_scalar = src->get_scalar(src_ridx);
+                    t_tscalar dst_scalar = dst->get_scalar(dst_ridx);
+                    if (dst_scalar.is_valid() && !dst_scalar.is_nan() && !src_scalar.is_nan()) {
+                        auto agg_col_name_type = spec.get_output_specs(m_schema)[0];
+                        if (agg_col_name_type.m_type == DTYPE_INT64) {
+                            new_value.set(dst_scalar.to_int64() + src_scalar.to_int64());
+                        } else {
+                            new_value.set(dst_scalar.to_double() + src_scalar.to_double());
+                        }
+                        dst->set_scalar(dst_ridx, new_value);
+                        break;
+                    }
+                }
+
                 /*t_tscalar src_scalar = src->get_scalar(src_ridx);
                 t_tscalar dst_scalar = dst->get_scalar(dst_ridx);
                 old_value.set(dst_scalar);
@@ -1966,6 +2090,18 @@ t_stree::update_agg_table(t_uindex nidx, t_agg_update_info& info, t_uindex src_r
                 } else {
                     new_value.set(nstrands);
                 }*/
+                if (info.m_from_deltas[idx]) {
+                    t_index npkeys = m_nodes->get_npkeys(nidx);
+                    if (npkeys > 0) {
+                        new_value.set(npkeys);
+                    } else {
+                        auto agg_col_name_type = spec.get_output_specs(m_schema)[0];
+                        new_value = mknull(agg_col_name_type.m_type);
+                    }
+                    dst->set_scalar(dst_ridx, new_value);
+                    break;
+                }
+
                 auto pkeys = get_show_pkeys(nidx, has_previous_filters, period_type);
                 if (pkeys.size() > 0) {
                     new_value.set(t_index(pkeys.size()));
@@ -1977,6 +2113,28 @@ t_stree::update_agg_table(t_uindex nidx, t_agg_update_info& info, t_uindex src_r
                 dst->set_scalar(dst_ridx, new_value);
             } break;
             case AGGTYPE_MEAN: {
+                if (info.m_from_deltas[idx] && m_nodes->get_npkeys(nidx) > 0
+                    && m_newids.find(nidx) == m_newids.end() && dst->is_valid(dst_ridx)) {
+                    // the rows of the update are all valid, so the count of
+                    // the mean moves with the primary keys of the node
+                    const std::pair<double, double>* src_pair
+                        = src->get_nth<std::pair<double, double>>(src_ridx);
+                    std::pair<double, double>* dst_pair
+                        = dst->get_nth<std::pair<double, double>>(dst_ridx);
+                    double nr = dst_pair->first + src_pair->first;
+                    double dr = dst_pair->second + m_npkeys_deltas[nidx];
+
+                    if (dr > 0 && !std::isnan(dst_pair->first) && !std::isnan(src_pair->first)) {
+                        old_value.set(dst_pair->first / dst_pair->second);
+
+                        dst_pair->first = nr;
+                        dst_pair->second = dr;
+
+                        new_value.set(nr / dr);
+                        break;
+                    }
+                }
+
                 //auto pkeys = get_pkeys(nidx);
                 auto pkeys = get_show_pkeys(nidx, has_previous_filters, period_type);
 
@@ -2423,6 +2581,34 @@ t_stree::update_agg_table(t_uindex nidx, t_agg_update_info& info, t_uindex src_r
 
                 dst->set_scalar(dst_ridx, new_value);
             } break;
+            case AGGTYPE_APPROX_MEDIAN: {
+                const std::string& tbl_colname = m_schema.get_tbl_colname(spec.get_dependencies()[0].name());
+                const t_quantile_sketch& sketch = update_sketch(nidx, dst_ridx,
+                    m_quantile_sketches[idx], tbl_colname, has_previous_filters, period_type, gstate);
+
+                if (!sketch.empty()) {
+                    new_value.set(sketch.quantile(0.5, dst->get_dtype()));
+                } else {
+                    auto agg_col_name_type = spec.get_output_specs(m_schema)[0];
+                    new_value = mknull(agg_col_name_type.m_type);
+                }
+
+                dst->set_scalar(dst_ridx, new_value);
+            } break;
+            case AGGTYPE_APPROX_DISTINCT_COUNT: {
+                const std::string& tbl_colname = m_schema.get_tbl_colname(spec.get_dependencies()[0].name());
+                const t_distinct_sketch& sketch = update_sketch(nidx, dst_ridx,
+                    m_distinct_sketches[idx], tbl_colname, has_previous_filters, period_type, gstate);
+
+                if (!sketch.empty()) {
+                    new_value.set(std::uint32_t(sketch.estimate()));
+                } else {
+                    auto agg_col_name_type = spec.get_output_specs(m_schema)[0];
+                    new_value = mknull(agg_col_name_type.m_type);
+                }
+
+                dst->set_scalar(dst_ridx, new_value);
+            } break;
             case AGGTYPE_DISTINCT_LEAF: {
                 //auto pkeys = get_pkeys(nidx);
                 auto pkeys = get_show_pkeys(nidx, has_previous_filters, period_type);
@@ -2634,6 +2820,24 @@ t_stree::update_agg_table_with_having(t_uindex nidx, t_agg_update_info& info, t_
             case AGGTYPE_PCT_SUM_PARENT:
             case AGGTYPE_PCT_SUM_GRAND_TOTAL:
             case AGGTYPE_SUM: {
+                if (info.m_from_deltas[idx] && m_nodes->get_npkeys(nidx) > 0
+                    && m_newids.find(nidx) == m_newids.end()) {
+                    // src holds the sum of the deltas under the node, a NaN
+                    // sum can only become finite again by summing the rows
+                    t_tscalar src_scalar = src->get_scalar(src_ridx);
+                    t_tscalar dst_scalar = dst->get_scalar(dst_ridx);
+                    if (dst_scalar.is_valid() && !dst_scalar.is_nan() && !src_scalar.is_nan()) {
+                        auto agg_col_name_type = spec.get_output_specs(m_schema)[0];
+                        if (agg_col_name_type.m_type == DTYPE_INT64) {
+                            new_value.set(dst_scalar.to_int64() + src_scalar.to_int64());
+                        } else {
+                            new_value.set(dst_scalar.to_double() + src_scalar.to_double());
+                        }
+                        dst->set_scalar(dst_ridx, new_value);
+                        break;
+                    }
+                }
+
                 /*t_tscalar src_scalar = src->get_scalar(src_ridx);
                 t_tscalar dst_scalar = dst->get_scalar(dst_ridx);
                 old_value.set(dst_scalar);
@@ -3100,6 +3304,49 @@ t_stree::update_agg_table_with_having(t_uindex nidx, t_agg_update_info& info, t_
 
                 dst->set_scalar(dst_ridx, new_value);
             } break;
+            case AGGTYPE_APPROX_MEDIAN: {
+                auto pkeys_set = get_current_pkeys(nidx, period_type);
+                std::vector<t_tscalar> pkeys(pkeys_set.begin(), pkeys_set.end());
+
+                t_quantile_sketch sketch;
+                if (pkeys.size() > 0) {
+                    const std::string& tbl_colname = m_schema.get_tbl_colname(spec.get_dependencies()[0].name());
+                    std::vector<t_tscalar> values;
+                    gstate.read_column(tbl_colname, pkeys, values);
+                    for (const auto& v : values) {
+                        sketch.add(v);
+                    }
+                }
+
+                if (!sketch.empty()) {
+                    new_value.set(sketch.quantile(0.5, dst->get_dtype()));
+                } else {
+                    auto agg_col_name_type = spec.get_output_specs(m_schema)[0];
+                    new_value = mknull(agg_col_name_type.m_type);
+                }
+
+                dst->set_scalar(dst_ridx, new_value);
+            } break;
+            case AGGTYPE_APPROX_DISTINCT_COUNT: {
+                auto pkeys_set = get_current_pkeys(nidx, period_type);
+                std::vector<t_tscalar> pkeys(pkeys_set.begin(), pkeys_set.end());
+
+                if (pkeys.size() > 0) {
+                    const std::string& tbl_colname = m_schema.get_tbl_colname(spec.get_dependencies()[0].name());
+                    std::vector<t_tscalar> values;
+                    gstate.read_column(tbl_colname, pkeys, values);
+                    t_distinct_sketch sketch;
+                    for (const auto& v : values) {
+                        sketch.add(v);
+                    }
+                    new_value.set(std::uint32_t(sketch.estimate()));
+                } else {
+                    auto agg_col_name_type = spec.get_output_specs(m_schema)[0];
+                    new_value = mknull(agg_col_name_type.m_type);
+                }
+
+                dst->set_scalar(dst_ridx, new_value);
+            } break;
             case AGGTYPE_DISTINCT_LEAF: {
                 auto pkeys_set = get_current_pkeys(nidx, period_type);
                 std::vector<t_tscalar> pkeys(pkeys_set.begin(), pkeys_set.end());
@@ -3219,20 +3466,7 @@ std::cout << "computed specs-----2-----" << std::endl;
 
 std::vector<t_uindex>
 t_stree::zero_strands() const {
-    auto iterators = m_nodes->get<by_nstrands>().equal_range(0);
-    std::vector<t_uindex> rval;
-
-    // GAB: memory optim: do a first pass to compute the number of elements to be able to pre-reserve memory
-    t_index count = 0;
-    for (auto& iter = iterators.first; iter != iterators.second; ++iter) {
-        count++;
-    }
-
-    rval.reserve(count);
-    for (auto& iter = iterators.first; iter != iterators.second; ++iter) {
-        rval.push_back(iter->m_idx);
-    }
-    return rval;
+    return m_nodes->zero_strands();
 }
 
 std::set<t_uindex>
@@ -3265,12 +3499,11 @@ t_stree::non_zero_ids(
 
 t_uindex
 t_stree::get_parent_idx(t_uindex ptidx) const {
-    iter_by_idx iter = m_nodes->get<by_idx>().find(ptidx);
-    if (iter == m_nodes->get<by_idx>().end()) {
+    if (!m_nodes->contains(ptidx)) {
         std::cout << "Failed in tree => " << repr() << std::endl;
         PSP_VERBOSE_ASSERT(false, "Did not find node");
     }
-    return iter->m_pidx;
+    return m_nodes->get_pidx(ptidx);
 }
 
 std::vector<t_uindex>
@@ -3299,16 +3532,14 @@ t_stree::get_ancestry(t_uindex idx) const {
 
 t_index
 t_stree::get_sibling_idx(t_index p_ptidx, t_index p_nchild, t_uindex c_ptidx) const {
-    t_by_pidx_ipair iterators = m_nodes->get<by_pidx>().equal_range(p_ptidx);
-    iter_by_pidx c_iter = m_nodes->project<by_pidx>(m_nodes->get<by_idx>().find(c_ptidx));
-    return std::distance(iterators.first, c_iter);
+    auto begin = m_nodes->children_begin(p_ptidx);
+    return std::find(begin, m_nodes->children_end(p_ptidx), c_ptidx) - begin;
 }
 
 t_uindex
 t_stree::get_aggidx(t_uindex idx) const {
-    iter_by_idx iter = m_nodes->get<by_idx>().find(idx);
-    PSP_VERBOSE_ASSERT(iter != m_nodes->get<by_idx>().end(), "Failed in get_aggidx");
-    return iter->m_aggidx;
+    PSP_VERBOSE_ASSERT(m_nodes->contains(idx), "Failed in get_aggidx");
+    return m_nodes->get_aggidx(idx);
 }
 
 std::shared_ptr<const t_table>
@@ -3328,9 +3559,8 @@ t_stree::_get_aggtable() {
 
 t_stree::t_tnode
 t_stree::get_node(t_uindex idx) const {
-    iter_by_idx iter = m_nodes->get<by_idx>().find(idx);
-    PSP_VERBOSE_ASSERT(iter != m_nodes->get<by_idx>().end(), "Failed in get_node");
-    return *iter;
+    PSP_VERBOSE_ASSERT(m_nodes->contains(idx), "Failed in get_node");
+    return m_nodes->get(idx);
 }
 
 void
@@ -3341,11 +3571,10 @@ t_stree::get_path(t_uindex idx, std::vector<t_tscalar>& rval) const {
         return;
 
     while (1) {
-        auto iter = m_nodes->get<by_idx>().find(curidx);
-        //rval.push_back(iter->m_value);
-        auto value = format_with_binning(iter->m_value, curidx);
+        //rval.push_back(m_nodes->get_value(curidx));
+        auto value = format_with_binning(m_nodes->get_value(curidx), curidx);
         rval.push_back(value);
-        curidx = iter->m_pidx;
+        curidx = m_nodes->get_pidx(curidx);
         if (curidx == 0) {
             break;
         }
@@ -3355,13 +3584,7 @@ t_stree::get_path(t_uindex idx, std::vector<t_tscalar>& rval) const {
 
 t_uindex
 t_stree::resolve_child(t_uindex root, const t_tscalar& datum) const {
-    auto iter = m_nodes->get<by_pidx_hash>().find(std::make_tuple(root, datum));
-
-    if (iter == m_nodes->get<by_pidx_hash>().end()) {
-        return INVALID_INDEX;
-    }
-
-    return iter->m_idx;
+    return m_nodes->find_child(root, datum);
 }
 
 void
@@ -3373,12 +3596,28 @@ t_stree::clear_aggregates(const std::vector<t_uindex>& indices) {
         }
     }
 
+    for (auto& it : m_quantile_sketches) {
+        for (auto aggidx : indices) {
+            if (aggidx < it.second.size()) {
+                it.second[aggidx] = t_quantile_sketch();
+            }
+        }
+    }
+
+    for (auto& it : m_distinct_sketches) {
+        for (auto aggidx : indices) {
+            if (aggidx < it.second.size()) {
+                it.second[aggidx] = t_distinct_sketch();
+            }
+        }
+    }
+
     m_agg_freelist.insert(std::end(m_agg_freelist), std::begin(indices), std::end(indices));
 }
 
 void
 t_stree::drop_zero_strands() {
-    auto iterators = m_nodes->get<by_nstrands>().equal_range(0);
+    auto zeros = m_nodes->zero_strands();
 
     std::vector<t_uindex> leaves;
 
@@ -3386,10 +3625,10 @@ t_stree::drop_zero_strands() {
 
     std::vector<t_uindex> node_ids;
 
-    for (auto iter = iterators.first; iter != iterators.second; ++iter) {
-        if (iter->m_depth == lst)
-            leaves.push_back(iter->m_idx);
-        node_ids.push_back(iter->m_aggidx);
+    for (auto idx : zeros) {
+        if (m_nodes->get_depth(idx) == lst)
+            leaves.push_back(idx);
+        node_ids.push_back(m_nodes->get_aggidx(idx));
     }
 
     clear_aggregates(node_ids);
@@ -3404,15 +3643,15 @@ t_stree::drop_zero_strands() {
         }
     }
 
-    auto iterators2 = m_nodes->get<by_nstrands>().equal_range(0);
-
-    m_nodes->get<by_nstrands>().erase(iterators2.first, iterators2.second);
+    m_nodes->erase(zeros);
 }
 
 void
 t_stree::add_pkey(t_uindex idx, t_tscalar pkey) {
     t_stpkey s(idx, pkey);
-    m_idxpkey->insert(s);
+    if (m_idxpkey->insert(s).second) {
+        update_npkeys(idx, 1);
+    }
 }
 
 void
@@ -3423,6 +3662,17 @@ t_stree::remove_pkey(t_uindex idx, t_tscalar pkey) {
         return;
 
     m_idxpkey->get<by_idx_pkey>().erase(iter);
+    update_npkeys(idx, -1);
+}
+
+void
+t_stree::update_npkeys(t_uindex idx, t_index delta) {
+    t_uindex rpidx = root_pidx();
+    while (idx != rpidx) {
+        m_nodes->set_npkeys(idx, m_nodes->get_npkeys(idx) + delta);
+        m_npkeys_deltas[idx] += delta;
+        idx = m_nodes->get_pidx(idx);
+    }
 }
 
 void
@@ -3562,8 +3812,7 @@ t_stree::get_leaves(t_uindex idx) const {
 
 t_depth
 t_stree::get_depth(t_uindex ptidx) const {
-    auto iter = m_nodes->get<by_idx>().find(ptidx);
-    return iter->m_depth;
+    return m_nodes->get_depth(ptidx);
 }
 
 t_binning_info
@@ -3581,7 +3830,7 @@ t_stree::format_with_binning(t_tscalar value, t_uindex idx) const {
     if (binning_info.type == BINNING_TYPE_NONE) {
         return value;
     }
-    return get_interned_tscalar(value.formatted_with_binning(binning_info));
+    return m_symtable.get_interned_tscalar(value.formatted_with_binning(binning_info));
 }
 
 void
@@ -3615,29 +3864,16 @@ t_stree::get_drd_indices(
 
 std::vector<t_uindex>
 t_stree::get_child_idx(t_uindex idx) const {
-    t_index num_children = get_num_children(idx);
-    std::vector<t_uindex> children(num_children);
-    auto iterators = m_nodes->get<by_pidx>().equal_range(idx);
-    t_index count = 0;
-    while (iterators.first != iterators.second) {
-        children[count] = iterators.first->m_idx;
-        ++count;
-        ++iterators.first;
-    }
-    return children;
+    return std::vector<t_uindex>(m_nodes->children_begin(idx), m_nodes->children_end(idx));
 }
 
 std::vector<std::pair<t_index, t_index>>
 t_stree::get_child_idx_depth(t_uindex idx) const {
     t_index num_children = get_num_children(idx);
     std::vector<std::pair<t_index, t_index>> children(num_children);
-    auto iterators = m_nodes->get<by_pidx>().equal_range(idx);
-    t_index count = 0;
-    while (iterators.first != iterators.second) {
-        children[count]
-            = std::pair<t_index, t_index>(iterators.first->m_idx, iterators.first->m_depth);
-        ++count;
-        ++iterators.first;
+    auto iter = m_nodes->children_begin(idx);
+    for (t_index count = 0; count < num_children; ++count, ++iter) {
+        children[count] = std::pair<t_index, t_index>(*iter, m_nodes->get_depth(*iter));
     }
     return children;
 }
@@ -3663,9 +3899,8 @@ t_stree::last_level() const {
 
 bool
 t_stree::is_leaf(t_uindex nidx) const {
-    auto iter = m_nodes->get<by_idx>().find(nidx);
-    PSP_VERBOSE_ASSERT(iter != m_nodes->get<by_idx>().end(), "Did not find node");
-    return iter->m_depth == last_level();
+    PSP_VERBOSE_ASSERT(m_nodes->contains(nidx), "Did not find node");
+    return m_nodes->get_depth(nidx) == last_level();
 }
 
 std::vector<t_uindex>
@@ -3709,12 +3944,10 @@ t_stree::resolve_path(t_uindex root, const std::vector<t_tscalar>& path) const {
         return curidx;
 
     for (t_index i = path.size() - 1; i >= 0; i--) {
-        iter_by_pidx_hash iter
-            = m_nodes->get<by_pidx_hash>().find(std::make_tuple(curidx, path[i]));
-        if (iter == m_nodes->get<by_pidx_hash>().end()) {
+        curidx = m_nodes->find_child(curidx, path[i]);
+        if (curidx == INVALID_INDEX) {
             return INVALID_INDEX;
         }
-        curidx = iter->m_idx;
     }
 
     return curidx;
@@ -3803,14 +4036,7 @@ t_stree::get_aggregate(t_index idx, t_index aggnum) const {
 
 void
 t_stree::get_child_indices(t_index idx, std::vector<t_index>& out_data) const {
-    t_index num_children = get_num_children(idx);
-    std::vector<t_index> temp(num_children);
-    t_by_pidx_ipair iterators = m_nodes->get<by_pidx>().equal_range(idx);
-    t_index count = 0;
-    for (iter_by_pidx iter = iterators.first; iter != iterators.second; ++iter) {
-        temp[count] = iter->m_idx;
-        ++count;
-    }
+    std::vector<t_index> temp(m_nodes->children_begin(idx), m_nodes->children_end(idx));
     std::swap(out_data, temp);
 }
 
@@ -3823,6 +4049,8 @@ t_stree::clear_deltas() {
 void
 t_stree::clear() {
     m_nodes->clear();
+    m_quantile_sketches.clear();
+    m_distinct_sketches.clear();
     clear_deltas();
 }
 
@@ -3848,19 +4076,27 @@ t_stree::set_feature_state(t_ctx_feature feature, bool state) {
 
 t_minmax
 t_stree::get_agg_min_max(t_uindex aggidx, t_depth depth) const {
-    auto iterators = m_nodes->get<by_depth>().equal_range(depth);
-    return get_agg_min_max(iterators.first, iterators.second, aggidx);
+    std::vector<t_uindex> ids;
+    for (t_uindex idx = 0, loop_end = m_nodes->id_end(); idx < loop_end; ++idx) {
+        if (m_nodes->contains(idx) && m_nodes->get_depth(idx) == depth) {
+            ids.push_back(idx);
+        }
+    }
+    return get_agg_min_max(ids.begin(), ids.end(), aggidx);
 }
 
 std::vector<t_minmax>
 t_stree::get_min_max() const {
     t_uindex naggs = m_aggspecs.size();
     std::vector<t_minmax> rval(naggs);
+    std::vector<t_uindex> ids;
+    for (t_uindex idx = 0, loop_end = m_nodes->id_end(); idx < loop_end; ++idx) {
+        if (m_nodes->contains(idx)) {
+            ids.push_back(idx);
+        }
+    }
     for (t_uindex cidx = 0; cidx < naggs; ++cidx) {
-
-        auto biter = m_nodes->get<by_idx>().begin();
-        auto eiter = m_nodes->get<by_idx>().end();
-        rval[cidx] = get_agg_min_max(biter, eiter, cidx);
+        rval[cidx] = get_agg_min_max(ids.begin(), ids.end(), cidx);
     }
     return rval;
 }
@@ -3918,23 +4154,18 @@ t_stree::update_show_nodes(t_config config) {
     auto has_previous_filters = config.has_previous_filters();
     // Update show for all node
     for (t_index curidx = 1, tsize = size(); curidx < tsize; ++curidx) {
-        iter_by_idx iter = m_nodes->get<by_idx>().find(curidx);
-        auto node = *iter;
         auto pkeys = get_show_pkeys(curidx, has_previous_filters, PERIOD_TYPE_NONE);
-        if (pkeys.size() == 0) {
-            node.set_show(false);
-        } else {
-            node.set_show(true);
-        }
-        m_nodes->get<by_idx>().replace(iter, node);
+        m_nodes->set_show(curidx, pkeys.size() != 0);
     }
 }
 
 void
 t_stree::update_data_format_depth(std::map<t_depth, t_dataformattype> df_depth_map) {
     for (t_index curidx = 1, tsize = size(); curidx < tsize; ++curidx) {
-        iter_by_idx iter = m_nodes->get<by_idx>().find(curidx);
-        auto node = *iter;
+        if (!m_nodes->contains(curidx)) {
+            continue;
+        }
+        auto node = m_nodes->get(curidx);
         if (df_depth_map.find(node.m_depth) == df_depth_map.end()) {
             continue;
         }
@@ -3947,7 +4178,7 @@ t_stree::update_data_format_depth(std::map<t_depth, t_dataformattype> df_depth_m
         value.m_data_format_type = df_depth_map[node.m_depth];
         if (value.is_valid() && !value.is_error() && value.m_type == DTYPE_STR && (value.m_data_format_type == DATA_FORMAT_NUMBER
             || value.m_data_format_type == DATA_FORMAT_FINANCIAL || value.m_data_format_type == DATA_FORMAT_PERCENT)) {
-            value = get_interned_tscalar(value.format_binning_string(pre_df));
+            value = m_symtable.get_interned_tscalar(value.format_binning_string(pre_df));
             value.m_data_format_type = df_depth_map[node.m_depth];
         } else {
             t_dataformattype df = df_depth_map[node.m_depth];
@@ -3962,8 +4193,7 @@ t_stree::update_data_format_depth(std::map<t_depth, t_dataformattype> df_depth_m
                 value.m_data_format_type = df;
             }
         }
-        node.set_value(value);
-        m_nodes->get<by_idx>().replace(iter, node);
+        m_nodes->set_value(curidx, value);
     }
 }
 
@@ -4078,8 +4308,7 @@ t_stree::first_last_helper_with_pkeys(t_uindex nidx, const t_aggspec& spec, cons
 
 bool
 t_stree::node_exists(t_uindex idx) {
-    iter_by_idx iter = m_nodes->get<by_idx>().find(idx);
-    return iter != m_nodes->get<by_idx>().end();
+    return m_nodes->contains(idx);
 }
 
 t_table*
@@ -4087,7 +4316,7 @@ t_stree::get_aggtable() {
     return m_aggregates.get();
 }
 
-std::pair<iter_by_idx, bool>
+bool
 t_stree::insert_node(const t_tnode& node) {
     return m_nodes->insert(node);
 }
@@ -4107,10 +4336,9 @@ t_stree::get_sortby_path(t_uindex idx, std::vector<t_tscalar>& rval) const {
 
     //std::cout << "Path ==== " ;
     while (1) {
-        iter_by_idx iter = m_nodes->get<by_idx>().find(curidx);
-        //std::cout << iter->m_sort_value.to_string() << " ---> ";
-        rval.push_back(iter->m_sort_value);
-        curidx = iter->m_pidx;
+        //std::cout << m_nodes->get_sort_value(curidx).to_string() << " ---> ";
+        rval.push_back(m_nodes->get_sort_value(curidx));
+        curidx = m_nodes->get_pidx(curidx);
         if (curidx == 0) {
             break;
         }
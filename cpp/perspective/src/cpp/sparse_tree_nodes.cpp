@@ -0,0 +1,582 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/sparse_tree_nodes.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+
+namespace perspective {
+
+namespace {
+
+    const t_uindex EMPTY_SLOT = 0;
+    const t_uindex ERASED_SLOT = std::numeric_limits<t_uindex>::max();
+
+    inline std::uint64_t
+    mix(std::uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    inline std::uint64_t
+    combine(std::uint64_t h, std::uint64_t v) {
+        return mix(h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+    }
+
+    inline std::uint64_t
+    double_bits(double v) {
+        // -0 and 0 are equivalent, NaNs are not ordered
+        if (v == 0) {
+            v = 0;
+        } else if (v != v) {
+            v = std::numeric_limits<double>::quiet_NaN();
+        }
+        std::uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return bits;
+    }
+
+    inline bool
+    equivalent(const t_tscalar& a, const t_tscalar& b) {
+        return !(a < b) && !(b < a);
+    }
+
+} // namespace
+
+t_treenodes::t_treenodes()
+    : m_size(0)
+    , m_arena_garbage(0)
+    , m_nslots_used(0)
+    , m_nunsorted(0) {}
+
+t_treenodes::t_value
+t_treenodes::pack(const t_tscalar& s) {
+    t_value v;
+    v.m_data = s.m_data;
+    v.m_list_size = static_cast<std::uint32_t>(s.m_list_size);
+    v.m_type = static_cast<std::uint8_t>(s.m_type);
+    v.m_dftype = static_cast<std::uint8_t>(s.m_data_format_type);
+    v.m_status = static_cast<std::uint8_t>(s.m_status);
+    v.m_inplace = s.m_inplace;
+    return v;
+}
+
+t_tscalar
+t_treenodes::unpack(const t_value& v) {
+    t_tscalar s;
+    s.m_data = v.m_data;
+    s.m_list_size = v.m_list_size;
+    s.m_type = static_cast<t_dtype>(v.m_type);
+    s.m_data_format_type = static_cast<t_dataformattype>(v.m_dftype);
+    s.m_status = static_cast<t_status>(v.m_status);
+    s.m_inplace = v.m_inplace;
+    return s;
+}
+
+// Values equivalent under t_tscalar::operator< must hash alike: numeric types
+// compare across dtypes, invalid values are all equal and strings compare
+// case insensitively.
+std::uint64_t
+t_treenodes::hash_child(t_uindex pidx, const t_tscalar& value) {
+    t_dtype dtype = value.get_dtype();
+    std::uint64_t h = mix(pidx);
+    h = combine(h, is_numeric_type(dtype) ? std::uint64_t(0xff) : std::uint64_t(dtype));
+    h = combine(h, value.m_status);
+
+    if (!value.is_valid()) {
+        return h;
+    }
+
+    const t_scalar_u& d = value.m_data;
+    switch (dtype) {
+        case DTYPE_INT64: return combine(h, double_bits(double(d.m_int64)));
+        case DTYPE_INT32: return combine(h, double_bits(double(d.m_int32)));
+        case DTYPE_INT16: return combine(h, double_bits(double(d.m_int16)));
+        case DTYPE_INT8: return combine(h, double_bits(double(d.m_int8)));
+        case DTYPE_UINT64: return combine(h, double_bits(double(d.m_uint64)));
+        case DTYPE_UINT32: return combine(h, double_bits(double(d.m_uint32)));
+        case DTYPE_UINT16: return combine(h, double_bits(double(d.m_uint16)));
+        case DTYPE_UINT8: return combine(h, double_bits(double(d.m_uint8)));
+        case DTYPE_FLOAT64: return combine(h, double_bits(d.m_float64));
+        case DTYPE_FLOAT32: return combine(h, double_bits(double(d.m_float32)));
+        case DTYPE_DATE: return combine(h, std::uint64_t(std::uint32_t(d.m_int32)));
+        case DTYPE_TIME:
+        case DTYPE_DURATION: return combine(h, double_bits(d.m_float64));
+        case DTYPE_BOOL: return combine(h, std::uint64_t(d.m_bool));
+        case DTYPE_STR: {
+            for (const char* c = value.get_char_ptr(); *c != '\0'; ++c) {
+                h = (h ^ std::uint64_t(std::uint8_t(tolower(*c)))) * 0x100000001b3ULL;
+            }
+            return mix(h);
+        }
+        default: {
+            // lists and decimals only hash on their type
+            return h;
+        }
+    }
+}
+
+t_uindex
+t_treenodes::size() const {
+    return m_size;
+}
+
+t_uindex
+t_treenodes::id_end() const {
+    return m_pidx.size();
+}
+
+bool
+t_treenodes::contains(t_uindex idx) const {
+    return idx < id_end() && (m_flags[idx] & NODE_LIVE);
+}
+
+void
+t_treenodes::reserve_ids(t_uindex idx) {
+    if (idx < id_end()) {
+        return;
+    }
+
+    t_uindex n = idx + 1;
+    m_pidx.resize(n, root_pidx());
+    m_depth.resize(n, 0);
+    m_flags.resize(n, 0);
+    m_cunsorted.resize(n, 0);
+    m_nstrands.resize(n, 0);
+    m_npkeys.resize(n, 0);
+    m_aggidx.resize(n, 0);
+    m_value.resize(n);
+    m_sort_value.resize(n);
+    m_hash.resize(n, 0);
+    m_cbegin.resize(n, 0);
+    m_csize.resize(n, 0);
+    m_ccap.resize(n, 0);
+}
+
+bool
+t_treenodes::insert(const t_stnode& node) {
+    t_uindex idx = node.m_idx;
+    t_uindex pidx = node.m_pidx;
+
+    if (contains(idx) || find_child(pidx, node.m_value) != INVALID_INDEX) {
+        return false;
+    }
+
+    reserve_ids(idx);
+    if (pidx != root_pidx()) {
+        reserve_ids(pidx);
+    }
+
+    m_pidx[idx] = pidx;
+    m_depth[idx] = node.m_depth;
+    m_flags[idx] = NODE_LIVE | (node.m_show ? NODE_SHOW : 0);
+    m_nstrands[idx] = node.m_nstrands;
+    m_npkeys[idx] = 0;
+    m_aggidx[idx] = node.m_aggidx;
+    m_value[idx] = pack(node.m_value);
+    m_sort_value[idx] = pack(node.m_sort_value);
+    m_hash[idx] = hash_child(pidx, node.m_value);
+    ++m_size;
+
+    hash_insert(idx);
+    if (pidx != root_pidx()) {
+        add_child(pidx, idx);
+    }
+    return true;
+}
+
+void
+t_treenodes::clear() {
+    std::lock_guard<std::mutex> guard(m_sort_mutex);
+    m_size = 0;
+    m_pidx.clear();
+    m_depth.clear();
+    m_flags.clear();
+    m_cunsorted.clear();
+    m_nstrands.clear();
+    m_npkeys.clear();
+    m_aggidx.clear();
+    m_value.clear();
+    m_sort_value.clear();
+    m_hash.clear();
+    m_cbegin.clear();
+    m_csize.clear();
+    m_ccap.clear();
+    m_arena.clear();
+    m_arena_garbage = 0;
+    m_slots.clear();
+    m_nslots_used = 0;
+    m_unsorted.clear();
+    m_nunsorted.store(0);
+}
+
+t_stnode
+t_treenodes::get(t_uindex idx) const {
+    return t_stnode(idx, m_pidx[idx], unpack(m_value[idx]), m_depth[idx],
+        unpack(m_sort_value[idx]), m_nstrands[idx], m_aggidx[idx],
+        (m_flags[idx] & NODE_SHOW) != 0);
+}
+
+t_uindex
+t_treenodes::get_pidx(t_uindex idx) const {
+    return m_pidx[idx];
+}
+
+std::uint8_t
+t_treenodes::get_depth(t_uindex idx) const {
+    return m_depth[idx];
+}
+
+t_uindex
+t_treenodes::get_nstrands(t_uindex idx) const {
+    return m_nstrands[idx];
+}
+
+t_uindex
+t_treenodes::get_npkeys(t_uindex idx) const {
+    return m_npkeys[idx];
+}
+
+t_uindex
+t_treenodes::get_aggidx(t_uindex idx) const {
+    return m_aggidx[idx];
+}
+
+t_tscalar
+t_treenodes::get_value(t_uindex idx) const {
+    return unpack(m_value[idx]);
+}
+
+t_tscalar
+t_treenodes::get_sort_value(t_uindex idx) const {
+    return unpack(m_sort_value[idx]);
+}
+
+void
+t_treenodes::set_nstrands(t_uindex idx, t_uindex nstrands) {
+    m_nstrands[idx] = nstrands;
+}
+
+void
+t_treenodes::set_npkeys(t_uindex idx, t_uindex npkeys) {
+    m_npkeys[idx] = npkeys;
+}
+
+void
+t_treenodes::set_show(t_uindex idx, bool show) {
+    if (show) {
+        m_flags[idx] |= NODE_SHOW;
+    } else {
+        m_flags[idx] &= ~NODE_SHOW;
+    }
+}
+
+void
+t_treenodes::set_value(t_uindex idx, const t_tscalar& value) {
+    t_uindex pidx = m_pidx[idx];
+    bool live = contains(idx);
+    if (live) {
+        hash_erase(idx);
+    }
+    m_value[idx] = pack(value);
+    m_hash[idx] = hash_child(pidx, value);
+    if (live) {
+        hash_insert(idx);
+    }
+    if (pidx != root_pidx()) {
+        mark_unsorted(pidx);
+    }
+}
+
+void
+t_treenodes::set_sort_value(t_uindex idx, const t_tscalar& sort_value) {
+    m_sort_value[idx] = pack(sort_value);
+    t_uindex pidx = m_pidx[idx];
+    if (pidx != root_pidx()) {
+        mark_unsorted(pidx);
+    }
+}
+
+t_uindex
+t_treenodes::get_num_children(t_uindex idx) const {
+    return idx < id_end() ? m_csize[idx] : 0;
+}
+
+const t_uindex*
+t_treenodes::children_begin(t_uindex idx) const {
+    if (idx >= id_end()) {
+        return nullptr;
+    }
+    sort_children();
+    return m_arena.data() + m_cbegin[idx];
+}
+
+const t_uindex*
+t_treenodes::children_end(t_uindex idx) const {
+    if (idx >= id_end()) {
+        return nullptr;
+    }
+    return children_begin(idx) + m_csize[idx];
+}
+
+t_index
+t_treenodes::find_child(t_uindex pidx, const t_tscalar& value) const {
+    if (m_slots.empty()) {
+        return INVALID_INDEX;
+    }
+
+    std::uint64_t h = hash_child(pidx, value);
+    t_uindex mask = m_slots.size() - 1;
+    for (t_uindex pos = h & mask; m_slots[pos] != EMPTY_SLOT; pos = (pos + 1) & mask) {
+        t_uindex slot = m_slots[pos];
+        if (slot == ERASED_SLOT) {
+            continue;
+        }
+        t_uindex idx = slot - 1;
+        if (m_hash[idx] == h && m_pidx[idx] == pidx && equivalent(unpack(m_value[idx]), value)) {
+            return idx;
+        }
+    }
+    return INVALID_INDEX;
+}
+
+std::vector<t_uindex>
+t_treenodes::zero_strands() const {
+    std::vector<t_uindex> rval;
+    for (t_uindex idx = 0, loop_end = id_end(); idx < loop_end; ++idx) {
+        if ((m_flags[idx] & NODE_LIVE) && m_nstrands[idx] == 0) {
+            rval.push_back(idx);
+        }
+    }
+    return rval;
+}
+
+void
+t_treenodes::erase(const std::vector<t_uindex>& ids) {
+    std::vector<t_uindex> parents;
+    for (auto idx : ids) {
+        if (!contains(idx)) {
+            continue;
+        }
+        hash_erase(idx);
+        m_flags[idx] &= ~NODE_LIVE;
+        --m_size;
+        if (m_pidx[idx] != root_pidx()) {
+            parents.push_back(m_pidx[idx]);
+        }
+    }
+
+    std::sort(parents.begin(), parents.end());
+    parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+
+    // the order of the remaining children is kept
+    for (auto pidx : parents) {
+        t_uindex* begin = m_arena.data() + m_cbegin[pidx];
+        t_uindex* end = begin + m_csize[pidx];
+        t_uindex* last = std::remove_if(
+            begin, end, [this](t_uindex c) { return !(m_flags[c] & NODE_LIVE); });
+        m_csize[pidx] = static_cast<std::uint32_t>(last - begin);
+    }
+}
+
+bool
+t_treenodes::child_less(t_uindex a, t_uindex b) const {
+    t_tscalar sa = unpack(m_sort_value[a]);
+    t_tscalar sb = unpack(m_sort_value[b]);
+    if (sa < sb) {
+        return true;
+    }
+    if (sb < sa) {
+        return false;
+    }
+    return unpack(m_value[a]) < unpack(m_value[b]);
+}
+
+void
+t_treenodes::add_child(t_uindex pidx, t_uindex idx) {
+    std::uint32_t csize = m_csize[pidx];
+    std::uint32_t ccap = m_ccap[pidx];
+
+    if (csize == ccap) {
+        std::uint32_t ncap = std::max<std::uint32_t>(4, 2 * ccap);
+        if (ccap > 0 && m_cbegin[pidx] + ccap == m_arena.size()) {
+            // the range is at the end of the arena, grow it in place
+            m_arena.resize(m_cbegin[pidx] + ncap);
+        } else {
+            t_uindex nbegin = m_arena.size();
+            m_arena.resize(nbegin + ncap);
+            std::copy(m_arena.begin() + m_cbegin[pidx], m_arena.begin() + m_cbegin[pidx] + csize,
+                m_arena.begin() + nbegin);
+            m_arena_garbage += ccap;
+            m_cbegin[pidx] = nbegin;
+        }
+        m_ccap[pidx] = ncap;
+    }
+
+    t_uindex* children = m_arena.data() + m_cbegin[pidx];
+    children[csize] = idx;
+    m_csize[pidx] = csize + 1;
+
+    if (csize > 0 && !m_cunsorted[pidx] && !child_less(children[csize - 1], idx)) {
+        mark_unsorted(pidx);
+    }
+
+    if (m_arena_garbage > 4096 && 2 * m_arena_garbage > m_arena.size()) {
+        compact_arena();
+    }
+}
+
+void
+t_treenodes::compact_arena() {
+    std::vector<t_uindex> arena;
+    arena.reserve(m_arena.size() - m_arena_garbage);
+    for (t_uindex idx = 0, loop_end = id_end(); idx < loop_end; ++idx) {
+        if (m_ccap[idx] == 0) {
+            continue;
+        }
+        t_uindex nbegin = arena.size();
+        arena.insert(arena.end(), m_arena.begin() + m_cbegin[idx],
+            m_arena.begin() + m_cbegin[idx] + m_csize[idx]);
+        m_cbegin[idx] = nbegin;
+        m_ccap[idx] = m_csize[idx];
+    }
+    m_arena.swap(arena);
+    m_arena_garbage = 0;
+}
+
+void
+t_treenodes::mark_unsorted(t_uindex pidx) {
+    if (m_cunsorted[pidx]) {
+        return;
+    }
+    m_cunsorted[pidx] = 1;
+    m_unsorted.push_back(pidx);
+    m_nunsorted.store(m_unsorted.size(), std::memory_order_release);
+}
+
+// Readers may share the tree, the first one to need the order sorts the
+// children
+void
+t_treenodes::sort_children() const {
+    if (m_nunsorted.load(std::memory_order_acquire) == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(m_sort_mutex);
+    if (m_nunsorted.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    struct t_key {
+        t_tscalar m_sort_value;
+        t_tscalar m_value;
+        t_uindex m_idx;
+    };
+
+    std::vector<t_key> keys;
+    for (auto pidx : m_unsorted) {
+        m_cunsorted[pidx] = 0;
+        t_uindex* children = m_arena.data() + m_cbegin[pidx];
+        t_uindex nchild = m_csize[pidx];
+
+        keys.resize(nchild);
+        for (t_uindex cidx = 0; cidx < nchild; ++cidx) {
+            t_uindex idx = children[cidx];
+            keys[cidx] = t_key{unpack(m_sort_value[idx]), unpack(m_value[idx]), idx};
+        }
+
+        std::sort(keys.begin(), keys.end(), [](const t_key& a, const t_key& b) {
+            if (a.m_sort_value < b.m_sort_value) {
+                return true;
+            }
+            if (b.m_sort_value < a.m_sort_value) {
+                return false;
+            }
+            return a.m_value < b.m_value;
+        });
+
+        for (t_uindex cidx = 0; cidx < nchild; ++cidx) {
+            children[cidx] = keys[cidx].m_idx;
+        }
+    }
+
+    m_unsorted.clear();
+    m_nunsorted.store(0, std::memory_order_release);
+}
+
+void
+t_treenodes::hash_insert(t_uindex idx) {
+    if (m_slots.empty()) {
+        // picks up idx with the other live nodes
+        rehash(16);
+        return;
+    }
+
+    t_uindex mask = m_slots.size() - 1;
+    t_uindex pos = m_hash[idx] & mask;
+    while (m_slots[pos] != EMPTY_SLOT && m_slots[pos] != ERASED_SLOT) {
+        pos = (pos + 1) & mask;
+    }
+    if (m_slots[pos] == EMPTY_SLOT) {
+        ++m_nslots_used;
+    }
+    m_slots[pos] = idx + 1;
+
+    if (2 * m_nslots_used > m_slots.size()) {
+        rehash(m_slots.size());
+    }
+}
+
+void
+t_treenodes::hash_erase(t_uindex idx) {
+    if (m_slots.empty()) {
+        return;
+    }
+
+    t_uindex mask = m_slots.size() - 1;
+    for (t_uindex pos = m_hash[idx] & mask; m_slots[pos] != EMPTY_SLOT; pos = (pos + 1) & mask) {
+        if (m_slots[pos] == idx + 1) {
+            m_slots[pos] = ERASED_SLOT;
+            return;
+        }
+    }
+}
+
+void
+t_treenodes::rehash(t_uindex capacity) {
+    // keep the table at most a quarter full after erased slots are dropped
+    while (capacity < 4 * m_size) {
+        capacity *= 2;
+    }
+
+    std::vector<t_uindex> slots(capacity, EMPTY_SLOT);
+    t_uindex mask = capacity - 1;
+    for (t_uindex idx = 0, loop_end = id_end(); idx < loop_end; ++idx) {
+        if (!(m_flags[idx] & NODE_LIVE)) {
+            continue;
+        }
+        t_uindex pos = m_hash[idx] & mask;
+        while (slots[pos] != EMPTY_SLOT) {
+            pos = (pos + 1) & mask;
+        }
+        slots[pos] = idx + 1;
+    }
+
+    m_slots.swap(slots);
+    m_nslots_used = m_size;
+}
+
+} // end namespace perspective
@@ -0,0 +1,95 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/string_ranks.h>
+#include <perspective/scalar.h>
+#include <perspective/vocab.h>
+#include <algorithm>
+#include <functional>
+
+namespace perspective {
+
+int
+psp_strcasecmp(const char* x, const char* y) {
+    // collation order: iscntrl < isspace < ispunct < isalnum < unicode
+    // upper and lower are equal
+    static const uint8_t ascii_collate[] = {
+        0,1,2,3,4,5,6,7,8,28,29,30,31,32,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,
+        33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,48,66,67,68,69,70,71,72,73,74,75,49,50,51,52,53,54,
+        55,76,77,78,79,80,81,82,83,84,85,86,87,88,89,90,91,92,93,94,95,96,97,98,99,100,101,56,57,58,59,60,
+        61,76,77,78,79,80,81,82,83,84,85,86,87,88,89,90,91,92,93,94,95,96,97,98,99,100,101,62,63,64,65,27,
+        102,103,104,105,106,107,108,109,110,111,112,113,114,115,116,117,118,119,120,121,122,123,124,125,126,127,128,129,130,131,132,133,
+        134,135,136,137,138,139,140,141,142,143,144,145,146,147,148,149,150,151,152,153,154,155,156,157,158,159,160,161,162,163,164,165,
+        166,167,168,169,170,171,172,173,174,175,176,177,178,179,180,181,182,183,184,185,186,187,188,189,190,191,192,193,194,195,196,197,
+        198,199,200,201,202,203,204,205,206,207,208,209,210,211,212,213,214,215,216,217,218,219,220,221,222,223,224,225,226,227,228,229,
+    };
+    for(int i = 0;; ++i) {
+        int d = ascii_collate[(uint8_t)x[i]] - ascii_collate[(uint8_t)y[i]];
+        if(d || !x[i])
+            return d;
+    }
+}
+
+t_string_ranks::t_string_ranks(t_string_collation collation)
+    : m_collation(collation)
+    , m_nranks(0) {}
+
+bool
+t_string_ranks::less(const char* x, const char* y) const {
+    if (m_collation == STRING_COLLATION_SORT) {
+        return psp_strcasecmp(x, y) < 0;
+    }
+    return t_const_char_comparator<std::less>()(x, y);
+}
+
+bool
+t_string_ranks::is_current(const t_vocab& vocab) const {
+    return vocab.get_vlenidx() == m_order.size();
+}
+
+void
+t_string_ranks::update(const t_vocab& vocab) {
+    t_uindex nstrings = vocab.get_vlenidx();
+    if (nstrings == m_order.size()) {
+        return;
+    }
+    if (nstrings < m_order.size()) {
+        m_order.clear();
+    }
+
+    auto cmp = [&](std::uint32_t x, std::uint32_t y) {
+        return less(vocab.unintern_c(x), vocab.unintern_c(y));
+    };
+
+    std::vector<std::uint32_t> added;
+    added.reserve(nstrings - m_order.size());
+    for (t_uindex idx = m_order.size(); idx < nstrings; ++idx) {
+        added.push_back(static_cast<std::uint32_t>(idx));
+    }
+    std::stable_sort(added.begin(), added.end(), cmp);
+
+    std::vector<std::uint32_t> order;
+    order.reserve(nstrings);
+    std::merge(m_order.begin(), m_order.end(), added.begin(), added.end(),
+        std::back_inserter(order), cmp);
+    m_order.swap(order);
+
+    m_ranks.resize(nstrings);
+    m_nranks = 0;
+    for (t_uindex idx = 0; idx < nstrings; ++idx) {
+        if (idx > 0 && cmp(m_order[idx - 1], m_order[idx])) {
+            ++m_nranks;
+        }
+        m_ranks[m_order[idx]] = static_cast<std::uint32_t>(m_nranks);
+    }
+    m_nranks += nstrings > 0;
+}
+
+} // end namespace perspective
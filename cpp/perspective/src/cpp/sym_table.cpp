@@ -11,33 +11,147 @@
 #include <perspective/base.h>
 #include <perspective/sym_table.h>
 #include <perspective/column.h>
-#include <unordered_map>
-#include <functional>
+#include <cstring>
 #include <mutex>
 
 namespace perspective {
 
-std::mutex sym_table_mutex;
+namespace {
+
+// FNV-1a with a final mix, the top bits pick the shard and the low bits the
+// slot
+inline std::uint64_t
+hash_cstr(const char* s, t_uindex& len) {
+    std::uint64_t h = 14695981039346656037ULL;
+    const char* p = s;
+    for (; *p; ++p) {
+        h ^= static_cast<unsigned char>(*p);
+        h *= 1099511628211ULL;
+    }
+    len = p - s;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Entries are the hash followed by the string
+inline std::uint64_t
+entry_hash(const char* entry) {
+    std::uint64_t h;
+    std::memcpy(&h, entry - sizeof(std::uint64_t), sizeof(std::uint64_t));
+    return h;
+}
+
+} // end anonymous namespace
+
+t_symtable::t_slots::t_slots(t_uindex capacity)
+    : m_capacity(capacity)
+    , m_data(new std::atomic<const char*>[capacity]) {
+    for (t_uindex idx = 0; idx < capacity; ++idx) {
+        m_data[idx].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+t_symtable::t_shard::t_shard()
+    : m_slots(nullptr)
+    , m_size(0)
+    , m_head(nullptr)
+    , m_left(0) {}
 
 t_symtable::t_symtable() {}
 
-t_symtable::~t_symtable() {
-    for (auto& kv : m_mapping) {
-        free(const_cast<char*>(kv.second));
+t_symtable::~t_symtable() {}
+
+const char*
+t_symtable::find(const t_slots* slots, const char* s, std::uint64_t hash) {
+    t_uindex mask = slots->m_capacity - 1;
+    for (t_uindex idx = hash & mask;; idx = (idx + 1) & mask) {
+        const char* entry = slots->m_data[idx].load(std::memory_order_acquire);
+        if (!entry)
+            return nullptr;
+        if (entry_hash(entry) == hash && std::strcmp(entry, s) == 0)
+            return entry;
+    }
+}
+
+void
+t_symtable::place(t_slots* slots, const char* entry, std::uint64_t hash) {
+    t_uindex mask = slots->m_capacity - 1;
+    t_uindex idx = hash & mask;
+    while (slots->m_data[idx].load(std::memory_order_relaxed)) {
+        idx = (idx + 1) & mask;
+    }
+    // publishes the entry bytes written before
+    slots->m_data[idx].store(entry, std::memory_order_release);
+}
+
+char*
+t_symtable::allocate(t_shard& shard, t_uindex nbytes) {
+    nbytes = (nbytes + 7) & ~t_uindex(7);
+    if (nbytes > BLOCK_SIZE / 4) {
+        shard.m_blocks.emplace_back(new char[nbytes]);
+        return shard.m_blocks.back().get();
+    }
+    if (nbytes > shard.m_left) {
+        shard.m_blocks.emplace_back(new char[BLOCK_SIZE]);
+        shard.m_head = shard.m_blocks.back().get();
+        shard.m_left = BLOCK_SIZE;
     }
+    char* rval = shard.m_head;
+    shard.m_head += nbytes;
+    shard.m_left -= nbytes;
+    return rval;
 }
 
 const char*
-t_symtable::get_interned_cstr(const char* s) {
-    auto iter = m_mapping.find(s);
+t_symtable::insert(t_shard& shard, const char* s, t_uindex len, std::uint64_t hash) {
+    std::lock_guard<std::mutex> guard(shard.m_mutex);
+
+    t_slots* slots = shard.m_slots.load(std::memory_order_relaxed);
+    if (slots) {
+        if (const char* entry = find(slots, s, hash))
+            return entry;
+    }
 
-    if (iter != m_mapping.end()) {
-        return iter->second;
+    t_uindex size = shard.m_size.load(std::memory_order_relaxed);
+    if (!slots || (size + 1) * 4 > slots->m_capacity * 3) {
+        t_uindex capacity = slots ? slots->m_capacity * 2 : t_uindex(INITIAL_CAPACITY);
+        std::unique_ptr<t_slots> grown(new t_slots(capacity));
+        if (slots) {
+            for (t_uindex idx = 0; idx < slots->m_capacity; ++idx) {
+                const char* entry = slots->m_data[idx].load(std::memory_order_relaxed);
+                if (entry)
+                    place(grown.get(), entry, entry_hash(entry));
+            }
+        }
+        slots = grown.get();
+        shard.m_tables.push_back(std::move(grown));
+        shard.m_slots.store(slots, std::memory_order_release);
     }
 
-    auto scopy = strdup(s);
-    m_mapping[scopy] = scopy;
-    return scopy;
+    char* mem = allocate(shard, sizeof(std::uint64_t) + len + 1);
+    std::memcpy(mem, &hash, sizeof(std::uint64_t));
+    char* entry = mem + sizeof(std::uint64_t);
+    std::memcpy(entry, s, len + 1);
+
+    place(slots, entry, hash);
+    shard.m_size.store(size + 1, std::memory_order_relaxed);
+    return entry;
+}
+
+const char*
+t_symtable::get_interned_cstr(const char* s) {
+    t_uindex len;
+    std::uint64_t hash = hash_cstr(s, len);
+    t_shard& shard = m_shards[hash >> SHARD_SHIFT];
+
+    const t_slots* slots = shard.m_slots.load(std::memory_order_acquire);
+    if (slots) {
+        if (const char* entry = find(slots, s, hash))
+            return entry;
+    }
+    return insert(shard, s, len, hash);
 }
 
 t_tscalar
@@ -66,47 +180,33 @@ t_symtable::get_interned_tscalar(const t_tscalar& s) {
 
 t_uindex
 t_symtable::size() const {
-    return m_mapping.size();
+    t_uindex rval = 0;
+    for (const t_shard& shard : m_shards) {
+        rval += shard.m_size.load(std::memory_order_relaxed);
+    }
+    return rval;
 }
 
+// Never destroyed, its strings are referenced from static data
 static t_symtable*
 get_symtable() {
-    static t_symtable* sym = 0;
-
-    if (!sym) {
-        sym = new t_symtable;
-    }
+    static t_symtable* sym = new t_symtable;
     return sym;
 }
 
 const char*
 get_interned_cstr(const char* s) {
-    std::lock_guard<std::mutex> guard(sym_table_mutex);
-    auto sym = get_symtable();
-    return sym->get_interned_cstr(s);
+    return get_symtable()->get_interned_cstr(s);
 }
 
 t_tscalar
 get_interned_tscalar(const char* s) {
-    if (t_tscalar::can_store_inplace(s)) {
-        t_tscalar rval;
-        rval.set(s);
-        return rval;
-    }
-    t_tscalar rval;
-    rval.set(get_interned_cstr(s));
-    return rval;
+    return get_symtable()->get_interned_tscalar(s);
 }
 
 t_tscalar
 get_interned_tscalar(const t_tscalar& s) {
-    if (!s.is_str() || s.is_inplace())
-        return s;
-
-    t_tscalar rval;
-    rval.set(get_interned_cstr(s.get_char_ptr()));
-    rval.m_status = s.m_status;
-    return rval;
+    return get_symtable()->get_interned_tscalar(s);
 }
 
 } // end namespace perspective
@@ -19,6 +19,9 @@
 #include <perspective/utils.h>
 #include <perspective/logtime.h>
 #include <perspective/column_meta.h>
+#include <perspective/search_index.h>
+#include <atomic>
+#include <mutex>
 #include <sstream>
 namespace perspective {
 
@@ -46,7 +49,8 @@ t_table::t_table(const t_table_recipe& recipe)
     , m_backing_store(recipe.m_backing_store)
     , m_init(false)
     , m_recipe(recipe)
-    , m_from_recipe(true) {
+    , m_from_recipe(true)
+    , m_search_indexed(false) {
     set_capacity(recipe.m_capacity);
 }
 
@@ -57,7 +61,8 @@ t_table::t_table(const t_schema& s, t_uindex init_cap)
     , m_size(0)
     , m_backing_store(BACKING_STORE_MEMORY)
     , m_init(false)
-    , m_from_recipe(false) {
+    , m_from_recipe(false)
+    , m_search_indexed(false) {
     PSP_TRACE_SENTINEL();
     LOG_CONSTRUCTOR("t_table");
     set_capacity(init_cap);
@@ -71,7 +76,8 @@ t_table::t_table(const std::string& name, const std::string& dirname, const t_sc
     , m_size(0)
     , m_backing_store(backing_store)
     , m_init(false)
-    , m_from_recipe(false) {
+    , m_from_recipe(false)
+    , m_search_indexed(false) {
     PSP_TRACE_SENTINEL();
     LOG_CONSTRUCTOR("t_table");
     set_capacity(init_cap);
@@ -85,7 +91,8 @@ t_table::t_table(const t_schema& s, const std::vector<std::vector<t_tscalar>>& v
     , m_size(0)
     , m_backing_store(BACKING_STORE_MEMORY)
     , m_init(false)
-    , m_from_recipe(false) {
+    , m_from_recipe(false)
+    , m_search_indexed(false) {
     PSP_TRACE_SENTINEL();
     LOG_CONSTRUCTOR("t_table");
     auto ncols = s.size();
@@ -628,103 +635,92 @@ t_table::get_recipe() const {
     return rval;
 }
 
-t_mask
-t_table::filter_cpp(
-    t_filter_op combiner, const std::vector<t_fterm>& fterms, t_config& config) const {
-    size_t nterms = fterms.size();
-    std::vector<t_fterm::t_prepared> prepared;
-    std::vector<std::vector<t_fterm::t_prepared>> dependency_prepareds;
-    prepared.reserve(nterms);
-    auto data_format_map = config.get_data_format_map();
-    for(size_t i = 0; i < nterms; ++i) {
-        std::vector<t_fterm::t_prepared> sub_prepareds;
-        if (fterms[i].m_op == FILTER_OP_GROUP_FILTER) {
-            prepared.push_back(nullptr);
-            if (fterms[i].m_dependency->m_fterms.size() > 0) {
-                for (t_uindex didx = 0, dsize = fterms[i].m_dependency->m_fterms.size(); didx < dsize; ++didx) {
-                    auto sub_filter = fterms[i].m_dependency->m_fterms[didx];
-                    for (t_uindex sidx = 0, ssize = sub_filter.m_dependency->m_fterms.size(); sidx < ssize; ++sidx) {
-                        auto sub_f = sub_filter.m_dependency->m_fterms[sidx];
-                        const t_column *col = &*get_const_column(sub_f.m_colname);
-                        auto it = data_format_map.find(sub_f.m_colname);
-                        t_dataformattype force_df = DATA_FORMAT_NONE;
-                        if (it != data_format_map.end()) {
-                            force_df = it->second;
-                        }
-                        sub_prepareds.push_back(sub_f.prepare(col, force_df));
+// Evaluates a filter over FILTER_CHUNK_SIZE row morsels, in parallel with
+// PSP_PARALLEL_FOR. fill(first, last, words) writes the 64-bit mask words of
+// rows [first, last), morsels are 64-row aligned so they never share a word.
+// Progress and cancellation are checked once per morsel.
+template <typename F>
+static t_mask
+filter_morsels(t_uindex n, t_config& config, F fill) {
+    t_uindex nmorsels = (n + FILTER_CHUNK_SIZE - 1) / FILTER_CHUNK_SIZE;
+    std::vector<std::uint64_t> words((n + 63) / 64);
+    std::atomic<t_uindex> done(0);
+    std::atomic<bool> cancelled(false);
+    std::mutex progress_mutex;
+    std::atomic<std::int32_t> prev_percentage(0);
+
+#ifdef PSP_PARALLEL_FOR
+    PSP_PFOR(0, int(nmorsels), 1,
+        [&](int midx)
+#else
+    for (t_uindex midx = 0; midx < nmorsels; ++midx)
+#endif
+        {
+            if (!cancelled) {
+                t_uindex first = midx * FILTER_CHUNK_SIZE;
+                t_uindex last = std::min<t_uindex>(first + FILTER_CHUNK_SIZE, n);
+                fill(first, last, words.data() + first / 64);
+
+                std::int32_t percentage = ((done += last - first) * 100) / n;
+                if (percentage > prev_percentage) {
+                    std::lock_guard<std::mutex> guard(progress_mutex);
+                    if (percentage > prev_percentage) {
+                        config.update_query_percentage_store(QUERY_PERCENT_FILTER, percentage);
+                        prev_percentage = percentage;
                     }
                 }
+                if (config.get_cancel_query_status()) {
+                    cancelled = true;
+                }
             }
-            dependency_prepareds.push_back(sub_prepareds);
-            continue;
-        }
-        dependency_prepareds.push_back(sub_prepareds);
-        const t_column *col = &*get_const_column(fterms[i].m_colname);
-        auto it = data_format_map.find(fterms[i].m_colname);
-        t_dataformattype force_df = DATA_FORMAT_NONE;
-        if (it != data_format_map.end()) {
-            force_df = it->second;
         }
-        prepared.push_back(fterms[i].prepare(col, force_df));
-    }
+#ifdef PSP_PARALLEL_FOR
+    );
+#endif
 
-    bool conjunction = combiner == FILTER_OP_AND;
-    int32_t percentage = 0, prev_percentage = 0;
-    t_uindex n = size();
     t_mask mask;
     mask.reserve(n);
-    for(t_uindex i = 0; i < n; i += 32) {
-        uint32_t mask_block = -int32_t(conjunction);
-        for(size_t j = 0; j < nterms; ++j) {
-            uint32_t m;
-            if (fterms[j].m_op == FILTER_OP_GROUP_FILTER) {
-                bool f_sub_conjunction = fterms[j].m_dependency->m_combiner == FILTER_OP_AND;
-                uint32_t depend_mask_block = -int32_t(f_sub_conjunction);
-                if (fterms[j].m_dependency->m_fterms.size() > 0) {
-                    t_uindex prepared_idx = 0;
-                    for (t_uindex didx = 0, dsize = fterms[j].m_dependency->m_fterms.size(); didx < dsize; ++didx) {
-                        auto sub_filter = fterms[j].m_dependency->m_fterms[didx];
-                        bool s_sub_conjunction = sub_filter.m_dependency->m_combiner == FILTER_OP_AND;
-                        uint32_t sub_mask_block = -int32_t(s_sub_conjunction);
-                        for (t_uindex sidx = 0, ssize = sub_filter.m_dependency->m_fterms.size(); sidx < ssize; ++sidx) {
-                            auto sub_f = sub_filter.m_dependency->m_fterms[sidx];
-                            auto sub_p = dependency_prepareds[j][prepared_idx];
-                            prepared_idx++;
-                            uint32_t m = sub_p(i, std::min(i+32, n));
-                            if (s_sub_conjunction) {
-                                sub_mask_block &= m;
-                            } else {
-                                sub_mask_block |= m;
-                            }
-                        }
-                        if (f_sub_conjunction) {
-                            depend_mask_block &= sub_mask_block;
-                        } else {
-                            depend_mask_block |= sub_mask_block;
-                        }
-                    }
-                }
-                m = depend_mask_block;
-            } else {
-                m = prepared[j](i, std::min(i+32, n));
-            };
-            if(conjunction)
-                mask_block &= m;
-            else
-                mask_block |= m;
+    mask.append_words(words.data(), words.size());
+    mask.resize(n);
+    return mask;
+}
+
+t_mask
+t_table::filter_cpp(
+    t_filter_op combiner, const std::vector<t_fterm>& fterms, t_config& config) const {
+    auto data_format_map = config.get_data_format_map();
+    auto prepare = [&](const t_fterm& fterm) {
+        const t_column *col = &*get_const_column(fterm.m_colname);
+        auto it = data_format_map.find(fterm.m_colname);
+        t_dataformattype force_df = DATA_FORMAT_NONE;
+        if (it != data_format_map.end()) {
+            force_df = it->second;
         }
-        mask.append(mask_block);
+        return fterm.prepare(col, force_df);
+    };
 
-        percentage = (i * 100) / n;
-        if (percentage > prev_percentage) {
-            config.update_query_percentage_store(QUERY_PERCENT_FILTER, percentage);
-            prev_percentage = percentage;
+    // Compile the whole tree once, group filters hold sub filters of terms
+    std::vector<t_fterm::t_prepared> prepared;
+    prepared.reserve(fterms.size());
+    for (const auto& fterm : fterms) {
+        if (fterm.m_op != FILTER_OP_GROUP_FILTER) {
+            prepared.push_back(prepare(fterm));
+            continue;
         }
-        if (config.get_cancel_query_status()) {
-            return mask;
+        std::vector<t_fterm::t_prepared> sub_filters;
+        for (const auto& sub_filter : fterm.m_dependency->m_fterms) {
+            std::vector<t_fterm::t_prepared> sub_prepareds;
+            for (const auto& sub_f : sub_filter.m_dependency->m_fterms) {
+                sub_prepareds.push_back(prepare(sub_f));
+            }
+            sub_filters.push_back(
+                t_fterm::combine(sub_filter.m_dependency->m_combiner, std::move(sub_prepareds)));
         }
+        prepared.push_back(t_fterm::combine(fterm.m_dependency->m_combiner, std::move(sub_filters)));
     }
-    return mask;
+    t_fterm::t_prepared filter = t_fterm::combine(combiner, std::move(prepared));
+
+    return filter_morsels(size(), config, filter);
 }
 
 t_mask
@@ -734,7 +730,6 @@ t_table::having_cpp(
     auto self = const_cast<t_table*>(this);
     auto fterms = fterms_;
 
-    t_mask mask(size());
     t_uindex fterm_size = fterms.size();
     std::vector<t_uindex> indices(fterm_size);
     std::vector<const t_column*> columns(fterm_size);
@@ -751,78 +746,95 @@ t_table::having_cpp(
         }
     }
 
-    std::int32_t percentage = 0;
-    std::int32_t prev_percentage = 0;
-    switch (combiner) {
-        case FILTER_OP_AND: {
-            t_tscalar cell_val;
-
-            for (t_uindex ridx = 0, rloop_end = size(); ridx < rloop_end; ++ridx) {
-                bool pass = true;
-                for (t_uindex cidx = 0; cidx < fterm_size; ++cidx) {
-                    if (!pass)
-                        break;
-
-                    const auto& ft = fterms[cidx];
-                    if (dmap[ridx] != level) {
-                        pass = false;
-                        continue;
-                    }
-                    bool tval;
+    if (combiner != FILTER_OP_AND && combiner != FILTER_OP_OR) {
+        PSP_COMPLAIN_AND_ABORT("Unknown filter op");
+    }
 
-                    if (ft.m_use_interned) {
-                        cell_val.set(*(columns[cidx]->get_nth<t_uindex>(ridx)));
-                        tval = ft(cell_val);
-                    } else {
-                        cell_val = columns[cidx]->get_scalar(ridx);
-                        tval = ft(cell_val);
-                    }
+    // rows are read concurrently, so the depth map must not be modified
+    auto at_level = [&](t_uindex ridx) {
+        auto it = dmap.find(ridx);
+        return (it == dmap.end() ? t_depth(0) : it->second) == level;
+    };
+
+    auto pass_and = [&](t_uindex ridx) {
+        t_tscalar cell_val;
+        for (t_uindex cidx = 0; cidx < fterm_size; ++cidx) {
+            const auto& ft = fterms[cidx];
+            if (!at_level(ridx)) {
+                return false;
+            }
+            bool tval;
 
-                    if (!(cell_val.is_valid() || ft.m_op == FILTER_OP_IS_EMPTY) || !tval) {
-                        pass = false;
-                        break;
-                    }
-                }
+            if (ft.m_use_interned) {
+                cell_val.set(*(columns[cidx]->get_nth<t_uindex>(ridx)));
+                tval = ft(cell_val);
+            } else {
+                cell_val = columns[cidx]->get_scalar(ridx);
+                tval = ft(cell_val);
+            }
 
-                mask.set(ridx, pass);
+            if (!(cell_val.is_valid() || ft.m_op == FILTER_OP_IS_EMPTY) || !tval) {
+                return false;
+            }
+        }
+        return true;
+    };
 
-                percentage = (ridx * 100) / rloop_end;
-                if (percentage > prev_percentage) {
-                    config.update_query_percentage_store(QUERY_PERCENT_FILTER, percentage);
-                }
-                if (config.get_cancel_query_status()) {
-                    return mask;
-                }
+    auto pass_or = [&](t_uindex ridx) {
+        if (!at_level(ridx)) {
+            return false;
+        }
+        for (t_uindex cidx = 0; cidx < fterm_size; ++cidx) {
+            t_tscalar cell_val = columns[cidx]->get_scalar(ridx);
+            if (fterms[cidx](cell_val)) {
+                return true;
             }
-        } break;
-        case FILTER_OP_OR: {
-            for (t_uindex ridx = 0, rloop_end = size(); ridx < rloop_end; ++ridx) {
-                bool pass = false;
-                if (dmap[ridx] == level) {
-                    for (t_uindex cidx = 0; cidx < fterm_size; ++cidx) {
-                        t_tscalar cell_val = columns[cidx]->get_scalar(ridx);
-                        if (fterms[cidx](cell_val)) {
-                            pass = true;
-                            break;
-                        }
-                    }
-                }
-                mask.set(ridx, pass);
+        }
+        return false;
+    };
 
-                percentage = (ridx * 100) / rloop_end;
-                if (percentage > prev_percentage) {
-                    config.update_query_percentage_store(QUERY_PERCENT_FILTER, percentage);
-                }
+    bool conjunction = combiner == FILTER_OP_AND;
 
-                if (config.get_cancel_query_status()) {
-                    return mask;
-                }
+    // With AND, a row failing the kernel of a term fails the term, so rows are
+    // only checked where all the kernels pass, skipping the blocks they reject
+    t_fterm::t_prepared candidates;
+    if (conjunction) {
+        std::vector<t_fterm::t_prepared> kernels;
+        for (t_uindex cidx = 0; cidx < fterm_size; ++cidx) {
+            if (fterms[cidx].m_use_interned) {
+                continue;
+            }
+            if (auto kernel = fterms[cidx].optimized_prepare(columns[cidx])) {
+                kernels.push_back(kernel);
             }
-        } break;
-        default: { PSP_COMPLAIN_AND_ABORT("Unknown filter op"); } break;
+        }
+        if (!kernels.empty()) {
+            candidates = t_fterm::combine(FILTER_OP_AND, std::move(kernels));
+        }
     }
 
-    return mask;
+    return filter_morsels(size(), config, [&](t_uindex first, t_uindex last, std::uint64_t* words) {
+        if (candidates) {
+            candidates(first, last, words);
+            for (t_uindex widx = 0, nwords = (last - first + 63) / 64; widx < nwords; ++widx) {
+                std::uint64_t& word = words[widx];
+                for (t_uindex bit = 0; bit < 64 && word >> bit != 0; ++bit) {
+                    if ((word >> bit & 1) && !pass_and(first + widx * 64 + bit)) {
+                        word &= ~(std::uint64_t(1) << bit);
+                    }
+                }
+            }
+            return;
+        }
+        for (t_uindex ridx = first; ridx < last; ++ridx) {
+            bool pass = conjunction ? pass_and(ridx) : pass_or(ridx);
+            std::uint64_t& word = words[(ridx - first) / 64];
+            if ((ridx - first) % 64 == 0) {
+                word = 0;
+            }
+            word |= std::uint64_t(pass) << ((ridx - first) % 64);
+        }
+    });
 }
 
 inline bool
@@ -885,6 +897,59 @@ sterms_join(const std::vector<t_sterm>& sterms) {
     return res;
 }
 
+// Rows where some searched column may pass `st`, nullptr when an index
+// cannot narrow them down. The word checks of search_cpp also search edge
+// columns with starts with, and date columns with equals.
+inline t_masksptr
+search_index_rows(const std::vector<std::shared_ptr<const t_search_index>>& indexes,
+    const std::vector<t_searchtype>& col_st, const t_sterm& st, bool word, bool sterm_is_date,
+    t_uindex nrows) {
+    auto rows = std::make_shared<t_mask>(nrows);
+    for (size_t idx = 0, loop_end = indexes.size(); idx < loop_end; ++idx) {
+        auto type = col_st[idx];
+        if (type == t_searchtype::SEARCHTYPE_NULL)
+            continue;
+        if (!indexes[idx])
+            return nullptr;
+
+        std::vector<t_searchtype> types{type};
+        if (word && type == t_searchtype::SEARCHTYPE_EDGE)
+            types.push_back(t_searchtype::SEARCHTYPE_STARTS_WITH);
+        if (word && sterm_is_date)
+            types.push_back(t_searchtype::SEARCHTYPE_EQUALS);
+        for (auto t : types) {
+            auto col_rows = indexes[idx]->find(st, t);
+            if (!col_rows)
+                return nullptr;
+            col_rows->resize(nrows);
+            *rows |= *col_rows;
+        }
+    }
+    return rows;
+}
+
+// nullptr stands for every row
+inline void
+intersect_rows(t_masksptr& rows, const t_masksptr& other) {
+    if (!rows) {
+        rows = other;
+    } else if (other) {
+        *rows &= *other;
+    }
+}
+
+inline void
+merge_rows(t_masksptr& rows, const t_masksptr& other) {
+    if (!rows) {
+        return;
+    }
+    if (!other) {
+        rows = nullptr;
+    } else {
+        *rows |= *other;
+    }
+}
+
 t_mask
 t_table::search_cpp(std::vector<t_searchspec> search_types, const std::vector<t_sterm>& sterms_,
     t_config& config) const {
@@ -915,11 +980,6 @@ t_table::search_cpp(std::vector<t_searchspec> search_types, const std::vector<t_
             continue;
         }
         auto columnData = get_const_column(colname).get();
-        if (columnData->m_meta) { // TODO (background-built meta data)
-                                  // ...
-        } else {
-            // ...
-        }
         colnames.push_back(colname);
         col_st.push_back(search_maps[colname]);
         columns.push_back(columnData);
@@ -1083,13 +1143,81 @@ t_table::search_cpp(std::vector<t_searchspec> search_types, const std::vector<t_
     const auto num_rows = undo_search ? 0 : size();
     const auto sterms_after_date_passed_size = sterms_after_date.size();
     const auto sterms_date = {t_sterm(sterm_date)};
+
+    // The search index of the columns gives the rows that may pass: a row
+    // needs every word in some column, a multiword term equal to a cell, or
+    // the date and the words around it. Only these rows are checked below.
+    t_masksptr candidates;
+    if (m_search_indexed && num_rows > 0) {
+        std::vector<std::shared_ptr<const t_search_index>> indexes(num_columns);
+        std::vector<t_searchtype> equals_st(num_columns, t_searchtype::SEARCHTYPE_NULL);
+        for (size_t idx = 0; idx < num_columns; ++idx) {
+            if (col_st[idx] != t_searchtype::SEARCHTYPE_NULL)
+                indexes[idx] = columns[idx]->get_search_index();
+            if (col_st[idx] == t_searchtype::SEARCHTYPE_EQUALS)
+                equals_st[idx] = t_searchtype::SEARCHTYPE_EQUALS;
+        }
+
+        for (auto& st : sterms_word) {
+            intersect_rows(candidates,
+                search_index_rows(indexes, col_st, st, true, sterm_is_date, num_rows));
+            if (candidates && candidates->count() == 0)
+                break;
+        }
+        if (candidates) {
+            for (auto& st : sterms_multiword) {
+                merge_rows(candidates,
+                    search_index_rows(indexes, equals_st, st, false, false, num_rows));
+            }
+        }
+        if (candidates && sterm_is_date) {
+            auto date_rows = search_index_rows(
+                indexes, col_st, t_sterm(sterm_date), false, false, num_rows);
+            for (auto& st : sterms_after_date_) {
+                intersect_rows(date_rows,
+                    search_index_rows(indexes, col_st, st, false, false, num_rows));
+            }
+            merge_rows(candidates, date_rows);
+        }
+    }
+
+    // Cells that are not valid never match, so the columns without a valid
+    // row in the current zone map block are skipped, and so is the block
+    // when no column has one
+    std::vector<std::shared_ptr<const t_zone_map>> zone_maps(num_columns);
+    std::vector<std::uint8_t> block_has_valid(num_columns, 1);
+    for (size_t idx = 0; idx < num_columns; ++idx) {
+        zone_maps[idx] = columns[idx]->get_zone_map();
+    }
+
+    t_uindex zidx = std::numeric_limits<t_uindex>::max();
     for (t_uindex row = 0; row < num_rows; ++row) {
+        if (candidates && !candidates->get(row)) {
+            row = std::min<t_uindex>(candidates->find_next(row), num_rows) - 1;
+            continue;
+        }
+        if (row / ZONE_MAP_BLOCK_SIZE != zidx) {
+            zidx = row / ZONE_MAP_BLOCK_SIZE;
+            bool any_valid = false;
+            for (size_t idx = 0; idx < num_columns; ++idx) {
+                const t_zone_map* zones = zone_maps[idx].get();
+                block_has_valid[idx] = !zones || zones->get_zone(zidx).num_valid() > 0;
+                any_valid = any_valid || block_has_valid[idx];
+            }
+            if (!any_valid && sterms_word_size > 0) {
+                row = std::min<t_uindex>((zidx + 1) * ZONE_MAP_BLOCK_SIZE, num_rows) - 1;
+                continue;
+            }
+        }
+
         memset(sterms_word_passed.data(), 0, sizeof(int8_t) * sterms_word_size);
         memset(
             sterms_after_date_passed.data(), 0, sizeof(int8_t) * sterms_after_date_passed_size);
         bool all_sterms_passed = false;
         bool date_sterm_passed = false;
         for (size_t idx = 0; idx < num_columns; ++idx) {
+            if (!block_has_valid[idx])
+                continue;
             scal = columns[idx]->get_scalar(row);
 
             auto& meta = *columns[idx]->m_meta;
@@ -1192,6 +1320,8 @@ t_table::search_cpp(std::vector<t_searchspec> search_types, const std::vector<t_
             size_t n = sterms_after_date_passed_size;
 
             for (size_t idx = 0; idx < num_columns; ++idx) {
+                if (!block_has_valid[idx])
+                    continue;
                 scal = columns[idx]->get_scalar(row);
 
                 auto& meta = *columns[idx]->m_meta;
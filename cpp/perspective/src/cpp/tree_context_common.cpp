@@ -17,6 +17,7 @@
 #include <perspective/env_vars.h>
 #include <perspective/dense_tree.h>
 #include <perspective/dense_tree_context.h>
+#include <perspective/tree_context_common.h>
 
 namespace perspective {
 
@@ -28,7 +29,7 @@ notify_sparse_tree_common(std::shared_ptr<t_table> strands,
     const std::vector<std::pair<std::string, std::string>>& tree_sortby,
     const std::vector<t_sortspec>& ctx_sortby, const std::vector<t_fterm>& ctx_fterms,
     const t_gstate& gstate, t_config& config, const t_table& flattened, bool is_row,
-    t_ctx2* ctx2) {
+    t_ctx2* ctx2, const std::set<std::string>& delta_aggregates) {
     t_filter fltr;
     if (t_env::log_data_nsparse_strands()) {
         std::cout << "nsparse_strands" << std::endl;
@@ -115,8 +116,14 @@ notify_sparse_tree_common(std::shared_ptr<t_table> strands,
     // Update saved mask in case sort and limit
     tree->update_saved_mask(dt_msk);
 
+    // Nodes only aggregate the rows a limit or top-N filter left them, which
+    // the deltas of the update do not follow
+    t_mask saved_msk = tree->get_saved_mask();
+    bool all_saved = saved_msk.count() == saved_msk.size();
+
     // Calculated aggregated value
-    tree->update_aggs_from_static(dctx, gstate, config);
+    tree->update_aggs_from_static(dctx, gstate, config,
+        all_saved ? delta_aggregates : std::set<std::string>());
 
     if (config.get_cancel_query_status()) {
         return;
@@ -223,10 +230,27 @@ notify_sparse_tree(std::shared_ptr<t_stree> tree, std::shared_ptr<t_traversal> t
         return;
     }
 
+    // Having terms, limits and top-N filters recompute their nodes over a
+    // subset of the rows, otherwise sums, counts and means move by the
+    // deltas of the update. ctx2 passes its having terms in the config only.
+    bool has_limit = false;
+    for (const auto& s : ctx_sortby) {
+        has_limit = has_limit || s.m_limit != t_index(-1);
+    }
+    for (const auto& f : config.get_fterms()) {
+        has_limit = has_limit || f.m_op == FILTER_OP_TOP_N;
+    }
+
+    std::set<std::string> delta_aggregates;
+    if (ctx_fterms.empty() && config.get_hterms().empty() && !has_limit) {
+        delta_aggregates = tree->get_delta_aggregates(flattened, delta, prev, existed, config);
+    }
+
     auto strands = strand_values.first;
     auto strand_deltas = strand_values.second;
     notify_sparse_tree_common(strands, strand_deltas, tree, traversal, process_traversal,
-        aggregates, tree_sortby, ctx_sortby, ctx_fterms, gstate, config, flattened, is_row, ctx2);
+        aggregates, tree_sortby, ctx_sortby, ctx_fterms, gstate, config, flattened, is_row, ctx2,
+        delta_aggregates);
 }
 
 void
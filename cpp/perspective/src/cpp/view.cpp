@@ -1213,6 +1213,8 @@ View<CTX_T>::create_suggestion_column(const std::string& colname, const std::str
     auto agg_level = str_to_agg_level_type(agg_level_str);
     t_dataformattype force_df = str_to_data_format_type(data_format);
     //m_suggestion_col = tblcolumn->clone();
+    // binned strings are copied into the suggestion column
+    t_symtable symtable;
     std::set<t_tscalar> vset;
     t_index limit_size = limit;
     t_index max_idx = tblcolumn->size();
@@ -1230,7 +1232,7 @@ View<CTX_T>::create_suggestion_column(const std::string& colname, const std::str
     }
     m_suggestion_col = table->make_column("suggestion_" + colname, col_type, true, df_type);
     if (search_term == "") {
-        auto empty_sca = col_type == DTYPE_STR ? get_interned_tscalar("") : mknull(col_type);
+        auto empty_sca = col_type == DTYPE_STR ? symtable.get_interned_tscalar("") : mknull(col_type);
         auto error_sca = mkerror(col_type);
         for (t_index idx = 0; idx < max_idx; ++idx) {
             auto col_sca = tblcolumn->get_scalar(idx);
@@ -1246,7 +1248,7 @@ View<CTX_T>::create_suggestion_column(const std::string& colname, const std::str
                             if (agg_level == AGG_LEVEL_NONE) {
                                 if (binning_info.type != BINNING_TYPE_NONE) {
                                     auto str_val = list_sca[lidx].to_binning_string(binning_info, df_type);
-                                    vset.insert(get_interned_tscalar(str_val.c_str()));
+                                    vset.insert(symtable.get_interned_tscalar(str_val.c_str()));
                                 } else {
                                     vset.insert(list_sca[lidx]);
                                 }
@@ -1254,7 +1256,7 @@ View<CTX_T>::create_suggestion_column(const std::string& colname, const std::str
                                 auto agg_sca = mk_agg_level_one(list_sca[idx], agg_level, agg_ctype, df_type);
                                 if (binning_info.type != BINNING_TYPE_NONE) {
                                     auto str_val = agg_sca.to_binning_string(binning_info, df_type);
-                                    vset.insert(get_interned_tscalar(str_val.c_str()));
+                                    vset.insert(symtable.get_interned_tscalar(str_val.c_str()));
                                 } else {
                                     vset.insert(agg_sca);
                                 }
@@ -1268,7 +1270,7 @@ View<CTX_T>::create_suggestion_column(const std::string& colname, const std::str
                     if (agg_level == AGG_LEVEL_NONE) {
                         if (binning_info.type != BINNING_TYPE_NONE) {
                             auto str_val = col_sca.to_binning_string(binning_info, df_type);
-                            vset.insert(get_interned_tscalar(str_val.c_str()));
+                            vset.insert(symtable.get_interned_tscalar(str_val.c_str()));
                         } else {
                             vset.insert(col_sca);
                         }
@@ -1276,7 +1278,7 @@ View<CTX_T>::create_suggestion_column(const std::string& colname, const std::str
                         auto agg_sca = mk_agg_level_one(col_sca, agg_level, agg_ctype, df_type);
                         if (binning_info.type != BINNING_TYPE_NONE) {
                             auto str_val = agg_sca.to_binning_string(binning_info, df_type);
-                            vset.insert(get_interned_tscalar(str_val.c_str()));
+                            vset.insert(symtable.get_interned_tscalar(str_val.c_str()));
                         } else {
                             vset.insert(agg_sca);
                         }
@@ -1305,7 +1307,7 @@ View<CTX_T>::create_suggestion_column(const std::string& colname, const std::str
                         rv = mk_agg_level_one(rv, agg_level, agg_ctype, df_type);
                         if (binning_info.type != BINNING_TYPE_NONE) {
                             auto str_val = rv.to_binning_string(binning_info, df_type);
-                            rv = get_interned_tscalar(str_val.c_str());
+                            rv = symtable.get_interned_tscalar(str_val.c_str());
                         }
                     }
                     if (rv.contains(compare_v)) {
@@ -1320,7 +1322,7 @@ View<CTX_T>::create_suggestion_column(const std::string& colname, const std::str
                     v = mk_agg_level_one(v, agg_level, agg_ctype, df_type);
                     if (agg_level != AGG_LEVEL_NONE) {
                         auto str_val = v.to_binning_string(binning_info, df_type);
-                        v = get_interned_tscalar(str_val.c_str());
+                        v = symtable.get_interned_tscalar(str_val.c_str());
                     }
                 }
                 if (v.contains(compare_v)) {
@@ -9,10 +9,59 @@
 
 #include <perspective/first.h>
 #include <perspective/vocab.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <unordered_set>
+#include <vector>
 
 namespace perspective {
 
+namespace {
+
+    // Hash of a string without terminating 0, reads 8 bytes at a time
+    inline std::uint64_t
+    hash_bytes(const char* s, std::size_t len) {
+        const std::uint64_t mul = 0x9E3779B97F4A7C15ULL;
+        std::uint64_t h = len * mul;
+        std::uint64_t w;
+        for (; len >= 8; s += 8, len -= 8) {
+            std::memcpy(&w, s, 8);
+            h = (h ^ w) * mul;
+            h ^= h >> 32;
+        }
+        if (len > 0) {
+            w = 0;
+            std::memcpy(&w, s, len);
+            h = (h ^ w) * mul;
+        }
+        return h ^ (h >> 29);
+    }
+
+    // Slot of the open addressing table used by bulk_intern(), m_idx is the
+    // vocab id + 1, 0 for an empty slot
+    struct t_intern_slot {
+        std::uint64_t m_hash;
+        t_uindex m_idx;
+    };
+
+    // Lower cases like std::string_to_lower, which the string filters use
+    inline std::uint32_t
+    lower_byte(char c) {
+        return static_cast<unsigned char>(static_cast<char>(::tolower(c)));
+    }
+
+    inline std::uint32_t
+    trigram_at(const char* s) {
+        return lower_byte(s[0]) << 16 | lower_byte(s[1]) << 8 | lower_byte(s[2]);
+    }
+
+    // Postings the trigram index holds at most (16MB), larger vocabs are
+    // filtered without it
+    const t_uindex MAX_TRIGRAM_POSTINGS = t_uindex(1) << 22;
+
+} // namespace
+
 t_vocab::t_vocab()
     : m_vlenidx(0) {
     m_vlendata.reset(new t_lstore);
@@ -21,7 +70,7 @@ t_vocab::t_vocab()
 
 t_vocab::t_vocab(const t_column_recipe& r)
     : m_vlenidx(r.m_vlenidx) {
-    if (is_vlen_dtype(r.m_dtype)) {
+    if (is_vlen_dtype(r.m_dtype) || r.m_dtype == DTYPE_LIST_STR) {
         m_vlendata.reset(new t_lstore(r.m_vlendata));
         m_extents.reset(new t_lstore(r.m_extents));
     } else {
@@ -52,6 +101,92 @@ t_vocab::reserve(size_t total_string_size, size_t string_count) {
     rebuild_map();
 }
 
+void
+t_vocab::bulk_intern(const char* data, const std::int32_t* offsets, t_uindex count,
+    t_uindex* indices) {
+    if (count == 0) {
+        return;
+    }
+
+    const bool check_map = m_vlenidx > 0;
+    t_uindex capacity = 16;
+    while (capacity < 2 * std::min<t_uindex>(count, 4096)) {
+        capacity *= 2;
+    }
+    std::vector<t_intern_slot> slots(capacity, t_intern_slot{0, 0});
+    t_uindex nslots = 0;
+
+    // Reserve for the worst case, every string new, so the store does not
+    // move in the loop and the keys of m_map stay valid: the map is rebuilt
+    // at most once, here, if the reserve moved it
+    const void* obase = m_vlendata->get_nth<const char>(0);
+    m_vlendata->reserve(m_vlendata->size() + (offsets[count] - offsets[0]) + count);
+    m_extents->reserve(m_extents->size() + sizeof(std::pair<t_uindex, t_uindex>) * count);
+    if (check_map && obase != m_vlendata->get_nth<const char>(0)) {
+        rebuild_map();
+    }
+
+    for (t_uindex i = 0; i < count; ++i) {
+        const char* s = data + offsets[i];
+        std::size_t len = offsets[i + 1] - offsets[i];
+        std::uint64_t h = hash_bytes(s, len);
+
+        t_uindex mask = capacity - 1;
+        t_uindex pos = h & mask;
+        for (; slots[pos].m_idx != 0; pos = (pos + 1) & mask) {
+            if (slots[pos].m_hash != h) {
+                continue;
+            }
+            const auto* extent
+                = m_extents->get_nth<std::pair<t_uindex, t_uindex>>(slots[pos].m_idx - 1);
+            if (extent->second - extent->first == len + 1
+                && std::memcmp(m_vlendata->get_ptr(extent->first), s, len) == 0) {
+                break;
+            }
+        }
+
+        if (slots[pos].m_idx == 0) {
+            // Not seen in this buffer: copy it, then keep it only if the
+            // vocab did not already have it
+            t_uindex bidx = m_vlendata->size();
+            char* dst = m_vlendata->extend<char>(len + 1);
+            std::memcpy(dst, s, len);
+            dst[len] = 0;
+
+            t_uindex idx;
+            t_sidxmap::iterator iter;
+            if (check_map && (iter = m_map.find(dst)) != m_map.end()) {
+                idx = iter->second;
+                m_vlendata->set_size(bidx);
+            } else {
+                idx = genidx();
+                m_extents->push_back(std::pair<t_uindex, t_uindex>(bidx, bidx + len + 1));
+                m_map[dst] = idx;
+            }
+
+            slots[pos] = t_intern_slot{h, idx + 1};
+            if (2 * ++nslots > capacity) {
+                std::vector<t_intern_slot> old_slots(2 * capacity, t_intern_slot{0, 0});
+                old_slots.swap(slots);
+                capacity *= 2;
+                mask = capacity - 1;
+                for (const auto& slot : old_slots) {
+                    if (slot.m_idx != 0) {
+                        t_uindex npos = slot.m_hash & mask;
+                        while (slots[npos].m_idx != 0) {
+                            npos = (npos + 1) & mask;
+                        }
+                        slots[npos] = slot;
+                    }
+                }
+            }
+            indices[i] = idx;
+        } else {
+            indices[i] = slots[pos].m_idx - 1;
+        }
+    }
+}
+
 bool
 t_vocab::string_exists(const char* c, t_uindex& interned) const {
     auto iter = m_map.find(c);
@@ -185,6 +320,7 @@ t_vocab::fill(const t_lstore& o_vlen, const t_lstore& o_extents, t_uindex vlenid
     m_vlendata->fill(o_vlen);
     m_extents->fill(o_extents);
     m_vlenidx = vlenidx;
+    reset_trigrams();
 }
 
 void
@@ -193,6 +329,7 @@ t_vocab::copy_vocabulary(const t_vocab& other) {
     m_vlendata = other.m_vlendata->clone();
     m_extents = other.m_extents->clone();
     rebuild_map();
+    reset_trigrams();
 }
 
 void
@@ -219,11 +356,86 @@ t_vocab::clone(const t_vocab& v) {
     m_extents->fill(*(v.m_extents));
     m_vlenidx = v.m_vlenidx;
     rebuild_map();
+    reset_trigrams();
 }
 
 void
 t_vocab::set_vlenidx(t_uindex idx) {
     m_vlenidx = idx;
+    reset_trigrams();
+}
+
+void
+t_vocab::reset_trigrams() {
+    std::lock_guard<std::mutex> lock(m_trigrams_mutex);
+    m_trigrams.clear();
+    m_trigrams_size = 0;
+    m_trigram_postings = 0;
+    m_trigrams_full = false;
+}
+
+bool
+t_vocab::get_trigram_candidates(
+    const std::string& needle, std::vector<t_uindex>& candidates) const {
+    std::lock_guard<std::mutex> lock(m_trigrams_mutex);
+    candidates.clear();
+    if (m_trigrams_full) {
+        return false;
+    }
+
+    // ids are only appended, the strings interned since the last call are
+    // added to the end of the lists, which stay sorted
+    std::vector<std::uint32_t> grams;
+    for (t_uindex idx = m_trigrams_size; idx < m_vlenidx; ++idx) {
+        grams.clear();
+        for (const char* s = unintern_c(idx); s[0] && s[1] && s[2]; ++s) {
+            grams.push_back(trigram_at(s));
+        }
+        std::sort(grams.begin(), grams.end());
+        grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+        for (std::uint32_t gram : grams) {
+            m_trigrams[gram].push_back(static_cast<std::uint32_t>(idx));
+        }
+
+        // the vocab only grows, the index stays dropped until it is reset
+        m_trigram_postings += grams.size();
+        if (m_trigram_postings > MAX_TRIGRAM_POSTINGS) {
+            std::unordered_map<std::uint32_t, std::vector<std::uint32_t>>().swap(m_trigrams);
+            m_trigrams_full = true;
+            return false;
+        }
+    }
+    m_trigrams_size = m_vlenidx;
+
+    std::vector<const std::vector<std::uint32_t>*> lists;
+    for (std::size_t i = 0; i + 3 <= needle.size(); ++i) {
+        auto iter = m_trigrams.find(trigram_at(needle.data() + i));
+        if (iter == m_trigrams.end()) {
+            return true;
+        }
+        lists.push_back(&iter->second);
+    }
+    if (lists.empty()) {
+        return true;
+    }
+
+    // intersect starting from the shortest list
+    std::sort(lists.begin(), lists.end(),
+        [](const std::vector<std::uint32_t>* a, const std::vector<std::uint32_t>* b) {
+            return a->size() != b->size() ? a->size() < b->size() : a < b;
+        });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+    candidates.assign(lists[0]->begin(), lists[0]->end());
+    for (std::size_t k = 1; k < lists.size() && !candidates.empty(); ++k) {
+        const auto& list = *lists[k];
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                             [&list](t_uindex idx) {
+                                 return !std::binary_search(list.begin(), list.end(), idx);
+                             }),
+            candidates.end());
+    }
+    return true;
 }
 
 const t_extent_pair*
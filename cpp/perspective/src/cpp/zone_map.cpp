@@ -0,0 +1,182 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/zone_map.h>
+#include <perspective/column.h>
+#include <algorithm>
+
+namespace perspective {
+
+namespace {
+
+    template <typename T>
+    void
+    compute_zone(const T* values, const t_status* status, t_uindex bidx, t_uindex eidx,
+        t_zone& zone) {
+        zone = t_zone();
+        zone.m_nrows = static_cast<std::uint32_t>(eidx - bidx);
+
+        T lo = T();
+        T hi = T();
+        T prev = T();
+        bool found = false;
+        t_uindex distinct = 0;
+
+        for (t_uindex idx = bidx; idx < eidx; ++idx) {
+            t_status s = status ? status[idx] : STATUS_VALID;
+            if (s != STATUS_VALID) {
+                if (s < STATUS_VALID) {
+                    ++zone.m_nnull;
+                } else {
+                    ++zone.m_ncleared;
+                }
+                continue;
+            }
+
+            T v = values[idx];
+            // NaN is excluded from the bounds, filters scan blocks holding one
+            if (v != v) {
+                zone.m_has_nan = true;
+                continue;
+            }
+            if (!found) {
+                lo = hi = prev = v;
+                distinct = 1;
+                found = true;
+                continue;
+            }
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+            distinct += v != prev;
+            prev = v;
+        }
+
+        zone.m_distinct = static_cast<std::uint8_t>(std::min<t_uindex>(distinct, 255));
+        std::memcpy(&zone.m_min, &lo, sizeof(T));
+        std::memcpy(&zone.m_max, &hi, sizeof(T));
+    }
+
+    template <typename T>
+    void
+    compute_zones(const t_column& col, const std::vector<bool>& dirty, t_uindex first,
+        std::vector<t_zone>& zones) {
+        t_uindex nrows = col.size();
+        if (nrows == 0) {
+            return;
+        }
+        const T* values = col.get_nth<T>(0);
+        const t_status* status = col.is_status_enabled() ? col.get_nth_status(0) : nullptr;
+
+        for (t_uindex zidx = 0, loop_end = zones.size(); zidx < loop_end; ++zidx) {
+            if (zidx < first && !dirty[zidx]) {
+                continue;
+            }
+            t_uindex bidx = zidx * ZONE_MAP_BLOCK_SIZE;
+            t_uindex eidx = std::min(bidx + ZONE_MAP_BLOCK_SIZE, nrows);
+            compute_zone(values, status, bidx, eidx, zones[zidx]);
+        }
+    }
+
+} // namespace
+
+t_zone_map::t_zone_map()
+    : m_nrows(0)
+    , m_has_dirty(false) {}
+
+bool
+t_zone_map::is_supported(t_dtype dtype) {
+    switch (dtype) {
+        case DTYPE_INT64:
+        case DTYPE_INT32:
+        case DTYPE_INT16:
+        case DTYPE_INT8:
+        case DTYPE_UINT64:
+        case DTYPE_UINT32:
+        case DTYPE_UINT16:
+        case DTYPE_UINT8:
+        case DTYPE_FLOAT64:
+        case DTYPE_FLOAT32:
+        case DTYPE_BOOL:
+        case DTYPE_TIME:
+        case DTYPE_DATE:
+        case DTYPE_DURATION:
+        case DTYPE_STR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void
+t_zone_map::mark(t_uindex bidx, t_uindex eidx) {
+    // rows past m_nrows are recomputed anyway
+    eidx = std::min(eidx, m_nrows);
+    if (bidx >= eidx) {
+        return;
+    }
+    for (t_uindex zidx = bidx / ZONE_MAP_BLOCK_SIZE, zend = (eidx - 1) / ZONE_MAP_BLOCK_SIZE;
+         zidx <= zend; ++zidx) {
+        m_dirty[zidx] = true;
+    }
+    m_has_dirty = true;
+}
+
+void
+t_zone_map::mark_all() {
+    std::fill(m_dirty.begin(), m_dirty.end(), true);
+    m_has_dirty = true;
+}
+
+bool
+t_zone_map::is_current(const t_column& col) const {
+    return col.size() == m_nrows && !m_has_dirty;
+}
+
+void
+t_zone_map::update(const t_column& col) {
+    t_uindex nrows = col.size();
+    if (nrows == m_nrows && !m_has_dirty) {
+        return;
+    }
+
+    // the last block of the previous size may have grown or shrunk
+    t_uindex first = nrows == m_nrows ? m_zones.size()
+                                      : std::min(nrows, m_nrows) / ZONE_MAP_BLOCK_SIZE;
+    t_uindex nzones = (nrows + ZONE_MAP_BLOCK_SIZE - 1) / ZONE_MAP_BLOCK_SIZE;
+    m_zones.resize(nzones);
+    m_dirty.resize(nzones, false);
+
+    switch (col.get_dtype()) {
+        case DTYPE_INT64: compute_zones<std::int64_t>(col, m_dirty, first, m_zones); break;
+        case DTYPE_INT32: compute_zones<std::int32_t>(col, m_dirty, first, m_zones); break;
+        case DTYPE_INT16: compute_zones<std::int16_t>(col, m_dirty, first, m_zones); break;
+        case DTYPE_INT8: compute_zones<std::int8_t>(col, m_dirty, first, m_zones); break;
+        case DTYPE_UINT64: compute_zones<std::uint64_t>(col, m_dirty, first, m_zones); break;
+        case DTYPE_UINT32: compute_zones<std::uint32_t>(col, m_dirty, first, m_zones); break;
+        case DTYPE_UINT16: compute_zones<std::uint16_t>(col, m_dirty, first, m_zones); break;
+        case DTYPE_UINT8: compute_zones<std::uint8_t>(col, m_dirty, first, m_zones); break;
+        case DTYPE_FLOAT64: compute_zones<double>(col, m_dirty, first, m_zones); break;
+        case DTYPE_FLOAT32: compute_zones<float>(col, m_dirty, first, m_zones); break;
+        case DTYPE_BOOL: compute_zones<bool>(col, m_dirty, first, m_zones); break;
+        case DTYPE_TIME: compute_zones<t_time::t_rawtype>(col, m_dirty, first, m_zones); break;
+        case DTYPE_DATE: compute_zones<t_date::t_rawtype>(col, m_dirty, first, m_zones); break;
+        case DTYPE_DURATION:
+            compute_zones<t_duration::t_rawtype>(col, m_dirty, first, m_zones);
+            break;
+        case DTYPE_STR: compute_zones<t_uindex>(col, m_dirty, first, m_zones); break;
+        default: { PSP_COMPLAIN_AND_ABORT("Unsupported zone map dtype"); }
+    }
+
+    std::fill(m_dirty.begin(), m_dirty.end(), false);
+    m_has_dirty = false;
+    m_nrows = nrows;
+}
+
+} // end namespace perspective
@@ -65,6 +65,7 @@ const std::string GROUP_FILTER_NAME = "__GROUP_FILTER__";
 #endif
 #define DEFAULT_CAPACITY 4000
 #define DEFAULT_CHUNK_SIZE 4000
+#define FILTER_CHUNK_SIZE 65536
 #define DEFAULT_EMPTY_CAPACITY 8
 #define ROOT_AGGIDX 0
 #ifndef CHAR_BIT
@@ -341,7 +342,9 @@ enum t_aggtype {
     AGGTYPE_PCT_SUM_PARENT,
     AGGTYPE_PCT_SUM_GRAND_TOTAL,
     AGGTYPE_CUSTOM,
-    AGGTYPE_DISTINCT_VALUES
+    AGGTYPE_DISTINCT_VALUES,
+    AGGTYPE_APPROX_MEDIAN,
+    AGGTYPE_APPROX_DISTINCT_COUNT
 };
 
 PERSPECTIVE_EXPORT t_aggtype str_to_aggtype(const std::string& str);
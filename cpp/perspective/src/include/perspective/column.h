@@ -17,9 +17,14 @@
 #include <perspective/mask.h>
 #include <perspective/compat.h>
 #include <perspective/vocab.h>
+#include <perspective/sym_table.h>
+#include <perspective/zone_map.h>
+#include <perspective/search_index.h>
+#include <perspective/string_ranks.h>
 #include <functional>
 #include <limits>
 #include <cmath>
+#include <mutex>
 
 #ifdef PSP_ENABLE_PYTHON
 namespace py = boost::python;
@@ -40,6 +45,24 @@ class t_column;
 class t_table;
 struct t_column_meta;
 
+// Items of a list cell, read in place from the values of its column. Valid
+// until the column is written to.
+template <typename T>
+struct t_list_span {
+    t_list_span(const T* begin, const T* end)
+        : m_begin(begin)
+        , m_end(end) {}
+
+    const T* begin() const { return m_begin; }
+    const T* end() const { return m_end; }
+    t_uindex size() const { return m_end - m_begin; }
+    bool empty() const { return m_begin == m_end; }
+    const T& operator[](t_uindex idx) const { return m_begin[idx]; }
+
+    const T* m_begin;
+    const T* m_end;
+};
+
 #ifdef PSP_COLUMN_VERIFY
 #define COLUMN_CHECK_ACCESS(idx) PSP_VERBOSE_ASSERT((idx) <= m_size, "Invalid column access")
 #define COLUMN_CHECK_VALUES() verify()
@@ -120,6 +143,28 @@ public:
     template <typename T>
     void set_nth(t_uindex idx, T v, t_status status);
 
+    // List columns store a t_list_extent per row into m_list_values, where
+    // the items of all the rows are laid out flat (interned ids for
+    // DTYPE_LIST_STR). T is the item type: bool, std::int64_t, double,
+    // t_date, t_time, t_duration or t_uindex.
+    template <typename T>
+    t_list_span<T> get_list_nth(t_uindex idx) const;
+
+    // 0 for columns of other dtypes
+    t_uindex get_list_size(t_uindex idx) const;
+
+    template <typename T>
+    void set_list_nth(t_uindex idx, const T* items, t_uindex count);
+
+    // Sets rows [0, count) from items laid out as Arrow list values,
+    // `offsets` has count + 1 entries
+    template <typename T>
+    void set_list_values(const T* items, const std::int32_t* offsets, t_uindex count);
+
+    // Copies row `oidx` of the list column `other`, string items are
+    // interned again when the columns have different vocabularies
+    void copy_list_nth(t_uindex idx, const t_column& other, t_uindex oidx, t_status status);
+
     void set_error(t_uindex idx, t_cell_error error);
 
     void set_valid(t_uindex idx, bool valid);
@@ -150,8 +195,10 @@ public:
     t_lstore* _get_data_lstore();
 
     t_tscalar get_scalar(t_uindex idx, bool include_error = false) const;
+    // Agg level names of dates, times and durations are interned in
+    // `symtable`, owned by the caller
     t_tscalar get_unnest_scalar(t_uindex idx, t_uindex uidx, t_agg_level_type agg_level, t_binning_info binning,
-        t_dataformattype df_type, std::vector<double>& dbinning) const;
+        t_dataformattype df_type, std::vector<double>& dbinning, t_symtable& symtable) const;
     t_tscalar get_pivot_scalar(t_uindex idx) const;
     t_cell_error get_error(t_uindex idx) const;
     std::string get_error_message(t_uindex idx) const;
@@ -229,6 +276,26 @@ public:
 
     bool is_truncated() const;
 
+    // Per-block statistics, built on first use and brought up to date with
+    // the writes since the last call. nullptr for dtypes without zone maps.
+    std::shared_ptr<const t_zone_map> get_zone_map() const;
+
+    // Values written through get_nth() pointers bypass the zone map and the
+    // search index, the writers (the arrow loaders) call this afterwards
+    void invalidate_zone_map();
+
+    // Token index of the rows for search_cpp, built on first use and brought
+    // up to date like the zone map. nullptr for dtypes it does not cover.
+    std::shared_ptr<const t_search_index> get_search_index() const;
+
+    // Indexes again the rows written since the last call, when the search
+    // index was already built
+    void update_search_index();
+
+    // Rank of each vocab id of a DTYPE_STR column in `collation` order, built
+    // on first use and merged with the strings interned since the last call
+    std::shared_ptr<const t_string_ranks> get_string_ranks(t_string_collation collation) const;
+
 #ifdef PSP_ENABLE_PYTHON
     np::ndarray _as_numpy();
 #endif
@@ -236,6 +303,33 @@ public:
 private:
     void update_metadata();
 
+    // Called when the vocab is replaced rather than appended to
+    void invalidate_string_ranks();
+
+    void
+    zones_changed(t_uindex bidx, t_uindex eidx) {
+        if (m_zones)
+            m_zones->mark(bidx, eidx);
+        if (m_search_index)
+            m_search_index->mark(bidx, eidx);
+    }
+
+    template <typename T>
+    void set_nth_value(t_uindex idx, const T& v);
+    template <typename T>
+    void set_nth_value(t_uindex idx, const std::vector<T>& v);
+    void set_nth_value(t_uindex idx, const std::vector<bool>& v);
+    void set_nth_value(t_uindex idx, const std::vector<std::string>& v);
+
+    template <typename T>
+    void push_back_value(const T& v);
+    template <typename T>
+    void push_back_value(const std::vector<T>& v);
+
+    void set_list_nth_raw(t_uindex idx, const void* items, t_uindex count);
+    void copy_list_nth_raw(t_uindex idx, const t_column& other, t_uindex oidx);
+    void compact_list_values();
+
     t_dtype m_dtype;
     bool m_init;
     bool m_isvlen;
@@ -246,6 +340,13 @@ private:
 
     std::shared_ptr<t_vocab> m_vocab;
 
+    // Items of list columns, m_data holds the extent of each row. Rewritten
+    // cells that do not fit in place move to the end, m_list_garbage counts
+    // the items left behind until they are compacted.
+    std::shared_ptr<t_lstore> m_list_values;
+    t_uindex m_list_elemsize;
+    t_uindex m_list_garbage;
+
     // Missing value support
     std::shared_ptr<t_lstore> m_status;
 
@@ -261,6 +362,12 @@ private:
 
 	std::shared_ptr<t_column_meta> m_meta;
 
+    // Derived from the values and built lazily under m_zones_mutex
+    mutable std::shared_ptr<t_zone_map> m_zones;
+    mutable std::shared_ptr<t_search_index> m_search_index;
+    mutable std::shared_ptr<t_string_ranks> m_string_ranks[STRING_COLLATION_COUNT];
+    mutable std::mutex m_zones_mutex;
+
     std::shared_ptr<std::map<t_uindex, t_cell_error>> m_errors;
 
     t_warning_type m_truncated;
@@ -338,7 +445,7 @@ t_column::extend(t_uindex idx) {
 template <typename DATA_T>
 void
 t_column::push_back(DATA_T elem) {
-    m_data->push_back(elem);
+    push_back_value(elem);
     ++m_size;
 }
 
@@ -346,18 +453,32 @@ template <typename DATA_T>
 void
 t_column::push_back(DATA_T elem, t_status status) {
     PSP_VERBOSE_ASSERT(is_status_enabled(), "Validity not enabled for column");
-    m_data->push_back(elem);
+    push_back_value(elem);
     m_status->push_back(status);
     ++m_size;
 }
 
+template <typename T>
+void
+t_column::push_back_value(const T& v) {
+    m_data->push_back(v);
+}
+
+template <typename T>
+void
+t_column::push_back_value(const std::vector<T>& v) {
+    m_data->push_back(t_list_extent{0, 0});
+    set_nth_value(m_data->size() / sizeof(t_list_extent) - 1, v);
+}
+
 // idx is in items
 
 template <typename T>
 void
 t_column::set_nth(t_uindex idx, T v) {
     COLUMN_CHECK_ACCESS(idx);
-    m_data->set_nth<T>(idx, v);
+    set_nth_value(idx, v);
+    zones_changed(idx, idx + 1);
 
     if (is_status_enabled()) {
         m_status->set_nth<t_status>(idx, STATUS_VALID);
@@ -368,13 +489,66 @@ template <typename T>
 void
 t_column::set_nth(t_uindex idx, T v, t_status status) {
     COLUMN_CHECK_ACCESS(idx);
-    m_data->set_nth<T>(idx, v);
+    set_nth_value(idx, v);
+    zones_changed(idx, idx + 1);
 
     if (is_status_enabled()) {
         m_status->set_nth<t_status>(idx, status);
     }
 }
 
+template <typename T>
+void
+t_column::set_nth_value(t_uindex idx, const T& v) {
+    m_data->set_nth<T>(idx, v);
+}
+
+template <typename T>
+void
+t_column::set_nth_value(t_uindex idx, const std::vector<T>& v) {
+    set_list_nth_raw(idx, v.data(), v.size());
+}
+
+template <typename T>
+t_list_span<T>
+t_column::get_list_nth(t_uindex idx) const {
+    COLUMN_CHECK_ACCESS(idx);
+    const t_list_extent* extent = m_data->get_nth<t_list_extent>(idx);
+    const T* base = m_list_values->get_nth<T>(0);
+    return t_list_span<T>(base + extent->m_begin, base + extent->m_end);
+}
+
+template <typename T>
+void
+t_column::set_list_nth(t_uindex idx, const T* items, t_uindex count) {
+    COLUMN_CHECK_ACCESS(idx);
+    PSP_VERBOSE_ASSERT(sizeof(T) == m_list_elemsize, "Mismatched list item size");
+    set_list_nth_raw(idx, items, count);
+}
+
+template <typename T>
+void
+t_column::set_list_values(const T* items, const std::int32_t* offsets, t_uindex count) {
+    PSP_VERBOSE_ASSERT(sizeof(T) == m_list_elemsize, "Mismatched list item size");
+    t_uindex nitems = offsets[count] - offsets[0];
+    t_uindex base = m_list_values->size() / sizeof(T);
+    PSP_VERBOSE_ASSERT(base + nitems <= std::numeric_limits<std::uint32_t>::max(),
+        "Too many list items in column");
+    if (nitems > 0) {
+        m_list_values->push_back(items + offsets[0], nitems * sizeof(T));
+    }
+
+    t_list_extent* extents = m_data->get_nth<t_list_extent>(0);
+    for (t_uindex idx = 0; idx < count; ++idx) {
+        // extents of cells never written may hold anything
+        if (extents[idx].m_begin <= extents[idx].m_end && extents[idx].m_end <= base) {
+            m_list_garbage += extents[idx].m_end - extents[idx].m_begin;
+        }
+        extents[idx].m_begin = static_cast<std::uint32_t>(base + offsets[idx] - offsets[0]);
+        extents[idx].m_end = static_cast<std::uint32_t>(base + offsets[idx + 1] - offsets[0]);
+    }
+}
+
 template <>
 void t_column::fill<std::vector<const char*>>(
     std::vector<const char*>& vec, const t_uindex* bidx, const t_uindex* eidx) const;
@@ -399,6 +573,7 @@ t_column::set_nth_body(t_uindex idx, DATA_T elem, t_status status) {
     PSP_VERBOSE_ASSERT(m_dtype == DTYPE_STR, "Setting non string column");
     t_uindex interned = m_vocab->get_interned(elem);
     m_data->set_nth<t_uindex>(idx, interned);
+    zones_changed(idx, idx + 1);
 
     if (is_status_enabled()) {
         m_status->set_nth<t_status>(idx, status);
@@ -409,6 +584,7 @@ template <typename DATA_T>
 void
 t_column::raw_fill(DATA_T v) {
     m_data->raw_fill(v);
+    zones_changed(0, m_size);
 }
 
 template <typename VOCAB_T>
@@ -438,6 +614,7 @@ t_column::copy_helper(
     for (t_uindex idx = 0; idx < eidx; ++idx) {
         base[idx + offset] = o_base[indices[idx]];
     }
+    zones_changed(offset, offset + eidx);
 
     if (is_status_enabled() && other->is_status_enabled()) {
         for (t_uindex idx = 0; idx < eidx; ++idx) {
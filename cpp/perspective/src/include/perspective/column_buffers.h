@@ -0,0 +1,63 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
+#include <perspective/column.h>
+#include <perspective/gnode.h>
+#include <perspective/pool.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace perspective {
+
+/**
+ * Arrow-like buffers of one column, owned by the caller. They are read in
+ * place, so that a native loader (e.g. Ingest) can hand its columns over
+ * without going through Javascript.
+ *
+ * - m_validity: packed bits, 1 for a valid row, nullptr if all rows are valid
+ * - m_values: packed bits for DTYPE_BOOL and DTYPE_LIST_BOOL, utf8 bytes for
+ *   DTYPE_STR and DTYPE_LIST_STR, the native values of the dtype otherwise
+ * - m_offsets: nrows + 1 offsets into m_values for DTYPE_STR, into the list
+ *   items for the list dtypes
+ * - m_sub_offsets: offsets of the items into m_values for DTYPE_LIST_STR
+ */
+struct PERSPECTIVE_EXPORT t_column_buffers {
+    std::string m_name;
+    t_dtype m_dtype;
+    const std::uint8_t* m_validity;
+    const void* m_values;
+    const std::int32_t* m_offsets;
+    const std::int32_t* m_sub_offsets;
+};
+
+/**
+ * Fills `col`, already extended to the number of rows, from the buffers.
+ * Fixed width values are copied in bulk and strings are interned once per
+ * distinct value. Invalid rows with an entry for `cidx` in `error_col`
+ * (the __error__ column, may be null) get the error status.
+ */
+PERSPECTIVE_EXPORT void fill_column_from_buffers(t_column& col,
+    const t_column_buffers& buffers, t_index cidx, const t_column* error_col);
+
+/**
+ * Creates a gnode, registers it in the pool and loads `nrows` rows from the
+ * buffers into it, like make_table() does for Arrow data coming from
+ * Javascript.
+ */
+PERSPECTIVE_EXPORT std::shared_ptr<t_gnode> make_table_from_buffers(t_pool* pool,
+    const std::vector<t_column_buffers>& columns, t_uindex nrows,
+    const std::string& index = "", std::uint32_t limit = 4294967295);
+
+} // end namespace perspective
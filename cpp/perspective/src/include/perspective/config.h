@@ -352,7 +352,7 @@ protected:
 private:
     std::vector<t_pivot> m_row_pivots;
     std::vector<t_pivot> m_col_pivots;
-    bool m_column_only;
+    bool m_column_only = false;
     std::map<std::string, std::string> m_sortby;
     std::vector<t_sortspec> m_sortspecs;
     std::vector<t_sortspec> m_col_sortspecs;
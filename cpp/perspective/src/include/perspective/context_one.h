@@ -15,6 +15,7 @@
 #include <perspective/sort_specification.h>
 #include <perspective/traversal.h>
 #include <perspective/table.h>
+#include <perspective/sym_table.h>
 
 namespace perspective {
 
@@ -78,6 +79,8 @@ private:
     bool m_depth_set;
     std::vector<t_indiceinfo> m_traversal_indices;
     std::map<std::string, std::vector<double>> m_default_binning;
+    // Combined row labels, freed with the context
+    mutable t_symtable m_symtable;
 };
 
 } // end namespace perspective
@@ -17,6 +17,7 @@
 #include <perspective/traversal_nodes.h>
 #include <perspective/traversal.h>
 #include <perspective/table.h>
+#include <perspective/sym_table.h>
 
 namespace perspective {
 
@@ -109,6 +110,8 @@ private:
     bool m_column_depth_set;
     std::vector<t_indiceinfo> m_rtraversal_indices;
     std::map<std::string, std::vector<double>> m_default_binning;
+    // Combined row labels, freed with the context
+    mutable t_symtable m_symtable;
 };
 
 } // end namespace perspective
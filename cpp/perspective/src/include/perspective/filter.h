@@ -191,7 +191,9 @@ struct PERSPECTIVE_EXPORT t_fterm_recipe {
 };
 
 struct PERSPECTIVE_EXPORT t_fterm {
-    typedef std::function<uint32_t(t_uindex first, t_uindex last)> t_prepared;
+    // Writes the mask of rows [first, last) as 64-bit words: bit i of words[k] is
+    // row first + 64 * k + i. first is a multiple of 64, bits past last are zero.
+    typedef std::function<void(t_uindex first, t_uindex last, std::uint64_t* words)> t_prepared;
 
     t_fterm();
 
@@ -331,6 +333,7 @@ struct PERSPECTIVE_EXPORT t_fterm {
     t_fterm_recipe get_recipe() const;
     t_prepared optimized_prepare(const t_column *col) const;
     t_prepared prepare(const t_column *col, t_dataformattype force_df) const;
+    static t_prepared combine(t_filter_op combiner, std::vector<t_prepared> terms);
 
     std::string m_colname;
     t_filter_op m_op;
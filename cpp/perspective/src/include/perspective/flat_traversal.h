@@ -61,6 +61,12 @@ public:
 
     void step_end(std::shared_ptr<const t_gstate> state, t_config& config);
 
+    // Moves the rows of an update within the current order, so that the next
+    // step_end does not rebuild it. Returns whether the traversal changed.
+    bool update_rows(std::shared_ptr<const t_gstate> state, t_config& config,
+        const t_table& flattened, const t_table& prev, const t_table& curr,
+        const t_table& existed);
+
     const std::vector<t_sortspec>& get_sort_by() const;
     bool empty_sort_by() const;
 
@@ -71,6 +77,8 @@ private:
     t_symtable m_symtable;
     size_t m_nrows = 0, m_ncols = 0;
     std::shared_ptr<t_table_index> m_index;
+    // m_index was kept in step with the table by update_rows
+    bool m_synced = false;
 };
 
 } // end namespace perspective
@@ -16,22 +16,19 @@
 #include <perspective/mask.h>
 #include <perspective/sym_table.h>
 #include <perspective/rlookup.h>
+#include <perspective/pkey_mapping.h>
 
-#include <boost/container/flat_map.hpp>
 namespace perspective {
 
 std::pair<t_tscalar, t_tscalar> get_vec_min_max(const std::vector<t_tscalar>& vec);
 
 class PERSPECTIVE_EXPORT t_gstate {
-    // GAB: memory optim: use flat_map instead of unordered_map for the mapping, as we can know
-    // in advance the numbers of elements to add, and they are provided "ordered" (VERY IMPORTANT).
-    // flat_* containers are much more memory efficient, and the ordering allows for logarithmic insertions.
-    //
-    // TBD: use of a std::vector instead (as pkeys mostly start at zero and are contiguous. To be checked).
-    //
-    // Also: use t_index type instead of t_scalar type for the map indexes: much more smaller memory footprint.
+    // Use t_index type instead of t_scalar type for the map indexes: much more smaller memory footprint.
     // This is valid since we are only using pkeys as indexes, and they are now only INT32
-    typedef boost::container::flat_map<t_index, t_uindex> t_mapping;
+    //
+    // Pkeys are mostly row numbers, dense from zero, so the mapping is a vector indexed by pkey
+    // until they are not (see t_pkey_mapping).
+    typedef t_pkey_mapping t_mapping;
     typedef std::unordered_set<t_index> t_free_items;
 
 public:
@@ -0,0 +1,39 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
+#include <perspective/column.h>
+#include <perspective/config.h>
+#include <perspective/dense_nodes.h>
+#include <perspective/mask.h>
+#include <vector>
+
+namespace perspective {
+
+/**
+ * Pivot of the nodes [nbidx, neidx) of a dense tree on a column of a fixed
+ * size dtype or strings, with the contract of t_pivot_processor.
+ *
+ * Each row is reduced to an integer key ordered as t_tscalar::operator<
+ * orders its pivot scalar (collation ranks for strings), the keys are grouped
+ * with an open addressing table and only the distinct keys are sorted. Sibling
+ * nodes are pivoted in parallel, then their children are appended in order.
+ */
+struct PERSPECTIVE_EXPORT t_hash_pivot_processor {
+    static bool is_supported(t_dtype dtype);
+
+    t_uindex operator()(const t_column* data, std::vector<t_dense_tnode>* nodes,
+        t_column* values, t_column* leaves, t_uindex nbidx, t_uindex neidx, t_config& config,
+        t_mask& dt_msk, t_sorttype sort_type, t_index sort_limit, t_limit_type limit_type);
+};
+
+} // end namespace perspective
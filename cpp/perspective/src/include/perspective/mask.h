@@ -20,7 +20,9 @@ namespace perspective {
 class t_mask_iterator;
 
 class PERSPECTIVE_EXPORT t_mask {
-    typedef boost::dynamic_bitset<>::size_type t_msize;
+    // 64-bit blocks on every target, so that filters can append whole words
+    typedef boost::dynamic_bitset<std::uint64_t> t_bitmap;
+    typedef t_bitmap::size_type t_msize;
 
 public:
     t_mask();
@@ -43,14 +45,19 @@ public:
 
     t_uindex find_first() const;
     t_uindex find_next(t_uindex pos) const;
-    static const t_uindex m_npos = boost::dynamic_bitset<>::npos;
+    static const t_uindex m_npos = t_bitmap::npos;
     t_uindex size() const { return m_bitmap.size(); }
     void reserve(t_uindex sz) { m_bitmap.reserve(sz); }
-    void append(uint32_t block) { m_bitmap.append(block); }
+    void resize(t_uindex sz) { m_bitmap.resize(t_msize(sz)); }
+
+    // Appends 64 bits per word, bit i of words[k] becomes bit size() + 64 * k + i
+    void append_words(const std::uint64_t* words, t_uindex nwords) {
+        m_bitmap.append(words, words + nwords);
+    }
     void pprint() const;
 
 private:
-    boost::dynamic_bitset<> m_bitmap;
+    t_bitmap m_bitmap;
 };
 
 typedef std::shared_ptr<t_mask> t_masksptr;
@@ -15,6 +15,7 @@
 #include <perspective/column.h>
 #include <perspective/comparators.h>
 #include <perspective/dense_nodes.h>
+#include <perspective/hash_pivot.h>
 #include <perspective/node_processor_types.h>
 #include <perspective/partition.h>
 #include <perspective/mask.h>
@@ -31,12 +32,17 @@ struct t_pivot_processor {
     typedef std::vector<t_spanvec> t_spanvvec;
     typedef std::map<t_tscalar, t_uindex, t_comparator<t_tscalar, DTYPE_T>> t_map;
 
-    // For now we dont do any inter node
-    // parallelism. this should be trivial
-    // to fix in the future.
+    // Fixed size and string columns use t_hash_pivot_processor, which
+    // pivots sibling nodes in parallel.
     t_uindex operator()(const t_column* data, std::vector<t_dense_tnode>* nodes,
         t_column* values, t_column* leaves, t_uindex nbidx, t_uindex neidx, const t_mask* mask, t_config& config, t_mask &dt_msk,
         t_sorttype sort_type = SORTTYPE_ASCENDING, t_index sort_limit = t_index(-1), t_limit_type limit_type = LIMIT_TYPE_ITEMS);
+
+    // Pivot on the t_tscalar values of the rows, merged through std::maps.
+    // Used for the other dtypes.
+    t_uindex pivot_map(const t_column* data, std::vector<t_dense_tnode>* nodes, t_column* values,
+        t_column* leaves, t_uindex nbidx, t_uindex neidx, t_config& config, t_mask& dt_msk,
+        t_sorttype sort_type, t_index sort_limit, t_limit_type limit_type);
 };
 
 template <int DTYPE_T>
@@ -47,6 +53,21 @@ t_pivot_processor<DTYPE_T>::operator()(const t_column* data, std::vector<t_dense
     t_column* leaves, t_uindex nbidx, t_uindex neidx, const t_mask* mask, t_config& config, t_mask &dt_msk,
     t_sorttype sort_type, t_index sort_limit, t_limit_type limit_type) {
 
+    if (t_hash_pivot_processor::is_supported(data->get_dtype())) {
+        return t_hash_pivot_processor()(data, nodes, values, leaves, nbidx, neidx, config,
+            dt_msk, sort_type, sort_limit, limit_type);
+    }
+
+    return pivot_map(data, nodes, values, leaves, nbidx, neidx, config, dt_msk, sort_type,
+        sort_limit, limit_type);
+}
+
+template <int DTYPE_T>
+t_uindex
+t_pivot_processor<DTYPE_T>::pivot_map(const t_column* data, std::vector<t_dense_tnode>* nodes,
+    t_column* values, t_column* leaves, t_uindex nbidx, t_uindex neidx, t_config& config,
+    t_mask& dt_msk, t_sorttype sort_type, t_index sort_limit, t_limit_type limit_type) {
+
     t_lstore lcopy(leaves->data_lstore(), t_lstore_tmp_init_tag());
 
     // add accessor api and move these to that
@@ -13,6 +13,7 @@
 #include <perspective/raw_types.h>
 #include <perspective/column.h>
 #include <perspective/node_processor_types.h>
+#include <perspective/string_ranks.h>
 #include <vector>
 #include <algorithm>
 
@@ -102,6 +103,58 @@ argsortdesc(const DATA_T* b, std::vector<t_uindex>& output) {
     std::sort(output.begin(), output.end(), cmp);
 }
 
+// Partitions the leaves of a DTYPE_STR column on the collation ranks of its
+// vocab instead of comparing pivot scalars. Rows are ordered as by
+// t_tscalar::operator<: on the status, then on the string for the valid and
+// warning rows.
+inline void
+partition_str(const t_column* PSP_RESTRICT data_, t_uindex* PSP_RESTRICT leaves, t_uindex bidx,
+    t_uindex eidx, std::vector<t_chunk_value_span<t_tscalar>>& out_spans, t_sorttype sort_type) {
+    typedef t_chunk_value_span<t_tscalar> t_cvs;
+    std::shared_ptr<const t_string_ranks> str_ranks
+        = data_->get_string_ranks(STRING_COLLATION_SCALAR);
+    const std::uint32_t* ranks = str_ranks->get_ranks();
+    const t_uindex* sidx = data_->get_nth<t_uindex>(0);
+    const t_status* status = data_->is_status_enabled() ? data_->get_nth_status(0) : nullptr;
+    t_uindex nelems = eidx - bidx;
+
+    std::vector<std::uint64_t> keys(nelems);
+    for (t_uindex idx = 0; idx < nelems; ++idx) {
+        t_uindex leaf = leaves[bidx + idx];
+        t_status s = status ? status[leaf] : STATUS_VALID;
+        bool valid = s == STATUS_VALID || s == STATUS_WARNING;
+        keys[idx] = std::uint64_t(s) << 32 | (valid ? ranks[sidx[leaf]] : 0);
+    }
+
+    std::vector<t_uindex> order(nelems);
+    for (t_uindex idx = 0; idx < nelems; ++idx) {
+        order[idx] = idx;
+    }
+    if (sort_type != SORTTYPE_DESCENDING) {
+        std::stable_sort(order.begin(), order.end(),
+            [&keys](t_uindex a, t_uindex b) { return keys[a] < keys[b]; });
+    } else {
+        std::stable_sort(order.begin(), order.end(),
+            [&keys](t_uindex a, t_uindex b) { return keys[a] > keys[b]; });
+    }
+
+    std::vector<t_uindex> temp_leaves(nelems);
+    for (t_uindex j = 0; j < nelems; ++j) {
+        temp_leaves[j] = leaves[bidx + order[j]];
+    }
+    memcpy(leaves + bidx, temp_leaves.data(), sizeof(t_uindex) * nelems);
+
+    for (t_uindex begin = 0, end; begin < nelems; begin = end) {
+        end = begin + 1;
+        while (end < nelems && keys[order[end]] == keys[order[begin]]) {
+            ++end;
+        }
+        out_spans.push_back(t_cvs());
+        fill_chunk_value_span<t_tscalar>(out_spans.back(),
+            data_->get_pivot_scalar(temp_leaves[begin]), bidx + begin, bidx + end);
+    }
+}
+
 inline void
 partition(const t_column* PSP_RESTRICT data_, t_column* PSP_RESTRICT leaves_, t_uindex bidx,
     t_uindex eidx, std::vector<t_chunk_value_span<t_tscalar>>& out_spans, t_sorttype sort_type = SORTTYPE_ASCENDING) {
@@ -117,6 +170,12 @@ partition(const t_column* PSP_RESTRICT data_, t_column* PSP_RESTRICT leaves_, t_
             fill_chunk_value_span<t_tscalar>(c, data_->get_pivot_scalar(leaves[bidx]), bidx, eidx);
         } break;
         default: {
+            if (data_->get_dtype() == DTYPE_STR
+                && data_->get_vocab()->get_vlenidx() <= data_->size()) {
+                partition_str(data_, leaves, bidx, eidx, out_spans, sort_type);
+                break;
+            }
+
             std::vector<t_tscalar> buf(nelems);
             for (t_uindex idx = 0; idx < nelems; ++idx) {
                 buf[idx] = data_->get_pivot_scalar(leaves[bidx + idx]);
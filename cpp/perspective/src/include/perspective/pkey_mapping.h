@@ -0,0 +1,135 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace perspective {
+
+/**
+ * Map of integer primary keys to rows of the gnode state table.
+ *
+ * Keys are usually row numbers, dense from zero. While they stay dense the
+ * row of a key is kept at its position in a vector, absent keys holding a
+ * sentinel. A key that is negative or far past the others switches the map to
+ * an open addressing hash table with linear probing, for good.
+ */
+class PERSPECTIVE_EXPORT t_pkey_mapping {
+public:
+    t_pkey_mapping();
+
+    // Row of a key, or NOT_FOUND
+    t_uindex find(t_index key) const;
+    bool contains(t_index key) const;
+
+    void set(t_index key, t_uindex row);
+    void erase(t_index key);
+
+    t_uindex size() const;
+    bool empty() const;
+    bool is_dense() const;
+    void reserve(t_uindex n);
+    void clear();
+
+    // Calls fn(key, row) for each key, in key order while the map is dense
+    template <typename FN_T>
+    void for_each(FN_T fn) const;
+
+    static const t_uindex NOT_FOUND = std::numeric_limits<t_uindex>::max();
+
+private:
+    // Slot holding a key that was erased
+    static const t_uindex TOMBSTONE = NOT_FOUND - 1;
+
+    bool fits_dense(t_index key) const;
+    void to_hash();
+    void rehash(t_uindex capacity);
+    t_uindex slot(t_index key) const;
+    t_uindex find_slot(t_index key) const;
+
+    bool m_dense;
+    t_uindex m_size;
+    // dense: row by key
+    std::vector<t_uindex> m_rows;
+    // hash: keys and rows by slot, unused slots hold NOT_FOUND or TOMBSTONE
+    std::vector<t_index> m_keys;
+    t_uindex m_tombstones;
+};
+
+inline t_uindex
+t_pkey_mapping::slot(t_index key) const {
+    std::uint64_t h = static_cast<std::uint64_t>(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h & (m_keys.size() - 1);
+}
+
+inline t_uindex
+t_pkey_mapping::find(t_index key) const {
+    if (m_dense) {
+        if (key < 0 || static_cast<t_uindex>(key) >= m_rows.size()) {
+            return NOT_FOUND;
+        }
+        t_uindex row = m_rows[key];
+        return row == TOMBSTONE ? NOT_FOUND : row;
+    }
+
+    t_uindex s = find_slot(key);
+    return s == NOT_FOUND ? NOT_FOUND : m_rows[s];
+}
+
+inline t_uindex
+t_pkey_mapping::find_slot(t_index key) const {
+    if (m_keys.empty()) {
+        return NOT_FOUND;
+    }
+
+    t_uindex mask = m_keys.size() - 1;
+    for (t_uindex s = slot(key);; s = (s + 1) & mask) {
+        t_uindex row = m_rows[s];
+        if (row == NOT_FOUND) {
+            return NOT_FOUND;
+        }
+        if (row != TOMBSTONE && m_keys[s] == key) {
+            return s;
+        }
+    }
+}
+
+inline bool
+t_pkey_mapping::contains(t_index key) const {
+    return find(key) != NOT_FOUND;
+}
+
+template <typename FN_T>
+void
+t_pkey_mapping::for_each(FN_T fn) const {
+    if (m_dense) {
+        for (t_uindex key = 0, loop_end = m_rows.size(); key < loop_end; ++key) {
+            if (m_rows[key] != TOMBSTONE) {
+                fn(static_cast<t_index>(key), m_rows[key]);
+            }
+        }
+        return;
+    }
+
+    for (t_uindex s = 0, loop_end = m_keys.size(); s < loop_end; ++s) {
+        if (m_rows[s] != NOT_FOUND && m_rows[s] != TOMBSTONE) {
+            fn(m_keys[s], m_rows[s]);
+        }
+    }
+}
+
+} // end namespace perspective
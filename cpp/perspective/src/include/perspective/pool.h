@@ -14,6 +14,9 @@
 #include <perspective/exports.h>
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
 
 #ifdef PSP_ENABLE_WASM
 #include <emscripten/val.h>
@@ -29,6 +32,21 @@ struct PERSPECTIVE_EXPORT t_updctx {
     std::string m_ctx;
 };
 
+// Counters of the updates flushed by a pool, times in microseconds
+struct PERSPECTIVE_EXPORT t_pool_stats {
+    t_pool_stats();
+
+    t_uindex m_nflushes;
+    // Rows sent in the flushed updates
+    t_uindex m_nrows;
+    // From the first send of an update to the end of its flush
+    t_uindex m_last_latency;
+    t_uindex m_max_latency;
+    t_uindex m_total_latency;
+    // Spent processing the flushed updates
+    t_uindex m_total_process;
+};
+
 class t_update_task;
 
 class PERSPECTIVE_EXPORT t_pool {
@@ -62,7 +80,15 @@ public:
     void _process_helper();
     void init();
     void stop();
+    // Coalescing of the sends processed by the pool thread: pending data is
+    // flushed once nrows rows are pending (if nrows > 0), or delay
+    // microseconds after its first send. Flushes right away by default.
+    // No effect on wasm, which has no pool thread.
+    void set_coalescing(t_uindex nrows, t_uindex delay);
+    // Same as a delay of ms milliseconds
     void set_sleep(t_uindex ms);
+    t_pool_stats get_stats() const;
+    void reset_stats();
     std::vector<t_stree*> get_trees();
 
     bool get_data_remaining() const;
@@ -88,16 +114,35 @@ protected:
     bool validate_gnode_id(t_uindex gnode_id) const;
 
 private:
+    // Body of the pool thread, waits for sends instead of polling
+    void _process_loop();
+    // Runs the update task on the pending data taken by take_pending
+    void _process_pending(t_uindex nrows, std::chrono::steady_clock::time_point since);
+    // Reads and resets the pending sends, under m_mtx
+    void take_pending(t_uindex& nrows, std::chrono::steady_clock::time_point& since);
+    // Adds a flush of nrows rows, first sent at since, to the stats; only
+    // takes m_stats_mtx
+    void record_flush(std::chrono::steady_clock::time_point start,
+        std::chrono::steady_clock::time_point since, t_uindex nrows);
+
     std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::thread m_thread;
     std::vector<t_gnode*> m_gnodes;
 
 #ifdef PSP_ENABLE_WASM
     emscripten::val m_update_delegate;
 #endif
-    std::atomic_flag m_run;
+    std::atomic<bool> m_run;
     std::atomic<bool> m_data_remaining;
-    std::atomic<t_uindex> m_sleep;
+    std::atomic<t_uindex> m_flush_rows;
+    std::atomic<t_uindex> m_flush_delay;
     std::atomic<t_uindex> m_epoch;
+    // Sends since the last flush, guarded by m_mtx
+    t_uindex m_pending_rows;
+    std::chrono::steady_clock::time_point m_pending_since;
+    mutable std::mutex m_stats_mtx;
+    t_pool_stats m_stats;
     bool m_has_python_dep;
 };
 
@@ -89,6 +89,12 @@ struct t_extent_pair {
     t_uindex m_end;
 };
 
+// Items [m_begin, m_end) of a list cell in the child values of its column
+struct t_list_extent {
+    std::uint32_t m_begin;
+    std::uint32_t m_end;
+};
+
 struct t_column_static_ctx {
     std::string m_colname;
     t_dtype m_dtype;
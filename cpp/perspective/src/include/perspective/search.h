@@ -22,6 +22,10 @@ public:
 
 	const std::string &get_sterm() const;
 
+    // nullptr when the term does not read as a number or a date
+    const double* get_sterm_double() const;
+    const t_date* get_sterm_date() const;
+
 	bool call_pp(const t_tscalar& s, t_searchtype search_type) const;
 
     friend bool operator ==(const t_sterm &x, const t_sterm &y) {
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
+#include <perspective/mask.h>
+#include <perspective/search.h>
+#include <perspective/searchspec.h>
+#include <perspective/zone_map.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace perspective {
+
+class t_column;
+
+/**
+ * Inverted index of the search keys of a column: the lowercased words of
+ * the renderings t_tscalar::pp_search_* compare terms with, the numbers of
+ * numeric columns and the dates read at the start of each word of string
+ * cells. Each block of ZONE_MAP_BLOCK_SIZE rows keeps its own posting lists,
+ * the rows are stored as varint encoded deltas, so writes only tokenize
+ * again the blocks they touch.
+ *
+ * find() answers with a superset of the rows a term can pass, search_cpp
+ * still checks the candidate rows cell by cell.
+ */
+class PERSPECTIVE_EXPORT t_search_index {
+public:
+    t_search_index();
+
+    static bool is_supported(t_dtype dtype);
+
+    void mark(t_uindex bidx, t_uindex eidx);
+    void mark_all();
+
+    void update(const t_column& col);
+
+    // Rows that may pass `sterm` searched with `type`, nullptr when the
+    // index cannot narrow them down (contains searches)
+    t_masksptr find(const t_sterm& sterm, t_searchtype type) const;
+
+    // Keys of removed values stay in the dictionaries without postings
+    t_uindex num_keys() const { return m_nkeys; }
+
+private:
+    struct t_segment {
+        // sorted key ids, the postings of m_keys[i] are the bytes
+        // [m_offsets[i], m_offsets[i + 1]) of m_postings
+        std::vector<std::uint32_t> m_keys;
+        std::vector<std::uint32_t> m_offsets;
+        std::vector<std::uint8_t> m_postings;
+    };
+
+    void add_words(const char* s, std::vector<std::uint32_t>& out);
+    void add_keys(const t_column& col, t_uindex ridx, std::vector<std::uint32_t>& out);
+    void index_block(const t_column& col, t_uindex zidx);
+
+    std::vector<std::uint32_t> find_words(const std::string& word) const;
+    std::vector<std::uint32_t> find_number(double d) const;
+    std::vector<std::uint32_t> find_date(const t_date& date) const;
+    t_masksptr find_terms(const std::string& sterm) const;
+    void fill_rows(const std::vector<std::uint32_t>& ids, t_mask& rows) const;
+
+    t_dtype m_dtype;
+    std::map<std::string, std::uint32_t> m_words;
+    std::map<double, std::uint32_t> m_numbers;
+    std::map<t_date::t_rawtype, std::uint32_t> m_dates;
+    std::uint32_t m_nkeys;
+
+    std::vector<t_segment> m_segments;
+    std::vector<bool> m_dirty;
+    // rows covered by the last update
+    t_uindex m_nrows;
+    bool m_has_dirty;
+};
+
+} // end namespace perspective
@@ -0,0 +1,96 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
+#include <perspective/scalar.h>
+#include <cstdint>
+#include <vector>
+
+namespace perspective {
+
+/**
+ * Mergeable quantile sketch (KLL), over the finite numeric, date, time and
+ * duration values added to it, kept as doubles.
+ *
+ * Values are kept exactly until level 0 fills, after which pairs of sorted
+ * items are compacted into one item of twice the weight. For a capacity k the
+ * rank of a returned quantile is within about 1.7 / k of the requested one,
+ * and the quantile is always one of the added values. Merging two sketches
+ * gives the same bounds as adding every value to one sketch.
+ */
+class PERSPECTIVE_EXPORT t_quantile_sketch {
+public:
+    t_quantile_sketch(t_uindex k = DEFAULT_K);
+
+    void add(double v);
+    // Skips nulls, NaN and values that are neither numbers nor dates,
+    // times or durations
+    void add(const t_tscalar& v);
+    void merge(const t_quantile_sketch& other);
+
+    bool empty() const;
+    // Number of values added
+    t_uindex count() const;
+    // Number of values kept
+    t_uindex size() const;
+
+    // Value at rank floor(q * count()), the upper median for q = 0.5
+    double quantile(double q) const;
+    // quantile(q) as a scalar of dtype, the type of the added values
+    t_tscalar quantile(double q, t_dtype dtype) const;
+
+    enum { DEFAULT_K = 200 };
+
+private:
+    t_uindex capacity(t_uindex level) const;
+    void compact(t_uindex level);
+    void compress();
+
+    t_uindex m_k;
+    t_uindex m_n;
+    // alternates the items kept by successive compactions
+    bool m_odd;
+    // items of level h weigh 2^h
+    std::vector<std::vector<double>> m_levels;
+};
+
+/**
+ * Mergeable distinct count sketch (HyperLogLog).
+ *
+ * Hashes are kept exactly in a sorted list until it reaches the size of the
+ * registers, so counts below SPARSE_LIMIT are exact. Above it the standard
+ * error of the estimate is 1.04 / sqrt(2^PRECISION), about 1.6%.
+ */
+class PERSPECTIVE_EXPORT t_distinct_sketch {
+public:
+    t_distinct_sketch();
+
+    void add(const t_tscalar& v);
+    void add_hash(std::uint64_t h);
+    void merge(const t_distinct_sketch& other);
+
+    bool empty() const;
+    std::uint64_t estimate() const;
+
+    static std::uint64_t hash(const t_tscalar& v);
+
+    enum { PRECISION = 12, NREGISTERS = 1 << PRECISION, SPARSE_LIMIT = NREGISTERS / 8 };
+
+private:
+    void densify();
+    void insert_register(std::uint64_t h);
+
+    std::vector<std::uint64_t> m_sparse;
+    std::vector<std::uint8_t> m_registers;
+};
+
+} // end namespace perspective
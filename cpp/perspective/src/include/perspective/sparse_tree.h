@@ -16,11 +16,11 @@ SUPPRESS_WARNINGS_VC(4503)
 #include <perspective/exports.h>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
-#include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/composite_key.hpp>
 #include <perspective/sort_specification.h>
 #include <perspective/sparse_tree_node.h>
+#include <perspective/sparse_tree_nodes.h>
 #include <perspective/pivot.h>
 #include <perspective/aggspec.h>
 #include <perspective/step_delta.h>
@@ -29,11 +29,13 @@ SUPPRESS_WARNINGS_VC(4503)
 #include <perspective/sym_table.h>
 #include <perspective/table.h>
 #include <perspective/dense_tree.h>
+#include <perspective/sketch.h>
 #include <vector>
 #include <algorithm>
 #include <deque>
 #include <sstream>
 #include <queue>
+#include <unordered_map>
 
 namespace perspective {
 
@@ -48,16 +50,6 @@ using namespace boost::multi_index;
 typedef std::pair<t_depth, t_index> t_dptipair;
 typedef std::vector<t_dptipair> t_dptipairvec;
 
-struct by_idx {};
-
-struct by_depth {};
-
-struct by_pidx {};
-
-struct by_pidx_hash {};
-
-struct by_nstrands {};
-
 struct by_idx_pkey {};
 
 struct by_idx_lfidx {};
@@ -76,23 +68,6 @@ struct t_build_strand_table_common_rval {
     std::vector<t_binning_info> m_binning_vec;
 };
 
-typedef multi_index_container<t_stnode,
-    indexed_by<
-        ordered_unique<tag<by_idx>,
-            BOOST_MULTI_INDEX_MEMBER(t_stnode, t_uindex, m_idx)>,
-        hashed_non_unique<tag<by_depth>,
-            BOOST_MULTI_INDEX_MEMBER(t_stnode, std::uint8_t, m_depth)>,
-        hashed_non_unique<tag<by_nstrands>,
-            BOOST_MULTI_INDEX_MEMBER(t_stnode, t_uindex, m_nstrands)>,
-        ordered_unique<tag<by_pidx>,
-            composite_key<t_stnode, BOOST_MULTI_INDEX_MEMBER(t_stnode, t_uindex, m_pidx),
-                BOOST_MULTI_INDEX_MEMBER(t_stnode, t_tscalar, m_sort_value),
-                BOOST_MULTI_INDEX_MEMBER(t_stnode, t_tscalar, m_value)>>,
-        ordered_unique<tag<by_pidx_hash>,
-            composite_key<t_stnode, BOOST_MULTI_INDEX_MEMBER(t_stnode, t_uindex, m_pidx),
-                BOOST_MULTI_INDEX_MEMBER(t_stnode, t_tscalar, m_value)>>>>
-    t_treenodes;
-
 typedef multi_index_container<t_stpkey,
     indexed_by<ordered_unique<tag<by_idx_pkey>,
         composite_key<t_stpkey, BOOST_MULTI_INDEX_MEMBER(t_stpkey, t_uindex, m_idx),
@@ -105,15 +80,6 @@ typedef multi_index_container<t_stleaves,
             BOOST_MULTI_INDEX_MEMBER(t_stleaves, t_uindex, m_lfidx)>>>>
     t_idxleaf;
 
-typedef t_treenodes::index<by_idx>::type index_by_idx;
-typedef t_treenodes::index<by_pidx>::type index_by_pidx;
-
-typedef t_treenodes::index<by_idx>::type::iterator iter_by_idx;
-typedef t_treenodes::index<by_pidx>::type::iterator iter_by_pidx;
-typedef t_treenodes::index<by_pidx_hash>::type::iterator iter_by_pidx_hash;
-typedef t_treenodes::index<by_depth>::type::iterator iter_by_depth;
-typedef std::pair<iter_by_pidx, iter_by_pidx> t_by_pidx_ipair;
-
 typedef t_idxpkey::index<by_idx_pkey>::type::iterator iter_by_idx_pkey;
 
 typedef std::pair<iter_by_idx_pkey, iter_by_idx_pkey> t_by_idx_pkey_ipair;
@@ -122,6 +88,8 @@ struct PERSPECTIVE_EXPORT t_agg_update_info {
     std::vector<const t_column*> m_src;
     std::vector<t_column*> m_dst;
     std::vector<t_aggspec> m_aggspecs;
+    // columns moved by the deltas of the update instead of being recomputed
+    std::vector<bool> m_from_deltas;
 
     std::vector<t_uindex> m_dst_topo_sorted;
 };
@@ -186,8 +154,14 @@ public:
         t_config& config, std::map<t_index, t_index>& period_map,
         std::vector<t_binning_info>& binning_vec, std::map<std::string, std::vector<double>>& default_binning) const;
 
+    // Aggregates that an update can move by its deltas, without reading back
+    // the rows of the nodes it touches
+    std::set<std::string> get_delta_aggregates(const t_table& flattened, const t_table& delta,
+        const t_table& prev, const t_table& existed, const t_config& config) const;
+
     void update_shape_from_static(const t_dtree_ctx& ctx, t_config& config);
-    void update_aggs_from_static(const t_dtree_ctx& ctx, const t_gstate& gstate, t_config& config);
+    void update_aggs_from_static(const t_dtree_ctx& ctx, const t_gstate& gstate, t_config& config,
+        const std::set<std::string>& delta_aggregates = std::set<std::string>());
     void update_tree_from_combined_field(const t_dtree_ctx& ctx, t_config& config);
 
     t_mask having_mask(t_config& config, const std::vector<t_fterm>& fterms_, t_uindex level,
@@ -275,6 +249,7 @@ public:
 
     void set_feature_state(t_ctx_feature feature, bool state);
 
+    // Over a range of node ids
     template <typename ITER_T>
     t_minmax get_agg_min_max(ITER_T biter, ITER_T eiter, t_uindex aggidx) const;
     t_minmax get_agg_min_max(t_uindex aggidx, t_depth depth) const;
@@ -307,7 +282,7 @@ public:
 
     void clear_aggregates(const std::vector<t_uindex>& indices);
 
-    std::pair<iter_by_idx, bool> insert_node(const t_tnode& node);
+    bool insert_node(const t_tnode& node);
     bool has_deltas() const;
     void set_has_deltas(bool v);
 
@@ -327,6 +302,7 @@ protected:
     bool pivots_changed(t_value_transition t) const;
     t_uindex genidx();
     t_uindex gen_aggidx();
+    void update_npkeys(t_uindex idx, t_index delta);
     std::vector<t_uindex> get_children(t_uindex idx) const;
     void update_agg_table(t_uindex nidx, t_agg_update_info& info, t_uindex src_ridx,
         t_uindex dst_ridx, t_index nstrands, const t_gstate& gstate, const t_config& config);
@@ -334,6 +310,13 @@ protected:
         t_uindex dst_ridx, t_index nstrands, t_mask msk, t_depth level, std::map<t_uindex, t_depth> dmap,
         const t_gstate& gstate, const t_config& config);
 
+    // Rebuilds the sketch of a node, from its children's sketches when it
+    // has any, else from its own pkeys
+    template <typename SKETCH_T>
+    const SKETCH_T& update_sketch(t_uindex nidx, t_uindex aggidx, std::vector<SKETCH_T>& sketches,
+        const std::string& tbl_colname, bool has_previous_filters, t_period_type period_type,
+        const t_gstate& gstate);
+
     t_build_strand_table_common_rval build_strand_table_common(const t_table& flattened,
         const std::vector<t_aggspec>& aggspecs, const t_config& config) const;
 
@@ -361,18 +344,23 @@ private:
     t_uindex m_cur_aggidx;
     std::set<t_uindex> m_newids;
     std::set<t_uindex> m_newleaves;
+    // change in primary keys of each node in the last update
+    std::unordered_map<t_uindex, t_index> m_npkeys_deltas;
     t_sidxmap m_smap;
     std::vector<const t_column*> m_aggcols;
     std::shared_ptr<t_tcdeltas> m_deltas;
     std::vector<t_minmax> m_minmax;
     t_tree_unify_rec_vec m_tree_unification_records;
     std::vector<bool> m_features;
-    t_symtable m_symtable;
+    mutable t_symtable m_symtable;
     bool m_has_delta;
     std::string m_grand_agg_str;
     t_mask m_saved_msk;
     std::map<t_index, t_index> m_period_map;
     std::vector<t_binning_info> m_binning_vec;
+    // sketches of the approximate aggregates, by aggregate column then aggidx
+    std::map<t_uindex, std::vector<t_quantile_sketch>> m_quantile_sketches;
+    std::map<t_uindex, std::vector<t_distinct_sketch>> m_distinct_sketches;
 };
 
 template <typename ITER_T>
@@ -383,9 +371,9 @@ t_stree::get_agg_min_max(ITER_T biter, ITER_T eiter, t_uindex aggidx) const {
     t_minmax minmax;
 
     for (auto iter = biter; iter != eiter; ++iter) {
-        if (iter->m_idx == 0)
+        if (*iter == 0)
             continue;
-        t_uindex aggidx = iter->m_aggidx;
+        t_uindex aggidx = m_nodes->get_aggidx(*iter);
         t_tscalar v = col->get_scalar(aggidx);
 
         if (minmax.m_min.is_none()) {
@@ -0,0 +1,139 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
+#include <perspective/scalar.h>
+#include <perspective/sparse_tree_node.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace perspective {
+
+/**
+ * Node store of a t_stree, as arrays indexed by node id.
+ *
+ * The children of a node are a contiguous range of an arena, ordered by
+ * (sort value, value) as t_tscalar::operator< orders them. Children added
+ * out of order are sorted on the next read. A hash of (parent, value) finds
+ * the child of a node with a given value, values equivalent under
+ * t_tscalar::operator< hash alike.
+ *
+ * Values are kept as their raw scalar payload, strings are expected to be
+ * interned by the tree.
+ */
+class PERSPECTIVE_EXPORT t_treenodes {
+public:
+    t_treenodes();
+
+    t_uindex size() const;
+    // Node ids are below id_end()
+    t_uindex id_end() const;
+    bool contains(t_uindex idx) const;
+
+    // Fails when the id is taken, or when the parent already has a child
+    // with an equivalent value
+    bool insert(const t_stnode& node);
+    void clear();
+
+    t_stnode get(t_uindex idx) const;
+    t_uindex get_pidx(t_uindex idx) const;
+    std::uint8_t get_depth(t_uindex idx) const;
+    t_uindex get_nstrands(t_uindex idx) const;
+    // Primary keys under a node, kept by the tree
+    t_uindex get_npkeys(t_uindex idx) const;
+    t_uindex get_aggidx(t_uindex idx) const;
+    t_tscalar get_value(t_uindex idx) const;
+    t_tscalar get_sort_value(t_uindex idx) const;
+
+    void set_nstrands(t_uindex idx, t_uindex nstrands);
+    void set_npkeys(t_uindex idx, t_uindex npkeys);
+    void set_show(t_uindex idx, bool show);
+    void set_value(t_uindex idx, const t_tscalar& value);
+    void set_sort_value(t_uindex idx, const t_tscalar& sort_value);
+
+    // Children of a node (live or not), in (sort value, value) order
+    t_uindex get_num_children(t_uindex idx) const;
+    const t_uindex* children_begin(t_uindex idx) const;
+    const t_uindex* children_end(t_uindex idx) const;
+
+    // Id of the child of pidx with a value equivalent to value, or
+    // INVALID_INDEX
+    t_index find_child(t_uindex pidx, const t_tscalar& value) const;
+
+    // Live nodes with no strands, in id order
+    std::vector<t_uindex> zero_strands() const;
+    void erase(const std::vector<t_uindex>& ids);
+
+private:
+    // t_tscalar without its unused error description
+    struct t_value {
+        t_scalar_u m_data;
+        std::uint32_t m_list_size;
+        std::uint8_t m_type;
+        std::uint8_t m_dftype;
+        std::uint8_t m_status;
+        bool m_inplace;
+    };
+
+    static t_value pack(const t_tscalar& s);
+    static t_tscalar unpack(const t_value& v);
+    static std::uint64_t hash_child(t_uindex pidx, const t_tscalar& value);
+
+    bool child_less(t_uindex a, t_uindex b) const;
+    void reserve_ids(t_uindex idx);
+    void add_child(t_uindex pidx, t_uindex idx);
+    void mark_unsorted(t_uindex pidx);
+    void sort_children() const;
+    void hash_insert(t_uindex idx);
+    void hash_erase(t_uindex idx);
+    void rehash(t_uindex capacity);
+    void compact_arena();
+
+    enum {
+        NODE_LIVE = 1,
+        NODE_SHOW = 2
+    };
+
+    t_uindex m_size;
+
+    // per node id
+    std::vector<t_uindex> m_pidx;
+    std::vector<std::uint8_t> m_depth;
+    std::vector<std::uint8_t> m_flags;
+    std::vector<t_uindex> m_nstrands;
+    std::vector<t_uindex> m_npkeys;
+    std::vector<t_uindex> m_aggidx;
+    std::vector<t_value> m_value;
+    std::vector<t_value> m_sort_value;
+    std::vector<std::uint64_t> m_hash;
+    std::vector<t_uindex> m_cbegin;
+    std::vector<std::uint32_t> m_csize;
+    std::vector<std::uint32_t> m_ccap;
+
+    // child ranges, m_arena_garbage slots are unused
+    mutable std::vector<t_uindex> m_arena;
+    t_uindex m_arena_garbage;
+
+    // open addressing on hash_child, holds id + 1
+    std::vector<t_uindex> m_slots;
+    t_uindex m_nslots_used;
+
+    // parents with children out of order
+    mutable std::vector<std::uint8_t> m_cunsorted;
+    mutable std::vector<t_uindex> m_unsorted;
+    mutable std::atomic<t_uindex> m_nunsorted;
+    mutable std::mutex m_sort_mutex;
+};
+
+} // end namespace perspective
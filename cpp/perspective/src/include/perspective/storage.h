@@ -368,6 +368,7 @@ struct PERSPECTIVE_EXPORT t_column_recipe {
     t_lstore_recipe m_data;
     t_lstore_recipe m_vlendata;
     t_lstore_recipe m_extents;
+    t_lstore_recipe m_list_values;
     t_lstore_recipe m_status;
     t_uindex m_vlenidx;
     t_uindex m_size;
@@ -0,0 +1,65 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
+#include <cstdint>
+#include <vector>
+
+namespace perspective {
+
+class t_vocab;
+
+// Case insensitive orders of strings
+enum t_string_collation {
+    // t_tscalar comparisons (t_const_char_comparator), used by pivots
+    STRING_COLLATION_SCALAR,
+    // psp_strcasecmp, used to sort flat views
+    STRING_COLLATION_SORT,
+    STRING_COLLATION_COUNT
+};
+
+// Collation order of flat view sorts: iscntrl < isspace < ispunct < isalnum
+// < unicode, upper and lower case are equal
+PERSPECTIVE_EXPORT int psp_strcasecmp(const char* x, const char* y);
+
+/**
+ * Rank of each string id of a vocab in a collation order. Strings that
+ * compare equal share their rank, so sorting or grouping rows on the ranks
+ * gives the same result as comparing the strings.
+ *
+ * update() follows the vocab: as ids are only appended, the strings interned
+ * since the previous call are sorted and merged into the existing order.
+ */
+class PERSPECTIVE_EXPORT t_string_ranks {
+public:
+    t_string_ranks(t_string_collation collation);
+
+    // true when update(vocab) has no string to add
+    bool is_current(const t_vocab& vocab) const;
+    void update(const t_vocab& vocab);
+
+    const std::uint32_t* get_ranks() const { return m_ranks.data(); }
+    t_uindex num_strings() const { return m_order.size(); }
+    // Ranks are below num_ranks()
+    t_uindex num_ranks() const { return m_nranks; }
+
+private:
+    bool less(const char* x, const char* y) const;
+
+    t_string_collation m_collation;
+    // string ids in collation order
+    std::vector<std::uint32_t> m_order;
+    std::vector<std::uint32_t> m_ranks;
+    t_uindex m_nranks;
+};
+
+} // end namespace perspective
@@ -9,28 +9,79 @@
 
 #pragma once
 #include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
 #include <perspective/scalar.h>
-#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace perspective {
 
-class t_symtable {
-    typedef std::unordered_map<const char*, const char*, t_cchar_umap_hash, t_cchar_umap_cmp>
-        t_mapping;
-
+/**
+ * String interner, safe to share between threads.
+ *
+ * Strings are hashed to one of a fixed number of shards. A shard is an open
+ * addressing table of pointers into its own arena, lookups read the table
+ * without locking and only inserts take the shard mutex. Interned strings
+ * live until the table is destroyed, so a table owned by a context, tree or
+ * filter releases its strings with its owner.
+ */
+class PERSPECTIVE_EXPORT t_symtable {
 public:
     t_symtable();
     ~t_symtable();
 
+    t_symtable(const t_symtable&) = delete;
+    t_symtable& operator=(const t_symtable&) = delete;
+
     const char* get_interned_cstr(const char* s);
     t_tscalar get_interned_tscalar(const char* s);
     t_tscalar get_interned_tscalar(const t_tscalar& s);
     t_uindex size() const;
 
 private:
-    t_mapping m_mapping;
+    // capacity is a power of two, slots point past the hash of an entry
+    struct t_slots {
+        explicit t_slots(t_uindex capacity);
+
+        t_uindex m_capacity;
+        std::unique_ptr<std::atomic<const char*>[]> m_data;
+    };
+
+    struct t_shard {
+        t_shard();
+
+        std::atomic<t_slots*> m_slots;
+        std::atomic<t_uindex> m_size;
+        std::mutex m_mutex;
+
+        // slot tables replaced by a grow, readers may still be probing them
+        std::vector<std::unique_ptr<t_slots>> m_tables;
+
+        std::vector<std::unique_ptr<char[]>> m_blocks;
+        char* m_head;
+        t_uindex m_left;
+    };
+
+    static const char* find(const t_slots* slots, const char* s, std::uint64_t hash);
+    static void place(t_slots* slots, const char* entry, std::uint64_t hash);
+    const char* insert(t_shard& shard, const char* s, t_uindex len, std::uint64_t hash);
+    char* allocate(t_shard& shard, t_uindex nbytes);
+
+    enum {
+        NUM_SHARDS = 16,
+        SHARD_SHIFT = 60,
+        INITIAL_CAPACITY = 64,
+        BLOCK_SIZE = 16384
+    };
+
+    t_shard m_shards[NUM_SHARDS];
 };
 
+// Process wide interner, for strings that outlive any one owner
 const char* get_interned_cstr(const char* s);
 t_tscalar get_interned_tscalar(const char* s);
 t_tscalar get_interned_tscalar(const t_tscalar& s);
@@ -169,6 +169,11 @@ public:
     std::shared_ptr<t_table_index> get_last_index() const { return m_last_index; }
     void set_last_index(const std::shared_ptr<t_table_index> &p) const { m_last_index = p; }
 
+    // search_cpp narrows the rows with the search index of the columns,
+    // worth building for the tables searched again after each update
+    void set_search_indexed(bool indexed) { m_search_indexed = indexed; }
+    bool is_search_indexed() const { return m_search_indexed; }
+
 protected:
     template <typename FLATTENED_T>
     void flatten_body(FLATTENED_T flattened) const;
@@ -179,6 +184,10 @@ protected:
     template <typename DATA_T, typename ROWPACK_VEC_T>
     void flatten_helper_2(ROWPACK_VEC_T& sorted, std::vector<t_flatten_record>& fltrecs,
         const t_column* scol, t_column* dcol) const;
+
+    template <typename ROWPACK_VEC_T>
+    void flatten_helper_list(ROWPACK_VEC_T& sorted, std::vector<t_flatten_record>& fltrecs,
+        const t_column* scol, t_column* dcol) const;
     std::string repr() const;
 
 private:
@@ -194,6 +203,7 @@ private:
     t_table_recipe m_recipe;
     bool m_from_recipe;
     mutable std::shared_ptr<t_table_index> m_last_index;
+    bool m_search_indexed;
 };
 
 PERSPECTIVE_EXPORT bool operator==(const t_table& lhs, const t_table& rhs);
@@ -248,27 +258,6 @@ t_table::flatten_body(FLATTENED_T flattened) const {
         case DTYPE_FLOAT32: {
             flatten_helper_1<FLATTENED_T, float>(flattened);
         } break;
-        case DTYPE_LIST_STR: {
-            flatten_helper_1<FLATTENED_T, std::vector<std::string>>(flattened);
-        } break;
-        case DTYPE_LIST_BOOL: {
-            flatten_helper_1<FLATTENED_T, std::vector<bool>>(flattened);
-        } break;
-        case DTYPE_LIST_FLOAT64: {
-            flatten_helper_1<FLATTENED_T, std::vector<double>>(flattened);
-        } break;
-        case DTYPE_LIST_INT64: {
-            flatten_helper_1<FLATTENED_T, std::vector<std::int64_t>>(flattened);
-        } break;
-        case DTYPE_LIST_DATE: {
-            flatten_helper_1<FLATTENED_T, std::vector<t_date>>(flattened);
-        } break;
-        case DTYPE_LIST_TIME: {
-            flatten_helper_1<FLATTENED_T, std::vector<t_time>>(flattened);
-        } break;
-        case DTYPE_LIST_DURATION: {
-            flatten_helper_1<FLATTENED_T, std::vector<t_duration>>(flattened);
-        } break;
         case DTYPE_DECIMAL: {
             flatten_helper_1<FLATTENED_T, t_decimal>(flattened);
         } break;
@@ -302,6 +291,30 @@ t_table::flatten_helper_2(ROWPACK_VEC_T& sorted, std::vector<t_flatten_record>&
     }
 }
 
+template <typename ROWPACK_VEC_T>
+void
+t_table::flatten_helper_list(ROWPACK_VEC_T& sorted, std::vector<t_flatten_record>& fltrecs,
+    const t_column* scol, t_column* dcol) const {
+    for (const auto& rec : fltrecs) {
+        bool added = false;
+        t_index fragidx = 0;
+        t_status status = STATUS_INVALID;
+        for (t_index spanidx = rec.m_eidx - 1; spanidx >= t_index(rec.m_bidx); --spanidx) {
+            const auto& sort_rec = sorted[spanidx];
+            fragidx = sort_rec.m_idx;
+            status = *(scol->get_nth_status(fragidx));
+            if (status != STATUS_INVALID) {
+                added = true;
+                break;
+            }
+        }
+
+        if (added) {
+            dcol->copy_list_nth(rec.m_store_idx, *scol, fragidx, status);
+        }
+    }
+}
+
 template <typename FLATTENED_T, typename PKEY_T>
 void
 t_table::flatten_helper_1(FLATTENED_T flattened) const {
@@ -459,26 +472,14 @@ t_table::flatten_helper_1(FLATTENED_T flattened) const {
                 case DTYPE_STR: {
                     this->flatten_helper_2<t_uindex, t_rpvec>(sorted, fltrecs, scol, dcol);
                 } break;
-                case DTYPE_LIST_STR: {
-                    this->flatten_helper_2<std::vector<std::string>, t_rpvec>(sorted, fltrecs, scol, dcol);
-                } break;
-                case DTYPE_LIST_BOOL: {
-                    this->flatten_helper_2<std::vector<bool>, t_rpvec>(sorted, fltrecs, scol, dcol);
-                } break;
-                case DTYPE_LIST_FLOAT64: {
-                    this->flatten_helper_2<std::vector<double>, t_rpvec>(sorted, fltrecs, scol, dcol);
-                } break;
-                case DTYPE_LIST_INT64: {
-                    this->flatten_helper_2<std::vector<std::int64_t>, t_rpvec>(sorted, fltrecs, scol, dcol);
-                } break;
-                case DTYPE_LIST_DATE: {
-                    this->flatten_helper_2<std::vector<t_date>, t_rpvec>(sorted, fltrecs, scol, dcol);
-                } break;
-                case DTYPE_LIST_TIME: {
-                    this->flatten_helper_2<std::vector<t_time>, t_rpvec>(sorted, fltrecs, scol, dcol);
-                } break;
+                case DTYPE_LIST_STR:
+                case DTYPE_LIST_BOOL:
+                case DTYPE_LIST_FLOAT64:
+                case DTYPE_LIST_INT64:
+                case DTYPE_LIST_DATE:
+                case DTYPE_LIST_TIME:
                 case DTYPE_LIST_DURATION: {
-                    this->flatten_helper_2<std::vector<t_duration>, t_rpvec>(sorted, fltrecs, scol, dcol);
+                    this->flatten_helper_list<t_rpvec>(sorted, fltrecs, scol, dcol);
                 } break;
                 case DTYPE_DECIMAL: {
                     this->flatten_helper_2<t_decimal, t_rpvec>(sorted, fltrecs, scol, dcol);
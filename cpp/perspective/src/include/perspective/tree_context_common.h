@@ -23,7 +23,8 @@ PERSPECTIVE_EXPORT void notify_sparse_tree_common(std::shared_ptr<t_table> stran
     const std::vector<std::pair<std::string, std::string>>& tree_sortby,
     const std::vector<t_sortspec>& ctx_sortby, const std::vector<t_fterm>& ctx_fterms,
     const t_gstate& gstate, t_config& config, const t_table& flattened,
-    bool is_row = false, t_ctx2* ctx2 = nullptr);
+    bool is_row = false, t_ctx2* ctx2 = nullptr,
+    const std::set<std::string>& delta_aggregates = std::set<std::string>());
 
 PERSPECTIVE_EXPORT void notify_sparse_tree(std::shared_ptr<t_stree> tree,
     std::shared_ptr<t_traversal> traversal, bool process_traversal,
@@ -16,7 +16,10 @@
 #include <functional>
 #include <limits>
 #include <cmath>
+#include <mutex>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace perspective {
 
@@ -51,8 +54,29 @@ public:
     bool string_exists(const char* c, t_uindex& interned) const;
 
     void reserve(size_t total_string_size, size_t string_count);
+
+    /**
+     * Interns `count` strings stored one after another in `data`, string i
+     * spanning [offsets[i], offsets[i + 1]), and writes their ids to
+     * `indices`. Only new strings are stored, the string data and extents
+     * are reserved for the case where all of them are new. Strings must not
+     * contain 0 bytes.
+     */
+    void bulk_intern(const char* data, const std::int32_t* offsets, t_uindex count,
+        t_uindex* indices);
     bool is_init();
 
+    /**
+     * Sets `candidates` to the ids, in increasing order, of the strings
+     * holding every 3-byte substring of `needle` when both are lower cased.
+     * `needle` is at least 3 bytes long. Any string containing `needle` is
+     * returned, the callers check the candidates. The trigram index is built
+     * on the first call and extended with the strings interned since the
+     * previous one. Returns false, without candidates, once the index would
+     * outgrow its budget; the callers then check every string.
+     */
+    bool get_trigram_candidates(const std::string& needle, std::vector<t_uindex>& candidates) const;
+
 protected:
     // vlen interface
     t_uindex genidx();
@@ -82,6 +106,17 @@ private:
     std::shared_ptr<t_lstore> m_extents;
 
     bool m_init = false;
+
+    // Trigram of the lower cased strings => ids of the strings holding it,
+    // covers the ids below m_trigrams_size
+    mutable std::mutex m_trigrams_mutex;
+    mutable std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> m_trigrams;
+    mutable t_uindex m_trigrams_size = 0;
+    mutable t_uindex m_trigram_postings = 0;
+    // set when the index was dropped for holding too many postings
+    mutable bool m_trigrams_full = false;
+
+    void reset_trigrams();
 };
 
 } // end namespace perspective
@@ -0,0 +1,98 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace perspective {
+
+class t_column;
+
+#define ZONE_MAP_BLOCK_SIZE 4096
+
+/**
+ * Statistics of one block of ZONE_MAP_BLOCK_SIZE rows (fewer for the last
+ * one). m_min and m_max hold raw values of the column dtype, interned ids
+ * for strings, and bound the valid rows that are not NaN.
+ */
+struct PERSPECTIVE_EXPORT t_zone {
+    std::uint64_t m_min;
+    std::uint64_t m_max;
+    std::uint32_t m_nrows;
+    // rows with a status below STATUS_VALID (invalid, error, empty)
+    std::uint32_t m_nnull;
+    // rows with a status above STATUS_VALID (cleared, warning)
+    std::uint32_t m_ncleared;
+    // upper bound of the distinct valid values, saturates at 255
+    std::uint8_t m_distinct;
+    bool m_has_nan;
+
+    template <typename T>
+    T
+    get_min() const {
+        T v;
+        std::memcpy(&v, &m_min, sizeof(T));
+        return v;
+    }
+
+    template <typename T>
+    T
+    get_max() const {
+        T v;
+        std::memcpy(&v, &m_max, sizeof(T));
+        return v;
+    }
+
+    t_uindex
+    num_valid() const {
+        return m_nrows - m_nnull - m_ncleared;
+    }
+
+    // every row is valid and holds the same value
+    bool
+    is_constant() const {
+        return num_valid() == m_nrows && m_distinct == 1 && !m_has_nan;
+    }
+};
+
+/**
+ * Per-block statistics of a fixed width column, used by filters to skip or
+ * accept whole blocks. Writes only flag the rows they touch, the flagged
+ * blocks are recomputed by the next update().
+ */
+class PERSPECTIVE_EXPORT t_zone_map {
+public:
+    t_zone_map();
+
+    static bool is_supported(t_dtype dtype);
+
+    void mark(t_uindex bidx, t_uindex eidx);
+    void mark_all();
+
+    // true when update(col) has nothing to recompute
+    bool is_current(const t_column& col) const;
+    void update(const t_column& col);
+
+    t_uindex num_zones() const { return m_zones.size(); }
+    const t_zone& get_zone(t_uindex zidx) const { return m_zones[zidx]; }
+
+private:
+    std::vector<t_zone> m_zones;
+    std::vector<bool> m_dirty;
+    // rows covered by the last update
+    t_uindex m_nrows;
+    bool m_has_dirty;
+};
+
+} // end namespace perspective
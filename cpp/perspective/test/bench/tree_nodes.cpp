@@ -0,0 +1,222 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+// Compares the sparse tree node store (t_treenodes) with the
+// boost::multi_index container it replaced, on a three level tree.
+//
+// usage: psp_bench_tree_nodes [fanout]
+//
+// The tree has fanout^3 leaves (100 by default, 1M leaves): integer values at
+// depth 1, doubles at depth 2 and strings at depth 3. Reports the build time,
+// the heap bytes per node, the time to resolve every node by (parent, value)
+// and the time to iterate the children of every node.
+
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/scalar.h>
+#include <perspective/sparse_tree_node.h>
+#include <perspective/sparse_tree_nodes.h>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+// mallinfo2() is glibc only, __GLIBC__ is defined by the headers above
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace perspective;
+
+namespace {
+
+// The node container of t_stree before t_treenodes
+using namespace boost::multi_index;
+
+struct by_idx {};
+struct by_depth {};
+struct by_nstrands {};
+struct by_pidx {};
+struct by_pidx_hash {};
+
+typedef multi_index_container<t_stnode,
+    indexed_by<ordered_unique<tag<by_idx>, BOOST_MULTI_INDEX_MEMBER(t_stnode, t_uindex, m_idx)>,
+        hashed_non_unique<tag<by_depth>, BOOST_MULTI_INDEX_MEMBER(t_stnode, std::uint8_t, m_depth)>,
+        hashed_non_unique<tag<by_nstrands>,
+            BOOST_MULTI_INDEX_MEMBER(t_stnode, t_uindex, m_nstrands)>,
+        ordered_unique<tag<by_pidx>,
+            composite_key<t_stnode, BOOST_MULTI_INDEX_MEMBER(t_stnode, t_uindex, m_pidx),
+                BOOST_MULTI_INDEX_MEMBER(t_stnode, t_tscalar, m_sort_value),
+                BOOST_MULTI_INDEX_MEMBER(t_stnode, t_tscalar, m_value)>>,
+        ordered_unique<tag<by_pidx_hash>,
+            composite_key<t_stnode, BOOST_MULTI_INDEX_MEMBER(t_stnode, t_uindex, m_pidx),
+                BOOST_MULTI_INDEX_MEMBER(t_stnode, t_tscalar, m_value)>>>>
+    t_multi_index_nodes;
+
+typedef std::chrono::steady_clock clock_type;
+
+double
+elapsed_ms(clock_type::time_point start) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+// Bytes allocated on the heap, 0 where glibc does not report it
+std::size_t
+heap_bytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+struct t_result {
+    t_uindex m_nodes;
+    double m_build;
+    std::size_t m_bytes;
+    double m_resolve;
+    double m_children;
+    t_uindex m_checksum;
+};
+
+// Inserts the nodes of the tree through `insert`, returns the number of ids
+template <typename INSERT_T>
+t_uindex
+build_tree(t_uindex fanout, const std::vector<std::string>& strings, INSERT_T insert) {
+    t_tscalar root = mktscalar<std::int64_t>(0);
+    insert(t_stnode(0, root_pidx(), root, 0, root, 1, 0));
+    t_uindex next = 1;
+    for (t_uindex a = 0; a < fanout; ++a) {
+        t_uindex pa = next++;
+        t_tscalar va = mktscalar<std::int64_t>(a * 7919 % fanout);
+        insert(t_stnode(pa, 0, va, 1, va, 1, pa));
+        for (t_uindex b = 0; b < fanout; ++b) {
+            t_uindex pb = next++;
+            t_tscalar vb = mktscalar<double>(b * 31 % fanout);
+            insert(t_stnode(pb, pa, vb, 2, vb, 1, pb));
+            for (t_uindex c = 0; c < fanout; ++c) {
+                t_uindex pc = next++;
+                t_tscalar vc = mktscalar(strings[c * 17 % fanout].c_str());
+                insert(t_stnode(pc, pb, vc, 3, vc, 1, pc));
+            }
+        }
+    }
+    return next;
+}
+
+t_result
+bench_multi_index(t_uindex fanout, const std::vector<std::string>& strings) {
+    t_result rval;
+    std::size_t before = heap_bytes();
+    auto start = clock_type::now();
+    auto* nodes = new t_multi_index_nodes;
+    t_uindex nids = build_tree(
+        fanout, strings, [nodes](const t_stnode& node) { nodes->insert(node); });
+    rval.m_build = elapsed_ms(start);
+    rval.m_bytes = heap_bytes() - before;
+    rval.m_nodes = nodes->size();
+    rval.m_checksum = 0;
+
+    start = clock_type::now();
+    const auto& by_id = nodes->get<by_idx>();
+    const auto& by_value = nodes->get<by_pidx_hash>();
+    for (t_uindex idx = 1; idx < nids; ++idx) {
+        auto node = by_id.find(idx);
+        auto found = by_value.find(std::make_tuple(node->m_pidx, node->m_value));
+        rval.m_checksum += found->m_idx == idx;
+    }
+    rval.m_resolve = elapsed_ms(start);
+
+    start = clock_type::now();
+    const auto& by_parent = nodes->get<by_pidx>();
+    for (t_uindex idx = 0; idx < nids; ++idx) {
+        auto range = by_parent.equal_range(idx);
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            rval.m_checksum += iter->m_idx;
+        }
+    }
+    rval.m_children = elapsed_ms(start);
+    delete nodes;
+    return rval;
+}
+
+t_result
+bench_treenodes(t_uindex fanout, const std::vector<std::string>& strings) {
+    t_result rval;
+    std::size_t before = heap_bytes();
+    auto start = clock_type::now();
+    auto* nodes = new t_treenodes;
+    t_uindex nids = build_tree(
+        fanout, strings, [nodes](const t_stnode& node) { nodes->insert(node); });
+    // children appended out of order are sorted on the first read
+    nodes->children_begin(0);
+    rval.m_build = elapsed_ms(start);
+    rval.m_bytes = heap_bytes() - before;
+    rval.m_nodes = nodes->size();
+    rval.m_checksum = 0;
+
+    start = clock_type::now();
+    for (t_uindex idx = 1; idx < nids; ++idx) {
+        rval.m_checksum
+            += nodes->find_child(nodes->get_pidx(idx), nodes->get_value(idx)) == t_index(idx);
+    }
+    rval.m_resolve = elapsed_ms(start);
+
+    start = clock_type::now();
+    for (t_uindex idx = 0; idx < nids; ++idx) {
+        for (auto iter = nodes->children_begin(idx), end = nodes->children_end(idx); iter != end;
+             ++iter) {
+            rval.m_checksum += *iter;
+        }
+    }
+    rval.m_children = elapsed_ms(start);
+    delete nodes;
+    return rval;
+}
+
+void
+report(const char* name, const t_result& result) {
+    std::cout << name << ": nodes " << result.m_nodes << ", build " << result.m_build << " ms, "
+              << result.m_bytes / result.m_nodes << " bytes/node, resolve " << result.m_resolve
+              << " ms, children " << result.m_children << " ms" << std::endl;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[]) {
+    t_uindex fanout = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    if (fanout == 0) {
+        std::cerr << "usage: psp_bench_tree_nodes [fanout]" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> strings;
+    for (t_uindex idx = 0; idx < fanout; ++idx) {
+        strings.push_back("value number " + std::to_string(idx));
+    }
+
+    t_result old_result = bench_multi_index(fanout, strings);
+    report("multi_index", old_result);
+    t_result new_result = bench_treenodes(fanout, strings);
+    report("t_treenodes", new_result);
+
+    // both visited the same nodes and children
+    if (old_result.m_checksum != new_result.m_checksum) {
+        std::cerr << "checksum mismatch" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/column_buffers.h>
+#include <perspective/gnode.h>
+#include <perspective/pool.h>
+#include <perspective/table.h>
+#include <ingest/perspective_table.h>
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace perspective;
+
+namespace {
+
+Ingest::ColumnDefinition
+ingest_column(const std::string& name, Ingest::ColumnType type, int index) {
+    Ingest::ColumnDefinition coldef;
+    coldef.column_name = name;
+    coldef.column_type = type;
+    coldef.index = index;
+    coldef.is_list = false;
+    return coldef;
+}
+
+std::string
+ingest_string(t_uindex idx) {
+    // duplicates, and strings too long to be stored in a scalar
+    return idx % 3 == 0 ? "short " + std::to_string(idx % 13)
+                        : "a string value long enough to be interned " + std::to_string(idx % 29);
+}
+
+} // namespace
+
+TEST(INGEST_TABLE, gnode_matches_ingest_cells)
+{
+    Ingest::Schema schema;
+    schema.columns.push_back(ingest_column("i", Ingest::ColumnType::Integer, 0));
+    schema.columns.push_back(ingest_column("x", Ingest::ColumnType::Decimal, 1));
+    schema.columns.push_back(ingest_column("s", Ingest::ColumnType::String, 2));
+    schema.columns.push_back(ingest_column("d", Ingest::ColumnType::Date, 3));
+    schema.columns.push_back(ingest_column("b", Ingest::ColumnType::Boolean, 4));
+
+    Ingest::Table table(schema);
+    const t_uindex nrows = 1000;
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        Ingest::Row row(5);
+        row.values[0] = std::int64_t(idx) * 3 - 500;
+        row.flagmap[0] = idx % 7 != 0;
+        row.values[1] = idx / 4.0;
+        row.flagmap[1] = idx % 11 != 0;
+        row.values[2] = ingest_string(idx);
+        row.flagmap[2] = idx % 5 != 0;
+        row.values[3] = std::int32_t(40000 + idx);
+        row.flagmap[3] = true;
+        row.values[4] = idx % 2 == 0;
+        row.flagmap[4] = idx % 9 != 0;
+        table.append_row(row);
+    }
+
+    t_pool pool;
+    auto gnode = Ingest::make_perspective_table(&pool, table);
+    t_table* tbl = gnode->get_table();
+    ASSERT_EQ(tbl->size(), nrows);
+
+    std::map<std::int32_t, t_uindex> rows;
+    auto pkeys = tbl->get_const_column("psp_pkey");
+    for (t_uindex ridx = 0; ridx < nrows; ++ridx) {
+        rows[*pkeys->get_nth<std::int32_t>(ridx)] = ridx;
+    }
+    ASSERT_EQ(rows.size(), nrows);
+
+    auto icol = tbl->get_const_column("i");
+    auto xcol = tbl->get_const_column("x");
+    auto scol = tbl->get_const_column("s");
+    auto dcol = tbl->get_const_column("d");
+    auto bcol = tbl->get_const_column("b");
+    EXPECT_EQ(icol->get_dtype(), DTYPE_INT64);
+    EXPECT_EQ(xcol->get_dtype(), DTYPE_FLOAT64);
+    EXPECT_EQ(scol->get_dtype(), DTYPE_STR);
+    EXPECT_EQ(dcol->get_dtype(), DTYPE_DATE);
+    EXPECT_EQ(bcol->get_dtype(), DTYPE_BOOL);
+
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        t_uindex ridx = rows[std::int32_t(idx)];
+
+        EXPECT_EQ(icol->is_valid(ridx), idx % 7 != 0);
+        if (idx % 7 != 0) {
+            EXPECT_EQ(icol->get_scalar(ridx).to_int64(), std::int64_t(idx) * 3 - 500);
+        }
+        EXPECT_EQ(xcol->is_valid(ridx), idx % 11 != 0);
+        if (idx % 11 != 0) {
+            EXPECT_EQ(xcol->get_scalar(ridx).to_double(), idx / 4.0);
+        }
+        EXPECT_EQ(scol->is_valid(ridx), idx % 5 != 0);
+        if (idx % 5 != 0) {
+            EXPECT_EQ(scol->get_scalar(ridx).to_string(), ingest_string(idx));
+        }
+        EXPECT_TRUE(dcol->is_valid(ridx));
+        EXPECT_EQ(dcol->get_scalar(ridx).get<t_date>().raw_value(), std::int32_t(40000 + idx));
+        EXPECT_EQ(bcol->is_valid(ridx), idx % 9 != 0);
+        if (idx % 9 != 0) {
+            EXPECT_EQ(bcol->get_scalar(ridx).get<bool>(), idx % 2 == 0);
+        }
+    }
+}
@@ -25,12 +25,26 @@
 #include <perspective/none.h>
 #include <perspective/gnode.h>
 #include <perspective/sym_table.h>
+#include <perspective/vocab.h>
+#include <perspective/string_ranks.h>
+#include <perspective/sketch.h>
+#include <perspective/pkey_mapping.h>
+#include <perspective/sparse_tree_nodes.h>
+#include <perspective/pool.h>
 #include <gtest/gtest.h>
 #include <random>
 #include <limits>
 #include <cmath>
 #include <cstdint>
 #include <sstream>
+#include <set>
+#include <numeric>
+#include <functional>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cstring>
 
 using namespace perspective;
 
@@ -2202,6 +2216,1886 @@ TEST(TYPE_TO_DTYPE, test_time)
     EXPECT_EQ(type_to_dtype<std::string>(), DTYPE_STR);
 }
 
+TEST(SKETCH, quantile_merge)
+{
+    std::mt19937 rng(7);
+    std::vector<double> values;
+    t_quantile_sketch merged;
+    for (int part = 0; part < 10; ++part) {
+        t_quantile_sketch sketch;
+        for (int idx = 0; idx < 10000; ++idx) {
+            double v = double(rng() % 1000000);
+            values.push_back(v);
+            sketch.add(v);
+        }
+        merged.merge(sketch);
+    }
+    EXPECT_EQ(merged.count(), values.size());
+    EXPECT_LT(merged.size(), 1000);
+
+    std::sort(values.begin(), values.end());
+    for (double q : {0.1, 0.5, 0.9}) {
+        double v = merged.quantile(q);
+        double rank = std::lower_bound(values.begin(), values.end(), v) - values.begin();
+        EXPECT_NEAR(rank / values.size(), q, 0.02);
+    }
+
+    t_quantile_sketch small;
+    for (double v : {5.0, 1.0, 3.0, 2.0}) {
+        small.add(v);
+    }
+    small.add(mknone());
+    EXPECT_EQ(small.count(), 4);
+    EXPECT_EQ(small.quantile(0.5), 3.0);
+
+    t_quantile_sketch dates;
+    for (std::int16_t year : {2003, 2001, 2002}) {
+        dates.add(mktscalar(t_date(year, 4, 5)));
+    }
+    EXPECT_EQ(dates.count(), 3);
+    EXPECT_EQ(dates.quantile(0.5, DTYPE_DATE), mktscalar(t_date(2002, 4, 5)));
+    EXPECT_EQ(small.quantile(0.5, DTYPE_INT64), mktscalar<std::int64_t>(3));
+}
+
+TEST(SKETCH, distinct_merge)
+{
+    t_distinct_sketch small;
+    for (std::int64_t v = 0; v < 300; ++v) {
+        small.add(mktscalar(v % 100));
+    }
+    EXPECT_EQ(small.estimate(), 100);
+
+    t_distinct_sketch merged;
+    for (std::int64_t part = 0; part < 10; ++part) {
+        t_distinct_sketch sketch;
+        for (std::int64_t v = part * 5000; v < part * 5000 + 10000; ++v) {
+            sketch.add(mktscalar(v));
+        }
+        merged.merge(sketch);
+    }
+    merged.merge(small);
+    EXPECT_NEAR(double(merged.estimate()), 55000.0, 55000.0 * 0.05);
+}
+
+TEST(SKETCH, tree_matches_exact_aggregates)
+{
+    // Below the capacity of the quantile sketch and the sparse limit of the
+    // distinct sketch both are exact, so every node matches the exact
+    // aggregate next to it, through updates, moves and deletes
+    t_schema sch{{"psp_op", "psp_pkey", "g", "h", "x", "d", "t"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_STR, DTYPE_INT64, DTYPE_INT64, DTYPE_DATE, DTYPE_TIME},
+        {}};
+    std::vector<t_aggspec> aggs{{"median x", AGGTYPE_MEDIAN, "x"},
+        {"approx median x", AGGTYPE_APPROX_MEDIAN, "x"}, {"median d", AGGTYPE_MEDIAN, "d"},
+        {"approx median d", AGGTYPE_APPROX_MEDIAN, "d"}, {"median t", AGGTYPE_MEDIAN, "t"},
+        {"approx median t", AGGTYPE_APPROX_MEDIAN, "t"},
+        {"distinct count x", AGGTYPE_DISTINCT_COUNT, "x"},
+        {"approx distinct count x", AGGTYPE_APPROX_DISTINCT_COUNT, "x"}};
+
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    auto ctx = t_ctx1::build(sch, t_config(std::vector<std::string>{"g", "h"}, aggs, {}, {}));
+    gn->register_context("ctx", ctx);
+    // notifications may rebuild the tree, fetch it after each update
+    t_stree* tree = nullptr;
+
+    std::function<void(t_uindex)> check = [&](t_uindex idx) {
+        if (tree->get_pkeys(idx).empty()) {
+            return;
+        }
+        for (t_index agg = 0, naggs = aggs.size(); agg < naggs; agg += 2) {
+            t_tscalar exact = tree->get_aggregate(idx, agg);
+            t_tscalar approx = tree->get_aggregate(idx, agg + 1);
+            EXPECT_EQ(approx.get_dtype(), exact.get_dtype());
+            EXPECT_EQ(approx.to_double(), exact.to_double());
+        }
+        for (auto child : tree->get_child_idx(idx)) {
+            check(child);
+        }
+    };
+
+    std::mt19937 rng(11);
+    std::set<std::int64_t> live;
+    const char* groups[] = {"a", "b", "c"};
+    for (int step = 0; step < 30; ++step) {
+        std::set<std::int64_t> pkeys;
+        for (int count = 1 + rng() % 12; count > 0; --count) {
+            pkeys.insert(rng() % 150);
+        }
+
+        t_table tbl(sch);
+        tbl.init();
+        tbl.extend(pkeys.size());
+        t_uindex ridx = 0;
+        for (auto pkey : pkeys) {
+            bool erase = live.count(pkey) && rng() % 5 == 0;
+            tbl.get_column("psp_op")->set_nth<std::uint8_t>(ridx, erase ? OP_DELETE : OP_INSERT);
+            tbl.get_column("psp_pkey")->set_nth<std::int64_t>(ridx, pkey);
+            if (erase) {
+                live.erase(pkey);
+                for (const char* colname : {"g", "h", "x", "d", "t"}) {
+                    tbl.get_column(colname)->clear(ridx);
+                }
+                ++ridx;
+                continue;
+            }
+            live.insert(pkey);
+            tbl.get_column("g")->set_nth<const char*>(ridx, groups[rng() % 3]);
+            tbl.get_column("h")->set_nth<std::int64_t>(ridx, rng() % 2);
+            tbl.get_column("x")->set_nth<std::int64_t>(ridx, std::int64_t(rng() % 60) - 30);
+            tbl.get_column("d")->set_nth<t_date>(
+                ridx, t_date(2000 + rng() % 20, 1 + rng() % 12, 1 + rng() % 28));
+            tbl.get_column("t")->set_nth<t_time>(ridx, t_time(3.2e9 + 60.0 * (rng() % 100000)));
+            ++ridx;
+        }
+        gn->_send_and_process(tbl);
+        tree = ctx->get_trees()[0];
+        check(0);
+    }
+
+    EXPECT_EQ(tree->get_aggregate(0, 3).get_dtype(), DTYPE_DATE);
+    EXPECT_EQ(tree->get_aggregate(0, 5).get_dtype(), DTYPE_TIME);
+    gn->_unregister_context("ctx");
+}
+
+TEST(PKEY_MAPPING, dense_and_hashed)
+{
+    std::mt19937 rng(3);
+    std::map<t_index, t_uindex> expected;
+    t_pkey_mapping mapping;
+
+    auto check = [&]() {
+        EXPECT_EQ(mapping.size(), expected.size());
+        for (t_index key = -10; key < 3000; ++key) {
+            auto iter = expected.find(key);
+            t_uindex row = iter == expected.end() ? t_pkey_mapping::NOT_FOUND : iter->second;
+            EXPECT_EQ(mapping.find(key), row);
+        }
+        std::map<t_index, t_uindex> seen;
+        mapping.for_each([&seen](t_index key, t_uindex row) { seen[key] = row; });
+        EXPECT_EQ(seen, expected);
+    };
+
+    for (t_index key = 0; key < 2000; ++key) {
+        mapping.set(key, key);
+        expected[key] = key;
+    }
+    for (int idx = 0; idx < 500; ++idx) {
+        t_index key = rng() % 2000;
+        mapping.erase(key);
+        expected.erase(key);
+    }
+    EXPECT_TRUE(mapping.is_dense());
+    check();
+
+    mapping.set(-5, 7);
+    expected[-5] = 7;
+    EXPECT_FALSE(mapping.is_dense());
+    check();
+
+    for (int idx = 0; idx < 5000; ++idx) {
+        t_index key = rng() % 2500;
+        if (rng() % 3 == 0) {
+            mapping.erase(key);
+            expected.erase(key);
+        } else {
+            mapping.set(key, idx);
+            expected[key] = idx;
+        }
+    }
+    check();
+
+    mapping.clear();
+    expected.clear();
+    EXPECT_TRUE(mapping.is_dense());
+    check();
+}
+
+TEST(COLUMN, list_cells)
+{
+    std::mt19937 rng(11);
+    t_schema sch{{"l", "s"}, {DTYPE_LIST_INT64, DTYPE_LIST_STR}, {}};
+    t_table tbl(sch);
+    tbl.init();
+    t_uindex nrows = 50;
+    tbl.extend(nrows);
+    auto ints = tbl.get_column("l");
+    auto strs = tbl.get_column("s");
+
+    std::vector<std::vector<std::int64_t>> expected_ints(nrows);
+    std::vector<std::vector<std::string>> expected_strs(nrows);
+
+    auto check = [&]() {
+        for (t_uindex idx = 0; idx < nrows; ++idx) {
+            auto items = ints->get_list_nth<std::int64_t>(idx);
+            EXPECT_EQ(std::vector<std::int64_t>(items.begin(), items.end()), expected_ints[idx]);
+            auto sidxs = strs->get_list_nth<t_uindex>(idx);
+            std::vector<std::string> values;
+            for (t_uindex sidx : sidxs) {
+                values.push_back(strs->unintern_c(sidx));
+            }
+            EXPECT_EQ(values, expected_strs[idx]);
+        }
+    };
+
+    // cells grow, shrink and are copied from other rows of the same column,
+    // which moves the items they are read from while the column is compacted
+    for (int iter = 0; iter < 5000; ++iter) {
+        t_uindex idx = rng() % nrows;
+        if (rng() % 3 == 0) {
+            t_uindex oidx = rng() % nrows;
+            ints->copy_list_nth(idx, *ints, oidx, STATUS_VALID);
+            strs->copy_list_nth(idx, *strs, oidx, STATUS_VALID);
+            expected_ints[idx] = expected_ints[oidx];
+            expected_strs[idx] = expected_strs[oidx];
+            continue;
+        }
+
+        t_uindex count = rng() % 40;
+        std::vector<std::int64_t> values(count);
+        std::vector<std::string> names(count);
+        for (t_uindex item = 0; item < count; ++item) {
+            values[item] = std::int64_t(rng() % 1000) - 500;
+            names[item] = "name " + std::to_string(rng() % 20);
+        }
+        ints->set_nth(idx, values);
+        strs->set_nth(idx, names);
+        expected_ints[idx] = values;
+        expected_strs[idx] = names;
+    }
+    check();
+
+    // string items are interned again into a column with another vocab
+    t_table other(sch);
+    other.init();
+    other.extend(nrows);
+    auto other_strs = other.get_column("s");
+    other_strs->set_nth(0, std::vector<std::string>{"unrelated", "name 3"});
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        other_strs->copy_list_nth(nrows - 1 - idx, *strs, idx, STATUS_VALID);
+    }
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        auto sidxs = other_strs->get_list_nth<t_uindex>(nrows - 1 - idx);
+        std::vector<std::string> values;
+        for (t_uindex sidx : sidxs) {
+            values.push_back(other_strs->unintern_c(sidx));
+        }
+        EXPECT_EQ(values, expected_strs[idx]);
+    }
+
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        ints->set_nth(idx, std::vector<std::int64_t>());
+        expected_ints[idx].clear();
+    }
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        EXPECT_EQ(ints->get_list_size(idx), 0);
+    }
+    check();
+}
+
+TEST(FILTER, prepared_terms_match_scalar_path)
+{
+    std::mt19937 rng(5);
+    t_schema sch{{"i", "f", "n", "s", "b"},
+        {DTYPE_INT64, DTYPE_FLOAT64, DTYPE_INT32, DTYPE_STR, DTYPE_BOOL}, {}};
+    t_table tbl(sch);
+    tbl.init();
+    t_uindex nrows = 1000;
+    tbl.extend(nrows);
+
+    const char* names[] = {"apple", "banana", "cherry", "grape", "pineapple", "apricot"};
+    auto ints = tbl.get_column("i");
+    auto floats = tbl.get_column("f");
+    auto smalls = tbl.get_column("n");
+    auto strs = tbl.get_column("s");
+    auto bools = tbl.get_column("b");
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        ints->set_nth<std::int64_t>(idx, std::int64_t(rng() % 20) - 10);
+        double f = (int(rng() % 200) - 100) / 4.0;
+        floats->set_nth<double>(idx, rng() % 50 == 0 ? std::nan("") : f);
+        // a sorted run, so that some zone map blocks are decided whole
+        smalls->set_nth<std::int32_t>(idx, std::int32_t(idx / 10));
+        strs->set_nth<const char*>(idx, names[rng() % 6]);
+        bools->set_nth<bool>(idx, rng() % 2 == 0);
+        for (auto& col : {ints, floats, smalls, strs, bools}) {
+            if (rng() % 12 == 0) {
+                col->set_valid(idx, false);
+            } else if (rng() % 12 == 0) {
+                col->clear(idx);
+            }
+        }
+    }
+
+    // IN and NOT_IN kernels pass valid rows only and never match NaN, the
+    // scalar path would also pass the rows that are not valid for NOT_IN
+    auto expected_match = [](const t_fterm& term, const t_tscalar& cell) {
+        if (term.m_op != FILTER_OP_IN && term.m_op != FILTER_OP_NOT_IN) {
+            return term(cell);
+        }
+        if (!cell.is_valid()) {
+            return false;
+        }
+        bool found = std::any_of(term.m_bag.begin(), term.m_bag.end(), [&](const t_tscalar& v) {
+            return cell.m_type == DTYPE_STR ? cell.to_string() == v.to_string()
+                                            : cell.to_double() == v.to_double();
+        });
+        return found != (term.m_op == FILTER_OP_NOT_IN);
+    };
+
+    auto scalar_words = [&](const t_fterm& term, const t_column* col, t_uindex first,
+                            t_uindex last) {
+        std::vector<std::uint64_t> words((last - first + 63) / 64);
+        for (t_uindex idx = first; idx < last; ++idx) {
+            if (expected_match(term, col->get_scalar(idx))) {
+                words[(idx - first) / 64] |= std::uint64_t(1) << ((idx - first) % 64);
+            }
+        }
+        return words;
+    };
+
+    auto kernel_words = [](const t_fterm::t_prepared& kernel, t_uindex first, t_uindex last) {
+        std::vector<std::uint64_t> words((last - first + 63) / 64);
+        kernel(first, last, words.data());
+        return words;
+    };
+
+    auto make_term = [](const std::string& colname, t_filter_op op, t_tscalar threshold,
+                         std::vector<t_tscalar> bag) {
+        std::sort(bag.begin(), bag.end());
+        return t_fterm(colname, op, threshold, bag);
+    };
+
+    std::vector<t_fterm> terms;
+    std::vector<t_filter_op> compare_ops{FILTER_OP_EQ, FILTER_OP_NE, FILTER_OP_LT,
+        FILTER_OP_LTEQ, FILTER_OP_GT, FILTER_OP_GTEQ};
+    for (t_filter_op op : compare_ops) {
+        terms.push_back(make_term("i", op, mktscalar<std::int64_t>(3), {}));
+        terms.push_back(make_term("i", op, mktscalar<double>(2.5), {}));
+        terms.push_back(make_term("f", op, mktscalar<double>(-4.25), {}));
+        terms.push_back(make_term("f", op, mktscalar<double>(std::nan("")), {}));
+        terms.push_back(make_term("n", op, mktscalar<std::int32_t>(42), {}));
+        terms.push_back(make_term("s", op, mktscalar("cherry"), {}));
+        terms.push_back(make_term("b", op, mktscalar<bool>(true), {}));
+    }
+    for (t_filter_op op : {FILTER_OP_IN, FILTER_OP_NOT_IN}) {
+        std::vector<t_tscalar> few{mktscalar<std::int64_t>(-3), mktscalar<std::int64_t>(7)};
+        std::vector<t_tscalar> many;
+        for (std::int64_t v = -10; v < 10; v += 2) {
+            many.push_back(mktscalar<std::int64_t>(v));
+        }
+        terms.push_back(make_term("i", op, mknone(), few));
+        terms.push_back(make_term("i", op, mknone(), many));
+        terms.push_back(make_term("i", op, mknone(), {}));
+        terms.push_back(make_term("f", op, mknone(), {mktscalar<double>(0.25), mktscalar<double>(-1.0)}));
+        terms.push_back(make_term("n", op, mknone(), {mktscalar<std::int32_t>(5), mktscalar<std::int32_t>(99)}));
+        terms.push_back(make_term("s", op, mknone(), {mktscalar("grape"), mktscalar("kiwi")}));
+    }
+    for (t_filter_op op : {FILTER_OP_CONTAINS, FILTER_OP_NOT_CONTAIN, FILTER_OP_BEGINS_WITH,
+             FILTER_OP_ENDS_WITH}) {
+        terms.push_back(make_term("s", op, mktscalar("apple"), {}));
+        terms.push_back(make_term("s", op, mktscalar("ap"), {}));
+    }
+    for (t_filter_op op : {FILTER_OP_IS_VALID, FILTER_OP_IS_NOT_VALID, FILTER_OP_IS_EMPTY,
+             FILTER_OP_IS_NOT_EMPTY}) {
+        terms.push_back(make_term("f", op, mknone(), {}));
+        terms.push_back(make_term("n", op, mknone(), {}));
+    }
+    terms.push_back(make_term("b", FILTER_OP_IS_TRUE, mknone(), {}));
+    terms.push_back(make_term("b", FILTER_OP_IS_FALSE, mknone(), {}));
+    terms.push_back(make_term("n", FILTER_OP_BETWEEN, mknone(),
+        {mktscalar<std::int32_t>(20), mktscalar<std::int32_t>(40)}));
+
+    std::vector<std::pair<t_uindex, t_uindex>> ranges{{0, nrows}, {128, 700}, {64, 65}};
+    std::vector<t_fterm::t_prepared> kernels;
+    for (const auto& term : terms) {
+        const t_column* col = tbl.get_const_column(term.m_colname).get();
+        kernels.push_back(term.prepare(col, DATA_FORMAT_NONE));
+        for (const auto& range : ranges) {
+            EXPECT_EQ(kernel_words(kernels.back(), range.first, range.second),
+                scalar_words(term, col, range.first, range.second));
+        }
+    }
+
+    for (int iter = 0; iter < 200; ++iter) {
+        t_filter_op combiner = rng() % 2 == 0 ? FILTER_OP_AND : FILTER_OP_OR;
+        std::vector<t_uindex> picked(1 + rng() % 4);
+        std::vector<t_fterm::t_prepared> combined;
+        for (auto& tidx : picked) {
+            tidx = rng() % terms.size();
+            combined.push_back(kernels[tidx]);
+        }
+        auto kernel = t_fterm::combine(combiner, combined);
+
+        std::vector<std::uint64_t> expected((nrows + 63) / 64);
+        for (t_uindex idx = 0; idx < nrows; ++idx) {
+            bool pass = combiner == FILTER_OP_AND;
+            for (t_uindex tidx : picked) {
+                const t_fterm& term = terms[tidx];
+                bool match
+                    = expected_match(term, tbl.get_const_column(term.m_colname)->get_scalar(idx));
+                pass = combiner == FILTER_OP_AND ? pass && match : pass || match;
+            }
+            if (pass) {
+                expected[idx / 64] |= std::uint64_t(1) << (idx % 64);
+            }
+        }
+        EXPECT_EQ(kernel_words(kernel, 0, nrows), expected);
+    }
+
+    EXPECT_EQ(kernel_words(t_fterm::combine(FILTER_OP_AND, {}), 0, 100),
+        (std::vector<std::uint64_t>{~std::uint64_t(0), (std::uint64_t(1) << 36) - 1}));
+    EXPECT_EQ(kernel_words(t_fterm::combine(FILTER_OP_OR, {}), 0, 100),
+        (std::vector<std::uint64_t>{0, 0}));
+}
+
+TEST(FILTER, morsels_match_serial_rows)
+{
+    std::mt19937 rng(13);
+    t_schema sch{{"i", "f", "s"}, {DTYPE_INT64, DTYPE_FLOAT64, DTYPE_STR}, {}};
+    t_table tbl(sch);
+    tbl.init();
+    // three morsels, the last one ending inside a mask word
+    t_uindex nrows = 2 * FILTER_CHUNK_SIZE + 1000;
+    tbl.extend(nrows);
+
+    const char* names[] = {"apple", "banana", "cherry", "grape"};
+    auto ints = tbl.get_column("i");
+    auto floats = tbl.get_column("f");
+    auto strs = tbl.get_column("s");
+    std::map<t_uindex, t_depth> dmap;
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        ints->set_nth<std::int64_t>(idx, std::int64_t(rng() % 100));
+        floats->set_nth<double>(idx, (int(rng() % 400) - 200) / 8.0);
+        strs->set_nth<const char*>(idx, names[rng() % 4]);
+        for (auto& col : {ints, floats, strs}) {
+            if (rng() % 16 == 0) {
+                col->set_valid(idx, false);
+            }
+        }
+        if (rng() % 3 != 0) {
+            dmap[idx] = t_depth(rng() % 3);
+        }
+    }
+
+    std::vector<t_fterm> terms{
+        t_fterm("i", FILTER_OP_LT, mktscalar<std::int64_t>(40), {}),
+        t_fterm("i", FILTER_OP_GTEQ, mktscalar<std::int64_t>(75), {}),
+        t_fterm("f", FILTER_OP_GT, mktscalar<double>(-3.5), {}),
+        t_fterm("f", FILTER_OP_IS_NOT_VALID, mknone(), {}),
+        t_fterm("s", FILTER_OP_EQ, mktscalar("cherry"), {}),
+        t_fterm("s", FILTER_OP_BEGINS_WITH, mktscalar("ap"), {}),
+    };
+    std::vector<std::vector<t_uindex>> picks{{0}, {0, 2}, {1, 4}, {3, 5}, {0, 2, 5}};
+    std::vector<std::string> cols{"i", "f", "s"};
+    t_uindex level = 1;
+
+    for (t_filter_op combiner : {FILTER_OP_AND, FILTER_OP_OR}) {
+        for (const auto& pick : picks) {
+            std::vector<t_fterm> fterms;
+            for (t_uindex tidx : pick) {
+                fterms.push_back(terms[tidx]);
+            }
+            t_config config(cols, combiner, fterms, {}, t_search_info(cols, false), {}, {});
+            t_mask filtered = tbl.filter_cpp(combiner, fterms, config);
+            t_mask having = tbl.having_cpp(combiner, fterms, config, level, dmap);
+            ASSERT_EQ(filtered.size(), nrows);
+            ASSERT_EQ(having.size(), nrows);
+
+            t_uindex filter_mismatches = 0, having_mismatches = 0, npassed = 0;
+            for (t_uindex idx = 0; idx < nrows; ++idx) {
+                bool filter_pass = combiner == FILTER_OP_AND;
+                bool having_pass = combiner == FILTER_OP_AND;
+                for (const auto& term : fterms) {
+                    t_tscalar cell = tbl.get_const_column(term.m_colname)->get_scalar(idx);
+                    bool match = term(cell);
+                    bool having_match
+                        = match && (cell.is_valid() || term.m_op == FILTER_OP_IS_EMPTY);
+                    if (combiner == FILTER_OP_AND) {
+                        filter_pass = filter_pass && match;
+                        having_pass = having_pass && having_match;
+                    } else {
+                        filter_pass = filter_pass || match;
+                        having_pass = having_pass || match;
+                    }
+                }
+                auto it = dmap.find(idx);
+                having_pass = having_pass && (it == dmap.end() ? t_depth(0) : it->second) == level;
+                filter_mismatches += filtered.get(idx) != filter_pass;
+                having_mismatches += having.get(idx) != having_pass;
+                npassed += filter_pass;
+            }
+            EXPECT_EQ(filter_mismatches, 0);
+            EXPECT_EQ(having_mismatches, 0);
+            EXPECT_EQ(filtered.count(), npassed);
+            EXPECT_GT(npassed, 0);
+        }
+    }
+}
+
+TEST(ZONE_MAP, skipped_blocks_match_full_scan)
+{
+    std::mt19937 rng(9);
+    t_schema sch{{"i", "f", "d"}, {DTYPE_INT64, DTYPE_FLOAT64, DTYPE_DATE}, {}};
+    t_table tbl(sch);
+    tbl.init();
+    t_uindex nrows = 3 * ZONE_MAP_BLOCK_SIZE + 100;
+    tbl.extend(nrows);
+
+    auto ints = tbl.get_column("i");
+    auto floats = tbl.get_column("f");
+    auto dates = tbl.get_column("d");
+    auto fill = [&](t_uindex first, t_uindex last) {
+        for (t_uindex idx = first; idx < last; ++idx) {
+            // increasing runs, so that most blocks are decided by their range
+            ints->set_nth<std::int64_t>(idx, std::int64_t(idx / 100));
+            floats->set_nth<double>(idx, double(idx % ZONE_MAP_BLOCK_SIZE) / 16.0);
+            dates->set_nth<t_date>(idx, t_date(2000 + idx / ZONE_MAP_BLOCK_SIZE, 1, 1));
+        }
+    };
+    fill(0, nrows);
+
+    std::vector<t_fterm> terms;
+    for (t_filter_op op : {FILTER_OP_EQ, FILTER_OP_NE, FILTER_OP_LT, FILTER_OP_LTEQ,
+             FILTER_OP_GT, FILTER_OP_GTEQ}) {
+        terms.emplace_back("i", op, mktscalar<std::int64_t>(50), std::vector<t_tscalar>{});
+        terms.emplace_back("i", op, mktscalar<std::int64_t>(90), std::vector<t_tscalar>{});
+        terms.emplace_back("f", op, mktscalar<double>(100.0), std::vector<t_tscalar>{});
+        terms.emplace_back("d", op, mktscalar(t_date(2001, 1, 1)), std::vector<t_tscalar>{});
+    }
+    terms.emplace_back("i", FILTER_OP_IN, mknone(),
+        std::vector<t_tscalar>{mktscalar<std::int64_t>(3), mktscalar<std::int64_t>(120)});
+    terms.emplace_back("i", FILTER_OP_NOT_IN, mknone(),
+        std::vector<t_tscalar>{mktscalar<std::int64_t>(3), mktscalar<std::int64_t>(120)});
+    terms.emplace_back("f", FILTER_OP_IS_VALID, mknone(), std::vector<t_tscalar>{});
+    terms.emplace_back("f", FILTER_OP_IS_NOT_VALID, mknone(), std::vector<t_tscalar>{});
+    terms.emplace_back("i", FILTER_OP_BETWEEN, mknone(),
+        std::vector<t_tscalar>{mktscalar<std::int64_t>(40), mktscalar<std::int64_t>(85)});
+
+    auto check = [&]() {
+        t_uindex size = tbl.size();
+        for (const auto& term : terms) {
+            const t_column* col = tbl.get_const_column(term.m_colname).get();
+            std::vector<std::uint64_t> words((size + 63) / 64);
+            term.prepare(col, DATA_FORMAT_NONE)(0, size, words.data());
+
+            std::vector<std::uint64_t> expected((size + 63) / 64);
+            for (t_uindex idx = 0; idx < size; ++idx) {
+                t_tscalar cell = col->get_scalar(idx);
+                bool match = term(cell);
+                // the IN kernels only pass valid rows
+                if (term.m_op == FILTER_OP_IN || term.m_op == FILTER_OP_NOT_IN) {
+                    match = match && cell.is_valid();
+                }
+                if (match) {
+                    expected[idx / 64] |= std::uint64_t(1) << (idx % 64);
+                }
+            }
+            EXPECT_EQ(words, expected);
+        }
+
+        // the statistics of each block describe its rows
+        std::shared_ptr<const t_zone_map> zones = ints->get_zone_map();
+        EXPECT_EQ(zones->num_zones(), (size + ZONE_MAP_BLOCK_SIZE - 1) / ZONE_MAP_BLOCK_SIZE);
+        for (t_uindex zidx = 0; zidx < zones->num_zones(); ++zidx) {
+            const t_zone& zone = zones->get_zone(zidx);
+            t_uindex first = zidx * ZONE_MAP_BLOCK_SIZE;
+            t_uindex last = std::min(first + ZONE_MAP_BLOCK_SIZE, size);
+            t_uindex nnull = 0, ncleared = 0;
+            for (t_uindex idx = first; idx < last; ++idx) {
+                t_status status = *ints->get_nth_status(idx);
+                nnull += status < STATUS_VALID;
+                ncleared += status > STATUS_VALID;
+                if (status == STATUS_VALID) {
+                    std::int64_t v = *ints->get_nth<std::int64_t>(idx);
+                    EXPECT_TRUE(zone.get_min<std::int64_t>() <= v);
+                    EXPECT_TRUE(v <= zone.get_max<std::int64_t>());
+                }
+            }
+            EXPECT_EQ(zone.m_nrows, last - first);
+            EXPECT_EQ(zone.m_nnull, nnull);
+            EXPECT_EQ(zone.m_ncleared, ncleared);
+        }
+    };
+    check();
+
+    // values moved out of the range of their block, nulls and cleared rows
+    for (int iter = 0; iter < 200; ++iter) {
+        t_uindex idx = rng() % nrows;
+        switch (rng() % 4) {
+            case 0:
+                ints->set_nth<std::int64_t>(idx, std::int64_t(rng() % 200) - 50);
+                floats->set_nth<double>(idx, rng() % 10 == 0 ? std::nan("") : double(rng() % 400));
+                break;
+            case 1:
+                ints->set_valid(idx, false);
+                floats->set_valid(idx, false);
+                break;
+            case 2:
+                ints->clear(idx);
+                floats->clear(idx);
+                dates->clear(idx);
+                break;
+            default:
+                dates->set_nth<t_date>(idx, t_date(1999 + rng() % 5, 1 + rng() % 12, 1));
+                break;
+        }
+    }
+    check();
+
+    // a block holding a single value, then rows appended past the last block
+    for (t_uindex idx = ZONE_MAP_BLOCK_SIZE; idx < 2 * ZONE_MAP_BLOCK_SIZE; ++idx) {
+        ints->set_nth<std::int64_t>(idx, 50);
+    }
+    tbl.extend(nrows + ZONE_MAP_BLOCK_SIZE);
+    fill(nrows, nrows + ZONE_MAP_BLOCK_SIZE);
+    check();
+
+    // values written through raw pointers are seen once the map is invalidated
+    std::int64_t* raw = ints->get_nth<std::int64_t>(0);
+    for (t_uindex idx = 0; idx < ZONE_MAP_BLOCK_SIZE; ++idx) {
+        raw[idx] = 500;
+    }
+    ints->invalidate_zone_map();
+    check();
+
+    // a map handed out earlier is not changed by the later updates
+    std::shared_ptr<const t_zone_map> held = ints->get_zone_map();
+    t_uindex held_zones = held->num_zones();
+    std::int64_t held_min = held->get_zone(0).get_min<std::int64_t>();
+    t_uindex size = tbl.size();
+    tbl.extend(size + ZONE_MAP_BLOCK_SIZE);
+    fill(size, size + ZONE_MAP_BLOCK_SIZE);
+    ints->set_nth<std::int64_t>(0, -1000);
+    check();
+    EXPECT_EQ(held->num_zones(), held_zones);
+    EXPECT_EQ(held->get_zone(0).get_min<std::int64_t>(), held_min);
+    EXPECT_EQ(ints->get_zone_map()->get_zone(0).get_min<std::int64_t>(), -1000);
+}
+
+TEST(SEARCH_INDEX, prefix_and_multiword_postings)
+{
+    t_schema sch{{"s"}, {DTYPE_STR}, {}};
+    t_table tbl(sch);
+    tbl.init();
+    std::vector<const char*> values{"New York", "newark", "York New", "old york",
+        "2020-01-02 meeting", "meeting on 2020-01-02", "NEW"};
+    t_uindex nrows = 2 * ZONE_MAP_BLOCK_SIZE + values.size();
+    tbl.extend(nrows);
+    auto col = tbl.get_column("s");
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        col->set_nth<const char*>(idx, values[idx % values.size()]);
+    }
+
+    // the rows of the first copy of the values
+    auto rows_of = [&](const t_sterm& st, t_searchtype type) {
+        std::vector<t_uindex> rows;
+        t_masksptr mask = col->get_search_index()->find(st, type);
+        EXPECT_TRUE(mask != nullptr);
+        for (t_uindex idx = 0; mask && idx < values.size(); ++idx) {
+            if (mask->get(idx)) {
+                rows.push_back(idx);
+            }
+        }
+        return rows;
+    };
+
+    EXPECT_EQ(rows_of(t_sterm("new"), SEARCHTYPE_EDGE), (std::vector<t_uindex>{0, 1, 2, 6}));
+    EXPECT_EQ(rows_of(t_sterm("ne yo"), SEARCHTYPE_EDGE), (std::vector<t_uindex>{0, 2}));
+    EXPECT_EQ(
+        rows_of(t_sterm("york"), SEARCHTYPE_STARTS_WITH), (std::vector<t_uindex>{0, 2, 3}));
+    EXPECT_EQ(rows_of(t_sterm("2020-01-02"), SEARCHTYPE_EQUALS), (std::vector<t_uindex>{4, 5}));
+    EXPECT_EQ(rows_of(t_sterm("boston"), SEARCHTYPE_EDGE), (std::vector<t_uindex>{}));
+    EXPECT_TRUE(col->get_search_index()->find(t_sterm("ork"), SEARCHTYPE_CONTAINS) == nullptr);
+
+    // rewritten and appended rows are indexed again
+    col->set_nth<const char*>(1, "boston");
+    tbl.extend(nrows + 1);
+    col->set_nth<const char*>(nrows, "Boston");
+    t_masksptr mask = col->get_search_index()->find(t_sterm("bos"), SEARCHTYPE_EDGE);
+    EXPECT_EQ(mask->count(), t_uindex(2));
+    EXPECT_TRUE(mask->get(1));
+    EXPECT_TRUE(mask->get(nrows));
+    EXPECT_EQ(rows_of(t_sterm("new"), SEARCHTYPE_EDGE), (std::vector<t_uindex>{0, 2, 6}));
+}
+
+TEST(SEARCH_INDEX, indexed_search_matches_full_scan)
+{
+    std::mt19937 rng(15);
+    t_schema sch{{"s", "i", "f", "d", "b"},
+        {DTYPE_STR, DTYPE_INT64, DTYPE_FLOAT64, DTYPE_DATE, DTYPE_BOOL}, {}};
+    t_table tbl(sch);
+    tbl.init();
+    t_uindex nrows = 2 * ZONE_MAP_BLOCK_SIZE + 300;
+    tbl.extend(nrows);
+
+    std::vector<std::string> values{"New York", "newark", "York New", "old york, ny", "meeting",
+        "2020-01-02 meeting", "meeting on jan 5 2021", "12 apples", "true story", "Jan"};
+    auto strings = tbl.get_column("s");
+    auto ints = tbl.get_column("i");
+    auto floats = tbl.get_column("f");
+    auto dates = tbl.get_column("d");
+    auto bools = tbl.get_column("b");
+    auto fill = [&](t_uindex first, t_uindex last) {
+        for (t_uindex idx = first; idx < last; ++idx) {
+            if (rng() % 20 == 0) {
+                strings->set_valid(idx, false);
+            } else {
+                strings->set_nth<const char*>(idx, values[rng() % values.size()].c_str());
+            }
+            ints->set_nth<std::int64_t>(idx, std::int64_t(rng() % 3000));
+            floats->set_nth<double>(idx, double(rng() % 400) / 8.0);
+            dates->set_nth<t_date>(idx, t_date(2019 + rng() % 3, 1 + rng() % 12, 1 + rng() % 5));
+            bools->set_nth<bool>(idx, rng() % 2 == 0);
+        }
+    };
+    fill(0, nrows);
+
+    std::vector<std::string> queries{"new", "ne yo", "new york", "york new", "12", "12.5", "2020",
+        "jan", "2020-01-02", "meeting 2020-01-02", "jan 5 2021", "true", "zzz", "ny,", "a-b-c",
+        "12 apples"};
+    auto check = [&]() {
+        t_uindex matched = 0;
+        for (const auto& query : queries) {
+            for (t_searchtype type : {SEARCHTYPE_EQUALS, SEARCHTYPE_EDGE, SEARCHTYPE_STARTS_WITH,
+                     SEARCHTYPE_CONTAINS}) {
+                std::vector<t_searchspec> types;
+                for (const auto& colname : sch.m_columns) {
+                    types.emplace_back(colname, type);
+                }
+                std::vector<t_sterm> sterms{t_sterm(query)};
+                t_config config{sch.m_columns, FILTER_OP_AND, {}, sterms,
+                    t_search_info(sch.m_columns, false), types, {}};
+
+                tbl.set_search_indexed(false);
+                t_mask scanned = tbl.search_cpp(types, sterms, config);
+                tbl.set_search_indexed(true);
+                t_mask indexed = tbl.search_cpp(types, sterms, config);
+                ASSERT_EQ(indexed.size(), scanned.size());
+                EXPECT_EQ(indexed.count(), scanned.count()) << query << " " << type;
+                matched += scanned.count();
+                for (t_uindex idx = 0; idx < scanned.size(); ++idx) {
+                    if (indexed.get(idx) != scanned.get(idx)) {
+                        ADD_FAILURE() << query << " " << type << " row " << idx;
+                        break;
+                    }
+                }
+            }
+        }
+        EXPECT_TRUE(matched > 0);
+    };
+    check();
+
+    // rows rewritten, cleared and appended after the indexes were built
+    for (int iter = 0; iter < 200; ++iter) {
+        t_uindex idx = rng() % nrows;
+        if (rng() % 4 == 0) {
+            strings->clear(idx);
+        } else {
+            strings->set_nth<const char*>(idx, values[rng() % values.size()].c_str());
+            ints->set_nth<std::int64_t>(idx, 12);
+        }
+    }
+    tbl.extend(nrows + 100);
+    fill(nrows, nrows + 100);
+    check();
+}
+
+TEST(SEARCH_INDEX, update_history_refreshes_index)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "s"}, {DTYPE_UINT8, DTYPE_INT64, DTYPE_STR}, {}};
+    t_gstate gstate(sch, sch);
+    gstate.init();
+    t_tscalar op = mktscalar<std::uint8_t>(OP_INSERT);
+
+    auto search = [&](const std::string& query) {
+        auto tbl = gstate.get_table();
+        std::vector<t_searchspec> types{{"s", SEARCHTYPE_EDGE}};
+        std::vector<t_sterm> sterms{t_sterm(query)};
+        t_config config{
+            {"s"}, FILTER_OP_AND, {}, sterms, t_search_info({"s"}, false), types, {}};
+        t_mask mask = tbl->search_cpp(types, sterms, config);
+        std::set<std::string> rv;
+        auto col = tbl->get_const_column("s");
+        for (t_uindex idx = 0; idx < mask.size(); ++idx) {
+            if (mask.get(idx)) {
+                rv.insert(col->get_nth<const char>(idx));
+            }
+        }
+        return rv;
+    };
+
+    t_table first(sch,
+        {{op, 0_ts, "New York"_ts}, {op, 1_ts, "york new"_ts}, {op, 2_ts, "Newark"_ts},
+            {op, 3_ts, "old york"_ts}});
+    gstate.update_history(&first);
+    EXPECT_TRUE(gstate.get_table()->is_search_indexed());
+    EXPECT_EQ(search("new yo"), (std::set<std::string>{"New York", "york new"}));
+
+    // the rows written by the update are indexed again
+    t_table second(sch,
+        {{op, 0_ts, "Boston"_ts}, {op, 3_ts, "new yorkshire"_ts},
+            {op, 4_ts, "the new york times"_ts}});
+    gstate.update_history(&second);
+    EXPECT_EQ(search("new yo"),
+        (std::set<std::string>{"york new", "new yorkshire", "the new york times"}));
+    EXPECT_EQ(search("bos"), (std::set<std::string>{"Boston"}));
+}
+
+TEST(VOCAB, trigram_candidates)
+{
+    t_vocab vocab;
+    vocab.init(false);
+    std::vector<t_uindex> ids;
+    for (const char* s : {"Apple pie", "pineapple", "grape", "APPLET", "ap"}) {
+        ids.push_back(vocab.get_interned(s));
+    }
+
+    std::vector<t_uindex> candidates;
+    EXPECT_TRUE(vocab.get_trigram_candidates("apple", candidates));
+    EXPECT_EQ(candidates, (std::vector<t_uindex>{ids[0], ids[1], ids[3]}));
+    EXPECT_TRUE(vocab.get_trigram_candidates("xyz", candidates));
+    EXPECT_TRUE(candidates.empty());
+
+    // strings interned since the last call are indexed too
+    ids.push_back(vocab.get_interned("snapple"));
+    EXPECT_TRUE(vocab.get_trigram_candidates("pple", candidates));
+    EXPECT_EQ(candidates, (std::vector<t_uindex>{ids[0], ids[1], ids[3], ids[5]}));
+
+    // past its budget the index is dropped and the callers scan the vocab
+    std::mt19937 rng(1);
+    std::string s(200, 'a');
+    for (t_uindex idx = 0; idx < 30000; ++idx) {
+        for (auto& c : s) {
+            c = 'a' + rng() % 26;
+        }
+        vocab.get_interned(s);
+    }
+    EXPECT_FALSE(vocab.get_trigram_candidates("apple", candidates));
+    EXPECT_TRUE(candidates.empty());
+    EXPECT_FALSE(vocab.get_trigram_candidates("grape", candidates));
+}
+
+TEST(VOCAB, bulk_intern_matches_get_interned)
+{
+    std::mt19937 rng(17);
+    auto random_string = [&]() {
+        std::string s;
+        for (t_uindex len = rng() % 24; len > 0; --len) {
+            s += char('a' + rng() % 4);
+        }
+        return s;
+    };
+
+    // the same strings interned one at a time and by buffer
+    t_vocab expected;
+    expected.init(false);
+    t_vocab vocab;
+    vocab.init(false);
+    for (int idx = 0; idx < 1000; ++idx) {
+        std::string s = random_string();
+        EXPECT_EQ(vocab.get_interned(s), expected.get_interned(s));
+    }
+
+    bool moved = false;
+    for (int round = 0; round < 3; ++round) {
+        // duplicates within the buffer, strings already in the vocab and
+        // enough new ones to grow the string data and the slot table
+        std::vector<std::string> strings;
+        for (int idx = 0; idx < 30000; ++idx) {
+            strings.push_back(rng() % 3 == 0 && !strings.empty() ? strings[rng() % strings.size()]
+                                                                  : random_string());
+        }
+        std::string data;
+        std::vector<std::int32_t> offsets{0};
+        for (const auto& s : strings) {
+            data += s;
+            offsets.push_back(data.size());
+        }
+
+        const char* base = vocab.unintern_c(0);
+        t_uindex nstrings = vocab.get_vlenidx();
+        std::vector<t_uindex> indices(strings.size());
+        vocab.bulk_intern(data.data(), offsets.data(), strings.size(), indices.data());
+        moved = moved || vocab.unintern_c(0) != base;
+        EXPECT_TRUE(vocab.get_vlenidx() > nstrings + 4096);
+
+        for (t_uindex idx = 0; idx < strings.size(); ++idx) {
+            EXPECT_EQ(indices[idx], expected.get_interned(strings[idx]));
+            EXPECT_EQ(std::string(vocab.unintern_c(indices[idx])), strings[idx]);
+        }
+        EXPECT_EQ(vocab.get_vlenidx(), expected.get_vlenidx());
+        EXPECT_EQ(vocab.get_vlendata()->size(), expected.get_vlendata()->size());
+
+        // the map points into the moved string data
+        for (t_uindex idx = 0; idx < vocab.get_vlenidx(); ++idx) {
+            t_uindex interned;
+            EXPECT_TRUE(vocab.string_exists(expected.unintern_c(idx), interned));
+            EXPECT_EQ(interned, idx);
+            EXPECT_EQ(vocab.get_interned(expected.unintern_c(idx)), idx);
+        }
+    }
+    EXPECT_TRUE(moved);
+    vocab.verify();
+}
+
+TEST(STRING_RANKS, match_collation_as_vocab_grows)
+{
+    std::mt19937 rng(13);
+    t_schema sch{{"s"}, {DTYPE_STR}, {}};
+    t_table tbl(sch);
+    tbl.init();
+    auto col = tbl.get_column("s");
+
+    // case variants, punctuation, spaces, control and non-ascii bytes
+    const char* alphabet[] = {"a", "A", "b", "B", "z", "0", "9", " ", "-", "_", "!", "\t",
+        "\xc3\xa9", "\xc3\x89"};
+    auto random_string = [&]() {
+        std::string s;
+        for (t_uindex len = rng() % 5; len > 0; --len) {
+            s += alphabet[rng() % 14];
+        }
+        return s;
+    };
+
+    t_uindex nrows = 0;
+    std::shared_ptr<const t_string_ranks> held;
+    t_uindex held_strings = 0;
+    for (int step = 0; step < 6; ++step) {
+        t_uindex count = 50 + rng() % 200;
+        tbl.extend(nrows + count);
+        for (t_uindex idx = nrows; idx < nrows + count; ++idx) {
+            col->set_nth<const char*>(idx, random_string().c_str());
+        }
+        nrows += count;
+
+        const t_vocab* vocab = col->get_vocab().get();
+        const t_uindex* sidx = col->get_nth<t_uindex>(0);
+        t_uindex nstrings = vocab->get_vlenidx();
+
+        std::shared_ptr<const t_string_ranks> sort_ranks = col->get_string_ranks(STRING_COLLATION_SORT);
+        std::shared_ptr<const t_string_ranks> scalar_ranks
+            = col->get_string_ranks(STRING_COLLATION_SCALAR);
+        EXPECT_EQ(sort_ranks->num_strings(), nstrings);
+        EXPECT_EQ(scalar_ranks->num_strings(), nstrings);
+        // ranks handed out before the vocab grew are left as they were
+        if (held) {
+            EXPECT_EQ(held->num_strings(), held_strings);
+        }
+        held = sort_ranks;
+        held_strings = nstrings;
+        const std::uint32_t* rank = sort_ranks->get_ranks();
+        const std::uint32_t* scalar_rank = scalar_ranks->get_ranks();
+
+        for (t_uindex x = 0; x < nstrings; ++x) {
+            EXPECT_LT(rank[x], sort_ranks->num_ranks());
+            for (t_uindex y = 0; y < nstrings; ++y) {
+                const char* a = vocab->unintern_c(x);
+                const char* b = vocab->unintern_c(y);
+                int c = psp_strcasecmp(a, b);
+                EXPECT_EQ(rank[x] < rank[y], c < 0);
+                EXPECT_EQ(rank[x] == rank[y], c == 0);
+                EXPECT_EQ(scalar_rank[x] < scalar_rank[y], mktscalar(a) < mktscalar(b));
+            }
+        }
+
+        // rows sorted on the ranks are in the order of a stable sort on the strings
+        std::vector<t_uindex> by_rank(nrows), by_string(nrows);
+        std::iota(by_rank.begin(), by_rank.end(), 0);
+        std::iota(by_string.begin(), by_string.end(), 0);
+        std::stable_sort(by_rank.begin(), by_rank.end(),
+            [&](t_uindex x, t_uindex y) { return rank[sidx[x]] < rank[sidx[y]]; });
+        std::stable_sort(by_string.begin(), by_string.end(), [&](t_uindex x, t_uindex y) {
+            return psp_strcasecmp(vocab->unintern_c(sidx[x]), vocab->unintern_c(sidx[y])) < 0;
+        });
+        EXPECT_EQ(by_rank, by_string);
+    }
+}
+
+TEST(PIVOT, hash_pivot_matches_map_pivot)
+{
+    std::mt19937 rng(17);
+    t_schema sch{{"i", "s", "f", "n"}, {DTYPE_INT64, DTYPE_STR, DTYPE_FLOAT64, DTYPE_FLOAT64}, {}};
+    t_uindex nrows = 3000;
+    const char* names[] = {"apple", "Apple", "banana", "BANANA ", "cherry", "", "date"};
+
+    // the same values, with null, error and cleared rows and -0 in `mixed` only
+    t_table mixed(sch);
+    t_table clean(sch);
+    t_uindex nnan = 0;
+    for (t_table* tbl : {&mixed, &clean}) {
+        tbl->init();
+        tbl->extend(nrows);
+    }
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        std::int64_t i = std::int64_t(rng() % 40) - 20;
+        const char* s = names[rng() % 7];
+        double f = (int(rng() % 30) - 15) / 2.0;
+        bool nan = rng() % 40 == 0;
+        nnan += nan;
+        for (t_table* tbl : {&mixed, &clean}) {
+            tbl->get_column("i")->set_nth<std::int64_t>(idx, i);
+            tbl->get_column("s")->set_nth<const char*>(idx, s);
+            tbl->get_column("f")->set_nth<double>(idx, f);
+            tbl->get_column("n")->set_nth<double>(idx, nan ? std::nan("") : f);
+        }
+        if (f == 0 && rng() % 2) {
+            mixed.get_column("f")->set_nth<double>(idx, -0.0);
+        }
+        for (const auto& colname : {"i", "s", "f"}) {
+            auto col = mixed.get_column(colname);
+            switch (rng() % 16) {
+                case 0: col->set_valid(idx, false); break;
+                case 1: col->set_error_status(idx); break;
+                case 2: col->clear(idx); break;
+                default: break;
+            }
+        }
+    }
+
+    struct t_result {
+        std::vector<t_dense_tnode> m_nodes;
+        std::vector<std::vector<t_tscalar>> m_values;
+        std::vector<t_uindex> m_leaves;
+        std::vector<bool> m_mask;
+    };
+
+    auto run = [&](const t_table& tbl, bool hashed, const std::vector<std::string>& pivots,
+                   t_sorttype sort_type, t_index limit, t_limit_type limit_type) {
+        t_config config;
+        t_mask dt_msk(nrows);
+        for (t_uindex idx = 0; idx < nrows; ++idx) {
+            dt_msk.set(idx, true);
+        }
+        t_lstore_recipe args(DEFAULT_CAPACITY);
+        t_column leaves(DTYPE_UINT64, false, args, DEFAULT_CAPACITY, DATA_FORMAT_NUMBER);
+        leaves.init();
+        leaves.extend<t_uindex>(nrows);
+        for (t_uindex idx = 0; idx < nrows; ++idx) {
+            *leaves.get_nth<t_uindex>(idx) = idx;
+        }
+
+        std::vector<t_dense_tnode> nodes(1);
+        fill_dense_tnode(&nodes[0], 0, 0, 1, 0, 0, nrows, true);
+        t_uindex nbidx = 0, neidx = 1;
+
+        t_result result;
+        for (const auto& colname : pivots) {
+            const t_column* data = tbl.get_const_column(colname).get();
+            t_column values(data->get_dtype(), true, args, DEFAULT_CAPACITY, DATA_FORMAT_NONE);
+            values.init();
+
+            t_uindex next_neidx = 0;
+            if (hashed) {
+                next_neidx = t_hash_pivot_processor()(data, &nodes, &values, &leaves, nbidx,
+                    neidx, config, dt_msk, sort_type, limit, limit_type);
+            } else if (data->get_dtype() == DTYPE_INT64) {
+                next_neidx = t_pivot_processor<DTYPE_INT64>().pivot_map(data, &nodes, &values,
+                    &leaves, nbidx, neidx, config, dt_msk, sort_type, limit, limit_type);
+            } else if (data->get_dtype() == DTYPE_STR) {
+                next_neidx = t_pivot_processor<DTYPE_STR>().pivot_map(data, &nodes, &values,
+                    &leaves, nbidx, neidx, config, dt_msk, sort_type, limit, limit_type);
+            } else {
+                next_neidx = t_pivot_processor<DTYPE_FLOAT64>().pivot_map(data, &nodes, &values,
+                    &leaves, nbidx, neidx, config, dt_msk, sort_type, limit, limit_type);
+            }
+
+            std::vector<t_tscalar> level_values;
+            for (t_uindex idx = 0, loop_end = next_neidx - neidx; idx < loop_end; ++idx) {
+                level_values.push_back(values.get_scalar(idx));
+            }
+            result.m_values.push_back(level_values);
+            nbidx = neidx;
+            neidx = next_neidx;
+        }
+
+        result.m_nodes = nodes;
+        for (t_uindex idx = 0; idx < nrows; ++idx) {
+            result.m_leaves.push_back(*leaves.get_nth<t_uindex>(idx));
+            result.m_mask.push_back(dt_msk.get(idx));
+        }
+        return result;
+    };
+
+    auto same_value = [](const t_tscalar& a, const t_tscalar& b) {
+        if (a.m_status != b.m_status || a.get_dtype() != b.get_dtype()) {
+            return false;
+        }
+        if (!a.is_valid()) {
+            return true;
+        }
+        if (a.is_str()) {
+            // either string of a child may stand for it
+            return psp_strcasecmp(a.get_char_ptr(), b.get_char_ptr()) == 0;
+        }
+        return a.to_double() == b.to_double();
+    };
+
+    // rows of a child, in row order. The map pivot does not keep the row
+    // order within a child, and fills the ranges of the rows masked out by a
+    // limit of the previous level with stale rows.
+    auto leaves_of = [](const t_result& result, const t_dense_tnode& node) {
+        std::vector<t_uindex> rval;
+        for (t_uindex idx = node.m_flidx; idx < node.m_flidx + node.m_nleaves; ++idx) {
+            if (result.m_mask[result.m_leaves[idx]]) {
+                rval.push_back(result.m_leaves[idx]);
+            }
+        }
+        std::sort(rval.begin(), rval.end());
+        rval.erase(std::unique(rval.begin(), rval.end()), rval.end());
+        return rval;
+    };
+
+    auto check = [&](const t_table& tbl, const std::vector<std::string>& pivots,
+                     t_sorttype sort_type, t_index limit, t_limit_type limit_type) {
+        t_result hashed = run(tbl, true, pivots, sort_type, limit, limit_type);
+        t_result mapped = run(tbl, false, pivots, sort_type, limit, limit_type);
+
+        EXPECT_EQ(hashed.m_mask, mapped.m_mask);
+        EXPECT_EQ(hashed.m_nodes.size(), mapped.m_nodes.size());
+        if (hashed.m_nodes.size() != mapped.m_nodes.size()) {
+            return;
+        }
+        for (t_uindex idx = 0, loop_end = hashed.m_nodes.size(); idx < loop_end; ++idx) {
+            const t_dense_tnode& a = hashed.m_nodes[idx];
+            const t_dense_tnode& b = mapped.m_nodes[idx];
+            EXPECT_EQ(a.m_idx, b.m_idx);
+            EXPECT_EQ(a.m_pidx, b.m_pidx);
+            EXPECT_EQ(a.m_fcidx, b.m_fcidx);
+            EXPECT_EQ(a.m_nchild, b.m_nchild);
+            EXPECT_EQ(a.m_flidx, b.m_flidx);
+            EXPECT_EQ(a.m_nleaves, b.m_nleaves);
+            EXPECT_EQ(leaves_of(hashed, a), leaves_of(mapped, b));
+        }
+        EXPECT_EQ(hashed.m_values.size(), mapped.m_values.size());
+        for (t_uindex level = 0; level < hashed.m_values.size(); ++level) {
+            const auto& a = hashed.m_values[level];
+            const auto& b = mapped.m_values[level];
+            EXPECT_EQ(a.size(), b.size());
+            for (t_uindex idx = 0; idx < std::min(a.size(), b.size()); ++idx) {
+                EXPECT_TRUE(same_value(a[idx], b[idx]));
+            }
+        }
+    };
+
+    std::vector<std::vector<std::string>> pivot_sets{{"i"}, {"s"}, {"f"}, {"s", "i"}, {"f", "s"}};
+    for (const auto& pivots : pivot_sets) {
+        for (t_sorttype sort_type : {SORTTYPE_ASCENDING, SORTTYPE_DESCENDING}) {
+            check(mixed, pivots, sort_type, t_index(-1), LIMIT_TYPE_ITEMS);
+            check(mixed, pivots, sort_type, 3, LIMIT_TYPE_ITEMS);
+            check(mixed, pivots, sort_type, 100, LIMIT_TYPE_ITEMS);
+            // the map pivot takes a percent of its spans, where a numeric
+            // null row is a span of its own and -0 splits the spans of 0
+            check(clean, pivots, sort_type, 25, LIMIT_TYPE_PECENT);
+        }
+    }
+
+    // NaN does not order in the map pivot, the hash pivot groups the NaN rows
+    // in one child after the numbers
+    t_result result = run(clean, true, {"n"}, SORTTYPE_ASCENDING, t_index(-1), LIMIT_TYPE_ITEMS);
+    const auto& values = result.m_values[0];
+    EXPECT_EQ(values.size(), 31);
+    EXPECT_TRUE(std::isnan(values.back().to_double()));
+    EXPECT_EQ(result.m_nodes.back().m_nleaves, nnan);
+    for (t_uindex idx = 0; idx + 1 < values.size(); ++idx) {
+        EXPECT_TRUE(values[idx].to_double() < values[idx + 1].to_double() || idx + 2 == values.size());
+    }
+}
+
+TEST(SPARSE_TREE, node_store_matches_reference)
+{
+    struct t_ref_node {
+        t_uindex m_pidx;
+        std::uint8_t m_depth;
+        t_uindex m_nstrands;
+        t_uindex m_aggidx;
+        t_tscalar m_value;
+        t_tscalar m_sort_value;
+    };
+
+    std::mt19937 rng(5);
+    const char* strings[] = {"a", "A", "b", "B", "apple", "Apple", "zebra", ""};
+    auto random_value = [&]() {
+        switch (rng() % 4) {
+            case 0: return mknone();
+            case 1: return mktscalar(strings[rng() % 8]);
+            default: return mktscalar(std::int64_t(rng() % 40));
+        }
+    };
+    // sort values tie often, the values then order the children
+    auto random_sort_value = [&]() { return rng() % 2 ? mknone() : random_value(); };
+    auto equivalent = [](const t_tscalar& a, const t_tscalar& b) { return !(a < b) && !(b < a); };
+    auto same = [](const t_tscalar& a, const t_tscalar& b) {
+        return a.get_dtype() == b.get_dtype() && a.m_status == b.m_status
+            && a.to_string() == b.to_string();
+    };
+
+    t_treenodes nodes;
+    std::map<t_uindex, t_ref_node> expected;
+
+    // children of every node, in (sort value, value) order
+    auto children = [&]() {
+        std::map<t_uindex, std::vector<t_uindex>> rval;
+        for (auto& kv : expected) {
+            if (kv.first != 0) {
+                rval[kv.second.m_pidx].push_back(kv.first);
+            }
+        }
+        for (auto& kv : rval) {
+            std::sort(kv.second.begin(), kv.second.end(), [&](t_uindex a, t_uindex b) {
+                const t_ref_node& na = expected[a];
+                const t_ref_node& nb = expected[b];
+                if (na.m_sort_value < nb.m_sort_value) {
+                    return true;
+                }
+                if (nb.m_sort_value < na.m_sort_value) {
+                    return false;
+                }
+                return na.m_value < nb.m_value;
+            });
+        }
+        return rval;
+    };
+    auto find_child = [&](t_uindex pidx, const t_tscalar& value) {
+        for (auto& kv : expected) {
+            if (kv.second.m_pidx == pidx && equivalent(kv.second.m_value, value)) {
+                return t_index(kv.first);
+            }
+        }
+        return t_index(INVALID_INDEX);
+    };
+    auto random_node = [&]() {
+        auto iter = expected.begin();
+        std::advance(iter, rng() % expected.size());
+        return iter->first;
+    };
+
+    auto check = [&]() {
+        auto kids_of = children();
+        EXPECT_EQ(nodes.size(), expected.size());
+        for (t_uindex idx = 0, loop_end = nodes.id_end() + 5; idx < loop_end; ++idx) {
+            auto iter = expected.find(idx);
+            EXPECT_EQ(nodes.contains(idx), iter != expected.end());
+            if (iter == expected.end()) {
+                continue;
+            }
+            const t_ref_node& node = iter->second;
+            EXPECT_EQ(nodes.get_pidx(idx), node.m_pidx);
+            EXPECT_EQ(nodes.get_depth(idx), node.m_depth);
+            EXPECT_EQ(nodes.get_nstrands(idx), node.m_nstrands);
+            EXPECT_EQ(nodes.get_aggidx(idx), node.m_aggidx);
+            EXPECT_TRUE(same(nodes.get_value(idx), node.m_value));
+            EXPECT_TRUE(same(nodes.get_sort_value(idx), node.m_sort_value));
+            EXPECT_EQ(nodes.find_child(node.m_pidx, node.m_value), t_index(idx));
+
+            std::vector<t_uindex> kids(nodes.children_begin(idx), nodes.children_end(idx));
+            EXPECT_EQ(kids, kids_of[idx]);
+            EXPECT_EQ(nodes.get_num_children(idx), kids.size());
+        }
+        for (int probe = 0; probe < 50; ++probe) {
+            t_uindex pidx = random_node();
+            t_tscalar value = random_value();
+            EXPECT_EQ(nodes.find_child(pidx, value), find_child(pidx, value));
+        }
+        std::vector<t_uindex> zeros;
+        for (auto& kv : expected) {
+            if (kv.second.m_nstrands == 0) {
+                zeros.push_back(kv.first);
+            }
+        }
+        EXPECT_EQ(nodes.zero_strands(), zeros);
+    };
+
+    EXPECT_TRUE(nodes.insert(t_stnode(0, root_pidx(), mknone(), 0, mknone(), 1, 0)));
+    expected[0] = {root_pidx(), 0, 1, 0, mknone(), mknone()};
+
+    for (int step = 0; step < 40000; ++step) {
+        switch (rng() % 8) {
+            case 0:
+            case 1:
+            case 2: {
+                t_uindex idx = rng() % (2 * expected.size() + 64);
+                t_uindex pidx = random_node();
+                t_ref_node node = {pidx, std::uint8_t(expected[pidx].m_depth + 1),
+                    t_uindex(rng() % 3), t_uindex(rng() % 1000), random_value(),
+                    random_sort_value()};
+                bool inserted = expected.count(idx) == 0
+                    && find_child(pidx, node.m_value) == INVALID_INDEX;
+                EXPECT_EQ(nodes.insert(t_stnode(idx, pidx, node.m_value, node.m_depth,
+                              node.m_sort_value, node.m_nstrands, node.m_aggidx)),
+                    inserted);
+                if (inserted) {
+                    expected[idx] = node;
+                }
+            } break;
+            case 3: {
+                t_uindex idx = random_node();
+                t_tscalar value = random_value();
+                t_index sibling = find_child(expected[idx].m_pidx, value);
+                if (idx != 0 && (sibling == INVALID_INDEX || sibling == t_index(idx))) {
+                    nodes.set_value(idx, value);
+                    expected[idx].m_value = value;
+                }
+            } break;
+            case 4: {
+                t_uindex idx = random_node();
+                t_tscalar sort_value = random_sort_value();
+                nodes.set_sort_value(idx, sort_value);
+                expected[idx].m_sort_value = sort_value;
+            } break;
+            case 5:
+            case 6: {
+                t_uindex idx = random_node();
+                t_uindex nstrands = rng() % 3;
+                nodes.set_nstrands(idx, nstrands);
+                expected[idx].m_nstrands = nstrands;
+            } break;
+            case 7: {
+                // the tree erases leaves with no strands
+                auto kids_of = children();
+                std::vector<t_uindex> ids;
+                for (auto idx : nodes.zero_strands()) {
+                    if (idx != 0 && kids_of[idx].empty() && rng() % 2 == 0) {
+                        ids.push_back(idx);
+                    }
+                }
+                nodes.erase(ids);
+                for (auto idx : ids) {
+                    expected.erase(idx);
+                }
+            } break;
+        }
+        if (step % 2000 == 1999) {
+            check();
+        }
+    }
+
+    nodes.clear();
+    EXPECT_EQ(nodes.size(), 0);
+    EXPECT_FALSE(nodes.contains(0));
+    EXPECT_EQ(nodes.find_child(root_pidx(), mknone()), INVALID_INDEX);
+}
+
+TEST(SYMTABLE, concurrent_intern_and_lookup)
+{
+    const int nthreads = 4;
+    const int nstrings = 40000;
+    std::vector<std::string> strings;
+    for (int idx = 0; idx < nstrings; ++idx) {
+        strings.push_back("symbol_" + std::to_string(idx) + "_" + std::string(idx % 17, 'x'));
+    }
+
+    t_symtable sym;
+    std::vector<std::vector<const char*>> seen(nthreads, std::vector<const char*>(nstrings));
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+    for (int tidx = 0; tidx < nthreads; ++tidx) {
+        threads.emplace_back([&, tidx]() {
+            std::mt19937 rng(tidx);
+            std::vector<int> order(nstrings);
+            std::iota(order.begin(), order.end(), 0);
+            std::shuffle(order.begin(), order.end(), rng);
+            for (int count = 0; count < nstrings; ++count) {
+                int idx = order[count];
+                const char* interned = sym.get_interned_cstr(strings[idx].c_str());
+                seen[tidx][idx] = interned;
+                // strings interned before, possibly while the shards grow
+                int prev = order[rng() % (count + 1)];
+                if (sym.get_interned_cstr(strings[prev].c_str()) != seen[tidx][prev]
+                    || std::strcmp(seen[tidx][prev], strings[prev].c_str()) != 0) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(sym.size(), t_uindex(nstrings));
+    for (int idx = 0; idx < nstrings; ++idx) {
+        EXPECT_EQ(std::strcmp(seen[0][idx], strings[idx].c_str()), 0);
+        for (int tidx = 1; tidx < nthreads; ++tidx) {
+            EXPECT_EQ(seen[tidx][idx], seen[0][idx]);
+        }
+    }
+}
+
+TEST(SYMTABLE, owner_scoped_tables)
+{
+    // Tables own their strings: they do not share storage and release it
+    // when destroyed, which the leak checker of the sanitizer builds verifies
+    std::string long_string(100000, 'y');
+    t_symtable outer;
+    const char* kept = outer.get_interned_cstr("kept_by_the_outer_table");
+    for (int round = 0; round < 20; ++round) {
+        t_symtable sym;
+        std::vector<const char*> interned;
+        for (int idx = 0; idx < 5000; ++idx) {
+            std::string s = "round_" + std::to_string(round) + "_" + std::to_string(idx);
+            interned.push_back(sym.get_interned_cstr(s.c_str()));
+        }
+        const char* big = sym.get_interned_cstr(long_string.c_str());
+        EXPECT_EQ(sym.size(), t_uindex(5001));
+        EXPECT_EQ(sym.get_interned_cstr(long_string.c_str()), big);
+        for (int idx = 0; idx < 5000; ++idx) {
+            std::string s = "round_" + std::to_string(round) + "_" + std::to_string(idx);
+            EXPECT_EQ(sym.get_interned_cstr(s.c_str()), interned[idx]);
+        }
+
+        const char* shared = sym.get_interned_cstr("kept_by_the_outer_table");
+        EXPECT_TRUE(shared != kept);
+        EXPECT_EQ(std::strcmp(shared, kept), 0);
+        EXPECT_EQ(sym.size(), t_uindex(5002));
+    }
+    EXPECT_EQ(outer.size(), t_uindex(1));
+    EXPECT_EQ(outer.get_interned_cstr("kept_by_the_outer_table"), kept);
+
+    t_tscalar value = outer.get_interned_tscalar(mktscalar("a string stored out of place"));
+    EXPECT_EQ(value.get_char_ptr(), outer.get_interned_cstr("a string stored out of place"));
+    EXPECT_TRUE(outer.get_interned_tscalar("abc").is_inplace());
+    EXPECT_EQ(outer.size(), t_uindex(2));
+}
+
+TEST(SYMTABLE, agg_level_names_owned_by_caller)
+{
+    t_schema sch{{"d", "h"}, {DTYPE_DATE, DTYPE_DURATION}, {}};
+    t_table tbl(sch);
+    tbl.init();
+    t_uindex nrows = 400;
+    tbl.extend(nrows);
+    auto dates = tbl.get_column("d");
+    auto durations = tbl.get_column("h");
+    durations->set_data_format_type(DATA_FORMAT_DURATION);
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        dates->set_nth<t_date>(idx, t_date(t_date::t_rawtype(40000 + idx)));
+        // hours past 10^9 make names too long to be stored in place
+        durations->set_nth<t_duration>(idx, t_duration((1000000000.0 + idx) / 24));
+    }
+
+    // the bucket names are interned in the table of the caller
+    t_symtable first;
+    t_symtable second;
+    std::vector<double> dbinning;
+    std::set<std::string> names;
+    for (t_uindex idx = 0; idx < nrows; ++idx) {
+        t_tscalar a = dates->get_unnest_scalar(idx, 0, AGG_LEVEL_DAY,
+            t_binning_info{BINNING_TYPE_NONE}, DATA_FORMAT_NONE, dbinning, first);
+        t_tscalar b = dates->get_unnest_scalar(idx, 0, AGG_LEVEL_DAY,
+            t_binning_info{BINNING_TYPE_NONE}, DATA_FORMAT_NONE, dbinning, second);
+        EXPECT_EQ(a.get_dtype(), DTYPE_STR);
+        EXPECT_TRUE(a.is_inplace());
+        EXPECT_EQ(std::strcmp(a.get_char_ptr(), b.get_char_ptr()), 0);
+
+        a = durations->get_unnest_scalar(idx, 0, AGG_LEVEL_HOUR,
+            t_binning_info{BINNING_TYPE_NONE}, DATA_FORMAT_DURATION, dbinning, first);
+        b = durations->get_unnest_scalar(idx, 0, AGG_LEVEL_HOUR,
+            t_binning_info{BINNING_TYPE_NONE}, DATA_FORMAT_DURATION, dbinning, second);
+        EXPECT_EQ(a.get_dtype(), DTYPE_STR);
+        EXPECT_FALSE(a.is_inplace());
+        EXPECT_EQ(a.to_string(), std::to_string(1000000000 + idx) + ":00");
+        EXPECT_EQ(std::strcmp(a.get_char_ptr(), b.get_char_ptr()), 0);
+        EXPECT_EQ(a.get_char_ptr(), first.get_interned_cstr(a.get_char_ptr()));
+        EXPECT_EQ(b.get_char_ptr(), second.get_interned_cstr(b.get_char_ptr()));
+        EXPECT_TRUE(a.get_char_ptr() != b.get_char_ptr());
+        names.insert(a.get_char_ptr());
+    }
+    EXPECT_EQ(names.size(), nrows);
+    EXPECT_EQ(first.size(), nrows);
+    EXPECT_EQ(second.size(), nrows);
+}
+
+TEST(CTX0, incremental_rows_match_rebuild)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "s", "x", "i"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_STR, DTYPE_FLOAT64, DTYPE_INT64}, {}};
+    std::vector<std::string> cols{"s", "x", "i"};
+    auto spec = [](t_index idx, t_sorttype type) {
+        return t_sortspec(idx, type, idx, -1, -1, LIMIT_TYPE_ITEMS);
+    };
+
+    struct t_view_config {
+        std::vector<t_sortspec> m_sortby;
+        std::vector<t_fterm> m_fterms;
+    };
+    std::vector<t_view_config> views{
+        {{spec(1, SORTTYPE_ASCENDING)}, {}},
+        {{spec(1, SORTTYPE_DESCENDING)}, {t_fterm("i", FILTER_OP_GT, mktscalar<std::int64_t>(20), {})}},
+        {{spec(1, SORTTYPE_ASCENDING_ABS), spec(0, SORTTYPE_DESCENDING)}, {}},
+        {{spec(0, SORTTYPE_ASCENDING), spec(1, SORTTYPE_DESCENDING_ABS)},
+            {t_fterm("x", FILTER_OP_LT, mktscalar<double>(2), {})}},
+        {{spec(2, SORTTYPE_DESCENDING), spec(1, SORTTYPE_ASCENDING)},
+            {t_fterm("s", FILTER_OP_NE, mktscalar("b"), {})}},
+    };
+
+    const char* strings[] = {"a", "A", "b", "B", "apple", "Apple", "zebra"};
+    for (std::size_t vidx = 0; vidx < views.size(); ++vidx) {
+        const t_view_config& view = views[vidx];
+        t_gnode_options options;
+        options.m_gnode_type = GNODE_TYPE_PKEYED;
+        options.m_port_schema = sch;
+        auto gn = t_gnode::build(options);
+
+        auto build = [&]() {
+            auto ctx = t_ctx0::build(sch,
+                t_config(cols, FILTER_OP_AND, view.m_fterms, {}, t_search_info(), {}, {}));
+            ctx->sort_by(view.m_sortby);
+            return ctx;
+        };
+        auto ctx = build();
+        gn->register_context("incremental", ctx);
+
+        std::mt19937 rng(vidx);
+        std::set<std::int64_t> live;
+        std::int64_t next_pkey = 0;
+        for (int step = 0; step < 40; ++step) {
+            // inserts, updates, nulls, NaNs and deletes of distinct pkeys
+            std::set<std::int64_t> pkeys;
+            for (int count = 1 + rng() % 15; count > 0; --count) {
+                std::int64_t pkey = rng() % (next_pkey + 4);
+                pkeys.insert(pkey < next_pkey ? pkey : next_pkey++);
+            }
+
+            t_table tbl(sch);
+            tbl.init();
+            tbl.extend(pkeys.size());
+            auto op_col = tbl.get_column("psp_op");
+            auto pkey_col = tbl.get_column("psp_pkey");
+            auto s_col = tbl.get_column("s");
+            auto x_col = tbl.get_column("x");
+            auto i_col = tbl.get_column("i");
+            t_uindex ridx = 0;
+            for (auto pkey : pkeys) {
+                bool erase = live.count(pkey) && rng() % 5 == 0;
+                op_col->set_nth<std::uint8_t>(ridx, erase ? OP_DELETE : OP_INSERT);
+                pkey_col->set_nth<std::int64_t>(ridx, pkey);
+                if (erase) {
+                    live.erase(pkey);
+                    s_col->clear(ridx);
+                    x_col->clear(ridx);
+                    i_col->clear(ridx);
+                    ++ridx;
+                    continue;
+                }
+                live.insert(pkey);
+                s_col->set_nth<const char*>(ridx, strings[rng() % 7]);
+                switch (rng() % 8) {
+                    case 0: x_col->set_nth<double>(ridx, std::numeric_limits<double>::quiet_NaN()); break;
+                    case 1: x_col->clear(ridx); break;
+                    default: x_col->set_nth<double>(ridx, (int(rng() % 41) - 20) / 4.0); break;
+                }
+                i_col->set_nth<std::int64_t>(ridx, rng() % 40);
+                if (rng() % 8 == 0) {
+                    i_col->clear(ridx);
+                }
+                ++ridx;
+            }
+            gn->_send_and_process(tbl);
+
+            // a context built on the current table, without the last index
+            gn->get_table()->set_last_index(nullptr);
+            auto rebuilt = build();
+            gn->register_context("rebuilt", rebuilt);
+
+            t_index nrows = rebuilt->get_row_count();
+            EXPECT_EQ(ctx->get_row_count(), nrows);
+            std::vector<std::pair<t_uindex, t_uindex>> cells;
+            for (t_index row = 0; row < nrows; ++row) {
+                cells.push_back({row, 0});
+            }
+            EXPECT_EQ(ctx->get_pkeys(cells), rebuilt->get_pkeys(cells));
+            gn->_unregister_context("rebuilt");
+        }
+        gn->_unregister_context("incremental");
+    }
+}
+
+TEST(SPARSE_TREE, delta_aggregates_match_rebuild)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "g", "h", "x", "n"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_STR, DTYPE_INT64, DTYPE_FLOAT64, DTYPE_INT64}, {}};
+    std::vector<t_aggspec> aggs{{"sum_x", AGGTYPE_SUM, "x"}, {"sum_n", AGGTYPE_SUM, "n"},
+        {"count_x", AGGTYPE_COUNT, "x"}, {"mean_x", AGGTYPE_MEAN, "x"},
+        {"mean_n", AGGTYPE_MEAN, "n"}};
+    std::vector<t_fterm> no_filters;
+    std::vector<t_fterm> n_filter{t_fterm("n", FILTER_OP_GT, mktscalar<std::int64_t>(10), {})};
+
+    // aggregates of the nodes showing rows, by path
+    typedef std::map<std::vector<t_tscalar>, std::vector<t_tscalar>> t_node_map;
+    std::function<void(const t_stree*, t_uindex, std::vector<t_tscalar>, t_node_map&)> collect
+        = [&](const t_stree* tree, t_uindex idx, std::vector<t_tscalar> path, t_node_map& out) {
+              if (tree->get_pkeys(idx).empty()) {
+                  return;
+              }
+              for (t_index agg = 0, naggs = aggs.size(); agg < naggs; ++agg) {
+                  out[path].push_back(tree->get_aggregate(idx, agg));
+              }
+              path.push_back(mknone());
+              for (auto child : tree->get_child_idx(idx)) {
+                  path.back() = tree->get_value(child);
+                  collect(tree, child, path, out);
+              }
+          };
+    auto same = [](const t_tscalar& a, const t_tscalar& b) {
+        if (a.is_valid() != b.is_valid()) {
+            return false;
+        }
+        return !a.is_valid() || a.to_double() == b.to_double()
+            || (std::isnan(a.to_double()) && std::isnan(b.to_double()));
+    };
+    auto compare = [&](const std::vector<t_stree*>& trees, const std::vector<t_stree*>& rebuilt) {
+        ASSERT_EQ(trees.size(), rebuilt.size());
+        for (std::size_t tidx = 0; tidx < trees.size(); ++tidx) {
+            t_node_map expected, actual;
+            collect(trees[tidx], 0, {}, actual);
+            collect(rebuilt[tidx], 0, {}, expected);
+            ASSERT_EQ(actual.size(), expected.size());
+            for (auto& kv : expected) {
+                auto iter = actual.find(kv.first);
+                ASSERT_TRUE(iter != actual.end()) << "depth " << kv.first.size();
+                for (std::size_t agg = 0; agg < kv.second.size(); ++agg) {
+                    EXPECT_TRUE(same(iter->second[agg], kv.second[agg]))
+                        << "depth " << kv.first.size() << " " << aggs[agg].name() << " "
+                        << iter->second[agg].to_double() << " " << kv.second[agg].to_double();
+                }
+            }
+        }
+    };
+
+    struct t_view_config {
+        std::vector<std::string> m_row_pivots;
+        std::vector<std::string> m_column_pivots;
+        std::vector<t_fterm> m_fterms;
+    };
+    std::vector<t_view_config> views{
+        {{"g"}, {}, no_filters},
+        {{"g", "h"}, {}, n_filter},
+        {{"g"}, {"h"}, n_filter},
+        {{"g", "h"}, {"h"}, no_filters},
+    };
+
+    const char* groups[] = {"a", "b", "c", "d", "e"};
+    for (std::size_t vidx = 0; vidx < views.size(); ++vidx) {
+        const t_view_config& view = views[vidx];
+        t_gnode_options options;
+        options.m_gnode_type = GNODE_TYPE_PKEYED;
+        options.m_port_schema = sch;
+        auto gn = t_gnode::build(options);
+
+        // the trees of a context registered under name
+        auto build = [&](const std::string& name) -> std::function<std::vector<t_stree*>()> {
+            if (view.m_column_pivots.empty()) {
+                auto ctx = t_ctx1::build(sch,
+                    t_config(view.m_row_pivots, aggs, {}, {}, FILTER_OP_AND, view.m_fterms, {}));
+                gn->register_context(name, ctx);
+                return [ctx]() { return ctx->get_trees(); };
+            }
+            auto ctx = t_ctx2::build(sch,
+                t_config(view.m_row_pivots, view.m_column_pivots, aggs, {}, {}, TOTALS_BEFORE,
+                    FILTER_OP_AND, view.m_fterms, {}));
+            gn->register_context(name, ctx);
+            return [ctx]() { return ctx->get_trees(); };
+        };
+        auto incremental = build("incremental");
+
+        std::mt19937 rng(vidx);
+        std::set<std::int64_t> live;
+        std::int64_t next_pkey = 0;
+        for (int step = 0; step < 40; ++step) {
+            // new and moved rows, deletes, and values crossing the filter;
+            // some steps have nulls, which take the recompute
+            bool nulls = step % 4 == 3;
+            std::set<std::int64_t> pkeys;
+            for (int count = 1 + rng() % 10; count > 0; --count) {
+                std::int64_t pkey = rng() % (next_pkey + 3);
+                pkeys.insert(pkey < next_pkey ? pkey : next_pkey++);
+            }
+
+            t_table tbl(sch);
+            tbl.init();
+            tbl.extend(pkeys.size());
+            auto op_col = tbl.get_column("psp_op");
+            auto pkey_col = tbl.get_column("psp_pkey");
+            auto g_col = tbl.get_column("g");
+            auto h_col = tbl.get_column("h");
+            auto x_col = tbl.get_column("x");
+            auto n_col = tbl.get_column("n");
+            t_uindex ridx = 0;
+            for (auto pkey : pkeys) {
+                bool erase = live.count(pkey) && rng() % 5 == 0;
+                op_col->set_nth<std::uint8_t>(ridx, erase ? OP_DELETE : OP_INSERT);
+                pkey_col->set_nth<std::int64_t>(ridx, pkey);
+                if (erase) {
+                    live.erase(pkey);
+                    g_col->clear(ridx);
+                    h_col->clear(ridx);
+                    x_col->clear(ridx);
+                    n_col->clear(ridx);
+                    ++ridx;
+                    continue;
+                }
+                live.insert(pkey);
+                g_col->set_nth<const char*>(ridx, groups[rng() % 5]);
+                h_col->set_nth<std::int64_t>(ridx, rng() % 3);
+                // quarters add up exactly in any order
+                x_col->set_nth<double>(ridx, (int(rng() % 401) - 200) / 4.0);
+                n_col->set_nth<std::int64_t>(ridx, rng() % 20);
+                if (nulls && rng() % 4 == 0) {
+                    x_col->clear(ridx);
+                }
+                ++ridx;
+            }
+            gn->_send_and_process(tbl);
+
+            auto rebuilt = build("rebuilt");
+            compare(incremental(), rebuilt());
+            gn->_unregister_context("rebuilt");
+        }
+        gn->_unregister_context("incremental");
+    }
+}
+
+// A pool running its thread on a pkeyed gnode with a flat context
+class PoolTest : public ::testing::Test
+{
+public:
+    PoolTest()
+        : m_schema{{"psp_op", "psp_pkey", "x"}, {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64}, {}}
+        , m_next_pkey(0)
+    {
+        t_gnode_options options;
+        options.m_gnode_type = GNODE_TYPE_PKEYED;
+        options.m_port_schema = m_schema;
+        m_gnode = t_gnode::build(options);
+        m_gnode_id = m_pool.register_gnode(m_gnode.get());
+        m_ctx = t_ctx0::build(m_schema, t_config(std::vector<std::string>{"x"}, FILTER_OP_AND,
+            {}, {}, t_search_info(), {}, {}));
+        m_gnode->register_context("ctx", m_ctx);
+        m_pool.init();
+    }
+
+    ~PoolTest()
+    {
+        m_pool.stop();
+        m_gnode->_unregister_context("ctx");
+    }
+
+    // sends nrows inserts of new pkeys
+    void
+    send(t_uindex nrows)
+    {
+        t_table tbl(m_schema);
+        tbl.init();
+        tbl.extend(nrows);
+        for (t_uindex ridx = 0; ridx < nrows; ++ridx, ++m_next_pkey) {
+            tbl.get_column("psp_op")->set_nth<std::uint8_t>(ridx, OP_INSERT);
+            tbl.get_column("psp_pkey")->set_nth<std::int64_t>(ridx, m_next_pkey);
+            tbl.get_column("x")->set_nth<std::int64_t>(ridx, m_next_pkey);
+        }
+        m_pool.send(m_gnode_id, 0, tbl);
+    }
+
+    // waits for the pool thread to have flushed nrows rows in all
+    bool
+    wait_for_rows(t_uindex nrows)
+    {
+        for (int idx = 0; idx < 60000 && m_pool.get_stats().m_nrows < nrows; ++idx) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return m_pool.get_stats().m_nrows >= nrows;
+    }
+
+protected:
+    t_schema m_schema;
+    t_pool m_pool;
+    std::shared_ptr<t_gnode> m_gnode;
+    t_uindex m_gnode_id;
+    std::shared_ptr<t_ctx0> m_ctx;
+    std::int64_t m_next_pkey;
+};
+
+TEST_F(PoolTest, flushes_on_send)
+{
+    // every send is flushed by the pool thread on its own, without waiting
+    // for another send or a polling interval
+    const t_uindex nsends = 50;
+    for (t_uindex idx = 0; idx < nsends; ++idx) {
+        send(1);
+        ASSERT_TRUE(wait_for_rows(idx + 1));
+        EXPECT_EQ(m_pool.get_stats().m_nflushes, idx + 1);
+    }
+
+    t_pool_stats stats = m_pool.get_stats();
+    EXPECT_EQ(stats.m_nflushes, nsends);
+    EXPECT_EQ(stats.m_nrows, nsends);
+    EXPECT_TRUE(stats.m_last_latency <= stats.m_max_latency);
+    EXPECT_TRUE(stats.m_max_latency <= stats.m_total_latency);
+    EXPECT_TRUE(stats.m_total_process <= stats.m_total_latency);
+    EXPECT_EQ(m_ctx->get_row_count(), nsends);
+
+    m_pool.reset_stats();
+    EXPECT_EQ(m_pool.get_stats().m_nflushes, 0);
+    EXPECT_EQ(m_pool.get_stats().m_total_latency, 0);
+}
+
+TEST_F(PoolTest, coalesces_sends)
+{
+    // pending data waits for the delay after its first send, so each
+    // flush carries one or more sends and waited at least the delay
+    const t_uindex delay = 200000;
+    m_pool.set_coalescing(0, delay);
+    for (int idx = 0; idx < 20; ++idx) {
+        send(1);
+    }
+    ASSERT_TRUE(wait_for_rows(20));
+    t_pool_stats stats = m_pool.get_stats();
+    EXPECT_TRUE(stats.m_nflushes >= 1);
+    EXPECT_TRUE(stats.m_nflushes <= 20);
+    EXPECT_EQ(stats.m_nrows, 20);
+    EXPECT_TRUE(stats.m_total_latency >= stats.m_nflushes * delay);
+    EXPECT_EQ(m_ctx->get_row_count(), 20);
+
+    // below the row threshold nothing is flushed before the delay, which
+    // is out of reach of the test, the send reaching it flushes them all
+    m_pool.reset_stats();
+    m_pool.set_coalescing(100, 3600000000);
+    for (int idx = 0; idx < 4; ++idx) {
+        send(20);
+    }
+    EXPECT_EQ(m_pool.get_stats().m_nflushes, 0);
+    EXPECT_TRUE(m_pool.get_data_remaining());
+    send(20);
+    ASSERT_TRUE(wait_for_rows(100));
+    stats = m_pool.get_stats();
+    EXPECT_EQ(stats.m_nflushes, 1);
+    EXPECT_EQ(stats.m_nrows, 100);
+    EXPECT_TRUE(stats.m_last_latency <= stats.m_total_latency);
+    EXPECT_EQ(m_ctx->get_row_count(), 120);
+}
+
+TEST_F(PoolTest, stop_flushes_pending)
+{
+    // data still waiting for the delay is flushed by stop()
+    m_pool.set_coalescing(0, 3600000000);
+    send(10);
+    EXPECT_EQ(m_pool.get_stats().m_nflushes, 0);
+    EXPECT_TRUE(m_pool.get_data_remaining());
+
+    m_pool.stop();
+    EXPECT_EQ(m_pool.get_stats().m_nflushes, 1);
+    EXPECT_EQ(m_pool.get_stats().m_nrows, 10);
+    EXPECT_FALSE(m_pool.get_data_remaining());
+    EXPECT_EQ(m_ctx->get_row_count(), 10);
+
+    // without a thread, sends are flushed by _process()
+    send(1);
+    m_pool._process();
+    EXPECT_EQ(m_pool.get_stats().m_nflushes, 2);
+    EXPECT_EQ(m_ctx->get_row_count(), 11);
+}
+
 TEST(GNODE_TEST, get_registered_contexts)
 {
     t_schema sch{{"psp_op", "psp_pkey", "s", "i"},